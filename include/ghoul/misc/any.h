@@ -33,16 +33,69 @@
 #ifndef __ANY_H__
 #define __ANY_H__
 
-#include <algorithm>
-#include <memory>
+#include <cstddef>
 #include <type_traits>
 #include <typeinfo>
 
 namespace ghoul {
-   
+
+/// The number of bytes that an !any object can store without allocating
+const size_t AnyInlineCapacity = 32;
+
+namespace internal {
+
+/**
+ * The table of functions that an !any object uses to operate on the value that is stored
+ * inside it. There is exactly one table for each type of stored value.
+ */
+struct AnyVTable {
+    /// Returns the <code>std::type_info</code> of the stored value
+    const std::type_info& (*type)() noexcept;
+    /// Copy-constructs the value in <code>source</code> into <code>target</code>. This
+    /// is <code>nullptr</code> for values that are stored inplace, as these are
+    /// trivially copyable and copied with <code>memcpy</code> instead
+    void (*copy)(void* target, const void* source);
+    /// Destroys the value that is stored in the <code>storage</code>. This is
+    /// <code>nullptr</code> for values that are stored inplace, as these are trivially
+    /// destructible
+    void (*destroy)(void* storage) noexcept;
+};
+
+/**
+ * The functions operating on a value of type \p T that is stored directly inside the
+ * storage of the !any object.
+ */
+template <typename T>
+struct AnyInplaceOperations {
+    static const std::type_info& type() noexcept;
+
+    static const AnyVTable VTable;
+};
+
+/**
+ * The functions operating on a value of type \p T that is allocated on the heap, as it
+ * is too big or not trivially copyable. Only the pointer to the value is stored in the
+ * !any object.
+ */
+template <typename T>
+struct AnyHeapOperations {
+    static const std::type_info& type() noexcept;
+    static void copy(void* target, const void* source);
+    static void destroy(void* storage) noexcept;
+
+    static const AnyVTable VTable;
+};
+
+} // namespace internal
+
 /**
  * An object of type !any is able to represent any object. When accessing the stored value
  * using !any_cast%, the correct type must be requested or an exception is thrown.
+ *
+ * Values of trivially copyable types that are at most #AnyInlineCapacity bytes large,
+ * for example scalars, glm vectors and small <code>std::array</code>s, are stored inside
+ * the !any object itself, so that creating, copying, and moving them does not allocate
+ * and copying is a plain <code>memcpy</code>. All other values are allocated on the heap.
  */
 class any {
 public:
@@ -79,7 +132,7 @@ public:
         typename std::enable_if_t<!std::is_same<any&, ValueType>::value>* = 0,
         typename std::enable_if_t<!std::is_const<ValueType>::value>* = 0);
 
-    /// Default destructor 
+    /// Destroys the stored value
     ~any() noexcept;
 
     /**
@@ -128,71 +181,47 @@ public:
     const std::type_info& type() const noexcept;
 
     /**
-     * This abstract internal class is a baseclass to !holder, which stores the contents
-     * for an !any object.
-    */
-    class placeholder {
-    public:
-        /// Default virtual destructor
-        virtual ~placeholder();
-
-        /**
-         * This method returns the std::type_info of the stored value
-         * \returns The std::type_info of the stored value
-         */
-        virtual const std::type_info& type() const noexcept = 0;
-
-        /**
-         * Creates a copy of the stored value by calling its copy constructor
-         * \return A copy of the stored value by calling its copy constructor
-         */
-        virtual placeholder* clone() const = 0;
-    };
+     * Returns whether the stored value is stored inside of this object, rather than
+     * being allocated on the heap.
+     * \return <code>true</code> if the stored value is stored inside this object
+     * \pre This !any object must not be empty
+     */
+    bool isStoredInplace() const;
 
     /**
-     * The concrete implementation of a placeholder using a specific type of value held.
-     * The <code>ValueType</code> must be copy constructable and move constructable.
+     * Returns whether a value of type \p ValueType would be stored inside the object
+     * rather than being allocated on the heap.
+     * \tparam ValueType The type of value that is tested
+     * \return <code>true</code> if a \p ValueType would be stored inside the object
      */
     template <typename ValueType>
-    class holder : public placeholder {
-    public:
-        /**
-         * Constructor that will take a copy of the \p value and stores it internally.
-         * \param value The value to be stored in the holder
-         */
-        holder(const ValueType& value);
-
-        /**
-         * Move constructor that will store the contents of \p value inside and leave the
-         * \p value in an undefined state.
-         * \param value The value that is used to initialize this holder
-         */
-        holder(ValueType&& value);
-
-        /**
-         * Returns the std::type_info struct that contains the type information for the
-         * stored value type. This call is equivalent to calling
-         * <code>typeid(ValueType)</code>.
-         * \return The std::type_info structure describing the stored value's type
-         */
-        const std::type_info& type() const noexcept override;
-
-        /**
-         * Clones the stored value by invoking the copy constructor of
-         * <code>ValueType</code>.
-         * \return A copy of the stored value
-         */
-        placeholder* clone() const override;
-
-        /// The object that is contained in this !holder
-        ValueType held;
-
-    private:
-        holder& operator=(const holder&) = delete;
-
-    };
-
-    std::unique_ptr<placeholder> content;
+    static constexpr bool fitsInplace();
+
+private:
+    template <typename ValueType>
+    friend ValueType* any_cast(any* operand);
+
+    template <typename ValueType>
+    friend const ValueType* any_cast(const any* operand);
+
+    /// The storage type that holds either the value itself or a pointer to it
+    using Storage = std::aligned_storage_t<AnyInlineCapacity, alignof(double)>;
+
+    /// Stores the \p value in this empty !any object
+    template <typename ValueType, typename V>
+    void store(V&& value);
+
+    /// Returns a pointer to the stored value
+    void* data() noexcept;
+
+    /// Returns a pointer to the stored value
+    const void* data() const noexcept;
+
+    /// The storage for the value or the pointer to the heap-allocated value
+    Storage _storage;
+
+    /// The functions operating on the stored value, or nullptr if this is empty
+    const internal::AnyVTable* _vtable;
 };
 
 /**
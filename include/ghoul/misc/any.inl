@@ -25,13 +25,69 @@
 
 #include <ghoul/misc/assert.h>
 
+#include <new>
+#include <utility>
+
 namespace ghoul {
 
+namespace internal {
+
+template <typename T>
+const std::type_info& AnyInplaceOperations<T>::type() noexcept {
+    return typeid(T);
+}
+
+template <typename T>
+const AnyVTable AnyInplaceOperations<T>::VTable = {
+    &AnyInplaceOperations<T>::type,
+    nullptr,
+    nullptr
+};
+
+template <typename T>
+const std::type_info& AnyHeapOperations<T>::type() noexcept {
+    return typeid(T);
+}
+
+template <typename T>
+void AnyHeapOperations<T>::copy(void* target, const void* source) {
+    new (target) T*(new T(**static_cast<T* const*>(source)));
+}
+
+template <typename T>
+void AnyHeapOperations<T>::destroy(void* storage) noexcept {
+    delete *static_cast<T**>(storage);
+}
+
+template <typename T>
+const AnyVTable AnyHeapOperations<T>::VTable = {
+    &AnyHeapOperations<T>::type,
+    &AnyHeapOperations<T>::copy,
+    &AnyHeapOperations<T>::destroy
+};
+
+/// Stores the \p value inside the \p storage
+template <typename T, typename V>
+const AnyVTable* storeAny(void* storage, V&& value, std::true_type) {
+    new (storage) T(std::forward<V>(value));
+    return &AnyInplaceOperations<T>::VTable;
+}
+
+/// Allocates the \p value on the heap and stores the pointer in \p storage
+template <typename T, typename V>
+const AnyVTable* storeAny(void* storage, V&& value, std::false_type) {
+    new (storage) T*(new T(std::forward<V>(value)));
+    return &AnyHeapOperations<T>::VTable;
+}
+
+} // namespace internal
+
 template<typename ValueType>
 any::any(const ValueType& value)
-    : content(new holder<typename std::remove_cv_t<typename std::decay_t<const ValueType>>
-        >(value))
-{}
+    : _vtable(nullptr)
+{
+    store<std::remove_cv_t<std::decay_t<const ValueType>>>(value);
+}
 
 template <typename ValueType>
 any::any(ValueType&& value,
@@ -39,9 +95,10 @@ any::any(ValueType&& value,
     typename std::enable_if_t<!std::is_same<any&, ValueType>::value>*, 
     // disable if value has type `const ValueType&&`
     typename std::enable_if_t<!std::is_const<ValueType>::value>*)  
-    : content(new holder<
-                typename std::decay_t<ValueType>>(static_cast<ValueType&&>(value)))
-{}
+    : _vtable(nullptr)
+{
+    store<std::decay_t<ValueType>>(static_cast<ValueType&&>(value));
+}
 
 template <typename ValueType>
 any& any::operator=(ValueType&& rhs) {
@@ -50,32 +107,34 @@ any& any::operator=(ValueType&& rhs) {
 }
 
 template <typename ValueType>
-any::holder<ValueType>::holder(const ValueType & value)
-    : held(value)
-{}
+constexpr bool any::fitsInplace() {
+    return std::is_trivially_copyable<ValueType>::value &&
+        sizeof(ValueType) <= sizeof(Storage) &&
+        alignof(ValueType) <= alignof(Storage);
+}
 
-template <typename ValueType>
-any::holder<ValueType>::holder(ValueType&& value)
-    : held(static_cast<ValueType&&>(value))
-{}
+template <typename ValueType, typename V>
+void any::store(V&& value) {
+    _vtable = internal::storeAny<ValueType>(
+        &_storage,
+        std::forward<V>(value),
+        std::integral_constant<bool, fitsInplace<ValueType>()>()
+    );
+}
 
-template <typename ValueType>
-const std::type_info& any::holder<ValueType>::type() const noexcept {
-    return typeid(ValueType);
+inline void* any::data() noexcept {
+    return _vtable->copy ? *reinterpret_cast<void**>(&_storage) : &_storage;
 }
 
-template<typename ValueType>
-any::placeholder* any::holder<ValueType>::clone() const {
-    return new holder(held);
+inline const void* any::data() const noexcept {
+    return _vtable->copy ? *reinterpret_cast<void* const*>(&_storage) : &_storage;
 }
 
 template <typename ValueType>
 ValueType* any_cast(any* operand) {
     ghoul_assert(operand, "Operand for any_cast must not be nullptr");
     if (operand->type() == typeid(ValueType)) {
-        return &static_cast<
-            any::holder<typename std::remove_cv_t<ValueType>>*
-        >(operand->content.get())->held;
+        return static_cast<ValueType*>(operand->data());
     }
     else {
         return nullptr;
@@ -86,9 +145,7 @@ template <typename ValueType>
 inline const ValueType* any_cast(const any* operand) {
     ghoul_assert(operand, "Operand for any_cast must not be nullptr");
     if (operand->type() == typeid(ValueType)) {
-        return &static_cast<
-            any::holder<typename std::remove_cv_t<ValueType>>*
-        >(operand->content.get())->held;
+        return static_cast<const ValueType*>(operand->data());
     }
     else {
         return nullptr;
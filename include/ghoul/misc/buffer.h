@@ -133,6 +133,13 @@ public:
      * \return The current size of the internal array
      */
     size_type size() const;
+
+    /**
+     * Returns the number of bytes that have been serialized but were not deserialized
+     * yet.
+     * \return The number of bytes that are left to be deserialized
+     */
+    size_type remaining() const;
     
     /**
      * Writes the current Buffer to a file. This file will be bigger than the current
@@ -150,6 +157,7 @@ public:
      * Reads the Buffer from a Buffer file. 
      * \param filename The path to the file to read
      * \throw std::ios_base::failure If there was an error reading the file
+     * \throw RuntimeError If the data of a compressed file could not be decompressed
      * \pre \p filename must not be empty
      */
     void read(const std::string& filename);
@@ -30,7 +30,9 @@ void ghoul::Buffer::serialize(const T& v) {
     static_assert(std::is_pod<T>::value, "T has to be a POD for general serialize");
     
     size_t size = sizeof(T);
-    _data.resize(_data.capacity() + size);
+    if (_offsetWrite + size > _data.size()) {
+        _data.resize(_offsetWrite + size);
+    }
     memcpy(_data.data() + _offsetWrite, &v, size);
     _offsetWrite += size;
 }
@@ -52,7 +54,9 @@ void ghoul::Buffer::serialize(const std::vector<T>& v) {
     
     size_t length = v.size();
     size_t size = sizeof(T)*length+sizeof(size_t);
-    _data.resize(_data.capacity() + size);
+    if (_offsetWrite + size > _data.size()) {
+        _data.resize(_offsetWrite + size);
+    }
     
     std::memcpy(_data.data() + _offsetWrite, &length, sizeof(size_t));
     _offsetWrite += sizeof(size_t);
@@ -70,7 +74,9 @@ void ghoul::Buffer::serialize(Iter begin, Iter end) {
     
     size_t length = std::distance(begin, end);
     size_t size = sizeof(T) * length + sizeof(size_t);
-    _data.resize(_data.capacity() + size);
+    if (_offsetWrite + size > _data.size()) {
+        _data.resize(_offsetWrite + size);
+    }
     
     std::memcpy(_data.data() + _offsetWrite, &length, sizeof(size_t));
     _offsetWrite += sizeof(size_t);
@@ -0,0 +1,137 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#ifndef __CANCELLATIONTOKEN_H__
+#define __CANCELLATIONTOKEN_H__
+
+#include <ghoul/misc/exception.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+namespace ghoul {
+
+/**
+ * A CancellationToken is used to cancel work that has been queued in a ThreadPool but is
+ * no longer needed. All copies of a token share the same state, so a token can be handed
+ * to any number of tasks and cancelling any of the copies cancels all of them. Tasks
+ * that are queued with a token are dropped without being executed if the token has been
+ * cancelled by the time a Worker would start them. A task that is already running can
+ * capture a copy of the token and poll #isCancelled to stop early.
+ *
+ * A token can optionally have a deadline, after which it counts as cancelled
+ * automatically. This way, work that becomes stale, such as prefetches for data that
+ * was needed in a previous frame, is dropped without anybody having to cancel it.
+ * Example:
+ *\verbatim
+ghoul::CancellationToken token(std::chrono::milliseconds(100));
+pool.post(ThreadPool::Priority::Background, token, [token]() {
+    for (const Tile& tile : tiles) {
+        if (token.isCancelled()) {
+            return;
+        }
+        prefetch(tile);
+    }
+});
+\endverbatim
+ */
+class CancellationToken {
+public:
+    /// The clock that is used for the deadlines
+    using Clock = std::chrono::steady_clock;
+
+    /// The exception that is thrown by #throwIfCancelled
+    struct CancelledError : public RuntimeError {
+        CancelledError();
+    };
+
+    /**
+     * Creates a new token that is not cancelled and does not have a deadline.
+     */
+    CancellationToken();
+
+    /**
+     * Creates a new token that is cancelled automatically at the \p deadline.
+     * \param deadline The point in time after which the token counts as cancelled
+     */
+    explicit CancellationToken(Clock::time_point deadline);
+
+    /**
+     * Creates a new token that is cancelled automatically after the \p timeout has
+     * passed, starting from now.
+     * \param timeout The duration after which the token counts as cancelled
+     */
+    explicit CancellationToken(Clock::duration timeout);
+
+    /**
+     * Cancels this token and all of its copies. Cancelling a token more than once has no
+     * additional effect.
+     */
+    void cancel();
+
+    /**
+     * Returns whether this token has been cancelled or its deadline has passed. Checking
+     * a token without a deadline only costs a single atomic load.
+     * \return <code>true</code> if this token has been cancelled
+     */
+    bool isCancelled() const;
+
+    /**
+     * Throws a CancelledError if this token has been cancelled or its deadline has
+     * passed. This can be used to leave a deeply nested computation inside a task.
+     * \throw CancelledError If the token has been cancelled
+     */
+    void throwIfCancelled() const;
+
+    /**
+     * Returns whether this token has a deadline.
+     * \return <code>true</code> if this token has a deadline
+     */
+    bool hasDeadline() const;
+
+    /**
+     * Returns the deadline of this token.
+     * \return The deadline of this token
+     * \pre This token must have a deadline
+     */
+    Clock::time_point deadline() const;
+
+private:
+    /// The state that is shared between all copies of a token
+    struct State {
+        State(bool withDeadline, Clock::time_point time);
+
+        std::atomic_bool isCancelled;
+        const bool hasDeadline;
+        const Clock::time_point deadline;
+    };
+
+    std::shared_ptr<State> _state;
+};
+
+} // namespace ghoul
+
+#endif // __CANCELLATIONTOKEN_H__
@@ -0,0 +1,340 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#ifndef __CONTINUATION_H__
+#define __CONTINUATION_H__
+
+#include <ghoul/misc/inplacefunction.h>
+#include <ghoul/misc/threadpool.h>
+
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace ghoul {
+
+template <typename T>
+class Continuable;
+
+namespace internal {
+
+/**
+ * The shared state between a Continuable and the task that produces its result. The
+ * state stores the result (or the exception) of the task and the list of callbacks that
+ * are invoked once the result is available. The callbacks are invoked on the thread that
+ * finishes the state, or immediately on the calling thread if a callback is added after
+ * the state has been finished.
+ * \tparam T The type of the result that is stored in this state
+ */
+template <typename T>
+class ContinuationState {
+public:
+    /**
+     * Creates a new unfinished state whose continuations will be queued in the \p pool.
+     * \param pool The ThreadPool that will execute continuations of this state
+     */
+    explicit ContinuationState(ThreadPool& pool);
+
+    /**
+     * Returns the ThreadPool that executes the continuations of this state.
+     * \return The ThreadPool that executes the continuations of this state
+     */
+    ThreadPool& pool() const;
+
+    /**
+     * Returns the <code>std::shared_future</code> that will hold the result.
+     * \return The <code>std::shared_future</code> that will hold the result
+     */
+    const std::shared_future<T>& future() const;
+
+    /**
+     * Returns whether a result or an exception has been stored in this state.
+     * \return <code>true</code> if this state has been finished
+     */
+    bool isFinished() const;
+
+    /**
+     * Calls the \p function and stores its return value, or the exception it threw, as
+     * the result of this state. Afterwards, all registered callbacks are invoked.
+     * \param function The function that produces the result
+     * \pre This state must not have been finished before
+     */
+    template <typename Function>
+    void run(Function&& function);
+
+    /**
+     * Stores the \p exception as the result of this state and invokes all registered
+     * callbacks.
+     * \param exception The exception that is stored
+     * \pre This state must not have been finished before
+     */
+    void setException(std::exception_ptr exception);
+
+    /**
+     * Registers the \p callback that is invoked once this state is finished. If the state
+     * has already been finished, the \p callback is invoked immediately.
+     * \param callback The callback that is invoked once this state is finished. It is
+     *        invoked exactly once and can be move-only
+     */
+    void addCallback(InplaceFunction<void()> callback);
+
+private:
+    /// Marks the state as finished and invokes all registered callbacks
+    void finish();
+
+    ThreadPool& _pool;
+    std::promise<T> _promise;
+    std::shared_future<T> _future;
+
+    bool _isFinished;
+    std::vector<InplaceFunction<void()>> _callbacks;
+    mutable std::mutex _mutex;
+};
+
+/**
+ * This guard belongs to a task that was queued to produce the result of a
+ * ContinuationState. If the task is destroyed without being executed, for example
+ * because the ThreadPool was stopped without running the remaining tasks, the guard
+ * stores a <code>std::future_errc::broken_promise</code> error in the state, so that
+ * waiting threads and continuations are not blocked forever.
+ * \tparam T The type of the result of the guarded state
+ */
+template <typename T>
+struct BrokenPromiseGuard {
+    explicit BrokenPromiseGuard(std::shared_ptr<ContinuationState<T>> s);
+    BrokenPromiseGuard(BrokenPromiseGuard&&) = default;
+    ~BrokenPromiseGuard();
+
+    std::shared_ptr<ContinuationState<T>> state;
+};
+
+/// Provides access to the shared state of Continuable%s for the free functions
+struct ContinuableAccess {
+    template <typename T>
+    static const std::shared_ptr<ContinuationState<T>>& state(const Continuable<T>& c);
+
+    template <typename T>
+    static Continuable<T> create(std::shared_ptr<ContinuationState<T>> state);
+};
+
+/// Whether a task is queued regardless of the capacity of its ThreadPool, which is the
+/// case for continuations, as they continue work that has already been queued
+using BypassCapacity = ghoul::Boolean;
+
+/**
+ * Determines the type of the result of a continuation \p Function that is attached to a
+ * Continuable<T>. The \p Function is called with the result of the predecessor, or
+ * without any arguments if the predecessor does not have a result.
+ */
+template <typename T, typename Function>
+struct ContinuationResult {
+    using type = decltype(std::declval<Function>()(std::declval<const T&>()));
+};
+
+template <typename Function>
+struct ContinuationResult<void, Function> {
+    using type = decltype(std::declval<Function>()());
+};
+
+} // namespace internal
+
+/**
+ * A Continuable is a handle to the result of a task that is executed by a ThreadPool.
+ * In contrast to a plain <code>std::future</code>, further tasks can be attached to a
+ * Continuable using the #then method, which are queued in the ThreadPool only after the
+ * result is available. This way, chains of dependent tasks can be expressed without
+ * blocking a Worker of the ThreadPool on a <code>std::future::get</code> call, which
+ * wastes the Worker and can lead to deadlocks if the ThreadPool is small. Example:
+ *\verbatim
+ghoul::Continuable<Image> image = ghoul::submit(pool, [file]() { return decode(file); });
+image.then([](const Image& img) { return convert(img); })
+     .then([](const Image& img) { return compress(img); })
+     .then([file](const Buffer& buffer) { writeCache(file, buffer); });
+\endverbatim
+ * If a task throws an exception, the exception is stored in its Continuable and all
+ * continuations are skipped, passing the exception on to their own Continuable%s. A
+ * Continuable can be copied and a single Continuable can have any number of
+ * continuations. The ThreadPool that executes the tasks has to outlive all Continuable%s
+ * that were created with it.
+ * \tparam T The type of the result of the task
+ */
+template <typename T>
+class Continuable {
+public:
+    /// Creates an invalid Continuable that is not associated with a task
+    Continuable() = default;
+
+    /**
+     * Returns whether this Continuable is associated with a task.
+     * \return <code>true</code> if this Continuable is associated with a task
+     */
+    bool isValid() const;
+
+    /**
+     * Returns whether the result of the task is available.
+     * \return <code>true</code> if the result of the task is available
+     * \pre This Continuable must be valid
+     */
+    bool isReady() const;
+
+    /**
+     * Blocks until the result of the task is available. This function must not be called
+     * from within a task of the same ThreadPool, as it blocks the Worker.
+     * \pre This Continuable must be valid
+     */
+    void wait() const;
+
+    /**
+     * Blocks until the result of the task is available and returns it. This function
+     * must not be called from within a task of the same ThreadPool, as it blocks the
+     * Worker.
+     * \return The result of the task
+     * \throw Rethrows the exception that was thrown by the task or one of its
+     * predecessors
+     * \pre This Continuable must be valid
+     */
+    auto get() const -> decltype(std::declval<std::shared_future<T>>().get());
+
+    /**
+     * Returns a <code>std::shared_future</code> that holds the result of the task.
+     * \return A <code>std::shared_future</code> that holds the result of the task
+     * \pre This Continuable must be valid
+     */
+    std::shared_future<T> future() const;
+
+    /**
+     * Attaches the \p function as a continuation to this Continuable. The \p function is
+     * queued with ThreadPool::Priority::Normal in the ThreadPool as soon as the result of
+     * this Continuable is available and is called with the result as its only argument,
+     * or without arguments if <code>T</code> is <code>void</code>. If the task of this
+     * Continuable threw an exception, the \p function is not called and the exception is
+     * passed on to the returned Continuable.
+     * \tparam Function The type of the continuation function
+     * \param function The continuation function
+     * \return The Continuable that holds the result of the \p function
+     * \pre This Continuable must be valid
+     */
+    template <typename Function>
+    auto then(Function&& function)
+        -> Continuable<typename internal::ContinuationResult<T, Function>::type>;
+
+    /**
+     * Attaches the \p function as a continuation to this Continuable that is queued with
+     * the provided \p priority. Apart from the priority, this function behaves like the
+     * #then function without a priority.
+     * \tparam Function The type of the continuation function
+     * \param priority The Priority with which the continuation is queued
+     * \param function The continuation function
+     * \return The Continuable that holds the result of the \p function
+     * \pre This Continuable must be valid
+     */
+    template <typename Function>
+    auto then(ThreadPool::Priority priority, Function&& function)
+        -> Continuable<typename internal::ContinuationResult<T, Function>::type>;
+
+private:
+    friend struct internal::ContinuableAccess;
+
+    explicit Continuable(std::shared_ptr<internal::ContinuationState<T>> state);
+
+    std::shared_ptr<internal::ContinuationState<T>> _state;
+};
+
+/**
+ * Queues the \p function with the provided \p priority in the \p pool and returns a
+ * Continuable for its result, to which further tasks can be attached.
+ * \tparam Function The type of the function that is executed
+ * \param pool The ThreadPool that executes the \p function
+ * \param priority The Priority with which the \p function is queued
+ * \param function The function that is executed. It is called without arguments
+ * \return A Continuable that holds the result of the \p function
+ */
+template <typename Function>
+auto submit(ThreadPool& pool, ThreadPool::Priority priority, Function&& function)
+    -> Continuable<decltype(function())>;
+
+/**
+ * Queues the \p function with ThreadPool::Priority::Normal in the \p pool and returns a
+ * Continuable for its result, to which further tasks can be attached.
+ * \tparam Function The type of the function that is executed
+ * \param pool The ThreadPool that executes the \p function
+ * \param function The function that is executed. It is called without arguments
+ * \return A Continuable that holds the result of the \p function
+ */
+template <typename Function>
+auto submit(ThreadPool& pool, Function&& function)
+    -> Continuable<decltype(function())>;
+
+/**
+ * Returns a Continuable that becomes ready once all of the \p tasks are finished. Its
+ * result contains the results of the \p tasks in the same order. No Worker is blocked
+ * while waiting; the combined result is assembled on the thread that finishes the last
+ * of the \p tasks. If any of the \p tasks threw an exception, the first exception (in
+ * the order of the \p tasks) is stored in the returned Continuable instead. Continuations
+ * of the returned Continuable are queued in the ThreadPool of the first task.
+ * \tparam T The type of the results of the \p tasks
+ * \param tasks The tasks that are waited for
+ * \return A Continuable holding the results of all \p tasks
+ * \pre \p tasks must not be empty
+ * \pre All \p tasks must be valid
+ */
+template <typename T>
+Continuable<std::vector<T>> whenAll(const std::vector<Continuable<T>>& tasks);
+
+/**
+ * Returns a Continuable that becomes ready once all of the \p tasks are finished. If any
+ * of the \p tasks threw an exception, the first exception (in the order of the \p tasks)
+ * is stored in the returned Continuable. Continuations of the returned Continuable are
+ * queued in the ThreadPool of the first task.
+ * \param tasks The tasks that are waited for
+ * \return A Continuable that becomes ready once all \p tasks are finished
+ * \pre \p tasks must not be empty
+ * \pre All \p tasks must be valid
+ */
+Continuable<void> whenAll(const std::vector<Continuable<void>>& tasks);
+
+/**
+ * Returns a Continuable that becomes ready as soon as any of the \p tasks is finished.
+ * Its result is the index of the first task that finished, either with a result or with
+ * an exception. Continuations of the returned Continuable are queued in the ThreadPool of
+ * the first task.
+ * \tparam T The type of the results of the \p tasks
+ * \param tasks The tasks that are waited for
+ * \return A Continuable holding the index of the first finished task
+ * \pre \p tasks must not be empty
+ * \pre All \p tasks must be valid
+ */
+template <typename T>
+Continuable<size_t> whenAny(const std::vector<Continuable<T>>& tasks);
+
+} // namespace ghoul
+
+#include "continuation.inl"
+
+#endif // __CONTINUATION_H__
@@ -0,0 +1,397 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include <ghoul/misc/assert.h>
+
+#include <atomic>
+#include <chrono>
+
+namespace ghoul {
+
+namespace internal {
+
+/**
+ * Calls the \p function and stores its return value in the \p promise. This overload
+ * handles functions returning a value.
+ */
+template <typename T, typename Function>
+void fulfillPromise(std::promise<T>& promise, Function& function) {
+    promise.set_value(function());
+}
+
+/**
+ * Calls the \p function and fulfills the \p promise. This overload handles functions
+ * without a return value.
+ */
+template <typename Function>
+void fulfillPromise(std::promise<void>& promise, Function& function) {
+    function();
+    promise.set_value();
+}
+
+/// Calls the continuation \p function with the result stored in the \p future
+template <typename T, typename Function>
+auto invokeContinuation(Function& function, const std::shared_future<T>& future)
+    -> typename ContinuationResult<T, Function>::type
+{
+    return function(future.get());
+}
+
+/// Calls the continuation \p function after checking the \p future for an exception
+template <typename Function>
+auto invokeContinuation(Function& function, const std::shared_future<void>& future)
+    -> typename ContinuationResult<void, Function>::type
+{
+    future.get();
+    return function();
+}
+
+template <typename T>
+ContinuationState<T>::ContinuationState(ThreadPool& pool)
+    : _pool(pool)
+    , _future(_promise.get_future().share())
+    , _isFinished(false)
+{}
+
+template <typename T>
+ThreadPool& ContinuationState<T>::pool() const {
+    return _pool;
+}
+
+template <typename T>
+const std::shared_future<T>& ContinuationState<T>::future() const {
+    return _future;
+}
+
+template <typename T>
+bool ContinuationState<T>::isFinished() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _isFinished;
+}
+
+template <typename T>
+template <typename Function>
+void ContinuationState<T>::run(Function&& function) {
+    ghoul_assert(!isFinished(), "State must not have been finished");
+
+    try {
+        fulfillPromise(_promise, function);
+    }
+    catch (...) {
+        _promise.set_exception(std::current_exception());
+    }
+    finish();
+}
+
+template <typename T>
+void ContinuationState<T>::setException(std::exception_ptr exception) {
+    ghoul_assert(!isFinished(), "State must not have been finished");
+
+    _promise.set_exception(std::move(exception));
+    finish();
+}
+
+template <typename T>
+void ContinuationState<T>::addCallback(InplaceFunction<void()> callback) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_isFinished) {
+            _callbacks.push_back(std::move(callback));
+            return;
+        }
+    }
+    // The result is already available, so nobody will call the callback for us
+    callback();
+}
+
+template <typename T>
+void ContinuationState<T>::finish() {
+    std::vector<InplaceFunction<void()>> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _isFinished = true;
+        callbacks.swap(_callbacks);
+    }
+    // The callbacks are invoked outside of the lock as they might add callbacks to this
+    // state themselves
+    for (InplaceFunction<void()>& c : callbacks) {
+        c();
+    }
+}
+
+template <typename T>
+BrokenPromiseGuard<T>::BrokenPromiseGuard(std::shared_ptr<ContinuationState<T>> s)
+    : state(std::move(s))
+{}
+
+template <typename T>
+BrokenPromiseGuard<T>::~BrokenPromiseGuard() {
+    // If the task owning this guard has been executed, the state has been finished. As
+    // the guard is only destroyed after the task is destroyed, there is no race here. A
+    // guard that has been moved from does not have a state anymore
+    if (state && !state->isFinished()) {
+        state->setException(
+            std::make_exception_ptr(std::future_error(std::future_errc::broken_promise))
+        );
+    }
+}
+
+template <typename T>
+const std::shared_ptr<ContinuationState<T>>& ContinuableAccess::state(
+                                                                const Continuable<T>& c)
+{
+    return c._state;
+}
+
+template <typename T>
+Continuable<T> ContinuableAccess::create(std::shared_ptr<ContinuationState<T>> state) {
+    return Continuable<T>(std::move(state));
+}
+
+/**
+ * Queues a task in the ThreadPool of the \p state with the provided \p priority that
+ * stores the result of the \p function in the \p state. Unless \p bypassCapacity is
+ * set, the task is subject to the capacity of the ThreadPool.
+ */
+template <typename T, typename Function>
+void queueForState(const std::shared_ptr<ContinuationState<T>>& state,
+                   ThreadPool::Priority priority, Function function,
+                   BypassCapacity bypassCapacity)
+{
+    BrokenPromiseGuard<T> guard(state);
+    auto task = [guard = std::move(guard), function = std::move(function)]() mutable {
+        guard.state->run(function);
+    };
+    if (bypassCapacity) {
+        ThreadPoolAccess::postBypassingCapacity(state->pool(), priority, std::move(task));
+    }
+    else {
+        state->pool().post(priority, std::move(task));
+    }
+}
+
+} // namespace internal
+
+template <typename T>
+Continuable<T>::Continuable(std::shared_ptr<internal::ContinuationState<T>> state)
+    : _state(std::move(state))
+{}
+
+template <typename T>
+bool Continuable<T>::isValid() const {
+    return _state != nullptr;
+}
+
+template <typename T>
+bool Continuable<T>::isReady() const {
+    ghoul_assert(isValid(), "Continuable must be valid");
+
+    // The result is available in the future before the state is marked as finished
+    return _state->future().wait_for(std::chrono::seconds(0)) ==
+        std::future_status::ready;
+}
+
+template <typename T>
+void Continuable<T>::wait() const {
+    ghoul_assert(isValid(), "Continuable must be valid");
+
+    _state->future().wait();
+}
+
+template <typename T>
+auto Continuable<T>::get() const -> decltype(std::declval<std::shared_future<T>>().get())
+{
+    ghoul_assert(isValid(), "Continuable must be valid");
+
+    return _state->future().get();
+}
+
+template <typename T>
+std::shared_future<T> Continuable<T>::future() const {
+    ghoul_assert(isValid(), "Continuable must be valid");
+
+    return _state->future();
+}
+
+template <typename T>
+template <typename Function>
+auto Continuable<T>::then(Function&& function)
+    -> Continuable<typename internal::ContinuationResult<T, Function>::type>
+{
+    return then(ThreadPool::Priority::Normal, std::forward<Function>(function));
+}
+
+template <typename T>
+template <typename Function>
+auto Continuable<T>::then(ThreadPool::Priority priority, Function&& function)
+    -> Continuable<typename internal::ContinuationResult<T, Function>::type>
+{
+    ghoul_assert(isValid(), "Continuable must be valid");
+
+    using R = typename internal::ContinuationResult<T, Function>::type;
+    using F = typename std::decay<Function>::type;
+
+    auto next = std::make_shared<internal::ContinuationState<R>>(_state->pool());
+
+    // We only capture the future of our state, rather than the state itself, as the
+    // callback is stored inside our state and would otherwise keep it alive forever
+    std::shared_future<T> future = _state->future();
+    // The callback is invoked only once, so it can pass the function on to the task
+    _state->addCallback(
+        [next, priority, future, f = F(std::forward<Function>(function))]() mutable {
+            internal::queueForState(
+                next,
+                priority,
+                [future, f = std::move(f)]() mutable {
+                    return internal::invokeContinuation(f, future);
+                },
+                internal::BypassCapacity::Yes
+            );
+        }
+    );
+
+    return internal::ContinuableAccess::create(std::move(next));
+}
+
+template <typename Function>
+auto submit(ThreadPool& pool, ThreadPool::Priority priority, Function&& function)
+    -> Continuable<decltype(function())>
+{
+    using R = decltype(function());
+
+    auto state = std::make_shared<internal::ContinuationState<R>>(pool);
+    internal::queueForState(
+        state,
+        priority,
+        typename std::decay<Function>::type(std::forward<Function>(function)),
+        internal::BypassCapacity::No
+    );
+    return internal::ContinuableAccess::create(std::move(state));
+}
+
+template <typename Function>
+auto submit(ThreadPool& pool, Function&& function) -> Continuable<decltype(function())>
+{
+    return submit(pool, ThreadPool::Priority::Normal, std::forward<Function>(function));
+}
+
+template <typename T>
+Continuable<std::vector<T>> whenAll(const std::vector<Continuable<T>>& tasks) {
+    using internal::ContinuableAccess;
+    ghoul_assert(!tasks.empty(), "Tasks must not be empty");
+
+    std::vector<std::shared_future<T>> futures;
+    futures.reserve(tasks.size());
+    for (const Continuable<T>& t : tasks) {
+        ghoul_assert(t.isValid(), "All tasks must be valid");
+        futures.push_back(t.future());
+    }
+
+    auto state = std::make_shared<internal::ContinuationState<std::vector<T>>>(
+        ContinuableAccess::state(tasks.front())->pool()
+    );
+    auto remaining = std::make_shared<std::atomic_size_t>(tasks.size());
+    auto sharedFutures = std::make_shared<const std::vector<std::shared_future<T>>>(
+        std::move(futures)
+    );
+
+    for (const Continuable<T>& t : tasks) {
+        ContinuableAccess::state(t)->addCallback([state, remaining, sharedFutures]() {
+            if (--(*remaining) == 0) {
+                // We are the last task to finish, so we assemble the result. Any
+                // exception thrown by 'get' is stored in the state by 'run'
+                state->run([&sharedFutures]() {
+                    std::vector<T> result;
+                    result.reserve(sharedFutures->size());
+                    for (const std::shared_future<T>& f : *sharedFutures) {
+                        result.push_back(f.get());
+                    }
+                    return result;
+                });
+            }
+        });
+    }
+
+    return ContinuableAccess::create(std::move(state));
+}
+
+inline Continuable<void> whenAll(const std::vector<Continuable<void>>& tasks) {
+    using internal::ContinuableAccess;
+    ghoul_assert(!tasks.empty(), "Tasks must not be empty");
+
+    std::vector<std::shared_future<void>> futures;
+    futures.reserve(tasks.size());
+    for (const Continuable<void>& t : tasks) {
+        ghoul_assert(t.isValid(), "All tasks must be valid");
+        futures.push_back(t.future());
+    }
+
+    auto state = std::make_shared<internal::ContinuationState<void>>(
+        ContinuableAccess::state(tasks.front())->pool()
+    );
+    auto remaining = std::make_shared<std::atomic_size_t>(tasks.size());
+    auto sharedFutures = std::make_shared<const std::vector<std::shared_future<void>>>(
+        std::move(futures)
+    );
+
+    for (const Continuable<void>& t : tasks) {
+        ContinuableAccess::state(t)->addCallback([state, remaining, sharedFutures]() {
+            if (--(*remaining) == 0) {
+                state->run([&sharedFutures]() {
+                    for (const std::shared_future<void>& f : *sharedFutures) {
+                        f.get();
+                    }
+                });
+            }
+        });
+    }
+
+    return ContinuableAccess::create(std::move(state));
+}
+
+template <typename T>
+Continuable<size_t> whenAny(const std::vector<Continuable<T>>& tasks) {
+    using internal::ContinuableAccess;
+    ghoul_assert(!tasks.empty(), "Tasks must not be empty");
+
+    auto state = std::make_shared<internal::ContinuationState<size_t>>(
+        ContinuableAccess::state(tasks.front())->pool()
+    );
+    auto isDecided = std::make_shared<std::atomic_bool>(false);
+
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        ghoul_assert(tasks[i].isValid(), "All tasks must be valid");
+        ContinuableAccess::state(tasks[i])->addCallback([state, isDecided, i]() {
+            // Only the first task to finish gets to set the result
+            if (!isDecided->exchange(true)) {
+                state->run([i]() { return i; });
+            }
+        });
+    }
+
+    return ContinuableAccess::create(std::move(state));
+}
+
+} // namespace ghoul
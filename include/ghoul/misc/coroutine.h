@@ -0,0 +1,275 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#ifndef __COROUTINE_H__
+#define __COROUTINE_H__
+
+#include <ghoul/misc/continuation.h>
+#include <ghoul/misc/threadpool.h>
+
+// The coroutine support requires C++20 and is only available if the compiler implements
+// coroutines. All other parts of Ghoul are unaffected by this
+#ifdef __cpp_impl_coroutine
+
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace ghoul {
+
+template <typename T = void>
+class Task;
+
+namespace internal {
+
+/**
+ * The part of the promise type of a Task that does not depend on the type of its result.
+ * A Task is started lazily when it is awaited and, once it has finished, it resumes the
+ * awaiting coroutine directly through symmetric transfer, so that long chains of Task%s
+ * do not grow the stack.
+ */
+class TaskPromiseBase {
+public:
+    /// Resumes the continuation of the Task after its coroutine has finished
+    struct FinalAwaiter {
+        bool await_ready() const noexcept;
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(
+            std::coroutine_handle<Promise> handle) noexcept;
+
+        void await_resume() const noexcept;
+    };
+
+    std::suspend_always initial_suspend() const noexcept;
+    FinalAwaiter final_suspend() const noexcept;
+    void unhandled_exception() noexcept;
+
+    /// Sets the coroutine that is resumed once this Task has finished
+    void setContinuation(std::coroutine_handle<> continuation);
+
+protected:
+    std::coroutine_handle<> _continuation;
+    std::exception_ptr _exception;
+};
+
+/// The promise type of Task%s that produce a value of type <code>T</code>
+template <typename T>
+class TaskPromise : public TaskPromiseBase {
+public:
+    Task<T> get_return_object();
+
+    template <typename U>
+    void return_value(U&& value);
+
+    /**
+     * Returns the result of the finished coroutine or rethrows the exception that
+     * escaped it.
+     */
+    T result();
+
+private:
+    std::optional<T> _value;
+};
+
+/// The promise type of Task%s that do not produce a value
+template <>
+class TaskPromise<void> : public TaskPromiseBase {
+public:
+    Task<void> get_return_object();
+    void return_void() const noexcept;
+
+    /// Rethrows the exception that escaped the finished coroutine, if there is one
+    void result();
+};
+
+/**
+ * The coroutine type that is used by #spawn to drive a Task. It starts immediately,
+ * cannot be awaited, and destroys itself once it has finished.
+ */
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() const noexcept;
+        std::suspend_never initial_suspend() const noexcept;
+        std::suspend_never final_suspend() const noexcept;
+        void return_void() const noexcept;
+        void unhandled_exception() const noexcept;
+    };
+};
+
+/**
+ * The awaitable object for a Continuable. If the result of the Continuable is not
+ * available yet, the awaiting coroutine is suspended and is resumed by a task in the
+ * ThreadPool of the Continuable once the result is available. No thread is blocked in
+ * the meantime.
+ * \tparam T The type of the result of the Continuable
+ */
+template <typename T>
+class ContinuableAwaiter {
+public:
+    explicit ContinuableAwaiter(Continuable<T> continuable);
+
+    bool await_ready() const;
+    void await_suspend(std::coroutine_handle<> handle);
+    T await_resume();
+
+private:
+    Continuable<T> _continuable;
+    ThreadPool::ScheduleAwaiter _schedule;
+};
+
+} // namespace internal
+
+/**
+ * A Task is the return type of a coroutine that produces a value of type <code>T</code>
+ * asynchronously. The coroutine is started lazily when the Task is awaited with
+ * <code>co_await</code> by another coroutine, or when it is passed to #spawn. A
+ * coroutine can move itself onto a ThreadPool with <code>co_await
+ * pool.schedule()</code> and can await Continuable%s, so that it never blocks a Worker
+ * while waiting. Example:
+ *\verbatim
+ghoul::Task<Image> loadImage(ghoul::ThreadPool& pool, std::string file) {
+    co_await pool.schedule();
+    Buffer buffer = readFile(file);
+    Image image = co_await ghoul::submit(pool, [&]() { return decode(buffer); });
+    co_return image;
+}
+
+ghoul::Task<void> loadAll(ghoul::ThreadPool& pool) {
+    Image a = co_await loadImage(pool, "a.png");
+    Image b = co_await loadImage(pool, "b.png");
+    // ...
+}
+
+ghoul::spawn(pool, loadAll(pool)).get();
+\endverbatim
+ * An exception that escapes the coroutine is rethrown by the <code>co_await</code>
+ * expression of the awaiting coroutine. A Task can only be awaited once and is
+ * move-only. This class is only available if the compiler supports C++20 coroutines.
+ * \tparam T The type of the result of the coroutine
+ */
+template <typename T>
+class Task {
+public:
+    using promise_type = internal::TaskPromise<T>;
+
+    /// The awaitable object that starts the Task and resumes the awaiting coroutine
+    class Awaiter {
+    public:
+        explicit Awaiter(std::coroutine_handle<promise_type> handle);
+
+        bool await_ready() const noexcept;
+        std::coroutine_handle<> await_suspend(
+            std::coroutine_handle<> continuation) noexcept;
+        T await_resume();
+
+    private:
+        std::coroutine_handle<promise_type> _handle;
+    };
+
+    /// Creates an invalid Task that is not associated with a coroutine
+    Task() = default;
+
+    Task(Task&& other) noexcept;
+    Task& operator=(Task&& other) noexcept;
+    ~Task();
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    /**
+     * Returns whether this Task is associated with a coroutine.
+     * \return <code>true</code> if this Task is associated with a coroutine
+     */
+    bool isValid() const;
+
+    /**
+     * Starts the coroutine of this Task and suspends the awaiting coroutine until it has
+     * finished.
+     * \return The awaitable object that returns the result of the coroutine
+     * \pre This Task must be valid
+     */
+    Awaiter operator co_await() &&;
+
+private:
+    friend class internal::TaskPromise<T>;
+
+    explicit Task(std::coroutine_handle<promise_type> handle);
+
+    std::coroutine_handle<promise_type> _handle;
+};
+
+/**
+ * Starts the \p task on a Worker of the \p pool and returns a Continuable for its result.
+ * This is the connection between code that uses coroutines and code that does not; the
+ * result can be retrieved with Continuable::get or further tasks can be attached with
+ * Continuable::then. If the start of the \p task is discarded because the \p pool is
+ * stopped without running the remaining tasks, the Continuable holds a
+ * <code>std::future_error</code> with <code>std::future_errc::broken_promise</code>.
+ * \tparam T The type of the result of the \p task
+ * \param pool The ThreadPool on which the \p task is started
+ * \param priority The Priority with which the start of the \p task is queued
+ * \param task The Task that is started
+ * \return A Continuable that holds the result of the \p task
+ * \pre \p task must be valid
+ */
+template <typename T>
+Continuable<T> spawn(ThreadPool& pool, ThreadPool::Priority priority, Task<T> task);
+
+/**
+ * Starts the \p task on a Worker of the \p pool with ThreadPool::Priority::Normal and
+ * returns a Continuable for its result.
+ * \tparam T The type of the result of the \p task
+ * \param pool The ThreadPool on which the \p task is started
+ * \param task The Task that is started
+ * \return A Continuable that holds the result of the \p task
+ * \pre \p task must be valid
+ */
+template <typename T>
+Continuable<T> spawn(ThreadPool& pool, Task<T> task);
+
+/**
+ * Makes Continuable%s awaitable from within a coroutine. The awaiting coroutine is
+ * resumed by a task with ThreadPool::Priority::Normal in the ThreadPool of the
+ * \p continuable once its result is available and the <code>co_await</code> expression
+ * returns a copy of the result or rethrows its exception.
+ * \tparam T The type of the result of the \p continuable
+ * \param continuable The Continuable that is awaited
+ * \return The awaitable object for the \p continuable
+ * \pre \p continuable must be valid
+ */
+template <typename T>
+internal::ContinuableAwaiter<T> operator co_await(Continuable<T> continuable);
+
+} // namespace ghoul
+
+#include "coroutine.inl"
+
+#endif // __cpp_impl_coroutine
+
+#endif // __COROUTINE_H__
@@ -0,0 +1,260 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include <ghoul/misc/assert.h>
+
+namespace ghoul {
+
+namespace internal {
+
+inline bool TaskPromiseBase::FinalAwaiter::await_ready() const noexcept {
+    return false;
+}
+
+template <typename Promise>
+std::coroutine_handle<> TaskPromiseBase::FinalAwaiter::await_suspend(
+                                         std::coroutine_handle<Promise> handle) noexcept
+{
+    // Continue with the awaiting coroutine without going through the caller's stack.
+    // A Task that is destroyed without being awaited has no continuation
+    std::coroutine_handle<> continuation = handle.promise()._continuation;
+    if (continuation) {
+        return continuation;
+    }
+    else {
+        return std::noop_coroutine();
+    }
+}
+
+inline void TaskPromiseBase::FinalAwaiter::await_resume() const noexcept {}
+
+inline std::suspend_always TaskPromiseBase::initial_suspend() const noexcept {
+    return {};
+}
+
+inline TaskPromiseBase::FinalAwaiter TaskPromiseBase::final_suspend() const noexcept {
+    return {};
+}
+
+inline void TaskPromiseBase::unhandled_exception() noexcept {
+    _exception = std::current_exception();
+}
+
+inline void TaskPromiseBase::setContinuation(std::coroutine_handle<> continuation) {
+    _continuation = continuation;
+}
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+template <typename T>
+template <typename U>
+void TaskPromise<T>::return_value(U&& value) {
+    _value.emplace(std::forward<U>(value));
+}
+
+template <typename T>
+T TaskPromise<T>::result() {
+    if (_exception) {
+        std::rethrow_exception(_exception);
+    }
+    return std::move(*_value);
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+inline void TaskPromise<void>::return_void() const noexcept {}
+
+inline void TaskPromise<void>::result() {
+    if (_exception) {
+        std::rethrow_exception(_exception);
+    }
+}
+
+inline DetachedTask DetachedTask::promise_type::get_return_object() const noexcept {
+    return {};
+}
+
+inline std::suspend_never DetachedTask::promise_type::initial_suspend() const noexcept {
+    return {};
+}
+
+inline std::suspend_never DetachedTask::promise_type::final_suspend() const noexcept {
+    return {};
+}
+
+inline void DetachedTask::promise_type::return_void() const noexcept {}
+
+inline void DetachedTask::promise_type::unhandled_exception() const noexcept {
+    // The coroutines driven by a DetachedTask catch all of their exceptions
+    std::terminate();
+}
+
+/**
+ * Drives the \p task on the ThreadPool of the \p state and stores its result or its
+ * exception in the \p state.
+ */
+template <typename T>
+DetachedTask runSpawned(std::shared_ptr<ContinuationState<T>> state,
+                        ThreadPool::Priority priority, Task<T> task)
+{
+    try {
+        co_await state->pool().schedule(priority);
+        if constexpr (std::is_void_v<T>) {
+            co_await std::move(task);
+            state->run([]() {});
+        }
+        else {
+            T value = co_await std::move(task);
+            state->run([&value]() { return std::move(value); });
+        }
+    }
+    catch (...) {
+        state->setException(std::current_exception());
+    }
+}
+
+template <typename T>
+ContinuableAwaiter<T>::ContinuableAwaiter(Continuable<T> continuable)
+    : _continuable(std::move(continuable))
+    , _schedule(
+        ContinuableAccess::state(_continuable)->pool(),
+        ThreadPool::Priority::Normal
+    )
+{}
+
+template <typename T>
+bool ContinuableAwaiter<T>::await_ready() const {
+    return _continuable.isReady();
+}
+
+template <typename T>
+void ContinuableAwaiter<T>::await_suspend(std::coroutine_handle<> handle) {
+    // The coroutine is not resumed on the thread that finishes the Continuable, but is
+    // queued in the ThreadPool instead. The callback might be invoked immediately, so
+    // this object must not be accessed after adding the callback
+    ContinuableAccess::state(_continuable)->addCallback([this, handle]() {
+        _schedule.await_suspend(handle);
+    });
+}
+
+template <typename T>
+T ContinuableAwaiter<T>::await_resume() {
+    _schedule.await_resume();
+    return _continuable.get();
+}
+
+} // namespace internal
+
+template <typename T>
+Task<T>::Awaiter::Awaiter(std::coroutine_handle<promise_type> handle)
+    : _handle(handle)
+{}
+
+template <typename T>
+bool Task<T>::Awaiter::await_ready() const noexcept {
+    return _handle.done();
+}
+
+template <typename T>
+std::coroutine_handle<> Task<T>::Awaiter::await_suspend(
+                                          std::coroutine_handle<> continuation) noexcept
+{
+    // Start our coroutine, which resumes the continuation once it has finished
+    _handle.promise().setContinuation(continuation);
+    return _handle;
+}
+
+template <typename T>
+T Task<T>::Awaiter::await_resume() {
+    return _handle.promise().result();
+}
+
+template <typename T>
+Task<T>::Task(std::coroutine_handle<promise_type> handle)
+    : _handle(handle)
+{}
+
+template <typename T>
+Task<T>::Task(Task&& other) noexcept
+    : _handle(std::exchange(other._handle, nullptr))
+{}
+
+template <typename T>
+Task<T>& Task<T>::operator=(Task&& other) noexcept {
+    if (this != &other) {
+        if (_handle) {
+            _handle.destroy();
+        }
+        _handle = std::exchange(other._handle, nullptr);
+    }
+    return *this;
+}
+
+template <typename T>
+Task<T>::~Task() {
+    if (_handle) {
+        _handle.destroy();
+    }
+}
+
+template <typename T>
+bool Task<T>::isValid() const {
+    return static_cast<bool>(_handle);
+}
+
+template <typename T>
+typename Task<T>::Awaiter Task<T>::operator co_await() && {
+    ghoul_assert(isValid(), "Task must be valid");
+
+    return Awaiter(_handle);
+}
+
+template <typename T>
+Continuable<T> spawn(ThreadPool& pool, ThreadPool::Priority priority, Task<T> task) {
+    ghoul_assert(task.isValid(), "Task must be valid");
+
+    auto state = std::make_shared<internal::ContinuationState<T>>(pool);
+    internal::runSpawned(state, priority, std::move(task));
+    return internal::ContinuableAccess::create(std::move(state));
+}
+
+template <typename T>
+Continuable<T> spawn(ThreadPool& pool, Task<T> task) {
+    return spawn(pool, ThreadPool::Priority::Normal, std::move(task));
+}
+
+template <typename T>
+internal::ContinuableAwaiter<T> operator co_await(Continuable<T> continuable) {
+    ghoul_assert(continuable.isValid(), "Continuable must be valid");
+
+    return internal::ContinuableAwaiter<T>(std::move(continuable));
+}
+
+} // namespace ghoul
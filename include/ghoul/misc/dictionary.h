@@ -44,9 +44,10 @@
 #include <ghoul/misc/exception.h>
 #include <ghoul/misc/any.h>
 
-#include <map>
+#include <memory>
 #include <string>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace ghoul {
@@ -135,6 +136,52 @@ using has_storage_converter = static_not<
 
 }
 
+/**
+ * A key into a Dictionary that has been split at its <code>.</code> separators once on
+ * construction. Passing a DictionaryKey instead of a <code>std::string</code> to the
+ * Dictionary's accessor methods avoids splitting the key and allocating temporary
+ * strings on every call, so a DictionaryKey that is used repeatedly, for example in a
+ * loop or for many Dictionary%s with the same layout, should be created only once:
+ * \verbatim
+const ghoul::DictionaryKey Radius("Renderable.Geometry.Radius");
+for (const ghoul::Dictionary& d : dictionaries) {
+    if (d.hasKeyAndValue<double>(Radius)) {
+        double radius = d.value<double>(Radius);
+    }
+}
+ \endverbatim
+ */
+class DictionaryKey {
+public:
+    /**
+     * Creates a DictionaryKey by splitting the provided \p key at each <code>.</code>.
+     * \param key The, potentially nested, key
+     * \pre \p key must not be empty
+     */
+    explicit DictionaryKey(std::string key);
+
+    /**
+     * Returns the full key as it was passed to the constructor.
+     * \return The full key
+     */
+    const std::string& key() const;
+
+    /**
+     * Returns the parts of the key in the order in which they are traversed. A key
+     * <code>a.b.c</code> results in the three segments <code>a</code>, <code>b</code>,
+     * and <code>c</code>.
+     * \return The parts of the key
+     */
+    const std::vector<std::string>& segments() const;
+
+private:
+    /// The full key
+    std::string _key;
+
+    /// The parts of the key that are separated by <code>.</code>
+    std::vector<std::string> _segments;
+};
+
 /**
  * The Dictionary is a class to generically store arbitrary items associated with and
  * accessible using <code>std::string</code>%s. It has the abilitiy to store and retrieve
@@ -209,11 +256,28 @@ using has_storage_converter = static_not<
  * in this second Dictionary and checks, sets, or gets the corresponding value. The single
  * exception to this is the #setValue method, which has an additional parameter that
  * controls if each individual level of the Dictionary is created on-the-fly or not.
+ *
+ * The entries of a Dictionary are stored in a single contiguous array that is sorted by
+ * key, so a lookup is a binary search without any pointer chasing and the keys are
+ * enumerated in lexicographical order. Copying a Dictionary is a constant-time operation,
+ * as the copies share their entries, including all nested Dictionary%s, until one of them
+ * is modified. A modification only copies the levels along the modified key, the
+ * remaining nested Dictionary%s stay shared.
+ *
+ * Thread safety: A Dictionary has the same guarantees as the standard containers.
+ * Multiple threads may call <code>const</code> methods on the same Dictionary, or any
+ * methods on different Dictionary objects, concurrently, even if the objects are copies
+ * of each other and thus share their entries. Values that were added out of order are
+ * sorted by the first reader under a lock that is part of the shared entries. A single
+ * Dictionary object must not be modified while any other thread accesses that object.
  */
-class Dictionary : private std::map<std::string, ghoul::any> {
+class Dictionary {
 public:
     using CreateIntermediate = ghoul::Boolean;
 
+    /// The iterator over the key-value pairs of a Dictionary, in the order of the keys
+    using ConstIterator = std::vector<std::pair<std::string, ghoul::any>>::const_iterator;
+
     /// Base class for all Dictionary%-based exceptions
     struct DictionaryError : public RuntimeError {
         explicit DictionaryError(std::string message);
@@ -265,6 +329,14 @@ public:
      */
     bool hasKey(const std::string& key) const;
 
+    /**
+     * Returns <code>true</code> if there is a specific key in the Dictionary, regardless
+     * of its type. This method does not allocate any memory.
+     * \param key The, potentially nested, key that should be checked for existence
+     * \return <code>true</code> if the provided key exists, <code>false</code> otherwise
+     */
+    bool hasKey(const DictionaryKey& key) const;
+
     /**
      * Adds the \p value for a given location at \p key. If a value already exists at that
      * key, the old value is overwritten, regardless of its previous type and without any
@@ -319,6 +391,23 @@ public:
     template <typename T>
     bool getValue(const std::string& key, T& value) const;
 
+    /**
+     * Returns the value stored at the location of the precompiled \p key. Except for
+     * the conversion of a Dictionary into a vector or matrix type, the traversal does not
+     * allocate any memory. See the other overload for details.
+     * \tparam T The type of the value that should be retrieved
+     * \param key The, potentially nested, key for which the stored value should be
+     * returned
+     * \param value A reference to the value where the value will be copied to, if it
+     * could be found and the types agree
+     * \return <code>true</code> if the value was retrieved successfully,
+     * <code>false</code> otherwise
+     * \pre \p value must not be the Dictionary this method is called on
+     * \post If the value could not be retrieved, the \p value is unchanged
+     */
+    template <typename T>
+    bool getValue(const DictionaryKey& key, T& value) const;
+
     /**
      * Returns the value stored at location with a given \p key. This key can be nested
      * and will automatically be decomposed by the method to traverse to deeper levels of
@@ -338,6 +427,20 @@ public:
     template <typename T>
     T value(const std::string& key) const;
 
+    /**
+     * Returns the value stored at the location of the precompiled \p key. See the other
+     * overload for details.
+     * \tparam T The type of the value that should be returned
+     * \param key The, potentially nested, key for which the stored value should be
+     * returned
+     * \return value The value stored at the <code>key</code>
+     * \throw KeyError If the \p key does not exist in the Dictionary
+     * \throw ConversionError If the stored value's type for \p does not agree with
+     * <code>T</code>
+     */
+    template <typename T>
+    T value(const DictionaryKey& key) const;
+
     /**
      * Returns <code>true</code> if the Dictionary stores a value at the provided
      * \p key and the stored type agrees with the provided template parameter. The key can
@@ -353,6 +456,19 @@ public:
      */
     template <typename T>
     bool hasValue(const std::string& key) const;
+
+    /**
+     * Returns <code>true</code> if the Dictionary stores a value at the location of the
+     * precompiled \p key and the stored type agrees with the provided template parameter.
+     * See the other overload for details.
+     * \tparam T The type of the value that should be tested
+     * \param key The, potentially nested, key which should be checked for existence
+     * \return <code>true</code> if the Dictionary contains a value at the specified
+     * \p key with the correct type <code>T</code>. Will return <code>false</code>
+     * otherwise
+     */
+    template <typename T>
+    bool hasValue(const DictionaryKey& key) const;
     
     /**
      * Returns <code>true</code> if the Dictionary contains a value for the specified
@@ -367,6 +483,52 @@ public:
     template <typename T>
     bool hasKeyAndValue(const std::string& key) const;
 
+    /**
+     * Returns <code>true</code> if the Dictionary contains a value for the precompiled
+     * \p key and the value that is stored is of the type <code>T</code>.
+     * \tparam T The type of the value that should be tested
+     * \param key The key that should be tested
+     * \return <code>true</code> if the Dictionary contains a value for the \p key and the
+     * value is of type <code>T</code>
+     */
+    template <typename T>
+    bool hasKeyAndValue(const DictionaryKey& key) const;
+
+    /**
+     * Returns a pointer to the value that is stored at the, potentially nested, \p key
+     * without copying it. In contrast to #getValue, no conversions are performed, so
+     * <code>T</code> has to be the exact type that is stored; for the types that are
+     * converted into a unified storage format, only the storage types themselves, for
+     * example <code>double</code> or <code>long long</code>, can be requested. A
+     * <code>const Dictionary*</code> that is returned for <code>T = Dictionary</code>
+     * serves as a non-owning view of the nested Dictionary. The returned pointer is valid
+     * until this Dictionary is modified or destroyed. Example:
+     * \verbatim
+if (const std::string* name = dict.findValue<std::string>("Name")) {
+    // use *name
+}
+     \endverbatim
+     * \tparam T The type of the value that is stored at the \p key
+     * \param key The, potentially nested, key for which the value is returned
+     * \return A pointer to the stored value, or <code>nullptr</code> if the \p key does
+     * not exist or the stored value is not of type <code>T</code>
+     * \pre \p key must not be empty
+     */
+    template <typename T>
+    const T* findValue(const std::string& key) const;
+
+    /**
+     * Returns a pointer to the value that is stored at the precompiled \p key without
+     * copying it. Neither the traversal nor the lookup allocate any memory. See the other
+     * overload for details.
+     * \tparam T The type of the value that is stored at the \p key
+     * \param key The, potentially nested, key for which the value is returned
+     * \return A pointer to the stored value, or <code>nullptr</code> if the \p key does
+     * not exist or the stored value is not of type <code>T</code>
+     */
+    template <typename T>
+    const T* findValue(const DictionaryKey& key) const;
+
     /**
      * Returns the total number of keys stored in this Dictionary. This method will not
      * recurse into sub-Dictionaries, but will only return the top-level keys for the
@@ -400,6 +562,28 @@ public:
      */
     bool removeKey(const std::string& key);
 
+    /**
+     * Returns the iterator to the first key-value pair of this Dictionary. Together with
+     * #end, this allows to visit all top-level entries without allocating memory, in
+     * contrast to #keys. The values can be accessed with <code>ghoul::any_cast</code>.
+     * The iterators are invalidated when this Dictionary is modified. Example:
+     * \verbatim
+for (const std::pair<std::string, ghoul::any>& p : dict) {
+    if (const double* v = ghoul::any_cast<double>(&p.second)) {
+        // use p.first and *v
+    }
+}
+     \endverbatim
+     * \return The iterator to the first key-value pair
+     */
+    ConstIterator begin() const;
+
+    /**
+     * Returns the iterator past the last key-value pair of this Dictionary.
+     * \return The iterator past the last key-value pair
+     */
+    ConstIterator end() const;
+
 private:
     /**
      * Splits the provided \p key into a \p first part and the \p rest. Provided a key
@@ -413,6 +597,18 @@ private:
      */
     bool splitKey(const std::string& key, std::string& first, std::string& rest) const;
 
+    /**
+     * Returns the Dictionary that contains the last segment of the \p key by following
+     * all other segments, starting at this Dictionary. For a key <code>a.b.c</code>, the
+     * Dictionary stored at <code>a.b</code> is returned; for a key without a separator,
+     * this Dictionary is returned.
+     * \param key The key whose parent Dictionary is returned
+     * \return The Dictionary that contains the last segment of the \p key, or
+     * <code>nullptr</code> if an intermediate segment does not exist or does not name a
+     * Dictionary
+     */
+    const Dictionary* parentDictionary(const DictionaryKey& key) const;
+
     /**
      * A helper function that is used by the <code>std::initializer_list</code>
      * constructor. Will determine the type in the <code>boost::any</code> and call the
@@ -424,6 +620,84 @@ private:
      */
     void setValueAnyHelper(std::string key, ghoul::any value);
 
+    /// A single key-value pair that is stored in the Dictionary
+    using Entry = std::pair<std::string, ghoul::any>;
+
+    /// The storage for all entries of the Dictionary, sorted by their keys
+    using Entries = std::vector<Entry>;
+
+    /// The Entries together with the information whether they are sorted already, which
+    /// are shared between copies of a Dictionary
+    struct Storage;
+
+    /// Only the unified storage types and non-standard types are stored as they are, so
+    /// only those can be accessed without a conversion
+    template <typename T>
+    using IsStoredType = std::integral_constant<bool,
+        !internal::has_storage_converter<T>::value ||
+        std::is_same<typename internal::StorageTypeConverter<T>::type, T>::value
+    >;
+
+    /**
+     * Returns the entry that is stored for the \p key in this Dictionary. The \p key is
+     * not split and nested Dictionaries are not searched. As the returned entry can be
+     * modified, this Dictionary's entries are unshared first.
+     * \param key The key for which the entry is returned
+     * \return The entry for the \p key, or #cend if no such entry exists
+     */
+    Entries::iterator find(const std::string& key);
+
+    /**
+     * Returns the entry that is stored for the \p key in this Dictionary. The \p key is
+     * not split and nested Dictionaries are not searched.
+     * \param key The key for which the entry is returned
+     * \return The entry for the \p key, or #cend if no such entry exists
+     */
+    Entries::const_iterator find(const std::string& key) const;
+
+    /// Returns the iterator past the last entry, which is returned by #find if a key
+    /// does not exist
+    Entries::const_iterator cend() const;
+
+    /**
+     * Appends a new empty value for the \p key to this Dictionary and returns it. The
+     * \p key is not split and nested Dictionaries are not searched. If the \p key does
+     * not sort after all existing keys, the entries are only sorted again the next time
+     * they are accessed through #entries or #mutableEntries, which also removes all but
+     * the last value that was appended for the same \p key. This keeps filling a
+     * Dictionary in an arbitrary order, for example with numbered keys, linear.
+     * \param key The key for which the value is appended
+     * \return A reference to the value that was appended for the \p key, which is only
+     *         valid until the entries are accessed the next time
+     */
+    ghoul::any& entry(std::string key);
+
+    /**
+     * Returns the entries of this Dictionary for reading, sorting them first if values
+     * have been appended out of order by #entry. If this Dictionary has no entries yet, a
+     * shared empty list is returned.
+     * \return The entries of this Dictionary, sorted by their keys
+     */
+    const Entries& entries() const;
+
+    /**
+     * Returns the entries of this Dictionary for writing. If the entries are shared with
+     * other Dictionary%s, they are copied first, so that the changes are not visible in
+     * the other Dictionary%s. The copy is shallow, as nested Dictionary%s are shared in
+     * turn and are only copied once they are modified themselves.
+     * \return The entries of this Dictionary that are owned exclusively by it, sorted by
+     *         their keys
+     */
+    Entries& mutableEntries();
+
+    /**
+     * Returns the Storage of this Dictionary for writing, creating it if it does not
+     * exist yet and copying it first if it is shared with other Dictionary%s. The
+     * entries of the returned Storage are not necessarily sorted.
+     * \return The Storage of this Dictionary that is owned exclusively by it
+     */
+    Storage& ownStorage();
+
     /**
      * This type is used in SFINAE evaluation of the internal methods (#setValueInternal,
      * #getValueInternal, and #hasValueInternal) and determines whether the type
@@ -663,6 +937,11 @@ private:
      */
     template <typename T>
     bool hasValueInternal(const std::string& key, IsNonStandardType<T>* = nullptr) const;
+
+    /// All entries of this Dictionary. The entries are shared between copies of a
+    /// Dictionary until one of the copies is modified. This is <code>nullptr</code> if no
+    /// entry has been added yet
+    std::shared_ptr<Storage> _entries;
 };
 
 }  // namespace ghoul
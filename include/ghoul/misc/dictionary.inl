@@ -25,6 +25,10 @@
 
 #include <ghoul/misc/assert.h>
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+
 namespace ghoul {
 
 template <typename T>
@@ -68,7 +72,7 @@ void Dictionary::setValueHelper(std::string key, T value,
     bool hasRestPath = splitKey(key, first, rest);
     if (!hasRestPath) {
         // if no rest exists, key == first and we can just insert the value
-        (*this)[std::move(key)] = std::move(value);
+        entry(std::move(key)) = std::move(value);
         return;
     }
     
@@ -78,7 +82,7 @@ void Dictionary::setValueHelper(std::string key, T value,
     if (keyIt == cend()) {
         // didn't find the Dictionary
         if (createIntermediate) {
-            (*this)[first] = ghoul::Dictionary();
+            entry(first) = ghoul::Dictionary();
             keyIt = find(first);
         }
         else
@@ -1079,6 +1083,77 @@ bool Dictionary::hasKeyAndValue(const std::string& key) const {
     return (hasKey(key) && hasValue<T>(key));
 }
 
+////////////////////
+// DictionaryKey access
+////////////////////
+
+template <typename T>
+bool Dictionary::getValue(const DictionaryKey& key, T& value) const {
+    const Dictionary* dict = parentDictionary(key);
+    if (!dict) {
+        return false;
+    }
+    return dict->getValue(key.segments().back(), value);
+}
+
+template <typename T>
+T Dictionary::value(const DictionaryKey& key) const {
+    const Dictionary* dict = parentDictionary(key);
+    if (!dict) {
+        throw KeyError("Key '" + key.key() + "' did not exist in Dictionary");
+    }
+    return dict->value<T>(key.segments().back());
+}
+
+template <typename T>
+bool Dictionary::hasValue(const DictionaryKey& key) const {
+    const Dictionary* dict = parentDictionary(key);
+    return dict && dict->hasValue<T>(key.segments().back());
+}
+
+template <typename T>
+bool Dictionary::hasKeyAndValue(const DictionaryKey& key) const {
+    const Dictionary* dict = parentDictionary(key);
+    return dict && dict->hasKeyAndValue<T>(key.segments().back());
+}
+
+template <typename T>
+const T* Dictionary::findValue(const std::string& key) const {
+    static_assert(
+        IsStoredType<T>::value,
+        "Only types that are stored without conversion can be accessed by pointer"
+    );
+    ghoul_assert(!key.empty(), "Key must not be empty");
+
+    auto it = find(key);
+    if (it != cend()) {
+        return ghoul::any_cast<T>(&(it->second));
+    }
+
+    std::string first;
+    std::string rest;
+    if (!splitKey(key, first, rest)) {
+        return nullptr;
+    }
+    const Dictionary* dict = findValue<Dictionary>(first);
+    return dict ? dict->findValue<T>(rest) : nullptr;
+}
+
+template <typename T>
+const T* Dictionary::findValue(const DictionaryKey& key) const {
+    static_assert(
+        IsStoredType<T>::value,
+        "Only types that are stored without conversion can be accessed by pointer"
+    );
+
+    const Dictionary* dict = parentDictionary(key);
+    if (!dict) {
+        return nullptr;
+    }
+    auto it = dict->find(key.segments().back());
+    return (it != dict->cend()) ? ghoul::any_cast<T>(&(it->second)) : nullptr;
+}
+
 // Extern define template declaration such that the compiler won't try to instantiate each
 // member function individually whenever it is encountered. The definitions are located
 // in the dictionary.cpp compilation unit
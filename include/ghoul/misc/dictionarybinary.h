@@ -0,0 +1,244 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#ifndef __DICTIONARYBINARY_H__
+#define __DICTIONARYBINARY_H__
+
+#include <ghoul/misc/buffer.h>
+#include <ghoul/misc/dictionary.h>
+#include <ghoul/misc/exception.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ghoul {
+
+namespace internal {
+    struct DictionaryRecord;
+} // namespace internal
+
+/// Exception that is thrown if a Dictionary cannot be serialized or if the binary data
+/// is malformed
+struct DictionaryBinaryError : public RuntimeError {
+    explicit DictionaryBinaryError(std::string message);
+};
+
+/**
+ * Appends the binary representation of the \p dictionary to the end of the \p buffer.
+ * The representation is prefixed with its length, so it can be mixed with other
+ * serialized values in the same Buffer. It can be read back either completely by
+ * #deserializeDictionary or on demand through a MappedDictionary. Each level of the
+ * Dictionary is stored as a table of fixed-size records sorted by key that is followed
+ * by the keys and values, so that a single key can be looked up by a binary search
+ * without reading the rest of the data. All values whose types have a
+ * <code>StorageTypeConverter</code>, as well as <code>bool</code>,
+ * <code>std::string</code>, <code>const char*</code> (which is read back as a
+ * <code>std::string</code>), and nested Dictionary%s are supported. The representation
+ * uses the native byte order and is thus not portable between architectures with a
+ * different endianness.
+ *
+ * In combination with the CacheManager, this makes it possible to skip the parsing of a
+ * large configuration file on all but the first start of an application:
+ * \verbatim
+std::string cache = cacheManager.cachedFilename(file, "dictionary", Persistent::Yes);
+if (FileSys.fileExists(cache)) {
+    ghoul::MappedDictionary mapped(cache);
+    ghoul::Dictionary scene = mapped.view().view("Scene").materialize();
+}
+else {
+    ghoul::Dictionary configuration;
+    ghoul::lua::loadDictionaryFromFile(file, configuration);
+    ghoul::Buffer buffer;
+    ghoul::serializeDictionary(configuration, buffer);
+    buffer.write(cache);
+}
+ \endverbatim
+ *
+ * \param dictionary The Dictionary that is serialized
+ * \param buffer The Buffer into which the \p dictionary is serialized
+ * \throw DictionaryBinaryError If the \p dictionary contains a value of a type that
+ * cannot be serialized
+ */
+void serializeDictionary(const Dictionary& dictionary, Buffer& buffer);
+
+/**
+ * Reads a Dictionary that was serialized using #serializeDictionary from the current
+ * read position of the \p buffer.
+ * \param buffer The Buffer from which the Dictionary is read
+ * \return The deserialized Dictionary
+ * \throw DictionaryBinaryError If the data in the \p buffer is not a valid serialized
+ * Dictionary
+ */
+Dictionary deserializeDictionary(Buffer& buffer);
+
+/**
+ * A read-only view of one level of a serialized Dictionary. Keys are looked up directly
+ * in the serialized data and only the values that are requested are converted, so a
+ * small part of a large Dictionary can be accessed without creating the rest of it. A
+ * DictionaryView does not own the data it refers to and must not outlive the
+ * MappedDictionary that it was created from. All accessors verify the bounds of the
+ * serialized data and throw a DictionaryBinaryError if the data is malformed.
+ */
+class DictionaryView {
+public:
+    /**
+     * Returns the number of keys on this level.
+     * \return The number of keys on this level
+     */
+    size_t size() const;
+
+    /**
+     * Returns <code>true</code> if there are no keys on this level.
+     * \return <code>true</code> if there are no keys on this level
+     */
+    bool empty() const;
+
+    /**
+     * Returns all keys on this level in sorted order.
+     * \return All keys on this level in sorted order
+     */
+    std::vector<std::string> keys() const;
+
+    /**
+     * Returns <code>true</code> if a value is stored at the, potentially nested, \p key.
+     * \param key The key that is checked
+     * \return <code>true</code> if a value is stored at the \p key
+     * \pre \p key must not be empty
+     */
+    bool hasKey(const std::string& key) const;
+
+    /**
+     * Returns a view of the Dictionary that is stored at the, potentially nested,
+     * \p key.
+     * \param key The key of the Dictionary
+     * \return A view of the Dictionary stored at \p key
+     * \throw KeyError If the \p key does not exist
+     * \throw ConversionError If the value at \p key is not a Dictionary
+     * \pre \p key must not be empty
+     */
+    DictionaryView view(const std::string& key) const;
+
+    /**
+     * Retrieves the value that is stored at the, potentially nested, \p key with the
+     * same conversions that Dictionary::getValue applies. Only the requested value is
+     * converted from the serialized data.
+     * \tparam T The type of the value that should be retrieved
+     * \param key The key of the value
+     * \param value The value into which the stored value is copied
+     * \return <code>true</code> if the value was retrieved successfully,
+     * <code>false</code> otherwise
+     * \pre \p key must not be empty
+     * \post If the value could not be retrieved, the \p value is unchanged
+     */
+    template <typename T>
+    bool getValue(const std::string& key, T& value) const;
+
+    /**
+     * Converts this level, including all nested levels, into a Dictionary.
+     * \return The Dictionary that contains all values of this level
+     */
+    Dictionary materialize() const;
+
+private:
+    friend class MappedDictionary;
+    friend Dictionary deserializeDictionary(Buffer& buffer);
+
+    using Record = internal::DictionaryRecord;
+
+    DictionaryView(const unsigned char* data, size_t size, uint64_t node);
+
+    /// Creates a view of the top level of the serialized data in \p data
+    static DictionaryView root(const unsigned char* data, size_t size);
+
+    Record record(uint64_t index) const;
+    bool find(const char* key, size_t length, Record& record) const;
+    bool findNested(const std::string& key, DictionaryView& parent, Record& record,
+        std::string::size_type& leaf) const;
+    DictionaryView child(const Record& record) const;
+    void materializeEntry(const Record& record, std::string key,
+        Dictionary& dictionary) const;
+    bool materializeEntry(const std::string& key, Dictionary& dictionary,
+        std::string& leaf) const;
+
+    const unsigned char* _data;
+    size_t _size;
+    uint64_t _node;
+};
+
+/**
+ * Provides access to a file that contains a single Dictionary that was serialized using
+ * #serializeDictionary into an otherwise empty Buffer and written using Buffer::write.
+ * If the file was not compressed, it is mapped into memory and only the parts that are
+ * accessed through the #view are read from disk. Compressed files are decompressed into
+ * memory instead. The MappedDictionary must outlive all DictionaryView%s created from
+ * it.
+ */
+class MappedDictionary {
+public:
+    /**
+     * Opens and maps the file \p filename.
+     * \param filename The file that contains the serialized Dictionary
+     * \throw DictionaryBinaryError If the file could not be opened or mapped or does not
+     * contain a serialized Dictionary
+     * \pre \p filename must not be empty
+     */
+    explicit MappedDictionary(const std::string& filename);
+
+    /// Unmaps the file
+    ~MappedDictionary();
+
+    MappedDictionary(const MappedDictionary&) = delete;
+    MappedDictionary& operator=(const MappedDictionary&) = delete;
+
+    /**
+     * Returns a view of the top level of the serialized Dictionary.
+     * \return A view of the top level of the serialized Dictionary
+     */
+    DictionaryView view() const;
+
+private:
+    /// Releases the mapping and the file handles
+    void unmap();
+
+    /// Stores the decompressed data if the file was compressed
+    Buffer _buffer;
+
+    void* _mapping;
+    size_t _mappingSize;
+#ifdef WIN32
+    void* _file;
+    void* _mappingHandle;
+#endif
+
+    const unsigned char* _data;
+    size_t _size;
+};
+
+} // namespace ghoul
+
+#include "dictionarybinary.inl"
+
+#endif // __DICTIONARYBINARY_H__
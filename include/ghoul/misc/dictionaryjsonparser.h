@@ -0,0 +1,142 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#ifndef __DICTIONARYJSONPARSER_H__
+#define __DICTIONARYJSONPARSER_H__
+
+#include <ghoul/misc/exception.h>
+
+#include <string>
+
+namespace ghoul {
+
+class Dictionary;
+
+/**
+ * This class parses JSON documents, either into a Dictionary or by reporting each element
+ * of the document to a Handler as it is encountered. The parser does not create an
+ * intermediate representation of the document and does not use recursion, so the depth
+ * of a document is only limited by the available memory. Strings that do not contain
+ * escape sequences are passed to the Handler without copying them and the contents of
+ * strings and whitespace are skipped eight bytes at a time.
+ *
+ * When creating a Dictionary, the same conventions as for Lua tables in
+ * ghoul::lua::luaDictionaryFromState are used: All numbers are stored as
+ * <code>double</code>s, <code>true</code> and <code>false</code> are stored as
+ * <code>bool</code>s and arrays are stored as Dictionary%s with the keys
+ * <code>"1"</code>, <code>"2"</code>, etc. As Lua cannot store <code>nil</code> in a
+ * table, <code>null</code> values are skipped, but still occupy an index in an array.
+ */
+class DictionaryJsonParser {
+public:
+    /// Exception that is thrown if the JSON document is malformed
+    struct JsonParsingError : public RuntimeError {
+        /**
+         * Creates the exception for an error at the provided \p line and \p column.
+         * \param message The description of the error
+         * \param line The 1-based line at which the error occurred
+         * \param column The 1-based column, in bytes, at which the error occurred
+         */
+        JsonParsingError(const std::string& message, size_t line, size_t column);
+
+        /// The 1-based line at which the error occurred
+        size_t line;
+
+        /// The 1-based column, in bytes, at which the error occurred
+        size_t column;
+    };
+
+    /**
+     * The interface that receives the elements of a JSON document in the order in which
+     * they occur. The pointers passed to #key and #stringValue are only valid until the
+     * method returns. If a method throws an exception, the parsing is aborted and the
+     * exception is rethrown as a JsonParsingError with the location of the element.
+     */
+    class Handler {
+    public:
+        virtual ~Handler() = default;
+
+        /// Called for the opening <code>{</code> of an object
+        virtual void startObject() = 0;
+
+        /// Called for the closing <code>}</code> of an object
+        virtual void endObject() = 0;
+
+        /// Called for the opening <code>[</code> of an array
+        virtual void startArray() = 0;
+
+        /// Called for the closing <code>]</code> of an array
+        virtual void endArray() = 0;
+
+        /**
+         * Called for the key of each member of an object before its value is reported.
+         * \param key The unescaped key, which is not null-terminated
+         * \param length The length of the \p key in bytes
+         */
+        virtual void key(const char* key, size_t length) = 0;
+
+        /**
+         * Called for each string value.
+         * \param value The unescaped string, which is not null-terminated
+         * \param length The length of the \p value in bytes
+         */
+        virtual void stringValue(const char* value, size_t length) = 0;
+
+        /// Called for each number value
+        virtual void numberValue(double value) = 0;
+
+        /// Called for each <code>true</code> or <code>false</code> value
+        virtual void booleanValue(bool value) = 0;
+
+        /// Called for each <code>null</code> value
+        virtual void nullValue() = 0;
+    };
+
+    /**
+     * Parses the JSON document in \p json and reports its elements to the \p handler.
+     * \param json The JSON document, which does not have to be null-terminated
+     * \param length The length of the \p json document in bytes
+     * \param handler The Handler that receives the elements of the document
+     * \throw JsonParsingError If the document is malformed or the \p handler threw an
+     * exception
+     * \pre \p json must not be <code>nullptr</code> if \p length is not 0
+     */
+    void parse(const char* json, size_t length, Handler& handler) const;
+
+    /**
+     * Parses the JSON document in \p json into a Dictionary. The top-level value of the
+     * document has to be an object or an array.
+     * \param json The JSON document
+     * \return The Dictionary that contains the values of the document
+     * \throw JsonParsingError If the document is malformed, if the top-level value is not
+     * an object or an array, or if a key contains a <code>.</code>, which cannot be
+     * represented in a Dictionary
+     */
+    Dictionary parse(const std::string& json) const;
+};
+
+}  // namespace ghoul
+
+#endif // __DICTIONARYJSONPARSER_H__
@@ -0,0 +1,198 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#ifndef __INPLACEFUNCTION_H__
+#define __INPLACEFUNCTION_H__
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace ghoul {
+
+/// The default number of bytes that an InplaceFunction can store without allocating
+const size_t InplaceFunctionDefaultCapacity = 48;
+
+namespace internal {
+
+/**
+ * The table of functions that an InplaceFunction uses to operate on the callable that is
+ * stored inside it. There is exactly one table for each type of stored callable.
+ */
+template <typename R, typename... Args>
+struct InplaceFunctionVTable {
+    /// Calls the callable stored in the <code>storage</code>
+    R (*invoke)(void* storage, Args&&... args);
+    /// Move-constructs the callable from <code>source</code> into <code>target</code>
+    /// and destroys the callable in <code>source</code>
+    void (*move)(void* target, void* source);
+    /// Destroys the callable that is stored in the <code>storage</code>
+    void (*destroy)(void* storage);
+    /// Whether the callable is stored inside the InplaceFunction or on the heap
+    bool isInplace;
+};
+
+/**
+ * The functions operating on a callable of type \p F that is stored directly inside the
+ * storage of the InplaceFunction.
+ */
+template <typename F, typename R, typename... Args>
+struct InplaceStorageOperations {
+    static R invoke(void* storage, Args&&... args);
+    static void move(void* target, void* source);
+    static void destroy(void* storage);
+
+    static const InplaceFunctionVTable<R, Args...> VTable;
+};
+
+/**
+ * The functions operating on a callable of type \p F that is allocated on the heap, as
+ * it does not fit into the storage of the InplaceFunction. Only the pointer to the
+ * callable is stored in the InplaceFunction.
+ */
+template <typename F, typename R, typename... Args>
+struct HeapStorageOperations {
+    static R invoke(void* storage, Args&&... args);
+    static void move(void* target, void* source);
+    static void destroy(void* storage);
+
+    static const InplaceFunctionVTable<R, Args...> VTable;
+};
+
+} // namespace internal
+
+template <typename Signature, size_t Capacity = InplaceFunctionDefaultCapacity>
+class InplaceFunction;
+
+/**
+ * An InplaceFunction is a move-only replacement for <code>std::function</code> that
+ * stores small callables directly inside the object instead of allocating them on the
+ * heap. Callables that are larger than \p Capacity bytes, that are over-aligned, or that
+ * might throw when they are moved are allocated on the heap instead, so any callable can
+ * be stored. As the InplaceFunction does not have to be copyable, it can also store
+ * move-only callables, for example lambda expressions that capture a
+ * <code>std::unique_ptr</code> or a <code>std::packaged_task</code>. Example:
+ *\verbatim
+auto ptr = std::make_unique<int>(5);
+ghoul::InplaceFunction<int()> f = [p = std::move(ptr)]() { return *p; };
+int i = f();
+\endverbatim
+ * \tparam R The return type of the stored callable
+ * \tparam Args The types of the arguments of the stored callable
+ * \tparam Capacity The number of bytes that are available to store a callable without
+ * allocating memory
+ */
+template <typename R, typename... Args, size_t Capacity>
+class InplaceFunction<R(Args...), Capacity> {
+public:
+    /// Creates an empty InplaceFunction
+    InplaceFunction() noexcept;
+
+    /// Creates an empty InplaceFunction
+    InplaceFunction(std::nullptr_t) noexcept;
+
+    /**
+     * Creates an InplaceFunction that stores the \p function. If the \p function fits
+     * into the storage of this object and cannot throw when moved, no memory is
+     * allocated.
+     * \tparam Function The type of the stored callable
+     * \param function The callable that is stored
+     */
+    template <
+        typename Function,
+        typename = typename std::enable_if<!std::is_same<
+            typename std::decay<Function>::type, InplaceFunction
+        >::value>::type
+    >
+    InplaceFunction(Function&& function);
+
+    /**
+     * Move-constructs an InplaceFunction, leaving \p other empty.
+     * \param other The InplaceFunction whose callable is taken over
+     */
+    InplaceFunction(InplaceFunction&& other) noexcept;
+
+    InplaceFunction(const InplaceFunction&) = delete;
+
+    /// Destroys the stored callable, if there is one
+    ~InplaceFunction();
+
+    /**
+     * Destroys the currently stored callable and takes over the callable of \p other,
+     * leaving \p other empty.
+     * \param other The InplaceFunction whose callable is taken over
+     * \return A reference to this InplaceFunction
+     */
+    InplaceFunction& operator=(InplaceFunction&& other) noexcept;
+
+    InplaceFunction& operator=(const InplaceFunction&) = delete;
+
+    /**
+     * Calls the stored callable with the \p args.
+     * \param args The arguments that are passed to the callable
+     * \return The return value of the callable
+     * \pre This InplaceFunction must not be empty
+     */
+    R operator()(Args... args);
+
+    /**
+     * Returns whether this InplaceFunction stores a callable.
+     * \return <code>true</code> if this InplaceFunction stores a callable
+     */
+    explicit operator bool() const noexcept;
+
+    /**
+     * Returns whether the stored callable is stored inside of this object, rather than
+     * being allocated on the heap.
+     * \return <code>true</code> if the stored callable is stored inside this object
+     * \pre This InplaceFunction must not be empty
+     */
+    bool isStoredInplace() const;
+
+    /**
+     * Returns whether a callable of type \p Function would be stored inside the object
+     * rather than being allocated on the heap.
+     * \tparam Function The type of callable that is tested
+     * \return <code>true</code> if a \p Function would be stored inside the object
+     */
+    template <typename Function>
+    static constexpr bool fitsInplace();
+
+private:
+    /// Destroys the stored callable and leaves this InplaceFunction empty
+    void reset() noexcept;
+
+    /// The storage for the callable or the pointer to the heap-allocated callable
+    typename std::aligned_storage<Capacity, alignof(std::max_align_t)>::type _storage;
+
+    /// The functions operating on the stored callable, or nullptr if this is empty
+    const internal::InplaceFunctionVTable<R, Args...>* _vtable;
+};
+
+} // namespace ghoul
+
+#include "inplacefunction.inl"
+
+#endif // __INPLACEFUNCTION_H__
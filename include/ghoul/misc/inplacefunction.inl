@@ -0,0 +1,199 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include <ghoul/misc/assert.h>
+
+#include <new>
+
+namespace ghoul {
+
+namespace internal {
+
+template <typename F, typename R, typename... Args>
+R InplaceStorageOperations<F, R, Args...>::invoke(void* storage, Args&&... args) {
+    return (*static_cast<F*>(storage))(std::forward<Args>(args)...);
+}
+
+template <typename F, typename R, typename... Args>
+void InplaceStorageOperations<F, R, Args...>::move(void* target, void* source) {
+    F* s = static_cast<F*>(source);
+    new (target) F(std::move(*s));
+    s->~F();
+}
+
+template <typename F, typename R, typename... Args>
+void InplaceStorageOperations<F, R, Args...>::destroy(void* storage) {
+    static_cast<F*>(storage)->~F();
+}
+
+template <typename F, typename R, typename... Args>
+const InplaceFunctionVTable<R, Args...> InplaceStorageOperations<F, R, Args...>::VTable = {
+    &InplaceStorageOperations<F, R, Args...>::invoke,
+    &InplaceStorageOperations<F, R, Args...>::move,
+    &InplaceStorageOperations<F, R, Args...>::destroy,
+    true
+};
+
+template <typename F, typename R, typename... Args>
+R HeapStorageOperations<F, R, Args...>::invoke(void* storage, Args&&... args) {
+    return (**static_cast<F**>(storage))(std::forward<Args>(args)...);
+}
+
+template <typename F, typename R, typename... Args>
+void HeapStorageOperations<F, R, Args...>::move(void* target, void* source) {
+    // Only the pointer is moved, the callable itself stays where it is
+    new (target) F*(*static_cast<F**>(source));
+}
+
+template <typename F, typename R, typename... Args>
+void HeapStorageOperations<F, R, Args...>::destroy(void* storage) {
+    delete *static_cast<F**>(storage);
+}
+
+template <typename F, typename R, typename... Args>
+const InplaceFunctionVTable<R, Args...> HeapStorageOperations<F, R, Args...>::VTable = {
+    &HeapStorageOperations<F, R, Args...>::invoke,
+    &HeapStorageOperations<F, R, Args...>::move,
+    &HeapStorageOperations<F, R, Args...>::destroy,
+    false
+};
+
+/// Stores the callable \p function inside the \p storage
+template <typename F, typename R, typename... Args, typename Function>
+const InplaceFunctionVTable<R, Args...>* storeInplaceFunction(void* storage,
+                                                              Function&& function,
+                                                              std::true_type)
+{
+    new (storage) F(std::forward<Function>(function));
+    return &InplaceStorageOperations<F, R, Args...>::VTable;
+}
+
+/// Allocates the callable \p function on the heap and stores the pointer in \p storage
+template <typename F, typename R, typename... Args, typename Function>
+const InplaceFunctionVTable<R, Args...>* storeInplaceFunction(void* storage,
+                                                              Function&& function,
+                                                              std::false_type)
+{
+    new (storage) F*(new F(std::forward<Function>(function)));
+    return &HeapStorageOperations<F, R, Args...>::VTable;
+}
+
+} // namespace internal
+
+template <typename R, typename... Args, size_t Capacity>
+InplaceFunction<R(Args...), Capacity>::InplaceFunction() noexcept
+    : _vtable(nullptr)
+{}
+
+template <typename R, typename... Args, size_t Capacity>
+InplaceFunction<R(Args...), Capacity>::InplaceFunction(std::nullptr_t) noexcept
+    : _vtable(nullptr)
+{}
+
+template <typename R, typename... Args, size_t Capacity>
+template <typename Function, typename>
+InplaceFunction<R(Args...), Capacity>::InplaceFunction(Function&& function)
+    : _vtable(nullptr)
+{
+    using F = typename std::decay<Function>::type;
+    static_assert(
+        sizeof(F*) <= Capacity,
+        "The capacity has to be big enough to store a pointer"
+    );
+
+    _vtable = internal::storeInplaceFunction<F, R, Args...>(
+        &_storage,
+        std::forward<Function>(function),
+        std::integral_constant<bool, fitsInplace<F>()>()
+    );
+}
+
+template <typename R, typename... Args, size_t Capacity>
+InplaceFunction<R(Args...), Capacity>::InplaceFunction(InplaceFunction&& other) noexcept
+    : _vtable(other._vtable)
+{
+    if (_vtable) {
+        _vtable->move(&_storage, &other._storage);
+        other._vtable = nullptr;
+    }
+}
+
+template <typename R, typename... Args, size_t Capacity>
+InplaceFunction<R(Args...), Capacity>::~InplaceFunction() {
+    reset();
+}
+
+template <typename R, typename... Args, size_t Capacity>
+InplaceFunction<R(Args...), Capacity>&
+InplaceFunction<R(Args...), Capacity>::operator=(InplaceFunction&& other) noexcept {
+    if (this != &other) {
+        reset();
+        if (other._vtable) {
+            _vtable = other._vtable;
+            _vtable->move(&_storage, &other._storage);
+            other._vtable = nullptr;
+        }
+    }
+    return *this;
+}
+
+template <typename R, typename... Args, size_t Capacity>
+R InplaceFunction<R(Args...), Capacity>::operator()(Args... args) {
+    ghoul_assert(_vtable, "InplaceFunction must not be empty");
+
+    return _vtable->invoke(&_storage, std::forward<Args>(args)...);
+}
+
+template <typename R, typename... Args, size_t Capacity>
+InplaceFunction<R(Args...), Capacity>::operator bool() const noexcept {
+    return _vtable != nullptr;
+}
+
+template <typename R, typename... Args, size_t Capacity>
+bool InplaceFunction<R(Args...), Capacity>::isStoredInplace() const {
+    ghoul_assert(_vtable, "InplaceFunction must not be empty");
+
+    return _vtable->isInplace;
+}
+
+template <typename R, typename... Args, size_t Capacity>
+template <typename Function>
+constexpr bool InplaceFunction<R(Args...), Capacity>::fitsInplace() {
+    // We can only store a callable inside this object if moving it cannot throw, as
+    // the move constructor of the InplaceFunction is noexcept
+    return sizeof(Function) <= Capacity &&
+        alignof(std::max_align_t) % alignof(Function) == 0 &&
+        std::is_nothrow_move_constructible<Function>::value;
+}
+
+template <typename R, typename... Args, size_t Capacity>
+void InplaceFunction<R(Args...), Capacity>::reset() noexcept {
+    if (_vtable) {
+        _vtable->destroy(&_storage);
+        _vtable = nullptr;
+    }
+}
+
+} // namespace ghoul
@@ -0,0 +1,149 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#ifndef __MAINTHREADEXECUTOR_H__
+#define __MAINTHREADEXECUTOR_H__
+
+#include <ghoul/misc/inplacefunction.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+
+namespace ghoul {
+
+/**
+ * The MainThreadExecutor runs tasks on one specific thread, usually the thread that owns
+ * the OpenGL context. Work that has to happen on that thread, for example
+ * <code>Texture::uploadTexture</code>, <code>VertexBufferObject::initialize</code>, or
+ * <code>ProgramObject::Build</code>, can be handed to the executor from any thread using
+ * #queue or #post. The tasks are collected in a lock-free queue, so producers never block
+ * on the context thread, and are executed in the order in which they were queued when
+ * the owning thread calls #pump. The time budget that is passed to #pump makes it
+ * possible to spread expensive uploads over several frames instead of stalling a single
+ * frame. Example:
+ *\verbatim
+pool.post([&executor, file]() {
+    std::unique_ptr<Texture> texture = loadTexture(file);
+    executor.post([t = texture.release()]() { t->uploadTexture(); });
+});
+
+// In the render loop
+executor.pump(std::chrono::milliseconds(2));
+\endverbatim
+ * Tasks that are still queued when the MainThreadExecutor is destroyed are destroyed
+ * without being executed, so that waiting futures receive a
+ * <code>std::future_errc::broken_promise</code> error.
+ */
+class MainThreadExecutor {
+public:
+    /// The type of the tasks that are executed
+    using Task = InplaceFunction<void()>;
+
+    /// Creates an empty MainThreadExecutor
+    MainThreadExecutor();
+
+    /// Destroys all tasks that have not been executed yet
+    ~MainThreadExecutor();
+
+    MainThreadExecutor(const MainThreadExecutor&) = delete;
+    MainThreadExecutor& operator=(const MainThreadExecutor&) = delete;
+
+    /**
+     * Queues the function \p f with the arguments \p arg to be executed by the next call
+     * to #pump and returns a future to the result of the function. This method can be
+     * called from any thread.
+     * \param f The function that is executed on the thread calling #pump
+     * \param arg The arguments that are passed to the function \p f
+     * \return A future to the result of the function
+     */
+    template <typename F, typename... Arg>
+    auto queue(F&& f, Arg&&... arg) -> std::future<decltype(f(arg...))>;
+
+    /**
+     * Queues the \p function to be executed by the next call to #pump without creating a
+     * future. This avoids the shared state of the future for fire-and-forget work. This
+     * method can be called from any thread.
+     * \param function The function that is executed on the thread calling #pump
+     */
+    template <typename Function>
+    void post(Function&& function);
+
+    /**
+     * Executes the queued tasks in the order in which they were queued until either no
+     * more tasks are available or the \p timeBudget is used up. The budget is checked
+     * after each task, so at least one task is executed if any is available and a long
+     * task can exceed the budget. Tasks that are queued while this method is running,
+     * including tasks queued by the executed tasks themselves, are executed by the next
+     * call. Exceptions thrown by a task are propagated to the caller, the remaining tasks
+     * stay queued.
+     * \param timeBudget The time after which no more tasks are started
+     * \return The number of tasks that have been executed
+     * \pre This method must only be called by one thread at a time and must not be called
+     *      from within a task that is executed by it
+     */
+    int pump(std::chrono::microseconds timeBudget = std::chrono::microseconds::max());
+
+    /**
+     * Returns whether there are tasks that have not been executed yet.
+     * \return <code>true</code> if there are tasks that have not been executed yet
+     * \pre This method must only be called from the thread that calls #pump
+     */
+    bool hasPendingTasks() const;
+
+private:
+    /// A single queued task that is linked to the task that was queued before it
+    struct Node {
+        Task task;
+        Node* next;
+    };
+
+    /// Adds the \p task to the lock-free list of incoming tasks
+    void pushTask(Task&& task);
+
+    /**
+     * Moves all incoming tasks to the end of the list of pending tasks, which is only
+     * accessed by the thread calling #pump.
+     */
+    void collectIncomingTasks();
+
+    /// The most recently queued task. The tasks are linked from the newest to the oldest
+    std::atomic<Node*> _incoming;
+
+    /// The oldest task that is ready to be executed by #pump
+    Node* _pendingFront;
+    /// The newest task that is ready to be executed by #pump
+    Node* _pendingBack;
+
+    /// Used to detect recursive calls to #pump
+    bool _isPumping;
+};
+
+} // namespace ghoul
+
+#include "mainthreadexecutor.inl"
+
+#endif // __MAINTHREADEXECUTOR_H__
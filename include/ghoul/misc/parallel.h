@@ -0,0 +1,237 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#ifndef __PARALLEL_H__
+#define __PARALLEL_H__
+
+#include <ghoul/misc/threadpool.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <iterator>
+#include <mutex>
+
+namespace ghoul {
+
+namespace internal {
+
+/**
+ * This class hands out chunks of the half-open range <code>[begin, end)</code> to all
+ * threads that participate in one of the parallel algorithms and keeps track of how many
+ * of the items have been finished. The chunks are handed out adaptively: while a lot of
+ * work remains, large chunks are used to keep the synchronization overhead low and the
+ * chunks become smaller towards the end of the range to balance the load between the
+ * participants. No chunk is smaller than the grain size, except for the very last one.
+ * \tparam Index The integral type that is used to describe the range
+ */
+template <typename Index>
+class ParallelRange {
+public:
+    /**
+     * Creates a range that will be processed by \p nParticipants threads.
+     * \param begin The first index of the range
+     * \param end The index one past the last index of the range
+     * \param grainSize The smallest number of items that are handed out in one chunk
+     * \param nParticipants The number of threads that work on this range
+     * \pre \p begin must be smaller or equal to \p end
+     * \pre \p grainSize must be bigger than 0
+     * \pre \p nParticipants must be bigger than 0
+     */
+    ParallelRange(Index begin, Index end, Index grainSize, int nParticipants);
+
+    /**
+     * Claims the next chunk of the range. If there are no more items left, this function
+     * returns <code>false</code> and does not modify the \p chunkBegin and \p chunkEnd.
+     * \param chunkBegin The first index of the claimed chunk
+     * \param chunkEnd The index one past the last index of the claimed chunk
+     * \return <code>true</code> if a chunk was claimed, <code>false</code> otherwise
+     */
+    bool claim(Index& chunkBegin, Index& chunkEnd);
+
+    /**
+     * Marks \p count items as finished. Once all items of the range are finished, all
+     * threads that are waiting in #wait are woken up.
+     * \param count The number of items that have been finished
+     */
+    void finish(Index count);
+
+    /**
+     * Stores the \p exception if it is the first exception that was reported and marks
+     * all items that have not been claimed yet as finished, so that no further chunks are
+     * handed out.
+     * \param exception The exception that occurred while processing a chunk
+     */
+    void abort(std::exception_ptr exception);
+
+    /**
+     * Blocks until all items of the range have been finished and rethrows the first
+     * exception that was reported by #abort, if there was one.
+     */
+    void wait();
+
+private:
+    // The first index that has not been claimed yet
+    std::atomic<Index> _next;
+    // The end of the range
+    const Index _end;
+    // The total number of items in the range
+    const Index _count;
+    // The smallest chunk that is handed out
+    const Index _grainSize;
+    // The number of threads among which the remaining work is distributed
+    const Index _nParticipants;
+
+    // The number of items that have been finished
+    std::atomic<Index> _nFinished;
+
+    // Protects the _exception and is used together with _finishedCondition
+    std::mutex _mutex;
+    std::condition_variable _finishedCondition;
+    // The first exception that occurred in any of the participants
+    std::exception_ptr _exception;
+};
+
+/**
+ * Calls the \p chunkFunction for consecutive chunks of the range
+ * <code>[begin, end)</code> on the calling thread and on up to ThreadPool::size Worker%s
+ * of the \p pool. Only one task is queued for each participating Worker, regardless of
+ * the number of chunks, and the calling thread only waits once, after it has run out of
+ * chunks itself. As the calling thread participates, this function is safe to call from
+ * inside a task that is executed by the \p pool.
+ * \param pool The ThreadPool whose Worker%s participate
+ * \param begin The first index of the range
+ * \param end The index one past the last index of the range
+ * \param grainSize The smallest number of items that are processed in one chunk
+ * \param chunkFunction The function that is called as
+ * <code>chunkFunction(chunkBegin, chunkEnd)</code> for each chunk
+ * \throw Rethrows the first exception that was thrown by the \p chunkFunction or,
+ * after all chunks have been processed, the exception that was thrown while queueing
+ * a task in the \p pool
+ * \pre \p grainSize must be bigger than 0
+ */
+template <typename Index, typename ChunkFunction>
+void parallelChunks(ThreadPool& pool, Index begin, Index end, Index grainSize,
+    const ChunkFunction& chunkFunction);
+
+} // namespace internal
+
+/**
+ * Calls the \p function for every index in the half-open range <code>[begin, end)</code>
+ * using the Worker%s of the \p pool and the calling thread. The range is split into
+ * chunks adaptively, with no chunk being smaller than \p grainSize, except for the last.
+ * Only one task is queued per participating Worker and this function returns after all
+ * indices have been processed. The order in which the indices are processed is
+ * unspecified. Example:
+ *\verbatim
+std::vector<float> v(100000);
+ghoul::parallelFor(pool, size_t(0), v.size(), size_t(1024), [&v](size_t i) {
+    v[i] = std::sqrt(static_cast<float>(i));
+});
+\endverbatim
+ * \tparam Index The integral type that is used for the indices
+ * \tparam Function The type of the function that is called for each index
+ * \param pool The ThreadPool whose Worker%s are used
+ * \param begin The first index that is processed
+ * \param end The index one past the last index that is processed
+ * \param grainSize The smallest number of indices that are processed in one chunk.
+ * Larger values reduce the overhead for very small functions
+ * \param function The function that is called as <code>function(i)</code> for every
+ * index <code>i</code>
+ * \throw Rethrows the first exception that was thrown by the \p function. If an exception
+ * is thrown, the remaining indices might not be processed
+ * \pre \p grainSize must be bigger than 0
+ */
+template <typename Index, typename Function>
+void parallelFor(ThreadPool& pool, Index begin, Index end, Index grainSize,
+    Function&& function);
+
+/**
+ * Combines the results of calling the \p function for every index in the half-open range
+ * <code>[begin, end)</code> using the \p reduction and the Worker%s of the \p pool and
+ * the calling thread. Every chunk is reduced locally starting from the \p identity and
+ * the partial results are combined afterwards. As the chunks are processed in an
+ * unspecified order, the \p reduction has to be associative and commutative. Example:
+ *\verbatim
+double sum = ghoul::parallelReduce(
+    pool, 0, 1000000, 4096, 0.0,
+    [](int i) { return 1.0 / (i + 1.0); },
+    [](double a, double b) { return a + b; }
+);
+\endverbatim
+ * \tparam Index The integral type that is used for the indices
+ * \tparam T The type of the result
+ * \tparam Function The type of the function that is called for each index
+ * \tparam Reduction The type of the function that combines two results
+ * \param pool The ThreadPool whose Worker%s are used
+ * \param begin The first index that is processed
+ * \param end The index one past the last index that is processed
+ * \param grainSize The smallest number of indices that are processed in one chunk
+ * \param identity The identity element of the \p reduction, which is also the result for
+ * an empty range
+ * \param function The function that is called as <code>function(i)</code> for every
+ * index <code>i</code> and returns a value convertible to <code>T</code>
+ * \param reduction The function that is called as <code>reduction(a, b)</code> to combine
+ * two values of type <code>T</code>
+ * \return The combination of all results
+ * \throw Rethrows the first exception that was thrown by the \p function or the
+ * \p reduction
+ * \pre \p grainSize must be bigger than 0
+ */
+template <typename Index, typename T, typename Function, typename Reduction>
+T parallelReduce(ThreadPool& pool, Index begin, Index end, Index grainSize, T identity,
+    Function&& function, Reduction&& reduction);
+
+/**
+ * Writes the result of calling the \p function on each element of the range
+ * <code>[first, last)</code> to the range beginning at \p destination using the
+ * Worker%s of the \p pool and the calling thread. This is the parallel equivalent to
+ * <code>std::transform</code>, but the order in which the elements are processed is
+ * unspecified.
+ * \tparam InputIterator A random access iterator type of the input range
+ * \tparam OutputIterator A random access iterator type of the output range
+ * \tparam Function The type of the function that is called for each element
+ * \param pool The ThreadPool whose Worker%s are used
+ * \param first The beginning of the input range
+ * \param last The end of the input range
+ * \param destination The beginning of the output range, which has to be at least as big
+ * as the input range
+ * \param grainSize The smallest number of elements that are processed in one chunk
+ * \param function The function that is called for each element of the input range
+ * \return The iterator one past the last element that was written
+ * \throw Rethrows the first exception that was thrown by the \p function
+ * \pre \p grainSize must be bigger than 0
+ */
+template <typename InputIterator, typename OutputIterator, typename Function>
+OutputIterator parallelTransform(ThreadPool& pool, InputIterator first,
+    InputIterator last, OutputIterator destination,
+    typename std::iterator_traits<InputIterator>::difference_type grainSize,
+    Function&& function);
+
+} // namespace ghoul
+
+#include "parallel.inl"
+
+#endif // __PARALLEL_H__
@@ -0,0 +1,232 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include <ghoul/misc/assert.h>
+
+#include <algorithm>
+#include <memory>
+
+namespace ghoul {
+
+namespace internal {
+
+template <typename Index>
+ParallelRange<Index>::ParallelRange(Index begin, Index end, Index grainSize,
+                                    int nParticipants)
+    : _next(begin)
+    , _end(end)
+    , _count(end - begin)
+    , _grainSize(grainSize)
+    , _nParticipants(static_cast<Index>(nParticipants))
+    , _nFinished(0)
+{
+    ghoul_assert(begin <= end, "Begin must not be bigger than end");
+    ghoul_assert(grainSize > 0, "Grain size must be bigger than 0");
+    ghoul_assert(nParticipants > 0, "Number of participants must be bigger than 0");
+}
+
+template <typename Index>
+bool ParallelRange<Index>::claim(Index& chunkBegin, Index& chunkEnd) {
+    Index current = _next.load();
+    while (current < _end) {
+        // Guided scheduling: every participant gets about half of its fair share of the
+        // remaining work, so the chunks shrink as we approach the end of the range
+        const Index remaining = _end - current;
+        const Index chunk = std::min(
+            remaining,
+            std::max(_grainSize, static_cast<Index>(remaining / (2 * _nParticipants)))
+        );
+
+        if (_next.compare_exchange_weak(current, current + chunk)) {
+            chunkBegin = current;
+            chunkEnd = current + chunk;
+            return true;
+        }
+        // If the exchange failed, 'current' has been updated and we try again
+    }
+    return false;
+}
+
+template <typename Index>
+void ParallelRange<Index>::finish(Index count) {
+    if (_nFinished.fetch_add(count) + count == _count) {
+        // We have to take the lock before notifying, as the waiting thread might
+        // otherwise check the condition and go to sleep after we notified
+        std::lock_guard<std::mutex> lock(_mutex);
+        _finishedCondition.notify_all();
+    }
+}
+
+template <typename Index>
+void ParallelRange<Index>::abort(std::exception_ptr exception) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_exception) {
+            _exception = std::move(exception);
+        }
+    }
+
+    // No more chunks will be handed out and the ones that never were count as finished
+    const Index previous = _next.exchange(_end);
+    if (previous < _end) {
+        finish(_end - previous);
+    }
+}
+
+template <typename Index>
+void ParallelRange<Index>::wait() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _finishedCondition.wait(lock, [this]() { return _nFinished.load() == _count; });
+
+    if (_exception) {
+        std::rethrow_exception(_exception);
+    }
+}
+
+template <typename Index, typename ChunkFunction>
+void parallelChunks(ThreadPool& pool, Index begin, Index end, Index grainSize,
+                    const ChunkFunction& chunkFunction)
+{
+    ghoul_assert(grainSize > 0, "Grain size must be bigger than 0");
+
+    if (!(begin < end)) {
+        return;
+    }
+
+    // There is no point in waking up more Workers than there are chunks
+    const Index nChunks = (end - begin + grainSize - 1) / grainSize;
+    const int nHelpers = static_cast<int>(
+        std::min(static_cast<Index>(pool.size()), static_cast<Index>(nChunks - 1))
+    );
+
+    // The range is shared with the helper tasks, as a helper might only be started after
+    // we have returned. In that case it will not find any chunks to process and will
+    // never touch the 'chunkFunction'
+    auto range = std::make_shared<ParallelRange<Index>>(
+        begin, end, grainSize, nHelpers + 1
+    );
+
+    auto participate = [range, &chunkFunction]() {
+        Index chunkBegin;
+        Index chunkEnd;
+        while (range->claim(chunkBegin, chunkEnd)) {
+            try {
+                chunkFunction(chunkBegin, chunkEnd);
+            }
+            catch (...) {
+                range->abort(std::current_exception());
+            }
+            range->finish(chunkEnd - chunkBegin);
+        }
+    };
+
+    // If queueing a helper fails, for example as the pool rejects it, the helpers that
+    // have already been queued still reference the 'chunkFunction'. So we cannot leave
+    // before the range has been processed and only report the error afterwards
+    std::exception_ptr queueError;
+    for (int i = 0; i < nHelpers; ++i) {
+        // We don't need a future as the completion is tracked by the range
+        try {
+            pool.post(participate);
+        }
+        catch (...) {
+            queueError = std::current_exception();
+            break;
+        }
+    }
+
+    // The calling thread participates as well, which also guarantees progress if we are
+    // called from a Worker of a busy pool
+    participate();
+    range->wait();
+
+    if (queueError) {
+        std::rethrow_exception(queueError);
+    }
+}
+
+} // namespace internal
+
+template <typename Index, typename Function>
+void parallelFor(ThreadPool& pool, Index begin, Index end, Index grainSize,
+                 Function&& function)
+{
+    internal::parallelChunks(
+        pool, begin, end, grainSize,
+        [&function](Index chunkBegin, Index chunkEnd) {
+            for (Index i = chunkBegin; i < chunkEnd; ++i) {
+                function(i);
+            }
+        }
+    );
+}
+
+template <typename Index, typename T, typename Function, typename Reduction>
+T parallelReduce(ThreadPool& pool, Index begin, Index end, Index grainSize, T identity,
+                 Function&& function, Reduction&& reduction)
+{
+    T result = identity;
+    std::mutex resultMutex;
+
+    internal::parallelChunks(
+        pool, begin, end, grainSize,
+        [&](Index chunkBegin, Index chunkEnd) {
+            // Each chunk is reduced without any synchronization and only the partial
+            // result is combined with the total
+            T partial = identity;
+            for (Index i = chunkBegin; i < chunkEnd; ++i) {
+                partial = reduction(std::move(partial), function(i));
+            }
+
+            std::lock_guard<std::mutex> lock(resultMutex);
+            result = reduction(std::move(result), std::move(partial));
+        }
+    );
+
+    return result;
+}
+
+template <typename InputIterator, typename OutputIterator, typename Function>
+OutputIterator parallelTransform(ThreadPool& pool, InputIterator first,
+    InputIterator last, OutputIterator destination,
+    typename std::iterator_traits<InputIterator>::difference_type grainSize,
+    Function&& function)
+{
+    using Difference = typename std::iterator_traits<InputIterator>::difference_type;
+
+    const Difference count = std::distance(first, last);
+    internal::parallelChunks(
+        pool, Difference(0), count, grainSize,
+        [&](Difference chunkBegin, Difference chunkEnd) {
+            for (Difference i = chunkBegin; i < chunkEnd; ++i) {
+                destination[i] = function(first[i]);
+            }
+        }
+    );
+
+    return destination + count;
+}
+
+} // namespace ghoul
@@ -0,0 +1,275 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include <ghoul/misc/threadpool.h>
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace ghoul {
+
+template <typename T>
+class PipelineBuilder;
+
+/**
+ * A Pipeline processes a stream of items in a ThreadPool by passing each item through a
+ * sequence of stages. The items are produced one at a time by a source and the stages
+ * of different items run concurrently, so that, for example, one file is read while the
+ * previous one is decoded and another one is compressed. The number of items that are
+ * in flight at the same time is limited by the number of tokens, so the memory that is
+ * needed is determined by the number of tokens rather than by the size of the data set.
+ *
+ * Each stage is either Mode::Serial or Mode::Parallel. A serial stage processes one item
+ * at a time in the order in which the items were produced, which is needed for stages
+ * that write to a file or hold other state. A parallel stage processes any number of
+ * items concurrently. Items that arrive at a serial stage out of order wait for their
+ * predecessors without blocking a Worker.
+ *
+ * A Pipeline is created with the #makePipeline function and the PipelineBuilder that it
+ * returns. Example:
+ *\verbatim
+std::future<void> done = ghoul::makePipeline(
+    pool,
+    8,
+    [&files, i = size_t(0)](ghoul::Pipeline::FlowControl& fc) mutable {
+        if (i == files.size()) {
+            fc.stop();
+            return std::string();
+        }
+        return files[i++];
+    })
+    .then(ghoul::Pipeline::Mode::Parallel, [](std::string f) { return decode(f); })
+    .then(ghoul::Pipeline::Mode::Parallel, [](Image image) { return compress(image); })
+    .run(ghoul::Pipeline::Mode::Serial, [&cache](Buffer data) { cache.write(data); });
+done.get();
+\endverbatim
+ *
+ * If a stage throws an exception, no new items are produced and the items that are in
+ * flight are discarded. The first exception is stored in the future that is returned by
+ * PipelineBuilder::run.
+ */
+class Pipeline : public std::enable_shared_from_this<Pipeline> {
+public:
+    /// Determines whether a stage processes its items one at a time or concurrently
+    enum class Mode {
+        Serial = 0, ///< One item at a time, in the order in which they were produced
+        Parallel    ///< Any number of items concurrently, in any order
+    };
+
+    /**
+     * The FlowControl is passed to the source of a Pipeline, which calls #stop when it
+     * has no more items to produce.
+     */
+    class FlowControl {
+    public:
+        FlowControl();
+
+        /// Signals that the source has no more items. The returned value is discarded
+        void stop();
+
+        /// Returns whether #stop has been called
+        bool isStopped() const;
+
+    private:
+        bool _isStopped;
+    };
+
+    /// The type-erased value of an item that is passed between the stages
+    using Value = std::shared_ptr<void>;
+
+    /// The type-erased source that produces the items
+    using Source = std::function<Value(FlowControl&)>;
+
+    /// A type-erased stage that transforms the value of an item into a new value
+    struct Stage {
+        Mode mode;
+        std::function<Value(Value)> function;
+    };
+
+    /**
+     * Starts a Pipeline in the \p pool that passes the items produced by the \p source
+     * through the \p stages. This function is used by the PipelineBuilder and returns
+     * immediately.
+     * \param pool The ThreadPool that executes the source and the stages
+     * \param nTokens The maximum number of items that are in flight at the same time
+     * \param source The function that produces the items
+     * \param stages The stages that each item passes through in order
+     * \return A future that becomes ready once all items have passed through all stages
+     * \pre \p nTokens must be bigger than 0
+     */
+    static std::future<void> run(ThreadPool& pool, int nTokens, Source source,
+        std::vector<Stage> stages);
+
+private:
+    /// A single item together with its position in the stream of items
+    struct Item {
+        uint64_t sequence;
+        Value value;
+        /// Is <code>false</code> if the item has been discarded after an exception
+        bool isValid;
+    };
+
+    /**
+     * The state of a serial stage. Only the item whose sequence number is
+     * <code>next</code> can enter the stage; items that arrive early are parked in
+     * <code>waiting</code> until it is their turn.
+     */
+    struct SerialState {
+        std::mutex mutex;
+        uint64_t next = 0;
+        std::map<uint64_t, Item> waiting;
+    };
+
+    Pipeline(ThreadPool& pool, int nTokens, Source source, std::vector<Stage> stages);
+
+    /**
+     * Produces one item if a token is available and the source is not running already,
+     * and passes the item through the stages. Another production is queued before the
+     * item is processed, so that the Pipeline fills up to the number of tokens.
+     */
+    void produce();
+
+    /**
+     * Passes the \p item through the stages, starting at the stage with index
+     * \p first. If the \p item has to wait at a serial stage, it is parked there and this
+     * function returns. Items that are waiting at a serial stage are queued in the
+     * ThreadPool once it is their turn.
+     */
+    void process(Item item, size_t first);
+
+    /// Applies the \p stage to the \p item unless the item or the Pipeline have failed
+    void apply(Item& item, const Stage& stage);
+
+    /// Releases the token of an item that has passed all stages
+    void finishItem();
+
+    /// Remembers the first exception and stops the production of new items
+    void fail(std::exception_ptr e);
+
+    /// Fulfills the promise once the last item has been finished
+    void complete();
+
+    ThreadPool& _pool;
+    const int _nTokens;
+    Source _source;
+    const std::vector<Stage> _stages;
+    /// One state for each stage; only the states of serial stages are used
+    std::vector<SerialState> _serialStates;
+
+    /// Protects the following members that control the production of items
+    std::mutex _mutex;
+    int _nInFlight;
+    uint64_t _nextSequence;
+    bool _isProducing;
+    bool _isSourceFinished;
+
+    std::atomic_bool _hasFailed;
+    /// The first exception, protected by <code>_mutex</code>
+    std::exception_ptr _exception;
+    std::promise<void> _promise;
+};
+
+/**
+ * The PipelineBuilder is used to add stages to a Pipeline. Each stage receives the
+ * result of the previous stage, so the type of the items can change from stage to stage.
+ * \tparam T The type of the items that are produced by the last stage that was added
+ */
+template <typename T>
+class PipelineBuilder {
+public:
+    /**
+     * Creates a PipelineBuilder for the \p source and the \p stages that were added so
+     * far. This constructor is not meant to be called directly; use #makePipeline
+     * instead.
+     */
+    PipelineBuilder(ThreadPool& pool, int nTokens, Pipeline::Source source,
+        std::vector<Pipeline::Stage> stages);
+
+    /**
+     * Adds a stage that calls the \p function for each item and passes its result to the
+     * next stage.
+     * \tparam Function The type of the function that is called with an item of type
+     *         \p T
+     * \param mode Whether the stage is serial or parallel
+     * \param function The function that is called for each item
+     * \return The PipelineBuilder to add further stages
+     */
+    template <typename Function>
+    auto then(Pipeline::Mode mode, Function&& function)
+        -> PipelineBuilder<std::decay_t<decltype(function(std::declval<T>()))>>;
+
+    /**
+     * Adds the last stage, which consumes the items, and starts the Pipeline.
+     * \tparam Function The type of the function that is called with an item of type
+     *         \p T
+     * \param mode Whether the last stage is serial or parallel
+     * \param function The function that is called for each item
+     * \return A future that becomes ready once all items have passed through all stages.
+     *         It must not be waited for by a Worker of the same ThreadPool
+     */
+    template <typename Function>
+    std::future<void> run(Pipeline::Mode mode, Function&& function);
+
+private:
+    ThreadPool& _pool;
+    int _nTokens;
+    Pipeline::Source _source;
+    std::vector<Pipeline::Stage> _stages;
+};
+
+/**
+ * Starts to build a Pipeline that is executed in the \p pool with at most \p nTokens
+ * items in flight. The \p source is called repeatedly, one call at a time, to produce
+ * the items until it calls Pipeline::FlowControl::stop.
+ * \tparam Function The type of the source function
+ * \param pool The ThreadPool that executes the Pipeline
+ * \param nTokens The maximum number of items that are in flight at the same time
+ * \param source The function that is called with a Pipeline::FlowControl and returns the
+ *        next item
+ * \return The PipelineBuilder to add the stages
+ * \pre \p nTokens must be bigger than 0
+ */
+template <typename Function>
+auto makePipeline(ThreadPool& pool, int nTokens, Function&& source)
+    -> PipelineBuilder<std::decay_t<decltype(
+        source(std::declval<Pipeline::FlowControl&>())
+    )>>;
+
+} // namespace ghoul
+
+#include "pipeline.inl"
+
+#endif // __PIPELINE_H__
@@ -0,0 +1,94 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include <ghoul/misc/assert.h>
+
+namespace ghoul {
+
+template <typename T>
+PipelineBuilder<T>::PipelineBuilder(ThreadPool& pool, int nTokens,
+                                    Pipeline::Source source,
+                                    std::vector<Pipeline::Stage> stages)
+    : _pool(pool)
+    , _nTokens(nTokens)
+    , _source(std::move(source))
+    , _stages(std::move(stages))
+{}
+
+template <typename T>
+template <typename Function>
+auto PipelineBuilder<T>::then(Pipeline::Mode mode, Function&& function)
+    -> PipelineBuilder<std::decay_t<decltype(function(std::declval<T>()))>>
+{
+    using U = std::decay_t<decltype(function(std::declval<T>()))>;
+
+    _stages.push_back({
+        mode,
+        [f = std::forward<Function>(function)](Pipeline::Value v) mutable
+            -> Pipeline::Value
+        {
+            return std::make_shared<U>(f(std::move(*static_cast<T*>(v.get()))));
+        }
+    });
+    return PipelineBuilder<U>(_pool, _nTokens, std::move(_source), std::move(_stages));
+}
+
+template <typename T>
+template <typename Function>
+std::future<void> PipelineBuilder<T>::run(Pipeline::Mode mode, Function&& function) {
+    _stages.push_back({
+        mode,
+        [f = std::forward<Function>(function)](Pipeline::Value v) mutable
+            -> Pipeline::Value
+        {
+            f(std::move(*static_cast<T*>(v.get())));
+            return nullptr;
+        }
+    });
+    return Pipeline::run(_pool, _nTokens, std::move(_source), std::move(_stages));
+}
+
+template <typename Function>
+auto makePipeline(ThreadPool& pool, int nTokens, Function&& source)
+    -> PipelineBuilder<std::decay_t<decltype(
+        source(std::declval<Pipeline::FlowControl&>())
+    )>>
+{
+    ghoul_assert(nTokens > 0, "nTokens must be bigger than 0");
+    using T = std::decay_t<decltype(source(std::declval<Pipeline::FlowControl&>()))>;
+
+    Pipeline::Source s = [f = std::forward<Function>(source)](
+                             Pipeline::FlowControl& fc) mutable -> Pipeline::Value
+    {
+        T value = f(fc);
+        if (fc.isStopped()) {
+            return nullptr;
+        }
+        return std::make_shared<T>(std::move(value));
+    };
+    return PipelineBuilder<T>(pool, nTokens, std::move(s), {});
+}
+
+} // namespace ghoul
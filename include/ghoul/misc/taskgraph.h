@@ -0,0 +1,156 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#ifndef __TASKGRAPH_H__
+#define __TASKGRAPH_H__
+
+#include <ghoul/misc/continuation.h>
+#include <ghoul/misc/exception.h>
+#include <ghoul/misc/threadpool.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ghoul {
+
+/**
+ * A TaskGraph describes a set of tasks together with the dependencies between them. When
+ * the graph is #run, each task is queued in the ThreadPool as soon as all of its
+ * predecessors have finished, so no Worker is ever blocked waiting for another task.
+ * Tasks without a dependency between them can be executed in parallel. Example:
+ *\verbatim
+ghoul::TaskGraph graph(pool);
+ghoul::TaskGraph::NodeId decode = graph.addTask([]() { decode(); });
+ghoul::TaskGraph::NodeId convert = graph.addTask([]() { convert(); });
+ghoul::TaskGraph::NodeId compress = graph.addTask([]() { compress(); });
+ghoul::TaskGraph::NodeId write = graph.addTask([]() { writeCache(); });
+graph.addDependency(decode, convert);
+graph.addDependency(convert, compress);
+graph.addDependency(compress, write);
+graph.run().wait();
+\endverbatim
+ * If one of the tasks throws an exception, no further tasks are started and the
+ * exception is stored in the Continuable returned by #run. The same TaskGraph can be run
+ * multiple times, also concurrently; each run executes every task exactly once. The
+ * ThreadPool has to outlive all runs of the TaskGraph.
+ */
+class TaskGraph {
+public:
+    /// The exception that is thrown if the TaskGraph is used incorrectly
+    struct TaskGraphError : public RuntimeError {
+        explicit TaskGraphError(std::string message);
+    };
+
+    /// The identifier of a task in the TaskGraph
+    using NodeId = int;
+
+    /**
+     * Creates an empty TaskGraph whose tasks will be executed by the \p pool.
+     * \param pool The ThreadPool that executes the tasks of this TaskGraph
+     */
+    explicit TaskGraph(ThreadPool& pool);
+
+    /**
+     * Adds the \p task to this TaskGraph, which will be queued with the provided
+     * \p priority.
+     * \param task The task that is added
+     * \param priority The Priority with which the task is queued
+     * \return The identifier of the added task that can be used to add dependencies
+     * \pre \p task must not be empty
+     */
+    NodeId addTask(std::function<void()> task,
+        ThreadPool::Priority priority = ThreadPool::Priority::Normal);
+
+    /**
+     * Adds a dependency between two tasks, such that the \p successor is only started
+     * after the \p predecessor has finished.
+     * \param predecessor The identifier of the task that has to finish first
+     * \param successor The identifier of the task that depends on the \p predecessor
+     * \throw TaskGraphError If \p predecessor or \p successor are not valid identifiers
+     * or if they are the same
+     */
+    void addDependency(NodeId predecessor, NodeId successor);
+
+    /**
+     * Returns the number of tasks in this TaskGraph.
+     * \return The number of tasks in this TaskGraph
+     */
+    int size() const;
+
+    /**
+     * Starts executing this TaskGraph by queueing all tasks without predecessors. The
+     * remaining tasks are queued as their predecessors finish. This function does not
+     * block.
+     * \return A Continuable that becomes ready once all tasks have finished, or holds the
+     * first exception thrown by a task
+     * \throw TaskGraphError If the dependencies of this TaskGraph contain a cycle
+     */
+    Continuable<void> run() const;
+
+private:
+    /// The information about a single task of the TaskGraph
+    struct Node {
+        /// The task that is executed for this node
+        std::function<void()> task;
+        /// The Priority with which the task is queued
+        ThreadPool::Priority priority;
+        /// The nodes that depend on this node
+        std::vector<NodeId> successors;
+        /// The number of nodes this node depends on
+        int nPredecessors;
+    };
+
+    /// The state of a single run of the TaskGraph, which is shared between its tasks
+    struct Execution;
+
+    /// Returns whether the dependencies of this TaskGraph contain a cycle
+    bool hasCycle() const;
+
+    /**
+     * Queues the node with the identifier \p id of the \p execution in the ThreadPool.
+     * \param execution The run of the TaskGraph to which the node belongs
+     * \param id The identifier of the node that is queued
+     */
+    static void queueNode(const std::shared_ptr<Execution>& execution, NodeId id);
+
+    /**
+     * Executes the node with the identifier \p id of the \p execution and queues all of
+     * its successors whose predecessors have all finished afterwards.
+     * \param execution The run of the TaskGraph to which the node belongs
+     * \param id The identifier of the node that is executed
+     */
+    static void executeNode(const std::shared_ptr<Execution>& execution, NodeId id);
+
+    /// The ThreadPool that executes the tasks
+    ThreadPool& _pool;
+    /// All of the nodes of this graph, the NodeId is the index into this vector
+    std::vector<Node> _nodes;
+};
+
+} // namespace ghoul
+
+#endif // __TASKGRAPH_H__
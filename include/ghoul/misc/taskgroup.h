@@ -0,0 +1,161 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#ifndef __TASKGROUP_H__
+#define __TASKGROUP_H__
+
+#include <ghoul/misc/threadpool.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+
+namespace ghoul {
+
+/**
+ * A TaskGroup runs a number of tasks in a ThreadPool and waits for all of them to finish.
+ * In contrast to waiting on the <code>std::future</code>s returned by
+ * ThreadPool::queue, #wait does not block the calling thread while tasks are waiting in
+ * the ThreadPool, but executes them itself (ThreadPool::runPendingTask). This makes
+ * recursive decomposition safe on a ThreadPool of any size: a task that splits its work
+ * into subtasks and waits for them can never deadlock, as it processes the subtasks
+ * itself if no other Worker is available. Example:
+ *\verbatim
+void build(ghoul::ThreadPool& pool, Node& node, int depth) {
+    if (depth == 0) {
+        fill(node);
+        return;
+    }
+    ghoul::TaskGroup group(pool);
+    for (Node& child : node.children) {
+        group.run([&pool, &child, depth]() { build(pool, child, depth - 1); });
+    }
+    group.wait();
+}
+\endverbatim
+ * A TaskGroup can be reused after #wait has returned. The destructor waits for all
+ * remaining tasks, so that they can safely reference variables of the enclosing scope.
+ */
+class TaskGroup {
+public:
+    /**
+     * Creates an empty TaskGroup that queues its tasks in the \p pool.
+     * \param pool The ThreadPool that executes the tasks of this group. It has to outlive
+     *        this TaskGroup
+     * \param priority The Priority with which the tasks of this group are queued
+     */
+    explicit TaskGroup(ThreadPool& pool,
+        ThreadPool::Priority priority = ThreadPool::Priority::Normal);
+
+    /**
+     * Waits for all tasks of this group to finish. Exceptions thrown by the tasks are
+     * ignored; #wait has to be called explicitly to receive them.
+     */
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    /**
+     * Queues the \p function as a task of this group. This function can be called from
+     * any thread, including the tasks of this group, while another thread is waiting.
+     * \tparam Function The type of the function that is called
+     * \param function The function that is called without any arguments
+     */
+    template <typename Function>
+    void run(Function&& function);
+
+    /**
+     * Executes tasks of the ThreadPool until all tasks of this group have finished. While
+     * there are no waiting tasks in the ThreadPool, but tasks of this group are still
+     * running on other threads, the calling thread sleeps for short intervals and checks
+     * for new tasks in between.
+     * \throw The first exception that was thrown by a task of this group. If a task was
+     *        discarded by the ThreadPool without being executed, a
+     *        <code>std::future_error</code> with
+     *        <code>std::future_errc::broken_promise</code> is thrown
+     */
+    void wait();
+
+    /**
+     * Returns whether all tasks of this group have finished.
+     * \return <code>true</code> if no task of this group is waiting or running
+     */
+    bool isFinished() const;
+
+private:
+    /// The interval in which #wait checks for new tasks while the last tasks are running
+    static constexpr std::chrono::microseconds HelpInterval =
+        std::chrono::microseconds(100);
+
+    /// The state that is shared between the TaskGroup and its tasks
+    struct State {
+        State();
+
+        /// Is called for each task after it has finished, failed, or was discarded
+        void finish(std::exception_ptr e);
+
+        /// The number of tasks that have not finished yet
+        std::atomic_int nPending;
+        /// The first exception that was thrown by any of the tasks
+        std::exception_ptr exception;
+        /// Protects the <code>exception</code> and is used for the condition variable
+        std::mutex mutex;
+        /// Notified when the last pending task has finished
+        std::condition_variable allFinished;
+    };
+
+    /**
+     * Is moved into each task and reports the task as finished exactly once. If the task
+     * is destroyed without being executed, the destructor reports a broken promise, so
+     * that #wait does not wait forever.
+     */
+    class Completion {
+    public:
+        explicit Completion(std::shared_ptr<State> state);
+        Completion(Completion&& other) noexcept;
+        Completion(const Completion&) = delete;
+        ~Completion();
+
+        /// Reports the task as finished with the exception \p e, which may be empty
+        void finish(std::exception_ptr e);
+
+    private:
+        std::shared_ptr<State> _state;
+    };
+
+    ThreadPool& _pool;
+    ThreadPool::Priority _priority;
+    std::shared_ptr<State> _state;
+};
+
+} // namespace ghoul
+
+#include "taskgroup.inl"
+
+#endif // __TASKGROUP_H__
@@ -26,7 +26,9 @@
 #ifndef __THREAD_H__
 #define __THREAD_H__
 
+#include <string>
 #include <thread>
+#include <vector>
 
 namespace ghoul {
 namespace thread {
@@ -63,6 +65,90 @@ enum class Background {
     No
 };
 
+/**
+ * Determines how a set of threads is placed onto the logical CPUs of the system. With
+ * any value other than Placement::None, each thread is pinned to a single logical CPU.
+ */
+enum class Placement {
+    /// The threads are not pinned and the operating system is free to migrate them
+    None = 0,
+    /// The threads are pinned to neighboring CPUs, filling one NUMA node before the next
+    /// one is used, so that the threads share as much of the cache hierarchy as possible
+    Compact,
+    /// The threads are pinned to CPUs of alternating NUMA nodes, so that the threads are
+    /// distributed over all nodes and their memory bandwidth
+    Spread
+};
+
+/**
+ * The description of a single logical CPU of the system.
+ */
+struct LogicalCpu {
+    /// The identifier of the logical CPU as used by the operating system
+    int id;
+    /// The identifier of the physical core, which is shared by hyperthreads
+    int core;
+    /// The identifier of the physical package (the socket)
+    int package;
+    /// The NUMA node to which this logical CPU belongs
+    int numaNode;
+};
+
+/**
+ * Returns the identifiers of the logical CPUs that the calling thread is allowed to run
+ * on, which are restricted, for example, by <code>taskset</code> or the cpuset of a
+ * container. This function is supported on Linux and Windows (for the first 64 CPUs) and
+ * returns an empty list on other platforms or if the information is not available.
+ * \return The identifiers of the allowed logical CPUs, sorted and without duplicates
+ */
+std::vector<int> allowedCpus();
+
+/**
+ * Returns the description of all online logical CPUs of the system that the calling
+ * thread is allowed to run on (see #allowedCpus). On Linux, the topology is read from
+ * the <code>sysfs</code> that is located at \p sysfsRoot. On other operating systems,
+ * or if the information is not available, one logical CPU for each allowed CPU or, if
+ * that is unknown as well, for each hardware thread is returned, all of them belonging
+ * to the same package and NUMA node.
+ * \param sysfsRoot The root directory of the <code>sysfs</code> CPU and node information
+ * \return The description of all usable logical CPUs, sorted by their identifier
+ */
+std::vector<LogicalCpu> cpuTopology(
+    const std::string& sysfsRoot = "/sys/devices/system"
+);
+
+/**
+ * Returns the description of all online logical CPUs of the system whose identifiers
+ * are contained in \p allowed. This function behaves like the other overload, but uses
+ * the provided list instead of the affinity of the calling thread.
+ * \param sysfsRoot The root directory of the <code>sysfs</code> CPU and node information
+ * \param allowed The identifiers of the CPUs that may be returned. If this list is empty,
+ * all online CPUs are returned
+ * \return The description of all usable logical CPUs, sorted by their identifier
+ */
+std::vector<LogicalCpu> cpuTopology(const std::string& sysfsRoot,
+    const std::vector<int>& allowed);
+
+/**
+ * Parses a list of CPU or node identifiers in the format that is used by the Linux
+ * kernel, for example <code>0-3,8,10-11</code>. Invalid parts of the list are ignored.
+ * \param list The list that is parsed
+ * \return The identifiers in the list, sorted and without duplicates
+ */
+std::vector<int> parseCpuList(const std::string& list);
+
+/**
+ * Returns the order in which the logical CPUs of the \p topology should be assigned to
+ * a set of threads to achieve the provided \p placement. The <code>i</code>-th thread
+ * should be pinned to the CPU at position <code>i % result.size()</code>. Physical cores
+ * are used before the hyperthreads of an already used core within a NUMA node.
+ * \param topology The logical CPUs that are available
+ * \param placement The desired placement of the threads
+ * \return The identifiers of the logical CPUs in the order in which they should be
+ * assigned, or an empty list if \p placement is Placement::None
+ */
+std::vector<int> cpuOrder(const std::vector<LogicalCpu>& topology, Placement placement);
+
 /**
  * This method sets the priorty of the thread \p t to the ThreadPriorityClass
  * \p priorityClass and the ThreadPriorityLevel to \p priorityLevel.
@@ -89,6 +175,27 @@ void setPriority(
  */
 void setThreadBackground(std::thread& t, Background background);
 
+/**
+ * Restricts the thread \p t to run only on the logical CPUs with the identifiers in
+ * \p cpus. This function is supported on Linux and Windows (for the first 64 CPUs) and
+ * reverts to a no-op on other platforms.
+ * \param t The thread whose affinity is set
+ * \param cpus The identifiers of the logical CPUs the thread is allowed to run on
+ * \throws ghoul::RuntimeError If the affinity could not be set
+ * \pre \p cpus must not be empty
+ */
+void setAffinity(std::thread& t, const std::vector<int>& cpus);
+
+/**
+ * Restricts the calling thread to run only on the logical CPUs with the identifiers in
+ * \p cpus. This function behaves like #setAffinity, but can be used by a thread to pin
+ * itself, for example before it allocates memory that should be local to its NUMA node.
+ * \param cpus The identifiers of the logical CPUs the thread is allowed to run on
+ * \throws ghoul::RuntimeError If the affinity could not be set
+ * \pre \p cpus must not be empty
+ */
+void setCurrentThreadAffinity(const std::vector<int>& cpus);
+
 } // namespace thread
 } // namespace ghoul
 
@@ -46,16 +46,38 @@
 #define __THREADPOOL_H__
 
 #include <ghoul/misc/boolean.h>
+#include <ghoul/misc/cancellationtoken.h>
+#include <ghoul/misc/exception.h>
+#include <ghoul/misc/inplacefunction.h>
 #include <ghoul/misc/thread.h>
+#include <ghoul/misc/timerwheel.h>
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <future>
+#include <iterator>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <string>
 #include <thread>
 #include <tuple>
+#include <utility>
+#include <vector>
+
+#ifdef __cpp_impl_coroutine
+#include <coroutine>
+#endif // __cpp_impl_coroutine
 
 namespace ghoul {
+
+class Dictionary;
+
+namespace internal { struct ThreadPoolAccess; }
  
 /**
  * The ThreadPool is a class that manages a list of threads (= ThreadPool::Worker%s) that
@@ -63,7 +85,9 @@ namespace ghoul {
  * threads but can be #resize%d after the fact, which will change the number of active
  * threads managed by this ThreadPool. Tasks can be queued by the #queue function,
  * which returns a <code>std::future</code> object that contains the possible return value
- * of the passed task. 
+ * of the passed task. If no result is needed, the #post function can be used instead,
+ * which avoids the cost of creating the <code>std::future</code>. Small tasks are stored
+ * inside the queues without any additional memory allocation.
  *
  * Example use-case:
  *\verbatim
@@ -90,12 +114,57 @@ namespace ghoul {
 
 \endverbatim 
  *
- * Tasks passed to the ThreadPool as started in order a strict FIFO ordering.
+ * Each task is queued with a Priority, which selects one of three lanes. Tasks of a
+ * higher Priority are started before waiting tasks of a lower Priority and, within the
+ * same lane, tasks are started in a strict FIFO ordering. To prevent starvation, a lane
+ * that has been passed over too many times in favor of a higher lane is served next, so
+ * that Priority::Background tasks still make progress on a busy ThreadPool.
+ *
+ * If the ThreadPool is created with WorkStealing::Yes, each Worker additionally owns a
+ * local double-ended queue. Tasks that are queued from inside a Worker of the same
+ * ThreadPool are pushed onto that Worker's local queue without touching the shared queue
+ * and the owning Worker processes them in LIFO order. Worker%s that run out of work first
+ * check the shared queue and then steal the oldest tasks from the other Worker%s' local
+ * queues. Tasks queued from outside of the ThreadPool still go through the shared queue
+ * and are started in FIFO order; no ordering guarantees exist for tasks that are queued
+ * from within a Worker in this mode.
  * 
  * Workers can be initialized with custom functions that are passed to the ThreadPool
  * during construction. These functions are called once for each Worker at the beginning
  * and at the end of its lifetime.
  *
+ * Tasks can be tagged with a CancellationToken when they are queued. If the token has
+ * been cancelled or its deadline has passed by the time a Worker would start the task,
+ * the task is dropped without being executed. This way, obsolete work can be discarded
+ * selectively instead of clearing all remaining tasks. Cancelled tasks that are still
+ * waiting are not counted as remaining tasks and are discarded before an OverflowPolicy
+ * is applied, so they do not take up the capacity of the ThreadPool.
+ *
+ * Tasks can also be queued after a delay (#queueAfter) or repeatedly with a fixed period
+ * (#queueEvery). All timers of a ThreadPool are stored in a single TimerWheel that is
+ * served by one timer thread, which is only created once the first timer is added. The
+ * timer thread does not execute the tasks itself, but queues them in the ThreadPool once
+ * their time has come.
+ *
+ * Instead of using a fixed number of Worker%s, the ThreadPool can adjust its size
+ * automatically (#enableAutoScaling). A supervising thread adds Worker%s while tasks have
+ * to wait too long in the queue and removes Worker%s after they have been idle for a
+ * while, staying within the limits of the AutoScaling policy.
+ *
+ * By default, the number of waiting tasks is not limited. If producers can queue tasks
+ * faster than they are processed, a capacity can be set (#setCapacity) together with an
+ * OverflowPolicy that determines what happens to a task that is queued while the
+ * ThreadPool is full: the producer is blocked, the task is executed by the producer
+ * itself, the task is rejected with a QueueFullError, or the oldest waiting task is
+ * discarded to make room.
+ *
+ * For capacity planning, each Worker can keep counters of the number of executed and
+ * stolen tasks, the time spent executing tasks and waiting for them, and histograms of
+ * the time tasks spent in the queue and running. The counters are disabled by default
+ * and are enabled with #setInstrumentationEnabled; while disabled, they cost a single
+ * relaxed atomic load per task. A snapshot of the counters is returned by #statistics
+ * and can be exported as a Dictionary or as JSON.
+ *
  * A ThreadPool can be running or stopped (#isRunning, #start, #stop). The ThreadPool is
  * automatically stopped in the destructor if it was running before (and will block and
  * wait for all remaining tasks to be finished. If this behavior is not desired, the
@@ -105,6 +174,124 @@ class ThreadPool {
 public:
     using RunRemainingTasks = ghoul::Boolean;
     using DetachThreads = ghoul::Boolean;
+    using WorkStealing = ghoul::Boolean;
+
+    /**
+     * The priority with which a task is queued. Each priority has a separate lane in the
+     * queues of the ThreadPool and tasks in the lanes of higher priority are started
+     * first.
+     */
+    enum class Priority {
+        High = 0,   ///< Time-critical tasks, for example work needed for the next frame
+        Normal,     ///< The default for all tasks
+        Background  ///< Tasks that should only run if nothing else is waiting
+    };
+
+    /// The number of different Priority values
+    static const int NPriorities = 3;
+
+    /// The number of buckets in each Histogram of the WorkerStatistics
+    static const int NHistogramBuckets = 32;
+
+    /**
+     * A histogram of durations with logarithmically growing buckets. The first bucket
+     * counts the durations below 1 microsecond and bucket <code>i</code> counts the
+     * durations in <code>[2^(i-1), 2^i)</code> microseconds. The last bucket also counts
+     * all durations that are longer than that.
+     */
+    using Histogram = std::array<uint64_t, NHistogramBuckets>;
+
+    /// A snapshot of the counters of a single Worker
+    struct WorkerStatistics {
+        /// The number of tasks that were executed by the Worker
+        uint64_t nTasksExecuted = 0;
+        /// The number of tasks that the Worker stole from other Worker%s
+        uint64_t nTasksStolen = 0;
+        /// The total time the Worker spent executing tasks
+        std::chrono::nanoseconds busyTime = std::chrono::nanoseconds(0);
+        /// The total time the Worker spent idle, waiting for new tasks
+        std::chrono::nanoseconds idleTime = std::chrono::nanoseconds(0);
+        /// The time between queueing a task and the Worker starting to execute it
+        Histogram queueWaitTime = {};
+        /// The time it took the Worker to execute each task
+        Histogram runTime = {};
+    };
+
+    /// A snapshot of the counters of all Worker%s of a ThreadPool
+    struct Statistics {
+        /// The statistics of each Worker in the order of the Worker%s
+        std::vector<WorkerStatistics> workers;
+        /// The number of tasks that were waiting to be executed
+        int nRemainingTasks = 0;
+
+        /**
+         * Converts the statistics into a Dictionary. The Dictionary contains the
+         * <code>RemainingTasks</code> and a <code>Workers</code> Dictionary with one
+         * entry per Worker under the keys <code>1</code> to <code>n</code>. Each Worker
+         * entry contains <code>TasksExecuted</code>, <code>TasksStolen</code>,
+         * <code>BusyTime</code> and <code>IdleTime</code> (in seconds), and the
+         * histograms <code>QueueWaitTime</code> and <code>RunTime</code>, whose buckets
+         * are stored under the keys <code>1</code> to <code>NHistogramBuckets</code>.
+         * \return A Dictionary containing the statistics
+         */
+        Dictionary toDictionary() const;
+
+        /**
+         * Converts the statistics into a JSON string with the same structure as the
+         * Dictionary returned by #toDictionary.
+         * \return A JSON string containing the statistics
+         */
+        std::string toJson() const;
+    };
+
+    /**
+     * The policy that determines how the ThreadPool adjusts its number of Worker%s if
+     * auto scaling is enabled (#enableAutoScaling). Every <code>interval</code>, the
+     * ThreadPool adds a Worker if a task has waited in the queue for longer than the
+     * <code>queueWaitThreshold</code>, or if tasks have been waiting while no Worker was
+     * idle for that long. If at least one Worker has been idle for the whole
+     * <code>idleTimeout</code>, a Worker is removed instead.
+     */
+    struct AutoScaling {
+        /// The smallest number of Worker%s. Must be bigger than 0
+        int minThreads = 1;
+        /// The largest number of Worker%s. If this is 0, the number of logical CPUs is
+        /// used
+        int maxThreads = 0;
+        /// The time a task can wait in the queue before another Worker is added
+        std::chrono::microseconds queueWaitThreshold = std::chrono::milliseconds(10);
+        /// The time for which a Worker has to be idle before a Worker is removed
+        std::chrono::milliseconds idleTimeout = std::chrono::seconds(5);
+        /// The interval in which the ThreadPool checks whether to add or remove Workers
+        std::chrono::milliseconds interval = std::chrono::milliseconds(25);
+    };
+
+    /**
+     * Determines what happens to a task that is queued while the number of waiting tasks
+     * has reached the capacity of the ThreadPool (#setCapacity).
+     */
+    enum class OverflowPolicy {
+        /// The producer is blocked until a Worker has taken a task out of the queue
+        Block = 0,
+        /// The task is executed immediately by the thread that tries to queue it
+        CallerRuns,
+        /// The task is not queued and a QueueFullError is thrown to the producer
+        Reject,
+        /// The oldest waiting task of the lowest Priority is discarded instead
+        DropOldest
+    };
+
+    /// The exception that is thrown if a task is rejected by OverflowPolicy::Reject
+    struct QueueFullError : public RuntimeError {
+        /**
+         * Creates the exception for a ThreadPool that has reached its \p capacity.
+         * \param capacity The capacity of the ThreadPool that rejected the task
+         */
+        explicit QueueFullError(int capacity);
+
+        /// The capacity of the ThreadPool that rejected the task
+        const int capacity;
+    };
     
     /**
      * Constructor that initializes and starts \p nThreads Worker objects.
@@ -120,6 +307,17 @@ public:
      * managed by the ThreadPool
      * \param background Whether the worker threads managed by this thread pool are run in
      * a background mode (depending on the support of the operating system)
+     * \param workStealing If WorkStealing::Yes, each Worker owns a local queue for the
+     * tasks it queues itself and idle Worker%s steal tasks from each other. If
+     * WorkStealing::No, all tasks are stored in a single, shared queue
+     * \param spinDuration The duration for which an idle Worker keeps checking for new
+     * tasks before it goes to sleep. A short spin reduces the latency for bursts of
+     * tasks at the cost of CPU time; if the duration is 0, idle Worker%s go to sleep
+     * immediately
+     * \param placement Determines whether and how the Worker%s are pinned to the logical
+     * CPUs of the system. If the Worker%s are pinned, each Worker pins itself before it
+     * creates its local queue, so that the memory of the queue is allocated on the NUMA
+     * node of the Worker
      * \pre \p nThreads must be bigger than 0
      * \pre \p workerInitialization must not be empty
      * \pre \p workerDeinitialization must not be empty
@@ -131,7 +329,10 @@ public:
         std::function<void ()> workerDeinitialization = [](){},
         thread::ThreadPriorityClass priorityClass = thread::ThreadPriorityClass::Normal,
         thread::ThreadPriorityLevel priorityLevel = thread::ThreadPriorityLevel::Normal,
-        thread::Background background = thread::Background::No
+        thread::Background background = thread::Background::No,
+        WorkStealing workStealing = WorkStealing::No,
+        std::chrono::microseconds spinDuration = std::chrono::microseconds(0),
+        thread::Placement placement = thread::Placement::None
     );
     
     /**
@@ -193,6 +394,68 @@ public:
      * \return The number of workers that are managed by this ThreadPool
      */
     int size() const;
+
+    /**
+     * Enables the automatic adjustment of the number of Worker%s according to the
+     * \p policy. The ThreadPool is immediately resized to fit into the limits of the
+     * \p policy. New Worker%s are created with the same initialization and
+     * deinitialization functions that were passed to the constructor. If auto scaling
+     * was already enabled, the \p policy replaces the previous policy. The number of
+     * Worker%s is only adjusted while the ThreadPool is running.
+     * \param policy The policy that determines when Worker%s are added or removed
+     * \pre <code>policy.minThreads</code> must be bigger than 0
+     * \pre <code>policy.maxThreads</code> must be 0 or not smaller than
+     * <code>policy.minThreads</code>
+     * \pre <code>policy.interval</code> must be positive
+     */
+    void enableAutoScaling(AutoScaling policy);
+
+    /**
+     * Disables the automatic adjustment of the number of Worker%s. The current number of
+     * Worker%s is kept.
+     */
+    void disableAutoScaling();
+
+    /**
+     * Returns whether the ThreadPool automatically adjusts its number of Worker%s.
+     * \return <code>true</code> if auto scaling is enabled
+     */
+    bool isAutoScaling() const;
+
+    /**
+     * Limits the number of tasks that can wait in the queues of this ThreadPool to
+     * \p capacity and determines what happens to tasks that are queued once this limit
+     * has been reached. As multiple producers check the limit concurrently, it can be
+     * exceeded by at most one task per producing thread. A Worker of this ThreadPool that
+     * queues a task is never blocked, as all Worker%s could end up waiting for each
+     * other; for OverflowPolicy::Block, such a task is executed by the Worker instead.
+     * Tasks that continue work which has already been queued, namely the continuations of
+     * a Continuable, the nodes of a TaskGraph, the stages of a Pipeline, and coroutines
+     * that are resumed by #schedule, are always queued. They are mostly queued by the
+     * Worker%s themselves, where a rejection could only terminate the program, and a
+     * suspended coroutine could neither be rejected nor run by the caller without
+     * resuming it twice. The same holds for tasks that are queued by timers
+     * (#queueAfter, #queueEvery), as the timer thread must neither block nor execute
+     * them itself. Batches that are queued while a capacity is set are queued one task
+     * at a time. Tasks whose CancellationToken has been cancelled do not count toward the
+     * capacity and are discarded before the \p policy is applied.
+     * \param capacity The maximum number of waiting tasks, or 0 for an unlimited number
+     * \param policy The OverflowPolicy that is applied to tasks that do not fit
+     * \pre \p capacity must not be negative
+     */
+    void setCapacity(int capacity, OverflowPolicy policy = OverflowPolicy::Block);
+
+    /**
+     * Returns the maximum number of waiting tasks, or 0 if the number is not limited.
+     * \return The maximum number of waiting tasks
+     */
+    int capacity() const;
+
+    /**
+     * Returns the OverflowPolicy that is applied once the capacity is reached.
+     * \return The OverflowPolicy that is applied once the capacity is reached
+     */
+    OverflowPolicy overflowPolicy() const;
     
     /**
      * Returns the number of currently idle workers in this ThreadPool.
@@ -202,15 +465,130 @@ public:
 
     /**
      * Returns the number of remaining tasks waiting to be processed by this ThreadPool.
+     * This includes the tasks in the local queues of the Worker%s if the ThreadPool uses
+     * work stealing.
      * \return The number of remaining tasks waiting to be processed by this ThreadPool
      */
     int remainingTasks() const;
 
+    /**
+     * Returns the number of remaining tasks of the provided \p priority that are waiting
+     * to be processed by this ThreadPool.
+     * \param priority The lane for which the number of tasks is returned
+     * \return The number of remaining tasks of the \p priority waiting to be processed
+     */
+    int remainingTasks(Priority priority) const;
+
+    /**
+     * Returns whether this ThreadPool was created with work stealing enabled.
+     * \return <code>true</code> if the Worker%s of this ThreadPool have local queues and
+     * steal tasks from each other, <code>false</code> otherwise
+     */
+    bool isWorkStealing() const;
+
+    /**
+     * Returns the duration for which an idle Worker keeps checking for new tasks before
+     * it goes to sleep.
+     * \return The duration for which an idle Worker spins before going to sleep
+     */
+    std::chrono::microseconds spinDuration() const;
+
+    /**
+     * Returns the placement of the Worker%s on the logical CPUs of the system.
+     * \return The placement of the Worker%s on the logical CPUs of the system
+     */
+    thread::Placement placement() const;
+
+    /**
+     * Enables or disables the counters of the Worker%s. Disabling the counters does not
+     * reset them, so that the instrumentation can be enabled for selected phases only.
+     * The time a task waits in the queue is only recorded for tasks that were queued
+     * while the instrumentation was enabled.
+     * \param enabled Whether the Worker%s should update their counters
+     */
+    void setInstrumentationEnabled(bool enabled);
+
+    /**
+     * Returns whether the Worker%s currently update their counters.
+     * \return <code>true</code> if the Worker%s currently update their counters
+     */
+    bool isInstrumentationEnabled() const;
+
+    /**
+     * Returns a snapshot of the counters of all Worker%s. The counters of a Worker
+     * persist while the ThreadPool is stopped and restarted, but are discarded if the
+     * Worker is removed by #resize. As the counters are updated concurrently, the
+     * individual values of the snapshot are not guaranteed to be consistent with each
+     * other.
+     * \return A snapshot of the counters of all Worker%s
+     */
+    Statistics statistics() const;
+
+    /**
+     * Resets the counters of all Worker%s to zero.
+     */
+    void resetStatistics();
+
     /**
      * Removes the remaining tasks from the waiting list, discarding them.
      * \post The number of remaining tasks is empty
      */
     void clearRemainingTasks();
+
+    /**
+     * Takes one waiting task out of the queues and executes it on the calling thread.
+     * If the calling thread is a Worker of this ThreadPool, its own local queue is
+     * checked first. Afterwards, the shared queue is checked and, if work stealing is
+     * enabled, a task is stolen from one of the Worker%s. This function is used by a
+     * thread that waits for the results of other tasks, for example in
+     * TaskGroup::wait, to help with the work instead of blocking. As any waiting task can
+     * be executed, the calling thread must not hold locks that the task might need.
+     * \return <code>true</code> if a task was executed, <code>false</code> if there was
+     * no waiting task
+     */
+    bool runPendingTask();
+
+    /**
+     * Returns the object of type \p T that belongs to the calling Worker. The object is
+     * created by calling the \p factory the first time that the Worker asks for an
+     * object of type \p T and the same object is returned for all later calls on this
+     * Worker. This is useful for resources that are expensive to create and that must
+     * not be shared between threads, such as a scripting state or a scratch buffer.
+     * Each type can only be stored once per Worker; wrap the object into a tag type if
+     * several objects of the same type are needed. The objects are destroyed in the
+     * reverse order of their creation when the Worker finishes, before the
+     * <code>workerDeinitialization</code> function is called, so they can still make use
+     * of anything that was set up by the <code>workerInitialization</code> function. If
+     * this function is called from a thread that is not a Worker, for example a thread
+     * that helps in TaskGroup::wait, the object belongs to that thread instead and is
+     * destroyed when the thread exits. Example:
+     * \verbatim
+pool.queue([]() {
+    std::vector<char>& buffer = ghoul::ThreadPool::workerLocal<std::vector<char>>(
+        []() { return std::vector<char>(1024 * 1024); }
+    );
+    // use buffer
+});
+     \endverbatim
+     * \tparam T The type of the object that is stored for each Worker
+     * \tparam Factory The type of the function that creates the object. It is called
+     *         without arguments and must return a value that is convertible to \p T
+     * \param factory The function that creates the object if it does not exist yet. If
+     *        the function throws, no object is stored and the exception is passed on
+     * \return The object of type \p T that belongs to the calling thread
+     */
+    template <typename T, typename Factory>
+    static T& workerLocal(Factory&& factory);
+
+    /**
+     * Returns the object of type \p T that belongs to the calling Worker, creating it
+     * with the default constructor if it does not exist yet. See the other overload for
+     * details.
+     * \tparam T The type of the object that is stored for each Worker
+     * \return The object of type \p T that belongs to the calling thread
+     */
+    template <typename T>
+    static T& workerLocal();
     
     /**
      * This function queues a task and returns an <code>std::future</code> object that
@@ -277,8 +655,310 @@ ghoul::ThreadPool pool(2);
     template <typename T, typename... Args>
     auto queue(std::packaged_task<T>&& task, Args&&... arguments
         ) -> decltype(task.get_future());
+
+    /**
+     * This function queues a task with the provided \p priority and returns an
+     * <code>std::future</code> object that holds a potential return value of the
+     * function. Apart from the \p priority, this function behaves exactly like the
+     * #queue function without a priority, which queues its tasks with Priority::Normal.
+     * \tparam Function The description of the \p function%'s signature that will be
+     * called
+     * \tparam Args A variable list of arguments that can be passed to the \p function
+     * \param priority The Priority lane into which the task is queued
+     * \param function The function that will be called
+     * \param arguments The potential list of arguments passed to the \p function
+     * \return A future containing the result of the evaluation of \p function with the
+     * passed \p arguments
+     */
+    template <typename Function, typename... Args>
+    auto queue(
+        Priority priority, Function&& function, Args&&... arguments
+    ) -> std::future<decltype(function(arguments...))>;
+
+    /**
+     * This function queues a <code>std::packaged_task</code> with the provided
+     * \p priority and returns its <code>std::future</code> object.
+     * \tparam T The type information of the <code>std::packaged_task</code> that is to be
+     * executed
+     * \tparam Args A variable list of arguments that can be passed to the \p task
+     * \param priority The Priority lane into which the task is queued
+     * \param task The task that will be executed.
+     * \param arguments The potential list of arguments passed to the \p task
+     * \return A future containing the result of the evaluation of \p task
+     */
+    template <typename T, typename... Args>
+    auto queue(Priority priority, std::packaged_task<T>&& task, Args&&... arguments
+        ) -> decltype(task.get_future());
+
+    /**
+     * Queues the \p function with Priority::Normal without creating a
+     * <code>std::future</code> for its result. This is the cheapest way of queueing a
+     * task, as no shared state has to be allocated and, if the \p function is small
+     * enough, it is stored in the queue without any memory allocation. The \p function
+     * can be move-only. If the \p function throws an exception, the behavior is the same
+     * as for an uncaught exception in a thread; the \p function has to handle its own
+     * errors.
+     * \tparam Function The type of the function that is called
+     * \param function The function that is called without any arguments
+     */
+    template <typename Function>
+    void post(Function&& function);
+
+    /**
+     * Queues the \p function with the provided \p priority without creating a
+     * <code>std::future</code> for its result. Apart from the \p priority, this function
+     * behaves like the #post function without a priority.
+     * \tparam Function The type of the function that is called
+     * \param priority The Priority lane into which the task is queued
+     * \param function The function that is called without any arguments
+     */
+    template <typename Function>
+    void post(Priority priority, Function&& function);
+
+    /**
+     * Queues the \p function with Priority::Normal, tagged with the \p token, and returns
+     * an <code>std::future</code> object that holds a potential return value of the
+     * function. If the \p token has been cancelled before a Worker starts the task, the
+     * task is dropped and the future holds a <code>std::future_error</code> with
+     * <code>std::future_errc::broken_promise</code>. A running task is not interrupted;
+     * it has to poll a copy of the \p token itself if it should stop early.
+     * \tparam Function The description of the \p function%'s signature that will be
+     * called
+     * \tparam Args A variable list of arguments that can be passed to the \p function
+     * \param token The token that can cancel the task before it is started
+     * \param function The function that will be called
+     * \param arguments The potential list of arguments passed to the \p function
+     * \return A future containing the result of the evaluation of \p function with the
+     * passed \p arguments
+     */
+    template <typename Function, typename... Args>
+    auto queue(
+        const CancellationToken& token, Function&& function, Args&&... arguments
+    ) -> std::future<decltype(function(arguments...))>;
+
+    /**
+     * Queues the \p function with the provided \p priority, tagged with the \p token.
+     * Apart from the \p priority, this function behaves like the #queue function with a
+     * token but without a priority.
+     * \tparam Function The description of the \p function%'s signature that will be
+     * called
+     * \tparam Args A variable list of arguments that can be passed to the \p function
+     * \param priority The Priority lane into which the task is queued
+     * \param token The token that can cancel the task before it is started
+     * \param function The function that will be called
+     * \param arguments The potential list of arguments passed to the \p function
+     * \return A future containing the result of the evaluation of \p function with the
+     * passed \p arguments
+     */
+    template <typename Function, typename... Args>
+    auto queue(
+        Priority priority, const CancellationToken& token, Function&& function,
+        Args&&... arguments
+    ) -> std::future<decltype(function(arguments...))>;
+
+    /**
+     * Queues the \p function with Priority::Normal, tagged with the \p token, without
+     * creating a <code>std::future</code> for its result. If the \p token has been
+     * cancelled before a Worker starts the task, the \p function is dropped without
+     * being called.
+     * \tparam Function The type of the function that is called
+     * \param token The token that can cancel the task before it is started
+     * \param function The function that is called without any arguments
+     */
+    template <typename Function>
+    void post(const CancellationToken& token, Function&& function);
+
+    /**
+     * Queues the \p function with the provided \p priority, tagged with the \p token,
+     * without creating a <code>std::future</code> for its result. Apart from the
+     * \p priority, this function behaves like the #post function with a token but
+     * without a priority.
+     * \tparam Function The type of the function that is called
+     * \param priority The Priority lane into which the task is queued
+     * \param token The token that can cancel the task before it is started
+     * \param function The function that is called without any arguments
+     */
+    template <typename Function>
+    void post(Priority priority, const CancellationToken& token, Function&& function);
+
+    /**
+     * Queues one task for each element in the range <code>[first, last)</code> with
+     * Priority::Normal. Each task calls the \p function with a reference to its element.
+     * In contrast to calling #queue for each element, all tasks are inserted into the
+     * queue while holding the lock only once and only as many Worker%s are woken up as
+     * are needed to process the batch. Example:
+     *\verbatim
+std::vector<std::string> files = ...;
+std::future<void> done = pool.queueBatch(
+    files.begin(), files.end(),
+    [](const std::string& file) { convert(file); }
+);
+done.get();
+\endverbatim
+     * \tparam Iterator A forward iterator type
+     * \tparam Function The type of the function that is called for each element
+     * \param first The beginning of the range of elements
+     * \param last The end of the range of elements
+     * \param function The function that is called as <code>function(*it)</code> for
+     * each element of the range. It is shared between all tasks of the batch
+     * \return A future that becomes ready once the \p function has been called for all
+     * elements. If any call threw an exception, the first exception is stored in the
+     * future instead. If tasks of the batch are discarded without being executed, the
+     * future holds a <code>std::future_errc::broken_promise</code> error
+     * \pre The range and its elements must stay valid until the future is ready
+     */
+    template <typename Iterator, typename Function>
+    std::future<void> queueBatch(Iterator first, Iterator last, Function&& function);
+
+    /**
+     * Queues one task for each element in the range <code>[first, last)</code> with the
+     * provided \p priority. Apart from the \p priority, this function behaves like the
+     * #queueBatch function without a priority.
+     * \tparam Iterator A forward iterator type
+     * \tparam Function The type of the function that is called for each element
+     * \param priority The Priority lane into which the tasks are queued
+     * \param first The beginning of the range of elements
+     * \param last The end of the range of elements
+     * \param function The function that is called as <code>function(*it)</code> for
+     * each element of the range
+     * \return A future that becomes ready once the \p function has been called for all
+     * elements
+     * \pre The range and its elements must stay valid until the future is ready
+     */
+    template <typename Iterator, typename Function>
+    std::future<void> queueBatch(Priority priority, Iterator first, Iterator last,
+        Function&& function);
+
+    /**
+     * Queues the function \p f with the arguments \p arg with Priority::Normal once the
+     * \p delay has passed and returns an <code>std::future</code> object that holds the
+     * potential return value of the function. The task is never queued early, but can be
+     * queued up to one millisecond late. If the ThreadPool is destroyed before the
+     * \p delay has passed, the future holds a
+     * <code>std::future_errc::broken_promise</code> error. Example:
+     *\verbatim
+std::future<void> f = pool.queueAfter(std::chrono::seconds(2), []() { flushCache(); });
+\endverbatim
+     * \param delay The duration after which the function is queued
+     * \param f The function that should be executed
+     * \param arg The arguments to the function \p f
+     * \return An <code>std::future</code> object that holds the potential return value of
+     * the function \p f
+     */
+    template <typename Rep, typename Period, typename F, typename... Arg>
+    auto queueAfter(std::chrono::duration<Rep, Period> delay, F&& f, Arg&&... arg)
+        -> std::future<decltype(f(arg...))>;
+
+    /**
+     * Queues the function \p f with the arguments \p arg with the provided \p priority
+     * once the \p delay has passed. Apart from the \p priority, this function behaves
+     * like the #queueAfter function without a priority.
+     * \param priority The Priority lane into which the task is queued
+     * \param delay The duration after which the function is queued
+     * \param f The function that should be executed
+     * \param arg The arguments to the function \p f
+     * \return An <code>std::future</code> object that holds the potential return value of
+     * the function \p f
+     */
+    template <typename Rep, typename Period, typename F, typename... Arg>
+    auto queueAfter(Priority priority, std::chrono::duration<Rep, Period> delay, F&& f,
+        Arg&&... arg) -> std::future<decltype(f(arg...))>;
+
+    /**
+     * Queues the \p function with Priority::Normal every \p period, starting one
+     * \p period from now, until the returned CancellationToken is cancelled. The
+     * expiration times do not drift, as each one is computed from the previous one. If
+     * the previous execution of the \p function is still waiting or running when the
+     * next one is due, the next one is skipped, so a slow function never piles up in the
+     * queue. Example:
+     *\verbatim
+ghoul::CancellationToken flushing = pool.queueEvery(
+    std::chrono::seconds(1),
+    []() { flushLogs(); }
+);
+// ...
+flushing.cancel();
+\endverbatim
+     * \param period The duration between two executions of the \p function
+     * \param function The function that is executed repeatedly. It has to be copyable
+     * \return The CancellationToken that stops the repetition once it is cancelled. An
+     * execution that is already queued is dropped as well
+     * \pre \p period must be positive
+     */
+    template <typename Rep, typename Period, typename Function>
+    CancellationToken queueEvery(std::chrono::duration<Rep, Period> period,
+        Function&& function);
+
+    /**
+     * Queues the \p function with the provided \p priority every \p period. Apart from
+     * the \p priority, this function behaves like the #queueEvery function without a
+     * priority.
+     * \param priority The Priority lane into which the tasks are queued
+     * \param period The duration between two executions of the \p function
+     * \param function The function that is executed repeatedly. It has to be copyable
+     * \return The CancellationToken that stops the repetition once it is cancelled
+     * \pre \p period must be positive
+     */
+    template <typename Rep, typename Period, typename Function>
+    CancellationToken queueEvery(Priority priority,
+        std::chrono::duration<Rep, Period> period, Function&& function);
+
+#ifdef __cpp_impl_coroutine
+    /**
+     * The awaitable object that is returned by #schedule. Awaiting it suspends the
+     * awaiting coroutine and queues a task in the ThreadPool that resumes it, so that
+     * the coroutine continues on one of the Worker%s. If the task is discarded without
+     * being executed, for example because the ThreadPool is stopped without running the
+     * remaining tasks, the coroutine is resumed on the discarding thread and the
+     * <code>co_await</code> expression throws a <code>std::future_error</code> with
+     * <code>std::future_errc::broken_promise</code>.
+     */
+    class ScheduleAwaiter {
+    public:
+        ScheduleAwaiter(ThreadPool& pool, Priority priority);
+
+        bool await_ready() const noexcept;
+        void await_suspend(std::coroutine_handle<> handle);
+        void await_resume() const;
+
+    private:
+        /// The task that is queued in the ThreadPool to resume the coroutine
+        struct Resumer {
+            Resumer(std::coroutine_handle<> h, bool* isDiscarded);
+            Resumer(Resumer&& other) noexcept;
+            ~Resumer();
+            void operator()();
+
+            std::coroutine_handle<> handle;
+            bool* isDiscarded;
+        };
+
+        ThreadPool& _pool;
+        Priority _priority;
+        bool _isDiscarded = false;
+    };
+
+    /**
+     * Returns an awaitable object that moves the awaiting coroutine onto one of the
+     * Worker%s of this ThreadPool. While the coroutine is waiting in the queue, it does
+     * not occupy any thread. Example:
+     *\verbatim
+ghoul::Task<Image> loadImage(ghoul::ThreadPool& pool, std::string file) {
+    co_await pool.schedule();
+    // From here on, the coroutine runs on a Worker of the pool
+    co_return decode(file);
+}
+\endverbatim
+     * This function is only available if the compiler supports C++20 coroutines.
+     * \param priority The Priority with which the coroutine is queued
+     * \return The awaitable object that resumes the coroutine on a Worker
+     */
+    ScheduleAwaiter schedule(Priority priority = Priority::Normal);
+#endif // __cpp_impl_coroutine
     
 private:
+    friend struct internal::ThreadPoolAccess;
+
     ThreadPool(const ThreadPool&) = delete;
     ThreadPool(ThreadPool&&) = delete;
     ThreadPool& operator=(const ThreadPool&) = delete;
@@ -286,11 +966,18 @@ private:
 
     /// A single task that is executed. This is a functional wrapper around the function +
     /// arguments that are passed in the queue method so that we can store all tasks in a
-    /// single list
-    using Task = std::function<void()>;
+    /// single list. Small tasks are stored without allocating memory
+    using Task = InplaceFunction<void()>;
 
-    /// A worker object that consists of a thread and a boolean flag that determines
-    /// whether the worker should terminatate (or rather return out of the infinite loop).
+    /// Whether a task is queued regardless of the capacity of the ThreadPool
+    using BypassCapacity = ghoul::Boolean;
+
+    class TaskQueue;
+    struct WorkerCounters;
+
+    /// A worker object that consists of a thread, a boolean flag that determines
+    /// whether the worker should terminatate (or rather return out of the infinite loop)
+    /// and the counters that are updated if the instrumentation is enabled
     struct Worker {
         // The thread that grabs a task from the ThreadPool or waits until there is a
         // task. This is stored as a unique_ptr in order to make the storage in a vector
@@ -300,30 +987,189 @@ private:
         // a new task. This is stored as a shared_pointer as this value is used in the
         // ThreadPool as well as the lambda expression that drives the thread.
         std::shared_ptr<std::atomic<bool>> shouldTerminate;
+        // The counters of this Worker. They are shared with the lambda expression and
+        // are kept when the thread is stopped
+        std::shared_ptr<WorkerCounters> counters;
     };
+
+    /**
+     * The counters of a single Worker. They are only updated by the Worker itself but can
+     * be read or reset from any thread at any time, so all counters are atomic and are
+     * accessed with relaxed memory ordering.
+     */
+    struct WorkerCounters {
+        /// Creates counters that are all zero
+        WorkerCounters();
+
+        /// Counts an executed task that ran for the \p duration
+        void addTask(std::chrono::nanoseconds duration);
+
+        /**
+         * Counts the \p duration that a task waited in the queue. The longest duration
+         * is always remembered for the auto scaling, the histogram is only updated if
+         * \p updateHistogram is <code>true</code>.
+         */
+        void addQueueWaitTime(std::chrono::nanoseconds duration, bool updateHistogram);
+
+        /// Returns the longest queue wait time since the last call and resets it
+        std::chrono::nanoseconds takeMaxQueueWaitTime();
+
+        /// Counts the \p duration that the Worker was idle
+        void addIdleTime(std::chrono::nanoseconds duration);
+
+        /// Counts a task that was stolen from another Worker
+        void addStolenTask();
+
+        /// Sets all counters to zero
+        void reset();
+
+        /// Returns the current values of all counters
+        WorkerStatistics snapshot() const;
+
+        using AtomicHistogram = std::array<std::atomic<uint64_t>, NHistogramBuckets>;
+
+        std::atomic<uint64_t> nTasksExecuted;
+        std::atomic<uint64_t> nTasksStolen;
+        // The busy and idle times are stored in nanoseconds
+        std::atomic<uint64_t> busyTime;
+        std::atomic<uint64_t> idleTime;
+        AtomicHistogram queueWaitTime;
+        AtomicHistogram runTime;
+        // The longest queue wait time in nanoseconds since it was last taken
+        std::atomic<uint64_t> maxQueueWaitTime;
+    };
+
+    /**
+     * The objects that were created by #workerLocal for a single thread. Each type is
+     * assigned a unique index the first time it is used, so looking up an object is
+     * only an access into a vector. The objects are destroyed in the reverse order of
+     * their creation.
+     */
+    class WorkerLocalStorage {
+    public:
+        WorkerLocalStorage() = default;
+        WorkerLocalStorage(const WorkerLocalStorage&) = delete;
+        WorkerLocalStorage& operator=(const WorkerLocalStorage&) = delete;
+
+        /// Destroys all objects in the reverse order of their creation
+        ~WorkerLocalStorage();
+
+        /// Returns the object of type \p T, creating it with the \p factory first if it
+        /// does not exist yet
+        template <typename T, typename Factory>
+        T& get(Factory&& factory);
+
+    private:
+        /// Returns the next unused type index
+        static int nextTypeIndex();
+
+        /// Returns the index that was assigned to the type \p T
+        template <typename T>
+        static int typeIndex();
+
+        /// An object together with the function that destroys it
+        struct Entry {
+            void* object = nullptr;
+            void (*deleter)(void*) = nullptr;
+        };
+
+        /// The objects indexed by their type index
+        std::vector<Entry> _entries;
+        /// The type indices in the order in which the objects were created
+        std::vector<int> _creationOrder;
+    };
+
+    /// Returns the WorkerLocalStorage of the calling thread
+    static WorkerLocalStorage& currentStorage();
     
     /**
-     * This class represents a thin wrapper around <code>std::queue</code> that provides
+     * This class represents a thin wrapper around <code>std::deque</code> that provides
      * <code>std::mutex</code> protection for the available methods, thus making them
      * thread-safe to use. As soon as there is a better adapter pattern for the STL
      * classes that works in a concurrent environment, this class is not needed anymore.
+     * The same class is used for the shared queue of the ThreadPool and for the local
+     * queues of the Worker%s if work stealing is enabled. Each Priority has its own lane
+     * inside the queue. The pop functions take the task from the highest non-empty lane,
+     * unless a lower lane has been passed over too often, in which case that lane is
+     * served instead.
      */
     class TaskQueue {
     public:
+        /// Creates an empty queue
+        TaskQueue();
+
         /**
-         * Returns the top element of the queue and whether this item existed. If the
+         * Returns the front element of the queue and whether this item existed. If the
          * queue was empty, <code>{ Task(), false}</code> is returned, otherwise the
-         * second argument to the <code>tuple</code> is <code>true</code>.
-         * \return A tuple containing either the top element of the queue and
+         * second argument to the <code>tuple</code> is <code>true</code>. This function
+         * is used for the FIFO processing of the shared queue and for stealing the
+         * oldest task from another Worker%'s local queue. The lane from which the task
+         * is taken is determined by the priorities and the starvation protection.
+         * \return A tuple containing either the front element of the queue and
          * <code>true</code>, or a default constructed Task and <code>false</code>
          */
         std::tuple<Task, bool> pop();
 
         /**
-         * Pushes the \p task to the bottom of the <code>std::queue</code>.
+         * Returns the back element of the queue and whether this item existed. If the
+         * queue was empty, <code>{ Task(), false}</code> is returned, otherwise the
+         * second argument to the <code>tuple</code> is <code>true</code>. This function
+         * is used by a Worker to process its own local queue in LIFO order. The lane from
+         * which the task is taken is determined by the priorities and the starvation
+         * protection.
+         * \return A tuple containing either the back element of the queue and
+         * <code>true</code>, or a default constructed Task and <code>false</code>
+         */
+        std::tuple<Task, bool> popBack();
+
+        /**
+         * Returns the front element of the lowest Priority lane that contains tasks and
+         * whether this item existed. This function is used to discard the oldest of the
+         * least important tasks for OverflowPolicy::DropOldest and does not influence
+         * the starvation protection.
+         * \return A tuple containing either the front element of the lowest non-empty
+         * lane and <code>true</code>, or a default constructed Task and
+         * <code>false</code>
+         */
+        std::tuple<Task, bool> popLowestPriority();
+
+        /**
+         * Pushes the \p task to the back of the lane for the provided \p priority.
          * \param task The task to be pushed onto the queue
+         * \param priority The Priority lane into which the task is pushed
+         * \param token The token that can cancel the \p task while it is waiting, or
+         *        <code>nullptr</code> if the \p task cannot be cancelled
+         */
+        void push(Task&& task, Priority priority,
+            const CancellationToken* token = nullptr);
+
+        /**
+         * Pushes all of the \p tasks to the back of the lane for the provided
+         * \p priority, preserving their order, while locking the queue only once.
+         * \param tasks The tasks to be pushed onto the queue
+         * \param priority The Priority lane into which the tasks are pushed
+         */
+        void push(std::vector<Task>&& tasks, Priority priority);
+
+        /**
+         * Moves all tasks that are stored in this queue to the back of the respective
+         * lanes of the \p target queue, preserving their order, and leaves this queue
+         * empty.
+         * \param target The queue that will receive all tasks of this queue
+         * \pre \p target must not be this queue
+         */
+        void moveTasksTo(TaskQueue& target);
+
+        /**
+         * Removes all tasks from the queue, discarding them.
          */
-        void push(Task&& task);
+        void clear();
+
+        /**
+         * Removes all tasks whose CancellationToken has been cancelled or has passed its
+         * deadline from the queue, discarding them.
+         */
+        void purgeCancelled();
 
         /**
          * Returns whether the queue is empty.
@@ -332,47 +1178,490 @@ private:
         bool isEmpty() const;
         
         /**
-         * Returns the size of the queue.
-         * \return The size of the queue
+         * Returns the number of tasks in the queue that have not been cancelled. This
+         * only requires a pass over the queue if it contains tasks with a
+         * CancellationToken.
+         * \return The number of tasks in the queue that have not been cancelled
          */
         int size() const;
+
+        /**
+         * Returns the number of tasks in the lane of the provided \p priority that have
+         * not been cancelled.
+         * \param priority The Priority of the lane
+         * \return The number of tasks in the lane of the provided \p priority that have
+         * not been cancelled
+         */
+        int size(Priority priority) const;
+
+        /**
+         * Returns the number of tasks that are stored in the queue, including cancelled
+         * tasks that have not been removed yet. This function does not lock the queue.
+         * \return The number of tasks that are stored in the queue
+         */
+        int nStoredTasks() const;
     
     private:
-        // The queue of tasks
-        std::queue<ThreadPool::Task> _queue;
+        /// A waiting task together with the token that can cancel it
+        struct Entry {
+            Task task;
+            // The token of the task, or nullptr if the task cannot be cancelled
+            std::unique_ptr<const CancellationToken> token;
+        };
+
+        /**
+         * Returns the index of the lane from which the next task should be taken, or
+         * <code>-1</code> if all lanes are empty. This function updates the starvation
+         * counters and has to be called while the <code>_queueMutex</code> is locked.
+         * \return The index of the lane from which the next task is taken
+         */
+        int nextLane();
+
+        /**
+         * Returns the number of cancelled tasks in the provided \p lane. This function
+         * has to be called while the <code>_queueMutex</code> is locked.
+         * \param lane The index of the lane
+         * \return The number of cancelled tasks in the \p lane
+         */
+        int nCancelled(int lane) const;
+
+        // The queues of tasks, one for each priority
+        std::array<std::deque<Entry>, NPriorities> _lanes;
+        // For each lane, the number of times in a row a task was taken from a higher
+        // lane while this lane had waiting tasks
+        std::array<int, NPriorities> _nPassedOver;
+        // The number of tasks in each lane. These are only written while holding the
+        // mutex, but can be read without it
+        std::array<std::atomic_int, NPriorities> _sizes;
+        // The number of tasks in all lanes that have a CancellationToken. This is only
+        // written while holding the mutex, but can be read without it
+        std::atomic_int _nCancellable;
         // The mutex protecting the queue. As the mutex is also required by const
         // functions, it is declared 'mutable'
         mutable std::mutex _queueMutex;
     };
-    
+
+    /**
+     * The capacity and OverflowPolicy of a ThreadPool and the means to block producers
+     * until there is space in the queues again. Producers that wait for space register
+     * themselves in <code>nWaiting</code>, so that the Worker%s only have to lock the
+     * mutex after taking a task if there is somebody to notify.
+     */
+    struct Backpressure {
+        /// Creates an unlimited capacity with OverflowPolicy::Block
+        Backpressure();
+
+        /// Wakes up one waiting producer after a Worker has taken a task
+        void notifyOne();
+
+        /// Wakes up all waiting producers after the capacity or the queues changed
+        void notifyAll();
+
+        std::atomic_int capacity;
+        std::atomic<OverflowPolicy> policy;
+        std::atomic_int nWaiting;
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+
+    /**
+     * This class keeps track of the local TaskQueue%s of all active Worker%s of a
+     * ThreadPool so that idle Worker%s can find tasks to steal. The list of queues is
+     * stored as an immutable snapshot that is replaced whenever a Worker is added or
+     * removed, so that stealing Worker%s never have to lock the list itself.
+     */
+    class LocalQueues {
+    public:
+        /// Creates an empty list of local queues
+        LocalQueues();
+
+        /**
+         * Registers the \p queue as the local queue of a Worker, making it available
+         * for stealing.
+         * \param queue The queue that is added
+         */
+        void add(std::shared_ptr<TaskQueue> queue);
+
+        /**
+         * Unregisters the \p queue so that it is no longer used for stealing.
+         * \param queue The queue that is removed
+         */
+        void remove(const std::shared_ptr<TaskQueue>& queue);
+
+        /**
+         * Tries to steal the oldest task from any of the registered queues other than
+         * the \p thief%'s own queue. The victims are visited in a round-robin fashion
+         * starting at a different queue for each call, so that not all idle Worker%s
+         * contend for the same queue.
+         * \param thief The local queue of the Worker that tries to steal, or
+         * <code>nullptr</code> if the task can be taken from any queue
+         * \return A tuple containing either the stolen task and <code>true</code>, or a
+         * default constructed Task and <code>false</code> if no task could be stolen
+         */
+        std::tuple<Task, bool> steal(const TaskQueue* thief);
+
+        /**
+         * Removes all tasks from all registered queues, discarding them.
+         */
+        void clear();
+
+        /**
+         * Removes all cancelled tasks from all registered queues, discarding them.
+         */
+        void purgeCancelled();
+
+        /**
+         * Returns the total number of tasks in all registered queues that have not been
+         * cancelled.
+         * \return The total number of tasks in all registered queues that have not been
+         * cancelled
+         */
+        int size() const;
+
+        /**
+         * Returns the total number of tasks of the provided \p priority in all registered
+         * queues.
+         * \param priority The Priority of the counted tasks
+         * \return The total number of tasks of the \p priority in all registered queues
+         */
+        int size(Priority priority) const;
+
+        /**
+         * Returns the total number of tasks that are stored in all registered queues,
+         * including cancelled tasks that have not been removed yet.
+         * \return The total number of tasks that are stored in all registered queues
+         */
+        int nStoredTasks() const;
+
+    private:
+        using Queues = std::vector<std::shared_ptr<TaskQueue>>;
+
+        // The current snapshot of registered queues. It is only accessed through the
+        // atomic free functions for std::shared_ptr
+        std::shared_ptr<const Queues> _queues;
+        // Serializes the writers that replace the snapshot
+        std::mutex _writeMutex;
+        // The starting point for the next steal attempt
+        std::atomic_uint _nextVictim;
+    };
+
+    /**
+     * The WakeupSignal is used to put idle Worker%s to sleep and to wake them up again.
+     * Every event that a sleeping Worker has to react to, such as a new task or a
+     * request to terminate, increases the generation of the signal. A Worker reads the
+     * generation before it looks for a task and, if it did not find one, sleeps until the
+     * generation has changed. This way, no notification can get lost between looking for
+     * a task and going to sleep, and Worker%s never have to wake up to poll.
+     */
+    class WakeupSignal {
+    public:
+        /// Creates a signal without any idle Worker%s
+        WakeupSignal();
+
+        /**
+         * Returns the current generation of this signal.
+         * \return The current generation of this signal
+         */
+        uint64_t generation() const;
+
+        /**
+         * Increases the generation and wakes up one sleeping Worker, if there is one.
+         * The mutex is only locked if there is at least one idle Worker.
+         */
+        void notifyOne();
+
+        /**
+         * Increases the generation and wakes up all sleeping Worker%s.
+         */
+        void notifyAll();
+
+        /**
+         * Increases the generation and wakes up \p n sleeping Worker%s, or all of them if
+         * there are fewer sleeping Worker%s. The mutex is locked at most once.
+         * \param n The number of Worker%s that should be woken up
+         */
+        void notify(int n);
+
+        /**
+         * Blocks the calling Worker until the generation is different from the
+         * \p generation. For the first \p spinDuration, the calling thread repeatedly
+         * checks the generation without going to sleep.
+         * \param generation The generation that was current when the Worker last looked
+         * for tasks
+         * \param spinDuration The duration for which the Worker spins before sleeping
+         */
+        void wait(uint64_t generation, std::chrono::microseconds spinDuration);
+
+        /**
+         * Marks the calling Worker as idle. This has to be called before the Worker reads
+         * the #generation that it will pass to #wait.
+         */
+        void enterIdle();
+
+        /**
+         * Marks the calling Worker as no longer being idle.
+         */
+        void leaveIdle();
+
+        /**
+         * Returns the number of Worker%s that are currently idle.
+         * \return The number of Worker%s that are currently idle
+         */
+        int nIdle() const;
+
+    private:
+        // The generation that is increased on every notification
+        std::atomic<uint64_t> _generation;
+        // The number of Worker%s that are idle and might be sleeping
+        std::atomic_int _nIdle;
+        // The mutex and condition variable that sleeping Worker%s are waiting on
+        std::mutex _mutex;
+        std::condition_variable _cv;
+    };
+
+    /**
+     * Pushes the \p task into the correct queue, which is the calling Worker%'s local
+     * queue if work stealing is enabled and this function is called from within one of
+     * the Worker%s of this ThreadPool, or the shared queue otherwise. Afterwards, a
+     * waiting Worker is notified. Unless \p bypassCapacity is <code>Yes</code>, the
+     * OverflowPolicy is applied first if the capacity has been reached.
+     * \param task The task that is queued
+     * \param priority The Priority lane into which the task is queued
+     * \param bypassCapacity Whether the task is queued regardless of the capacity
+     * \param token The token that can cancel the \p task while it is waiting, or
+     *        <code>nullptr</code> if the \p task cannot be cancelled
+     * \throw QueueFullError If the task is rejected by OverflowPolicy::Reject
+     */
+    void pushTask(Task&& task, Priority priority,
+        BypassCapacity bypassCapacity = BypassCapacity::No,
+        const CancellationToken* token = nullptr);
+
+    /**
+     * Pushes all of the \p tasks into the correct queue in one operation, following the
+     * same rules as #pushTask. Afterwards, as many waiting Worker%s are notified as there
+     * are \p tasks.
+     * \param tasks The tasks that are queued
+     * \param priority The Priority lane into which the tasks are queued
+     */
+    void pushTasks(std::vector<Task>&& tasks, Priority priority);
+
+    /**
+     * Applies the OverflowPolicy if the ThreadPool has reached its capacity. Depending
+     * on the policy, this function blocks until there is space, executes the \p task, or
+     * discards another task. Cancelled tasks are discarded before the policy is applied.
+     * \param task The task that is about to be queued
+     * \param isOwnWorker Whether the task is queued by a Worker of this ThreadPool
+     * \return <code>true</code> if the \p task has been executed and must not be queued
+     * \throw QueueFullError If the task is rejected by OverflowPolicy::Reject
+     */
+    bool applyOverflowPolicy(Task& task, bool isOwnWorker);
+
+    /**
+     * Wraps the \p task into a task that records the time it waited in the queue in the
+     * counters of the Worker that executes it. This is only used while the
+     * instrumentation or the auto scaling is enabled, as the wrapped task will usually
+     * not fit into the inline storage of a Task anymore.
+     * \param task The task that is wrapped
+     * \param updateHistogram Whether the wait time is added to the histogram of the
+     * Worker%'s counters
+     * \return The task that records its queue wait time before calling \p task
+     */
+    static Task timestamped(Task&& task, bool updateHistogram);
+
+    /**
+     * Changes the number of Worker%s to \p nThreads. This is the implementation of
+     * #resize and has to be called while the <code>_workersMutex</code> is locked.
+     * \param nThreads The new number of Worker%s
+     */
+    void resizeWorkers(int nThreads);
+
+    /**
+     * The function that is executed by the supervising thread while auto scaling is
+     * enabled. It checks the ThreadPool every <code>policy.interval</code> and adds or
+     * removes Worker%s until #disableAutoScaling is called.
+     * \param policy The policy that determines when Worker%s are added or removed
+     */
+    void supervise(AutoScaling policy);
+
+    /// The state of a function that is queued repeatedly by #queueEvery
+    struct PeriodicTask {
+        PeriodicTask(std::function<void()> f, TimerWheel::Clock::duration p,
+            Priority prio);
+
+        std::function<void()> function;
+        const TimerWheel::Clock::duration period;
+        const Priority priority;
+        CancellationToken token;
+        // Whether the previous execution is still waiting in the queue or running
+        std::atomic_bool isQueued;
+    };
+
+    /**
+     * Adds a timer that calls the \p callback on the timer thread at the \p expiration.
+     * The timer thread is started if it does not exist yet. The \p callback should only
+     * queue a task as it delays all other timers while it is running.
+     * \param expiration The point in time at which the \p callback is called
+     * \param callback The function that is called on the timer thread
+     */
+    void addTimer(TimerWheel::Clock::time_point expiration, Task&& callback);
+
+    /**
+     * Adds the timer for the next execution of the periodic \p task at the
+     * \p expiration. Once the timer expires, the \p task is queued and the timer for the
+     * following execution is added, unless the \p task has been cancelled.
+     * \param task The periodic task that is scheduled
+     * \param expiration The point in time at which the \p task is queued next
+     */
+    void schedulePeriodic(std::shared_ptr<PeriodicTask> task,
+        TimerWheel::Clock::time_point expiration);
+
+    /**
+     * The function that is executed by the timer thread. It sleeps until the next timer
+     * expires and calls the callbacks of all expired timers, until the ThreadPool is
+     * destroyed.
+     */
+    void runTimers();
+
+    /**
+     * The state that is shared between all tasks of a batch that was queued with
+     * #queueBatch. The last task to finish fulfills the promise.
+     * \tparam Function The type of the function that is called for each element
+     */
+    template <typename Function>
+    struct Batch {
+        Batch(Function f, int nTasks);
+
+        /// Is called by each task after it has finished or failed
+        void finish(std::exception_ptr exception);
+
+        /// The function that is called for each element
+        Function function;
+        /// The number of tasks that have not finished yet
+        std::atomic_int nRemaining;
+        /// The first exception that was thrown by any of the tasks
+        std::exception_ptr exception;
+        /// The mutex protecting the <code>exception</code>
+        std::mutex exceptionMutex;
+        /// The promise that is fulfilled after all tasks have finished. If the batch is
+        /// destroyed before, the destructor of the promise reports a broken promise
+        std::promise<void> promise;
+    };
+
     /**
      * Activate the \p worker by creating a <code>std::thread</code> with the lambda
      * expression that will do all of the work inside the Worker. This function will
-     * overwrite the values of the passed \p worker
+     * overwrite the values of the passed \p worker. This function does not wait for the
+     * Worker to start.
      * \param worker The worker to be set by this function
+     * \param cpu The logical CPU to which the Worker pins itself, or <code>-1</code> if
+     * the Worker should not be pinned
+     * \return A future that becomes ready once the Worker has finished its
+     * initialization
      */
-    void activateWorker(Worker& worker);
+    std::future<void> activateWorker(Worker& worker, int cpu);
+
+    /**
+     * Activates all Worker%s with an index in the half-open range
+     * <code>[first, last)</code> and waits until all of them have finished their
+     * initialization. All threads are started before waiting, so they initialize in
+     * parallel.
+     * \param first The index of the first Worker that is activated
+     * \param last The index one past the last Worker that is activated
+     */
+    void activateWorkers(int first, int last);
 
     /// The list of all workers managed by this ThreadPool
     std::vector<Worker> _workers;
 
+    /// Protects the <code>_workers</code> as they are also modified by the supervising
+    /// thread if auto scaling is enabled
+    mutable std::mutex _workersMutex;
+
+    /// The number of Worker%s, which can be read without locking the
+    /// <code>_workersMutex</code>
+    std::atomic_int _nWorkers;
+
     /// The list of remaining tasks that might be addressed by the available Worker%s
     std::shared_ptr<TaskQueue> _taskQueue;
 
+    /// The local queues of all Worker%s that are used if work stealing is enabled
+    std::shared_ptr<LocalQueues> _localQueues;
+
+    /// The capacity of the queues, which is shared with the Worker%s so that they can
+    /// wake up blocked producers
+    std::shared_ptr<Backpressure> _backpressure;
+
+    /// Whether the Worker%s of this ThreadPool use local queues and steal tasks
+    WorkStealing _workStealing;
+
+    /// The local queue of the Worker that is executing on the current thread, or
+    /// <code>nullptr</code> if the current thread is not a Worker. Together with
+    /// <code>_currentLocalQueues</code>, this is used to determine whether a task is
+    /// queued from within a Worker of this ThreadPool
+    static thread_local TaskQueue* _currentLocalQueue;
+
+    /// The LocalQueues object of the ThreadPool that owns the Worker executing on the
+    /// current thread, or <code>nullptr</code> if the current thread is not a Worker
+    static thread_local const LocalQueues* _currentLocalQueues;
+
+    /// The counters of the Worker that is executing on the current thread, or
+    /// <code>nullptr</code> if the current thread is not a Worker
+    static thread_local WorkerCounters* _currentCounters;
+
+    /// The WorkerLocalStorage of the Worker that is executing on the current thread, or
+    /// <code>nullptr</code> if the current thread is not a Worker
+    static thread_local WorkerLocalStorage* _currentStorage;
+
     /// <code>true</code> if the ThreadPool is currently running, <code>false</code>
     /// otherwise
     std::shared_ptr<std::atomic_bool> _isRunning;
     
-    /// The number of Worker%s that are currently waiting for a task
-    std::shared_ptr<std::atomic_int> _nWaiting;
-    
-    /// The mutex used by the <code>condition_variable</code> <code>_cv</code> used to
-    /// wait for and wake up Worker%s based on incoming Task%s
-    std::shared_ptr<std::mutex> _mutex;
+    /// The signal that is used to put idle Worker%s to sleep and wake them up when new
+    /// Task%s are incoming. It also keeps track of the number of idle Worker%s
+    std::shared_ptr<WakeupSignal> _signal;
+
+    /// <code>true</code> if the Worker%s update their counters
+    std::shared_ptr<std::atomic_bool> _isInstrumented;
+
+    /// <code>true</code> if the supervising thread adjusts the number of Worker%s
+    std::atomic_bool _isAutoScaling;
+
+    /// The thread that adjusts the number of Worker%s while auto scaling is enabled
+    std::thread _supervisor;
+
+    /// Set to <code>true</code> to tell the supervising thread to finish
+    bool _shouldStopSupervisor;
 
-    /// The condition variable that is used to wake up Worker%s when new Task%s are
-    /// incoming. Used in combination with <code>_mutex</code>
-    std::shared_ptr<std::condition_variable> _cv;
+    /// The mutex and condition variable that are used to wake the supervising thread
+    /// when it should finish
+    std::mutex _supervisorMutex;
+    std::condition_variable _supervisorCv;
+
+    /// The timers that were added by #queueAfter and #queueEvery
+    TimerWheel _timerWheel;
+
+    /// The thread that calls the callbacks of the expired timers. It is created when the
+    /// first timer is added
+    std::thread _timerThread;
+
+    /// Set to <code>true</code> to tell the timer thread to finish
+    bool _shouldStopTimers;
+
+    /// Protects the <code>_timerWheel</code>, the <code>_timerThread</code>, and
+    /// <code>_shouldStopTimers</code> and wakes the timer thread if a timer is added
+    std::mutex _timerMutex;
+    std::condition_variable _timerCv;
+
+    /// The duration for which idle Worker%s spin before going to sleep
+    std::chrono::microseconds _spinDuration;
+
+    /// The placement of the Worker%s on the logical CPUs
+    thread::Placement _placement;
+
+    /// The logical CPUs in the order in which they are assigned to the Worker%s. The
+    /// Worker with index <code>i</code> is pinned to <code>i % _cpuOrder.size()</code>.
+    /// This is empty if the Worker%s are not pinned
+    std::vector<int> _cpuOrder;
     
     /// The user-defined function that is called at initialization for each of the Worker
     /// threads
@@ -391,6 +1680,18 @@ private:
     thread::Background _threadBackground;
 };
 
+namespace internal {
+
+/// Provides the library's own tasks that continue work which has already been queued in
+/// a ThreadPool with a way to queue them regardless of the capacity of the ThreadPool
+struct ThreadPoolAccess {
+    template <typename Function>
+    static void postBypassingCapacity(ThreadPool& pool, ThreadPool::Priority priority,
+        Function&& function);
+};
+
+} // namespace internal
+
 } // namespace ghoul
 
 #include "threadpool.inl"
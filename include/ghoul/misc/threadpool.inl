@@ -23,29 +23,36 @@
  * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
  ****************************************************************************************/
 
+#include <ghoul/misc/assert.h>
+
 namespace ghoul {
 
 template <typename F, typename... Arg>
 auto ThreadPool::queue(F&& f, Arg&&... arg) -> std::future<decltype(f(arg...))> {
+    return queue(Priority::Normal, std::forward<F>(f), std::forward<Arg>(arg)...);
+}
+
+template <typename F, typename... Arg>
+auto ThreadPool::queue(Priority priority, F&& f, Arg&&... arg)
+    -> std::future<decltype(f(arg...))>
+{
     using ReturnType = decltype(f(arg...));
-    // We wrap the packaged_task into a shared pointer so that we can store it in the
-    // lambda expression below. The capture of the lambda expression will keep this
-    // packaged_task alive
-    auto pck = std::make_shared<std::packaged_task<ReturnType ()>>(
+    // The packaged_task is moved into the task itself, which keeps it alive until it has
+    // been executed. As the packaged_task is small, the Task does not allocate memory
+    std::packaged_task<ReturnType ()> pck(
         std::bind(std::forward<F>(f), std::forward<Arg>(arg)...)
     );
     
-    // Push the packaged packaged_task onto the queue of work items
-    _taskQueue->push(
-        [pck]() { (*pck)(); }
-    );
-    
     // Get the future of the result (which might be std::future<void>, but that is not a
     // problem
-    auto future = pck->get_future();
+    auto future = pck.get_future();
 
-    // Notify a potentially waiting thread that a new task is available
-    _cv->notify_one();
+    // Push the packaged packaged_task onto the correct queue of work items, which also
+    // notifies a potentially waiting thread that a new task is available
+    pushTask(
+        [pck = std::move(pck)]() mutable { pck(); },
+        priority
+    );
 
     // And return the future back to the caller
     return future;
@@ -57,16 +64,350 @@ template <typename T, typename... Args>
 auto ThreadPool::queue(std::packaged_task<T>&& task, Args&&... arguments)
     -> decltype(task.get_future())
 {
-    auto pck = std::make_shared<std::packaged_task<T>>(std::move(task));
-    _taskQueue->push(
-        [pck]() { (*pck)(); }
+    return queue(
+        Priority::Normal,
+        std::move(task),
+        std::forward<Args>(arguments)...
+    );
+}
+
+template <typename T, typename... Args>
+auto ThreadPool::queue(Priority priority, std::packaged_task<T>&& task,
+                       Args&&... arguments) -> decltype(task.get_future())
+{
+    auto future = task.get_future();
+
+    pushTask(
+        [pck = std::move(task)]() mutable { pck(); },
+        priority
+    );
+
+    return future;
+}
+
+template <typename Function>
+void ThreadPool::post(Function&& function) {
+    post(Priority::Normal, std::forward<Function>(function));
+}
+
+template <typename Function>
+void ThreadPool::post(Priority priority, Function&& function) {
+    pushTask(Task(std::forward<Function>(function)), priority);
+}
+
+template <typename F, typename... Arg>
+auto ThreadPool::queue(const CancellationToken& token, F&& f, Arg&&... arg)
+    -> std::future<decltype(f(arg...))>
+{
+    return queue(
+        Priority::Normal,
+        token,
+        std::forward<F>(f),
+        std::forward<Arg>(arg)...
+    );
+}
+
+template <typename F, typename... Arg>
+auto ThreadPool::queue(Priority priority, const CancellationToken& token, F&& f,
+                       Arg&&... arg) -> std::future<decltype(f(arg...))>
+{
+    using ReturnType = decltype(f(arg...));
+    std::packaged_task<ReturnType ()> pck(
+        std::bind(std::forward<F>(f), std::forward<Arg>(arg)...)
+    );
+    auto future = pck.get_future();
+
+    // If the task is dropped, the packaged_task is destroyed without being called, which
+    // stores a broken promise in the future. The token is also stored in the queue so
+    // that the task is removed as soon as it is cancelled
+    pushTask(
+        [token, pck = std::move(pck)]() mutable {
+            if (!token.isCancelled()) {
+                pck();
+            }
+        },
+        priority,
+        BypassCapacity::No,
+        &token
+    );
+
+    return future;
+}
+
+template <typename Function>
+void ThreadPool::post(const CancellationToken& token, Function&& function) {
+    post(Priority::Normal, token, std::forward<Function>(function));
+}
+
+template <typename Function>
+void ThreadPool::post(Priority priority, const CancellationToken& token,
+                      Function&& function)
+{
+    pushTask(
+        [token, f = std::forward<Function>(function)]() mutable {
+            if (!token.isCancelled()) {
+                f();
+            }
+        },
+        priority,
+        BypassCapacity::No,
+        &token
     );
+}
+
+template <typename Function>
+ThreadPool::Batch<Function>::Batch(Function f, int nTasks)
+    : function(std::move(f))
+    , nRemaining(nTasks)
+{}
+
+template <typename Function>
+void ThreadPool::Batch<Function>::finish(std::exception_ptr e) {
+    if (e) {
+        std::lock_guard<std::mutex> lock(exceptionMutex);
+        if (!exception) {
+            exception = std::move(e);
+        }
+    }
+
+    if (--nRemaining == 0) {
+        // We are the last task, so nobody else can modify the exception anymore
+        if (exception) {
+            promise.set_exception(exception);
+        }
+        else {
+            promise.set_value();
+        }
+    }
+}
+
+template <typename Iterator, typename Function>
+std::future<void> ThreadPool::queueBatch(Iterator first, Iterator last,
+                                         Function&& function)
+{
+    return queueBatch(
+        Priority::Normal,
+        std::move(first),
+        std::move(last),
+        std::forward<Function>(function)
+    );
+}
+
+template <typename Iterator, typename Function>
+std::future<void> ThreadPool::queueBatch(Priority priority, Iterator first,
+                                         Iterator last, Function&& function)
+{
+    using F = typename std::decay<Function>::type;
 
-    auto future = pck->get_future();
+    const int nTasks = static_cast<int>(std::distance(first, last));
+    if (nTasks == 0) {
+        std::promise<void> promise;
+        promise.set_value();
+        return promise.get_future();
+    }
 
-    _cv->notify_one();
+    auto batch = std::make_shared<Batch<F>>(std::forward<Function>(function), nTasks);
+    std::future<void> future = batch->promise.get_future();
 
+    // All tasks are created before any of them is pushed, so that the queue only has to
+    // be locked once
+    std::vector<Task> tasks;
+    tasks.reserve(nTasks);
+    for (Iterator it = first; it != last; ++it) {
+        tasks.emplace_back([batch, it]() {
+            try {
+                batch->function(*it);
+            }
+            catch (...) {
+                batch->finish(std::current_exception());
+                return;
+            }
+            batch->finish(nullptr);
+        });
+    }
+
+    pushTasks(std::move(tasks), priority);
     return future;
 }
 
+template <typename Rep, typename Period, typename F, typename... Arg>
+auto ThreadPool::queueAfter(std::chrono::duration<Rep, Period> delay, F&& f,
+                            Arg&&... arg) -> std::future<decltype(f(arg...))>
+{
+    return queueAfter(
+        Priority::Normal,
+        delay,
+        std::forward<F>(f),
+        std::forward<Arg>(arg)...
+    );
+}
+
+template <typename Rep, typename Period, typename F, typename... Arg>
+auto ThreadPool::queueAfter(Priority priority, std::chrono::duration<Rep, Period> delay,
+                            F&& f, Arg&&... arg) -> std::future<decltype(f(arg...))>
+{
+    using ReturnType = decltype(f(arg...));
+    std::packaged_task<ReturnType ()> pck(
+        std::bind(std::forward<F>(f), std::forward<Arg>(arg)...)
+    );
+    auto future = pck.get_future();
+
+    const TimerWheel::Clock::time_point expiration = TimerWheel::Clock::now() +
+        std::chrono::duration_cast<TimerWheel::Clock::duration>(delay);
+
+    // The timer thread only moves the packaged_task into the queue, it never executes it
+    // and never blocks, so the capacity does not apply
+    addTimer(
+        expiration,
+        [this, priority, pck = std::move(pck)]() mutable {
+            pushTask(
+                [pck = std::move(pck)]() mutable { pck(); },
+                priority,
+                BypassCapacity::Yes
+            );
+        }
+    );
+
+    return future;
+}
+
+template <typename Rep, typename Period, typename Function>
+CancellationToken ThreadPool::queueEvery(std::chrono::duration<Rep, Period> period,
+                                         Function&& function)
+{
+    return queueEvery(Priority::Normal, period, std::forward<Function>(function));
+}
+
+template <typename Rep, typename Period, typename Function>
+CancellationToken ThreadPool::queueEvery(Priority priority,
+                                         std::chrono::duration<Rep, Period> period,
+                                         Function&& function)
+{
+    const auto p = std::chrono::duration_cast<TimerWheel::Clock::duration>(period);
+    ghoul_assert(p.count() > 0, "period must be positive");
+
+    auto task = std::make_shared<PeriodicTask>(
+        std::forward<Function>(function),
+        p,
+        priority
+    );
+    schedulePeriodic(task, TimerWheel::Clock::now() + p);
+    return task->token;
+}
+
+template <typename T, typename Factory>
+T& ThreadPool::workerLocal(Factory&& factory) {
+    return currentStorage().get<T>(std::forward<Factory>(factory));
+}
+
+template <typename T>
+T& ThreadPool::workerLocal() {
+    return workerLocal<T>([]() { return T(); });
+}
+
+template <typename T>
+int ThreadPool::WorkerLocalStorage::typeIndex() {
+    static const int Index = nextTypeIndex();
+    return Index;
+}
+
+template <typename T, typename Factory>
+T& ThreadPool::WorkerLocalStorage::get(Factory&& factory) {
+    const int index = typeIndex<T>();
+    if (index < static_cast<int>(_entries.size()) && _entries[index].object) {
+        return *static_cast<T*>(_entries[index].object);
+    }
+
+    // The factory might ask for other objects itself, which might change _entries, so
+    // we only access the vector after the object has been created
+    std::unique_ptr<T> object = std::make_unique<T>(factory());
+    if (index < static_cast<int>(_entries.size()) && _entries[index].object) {
+        // The factory has created an object of the same type, so we keep that one
+        return *static_cast<T*>(_entries[index].object);
+    }
+
+    if (index >= static_cast<int>(_entries.size())) {
+        _entries.resize(index + 1);
+    }
+    _creationOrder.reserve(_creationOrder.size() + 1);
+    _entries[index].object = object.release();
+    _entries[index].deleter = [](void* o) { delete static_cast<T*>(o); };
+    _creationOrder.push_back(index);
+    return *static_cast<T*>(_entries[index].object);
+}
+
+#ifdef __cpp_impl_coroutine
+
+inline ThreadPool::ScheduleAwaiter::ScheduleAwaiter(ThreadPool& pool, Priority priority)
+    : _pool(pool)
+    , _priority(priority)
+{}
+
+inline bool ThreadPool::ScheduleAwaiter::await_ready() const noexcept {
+    return false;
+}
+
+inline void ThreadPool::ScheduleAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    // The Resumer must not be subject to the OverflowPolicy. If it were rejected, its
+    // destructor would resume the coroutine while the exception leaves this function,
+    // which would then resume the coroutine a second time
+    _pool.pushTask(
+        Task(Resumer(handle, &_isDiscarded)),
+        _priority,
+        BypassCapacity::Yes
+    );
+}
+
+inline void ThreadPool::ScheduleAwaiter::await_resume() const {
+    if (_isDiscarded) {
+        throw std::future_error(std::future_errc::broken_promise);
+    }
+}
+
+inline ThreadPool::ScheduleAwaiter::Resumer::Resumer(std::coroutine_handle<> h,
+                                                     bool* discarded)
+    : handle(h)
+    , isDiscarded(discarded)
+{}
+
+inline ThreadPool::ScheduleAwaiter::Resumer::Resumer(Resumer&& other) noexcept
+    : handle(std::exchange(other.handle, nullptr))
+    , isDiscarded(other.isDiscarded)
+{}
+
+inline ThreadPool::ScheduleAwaiter::Resumer::~Resumer() {
+    // If we still own the handle, the task was destroyed without being executed. The
+    // coroutine is resumed anyway, so that it can unwind instead of being leaked
+    if (handle) {
+        *isDiscarded = true;
+        std::exchange(handle, nullptr).resume();
+    }
+}
+
+inline void ThreadPool::ScheduleAwaiter::Resumer::operator()() {
+    std::exchange(handle, nullptr).resume();
+}
+
+inline ThreadPool::ScheduleAwaiter ThreadPool::schedule(Priority priority) {
+    return ScheduleAwaiter(*this, priority);
+}
+
+#endif // __cpp_impl_coroutine
+
+namespace internal {
+
+template <typename Function>
+void ThreadPoolAccess::postBypassingCapacity(ThreadPool& pool,
+                                             ThreadPool::Priority priority,
+                                             Function&& function)
+{
+    pool.pushTask(
+        ThreadPool::Task(std::forward<Function>(function)),
+        priority,
+        ThreadPool::BypassCapacity::Yes
+    );
+}
+
+} // namespace internal
+
 } // namespace ghoul
@@ -0,0 +1,152 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#ifndef __TIMERWHEEL_H__
+#define __TIMERWHEEL_H__
+
+#include <ghoul/misc/inplacefunction.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace ghoul {
+
+/**
+ * A hierarchical timer wheel that stores a large number of timers and finds the expired
+ * ones in constant time per timer. The time is divided into ticks of a fixed resolution.
+ * The wheel consists of NLevels levels with NSlots slots each; the slots of the lowest
+ * level cover one tick each, the slots of every higher level cover all slots of the
+ * level below. A timer is stored in the lowest level in which its expiration tick is in
+ * a different slot than the current tick. Whenever the current tick enters a slot of a
+ * higher level, the timers of that slot are redistributed into the lower levels, so each
+ * timer is moved at most NLevels times. Timers that expire beyond the range of the
+ * highest level are kept in an overflow list that is redistributed whenever the highest
+ * level wraps around.
+ *
+ * Timers never expire early, but can expire up to one resolution late. The TimerWheel is
+ * not thread-safe; the ThreadPool uses it from a single timer thread while holding a
+ * lock.
+ */
+class TimerWheel {
+public:
+    /// The clock that is used for the expiration times
+    using Clock = std::chrono::steady_clock;
+
+    /// The function that is returned once the timer has expired
+    using Callback = InplaceFunction<void()>;
+
+    /// The number of bits that are used to select a slot in a level
+    static const int NSlotBits = 6;
+    /// The number of slots per level
+    static const int NSlots = 1 << NSlotBits;
+    /// The number of levels
+    static const int NLevels = 4;
+
+    /**
+     * Creates an empty TimerWheel whose first tick starts at \p start.
+     * \param resolution The duration of a single tick
+     * \param start The point in time of the first tick
+     * \pre \p resolution must be positive
+     */
+    explicit TimerWheel(Clock::duration resolution = std::chrono::milliseconds(1),
+        Clock::time_point start = Clock::now());
+
+    /**
+     * Adds a timer that expires at \p expiration. If the \p expiration has already
+     * passed, the timer expires with the next tick.
+     * \param expiration The point in time at which the timer expires
+     * \param callback The function that is returned by #advance once the timer expired
+     */
+    void add(Clock::time_point expiration, Callback callback);
+
+    /**
+     * Advances the wheel to the point in time \p now and returns the callbacks of all
+     * timers that have expired in the meantime, ordered by their expiration.
+     * \param now The current point in time. If it is earlier than the last call, the
+     *        wheel is not changed
+     * \return The callbacks of all timers that have expired
+     */
+    std::vector<Callback> advance(Clock::time_point now);
+
+    /**
+     * Returns the earliest point in time at which #advance can return expired timers.
+     * This is the exact expiration time if the next timer is stored in the lowest level,
+     * and the point in time at which the next slot of a higher level is redistributed
+     * otherwise, which is always a lower bound.
+     * \return The earliest point in time at which a timer can expire, or
+     *         <code>Clock::time_point::max()</code> if the wheel is empty
+     */
+    Clock::time_point nextExpiration() const;
+
+    /**
+     * Returns the number of timers that have not expired yet.
+     * \return The number of timers that have not expired yet
+     */
+    int size() const;
+
+    /**
+     * Returns whether there are no timers that have not expired yet.
+     * \return <code>true</code> if there are no timers
+     */
+    bool isEmpty() const;
+
+private:
+    /// A single timer together with the tick at which it expires
+    struct Timer {
+        uint64_t tick;
+        Callback callback;
+    };
+
+    using Slot = std::vector<Timer>;
+
+    /// Stores the \p timer in the correct slot relative to the current tick
+    void insert(Timer&& timer);
+
+    /// Moves the current tick forward by one and collects the expired timers
+    void step(std::vector<Callback>& expired);
+
+    /// Returns the point in time at which the \p tick starts
+    Clock::time_point timeOf(uint64_t tick) const;
+
+    /// The slots of all levels
+    std::array<std::array<Slot, NSlots>, NLevels> _levels;
+    /// The timers that expire beyond the range of the highest level
+    Slot _overflow;
+
+    /// The duration of a single tick
+    Clock::duration _resolution;
+    /// The point in time at which tick 0 starts
+    Clock::time_point _start;
+    /// The tick up to which all timers have been collected
+    uint64_t _currentTick;
+    /// The number of stored timers
+    int _size;
+};
+
+} // namespace ghoul
+
+#endif // __TIMERWHEEL_H__
@@ -25,24 +25,44 @@
 
 #include <ghoul/misc/any.h>
 
+#include <cstring>
+#include <utility>
+
 namespace ghoul {
 
-any::any() noexcept {}
+any::any() noexcept
+    : _vtable(nullptr)
+{}
 
 any::any(const any& other)
-    : content(other.content ? other.content->clone() : nullptr)
-{}
+    : _vtable(other._vtable)
+{
+    if (_vtable) {
+        if (_vtable->copy) {
+            _vtable->copy(&_storage, &other._storage);
+        }
+        else {
+            // Values stored inplace are trivially copyable
+            std::memcpy(&_storage, &other._storage, sizeof(Storage));
+        }
+    }
+}
 
 any::any(any&& other) noexcept
-    : content(std::move(other.content))
+    : _vtable(other._vtable)
 {
-    other.content = nullptr;
+    // Both the inplace values and the pointers to heap values can be moved bitwise
+    std::memcpy(&_storage, &other._storage, sizeof(Storage));
+    other._vtable = nullptr;
 }
 
-any::~any() noexcept {}
+any::~any() noexcept {
+    clear();
+}
 
 any& any::swap(any& rhs) noexcept {
-    std::swap(content, rhs.content);
+    std::swap(_storage, rhs._storage);
+    std::swap(_vtable, rhs._vtable);
     return *this;
 }
 
@@ -58,18 +78,24 @@ any& any::operator=(any&& rhs) noexcept {
 }
 
 bool any::empty() const noexcept {
-    return !content;
+    return !_vtable;
 }
 
 void any::clear() noexcept {
-    any().swap(*this);
+    if (_vtable && _vtable->destroy) {
+        _vtable->destroy(&_storage);
+    }
+    _vtable = nullptr;
 }
 
 const std::type_info& any::type() const noexcept {
-    return content ? content->type() : typeid(void);
+    return _vtable ? _vtable->type() : typeid(void);
 }
 
-any::placeholder::~placeholder() {}
+bool any::isStoredInplace() const {
+    ghoul_assert(_vtable, "any must not be empty");
+    return _vtable->copy == nullptr;
+}
 
 inline void swap(any& lhs, any& rhs) noexcept {
     lhs.swap(rhs);
@@ -120,6 +120,10 @@ Buffer::size_type Buffer::size() const {
     return _offsetWrite;
 }
 
+Buffer::size_type Buffer::remaining() const {
+    return _offsetWrite > _offsetRead ? _offsetWrite - _offsetRead : 0;
+}
+
 void Buffer::write(const std::string& filename, Compress compress) {
     std::ofstream file;
     file.exceptions(std::ofstream::failbit | std::ofstream::badbit);
@@ -174,12 +178,19 @@ void Buffer::read(const std::string& filename) {
         file.read(reinterpret_cast<char*>(buffer.data()),size);
         
         // decompress
-        _offsetWrite = LZ4_decompress_safe(
+        const int nDecompressed = LZ4_decompress_safe(
             reinterpret_cast<const char*>(buffer.data()),
             reinterpret_cast<char*>(_data.data()),
             static_cast<int>(size),
             static_cast<int>(_data.size())
         );
+        // A corrupt file results in a negative size or in less data than was stored
+        if (nDecompressed < 0 || static_cast<size_t>(nDecompressed) != _data.size()) {
+            _data.clear();
+            _offsetWrite = 0;
+            throw RuntimeError("Error decompressing Buffer using LZ4", "Buffer");
+        }
+        _offsetWrite = static_cast<size_t>(nDecompressed);
     } else {
         file.read(reinterpret_cast<char*>(&size), sizeof(size_t));
         _data.resize(size);
@@ -196,15 +207,19 @@ void Buffer::serialize(const char* s) {
 void Buffer::serialize(const value_type* data, size_t size) {
     ghoul_assert(data, "Data must not be nullptr");
     
-    _data.resize(_data.capacity() + size);
-    std::memcpy(_data.data() + _offsetWrite, &data, size);
+    if (_offsetWrite + size > _data.size()) {
+        _data.resize(_offsetWrite + size);
+    }
+    std::memcpy(_data.data() + _offsetWrite, data, size);
     _offsetWrite += size;
 }
 
 void Buffer::deserialize(value_type* data, size_t size) {
     ghoul_assert(data, "Data must not be nullptr");
     
-    std::memcpy(data, &_data + _offsetRead, size);
+    ghoul_assert(_offsetRead + size <= _data.size(), "Insufficient buffer size");
+    
+    std::memcpy(data, _data.data() + _offsetRead, size);
     _offsetRead += size;
 }
 
@@ -212,7 +227,9 @@ template <>
 void Buffer::serialize(const std::string& v) {
     size_t length = v.length();
     size_t size = length + sizeof(size_t);
-    _data.resize(_data.capacity() + size);
+    if (_offsetWrite + size > _data.size()) {
+        _data.resize(_offsetWrite + size);
+    }
 
     std::memcpy(_data.data() + _offsetWrite, &length, sizeof(size_t));
     _offsetWrite += sizeof(size_t);
@@ -241,7 +258,9 @@ template <>
 void Buffer::serialize(const std::vector<std::string>& v) {
     size_t length = v.size();
     size_t size = sizeof(size_t);
-    _data.resize(_data.capacity() + size + length);
+    if (_offsetWrite + size + length > _data.size()) {
+        _data.resize(_offsetWrite + size + length);
+    }
     
     std::memcpy(_data.data() + _offsetWrite, &length, sizeof(size_t));
     _offsetWrite += sizeof(size_t);
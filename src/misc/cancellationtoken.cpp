@@ -0,0 +1,88 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include <ghoul/misc/cancellationtoken.h>
+
+#include <ghoul/misc/assert.h>
+
+namespace ghoul {
+
+CancellationToken::CancelledError::CancelledError()
+    : RuntimeError("Operation was cancelled", "CancellationToken")
+{}
+
+CancellationToken::State::State(bool withDeadline, Clock::time_point time)
+    : isCancelled(false)
+    , hasDeadline(withDeadline)
+    , deadline(time)
+{}
+
+CancellationToken::CancellationToken()
+    : _state(std::make_shared<State>(false, Clock::time_point()))
+{}
+
+CancellationToken::CancellationToken(Clock::time_point deadline)
+    : _state(std::make_shared<State>(true, deadline))
+{}
+
+CancellationToken::CancellationToken(Clock::duration timeout)
+    : CancellationToken(Clock::now() + timeout)
+{}
+
+void CancellationToken::cancel() {
+    _state->isCancelled = true;
+}
+
+bool CancellationToken::isCancelled() const {
+    if (_state->isCancelled) {
+        return true;
+    }
+
+    if (_state->hasDeadline && Clock::now() >= _state->deadline) {
+        // Remember that the deadline has passed, so that the following checks do not
+        // have to read the clock anymore
+        _state->isCancelled = true;
+        return true;
+    }
+    return false;
+}
+
+void CancellationToken::throwIfCancelled() const {
+    if (isCancelled()) {
+        throw CancelledError();
+    }
+}
+
+bool CancellationToken::hasDeadline() const {
+    return _state->hasDeadline;
+}
+
+CancellationToken::Clock::time_point CancellationToken::deadline() const {
+    ghoul_assert(hasDeadline(), "Token must have a deadline");
+
+    return _state->deadline;
+}
+
+} // namespace ghoul
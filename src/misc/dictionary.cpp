@@ -29,6 +29,8 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <mutex>
 
 using std::string;
 
@@ -53,7 +55,73 @@ using namespace ghoul::internal;
  */
 
 namespace ghoul {
+
+struct Dictionary::Storage {
+    Storage() = default;
+    explicit Storage(Entries e) : entries(std::move(e)) {}
+
+    Entries entries;
+
+    /// Whether the #entries are sorted and free of duplicate keys. This is only reset
+    /// by the exclusive owner of the Storage, but it is set by any reader that sorts the
+    /// #entries while holding the #sortMutex
+    std::atomic<bool> isSorted = { true };
+    std::mutex sortMutex;
+};
+
+namespace {
+
+void sortEntries(std::vector<std::pair<std::string, ghoul::any>>& entries) {
+    using Entry = std::pair<std::string, ghoul::any>;
+
+    // The stable sort keeps the values of the same key in the order they were appended
+    // in, so that the last one of them wins
+    std::stable_sort(
+        entries.begin(),
+        entries.end(),
+        [](const Entry& lhs, const Entry& rhs) { return lhs.first < rhs.first; }
+    );
+    auto out = entries.begin();
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        auto next = it + 1;
+        if (next != entries.end() && next->first == it->first) {
+            continue;
+        }
+        if (out != it) {
+            *out = std::move(*it);
+        }
+        ++out;
+    }
+    entries.erase(out, entries.end());
+}
+
+} // namespace
     
+DictionaryKey::DictionaryKey(std::string key)
+    : _key(std::move(key))
+{
+    ghoul_assert(!_key.empty(), "Key must not be empty");
+
+    std::string::size_type begin = 0;
+    while (true) {
+        const std::string::size_type end = _key.find('.', begin);
+        if (end == std::string::npos) {
+            _segments.push_back(_key.substr(begin));
+            break;
+        }
+        _segments.push_back(_key.substr(begin, end - begin));
+        begin = end + 1;
+    }
+}
+
+const std::string& DictionaryKey::key() const {
+    return _key;
+}
+
+const std::vector<std::string>& DictionaryKey::segments() const {
+    return _segments;
+}
+
 Dictionary::DictionaryError::DictionaryError(std::string message)
     : RuntimeError(std::move(message), "Dictionary")
 {}
@@ -193,8 +261,9 @@ Dictionary::Dictionary(std::initializer_list<std::pair<std::string, ghoul::any>>
 std::vector<string> Dictionary::keys(const string& location) const {
     if (location.empty()) {
         std::vector<string> result;
-        result.reserve(size());
-        for (const auto& it : *this) {
+        const Entries& e = entries();
+        result.reserve(e.size());
+        for (const Entry& it : e) {
             result.push_back(it.first);
         }
         return result;
@@ -243,23 +312,138 @@ bool Dictionary::hasKey(const string& key) const {
     return dict->hasKey(rest);
 }
 
+bool Dictionary::hasKey(const DictionaryKey& key) const {
+    const Dictionary* dict = parentDictionary(key);
+    return dict && (dict->find(key.segments().back()) != dict->cend());
+}
+
 size_t Dictionary::size() const {
-    return std::map<std::string, ghoul::any>::size();
+    return entries().size();
 }
 
 void Dictionary::clear() {
-    std::map<std::string, ghoul::any>::clear();
+    // Other Dictionaries that share the entries keep them
+    _entries = nullptr;
 }
 
 bool Dictionary::empty() const {
-    return std::map<std::string, ghoul::any>::empty();
+    return entries().empty();
 }
 
 bool Dictionary::removeKey(const std::string& key) {
     ghoul_assert(!key.empty(), "Key must not be empty");
     
-    std::map<std::string, ghoul::any>::size_type res = erase(key);
-    return (res == 1);
+    // Check for the key first so that the entries are not unshared unnecessarily
+    if (static_cast<const Dictionary*>(this)->find(key) == cend()) {
+        return false;
+    }
+    Entries& e = mutableEntries();
+    e.erase(find(key));
+    return true;
+}
+
+Dictionary::ConstIterator Dictionary::begin() const {
+    return entries().cbegin();
+}
+
+Dictionary::ConstIterator Dictionary::end() const {
+    return entries().cend();
+}
+
+Dictionary::Entries::iterator Dictionary::find(const std::string& key) {
+    Entries& e = mutableEntries();
+    auto it = std::lower_bound(
+        e.begin(),
+        e.end(),
+        key,
+        [](const Entry& entry, const std::string& k) { return entry.first < k; }
+    );
+    if (it != e.end() && it->first == key) {
+        return it;
+    }
+    else {
+        return e.end();
+    }
+}
+
+Dictionary::Entries::const_iterator Dictionary::find(const std::string& key) const {
+    const Entries& e = entries();
+    auto it = std::lower_bound(
+        e.cbegin(),
+        e.cend(),
+        key,
+        [](const Entry& entry, const std::string& k) { return entry.first < k; }
+    );
+    if (it != e.cend() && it->first == key) {
+        return it;
+    }
+    else {
+        return e.cend();
+    }
+}
+
+Dictionary::Entries::const_iterator Dictionary::cend() const {
+    return entries().cend();
+}
+
+ghoul::any& Dictionary::entry(std::string key) {
+    Storage& s = ownStorage();
+    Entries& e = s.entries;
+
+    // Dictionaries are often filled in sorted order, in which case they stay sorted.
+    // Otherwise, inserting at the sorted position would make filling the Dictionary
+    // quadratic, so the entries are sorted only once they are accessed the next time
+    if (s.isSorted.load(std::memory_order_relaxed) &&
+        !e.empty() && !(e.back().first < key))
+    {
+        s.isSorted.store(false, std::memory_order_relaxed);
+    }
+    e.emplace_back(std::move(key), ghoul::any());
+    return e.back().second;
+}
+
+const Dictionary::Entries& Dictionary::entries() const {
+    static const Entries Empty;
+    if (!_entries) {
+        return Empty;
+    }
+
+    Storage& s = *_entries;
+    if (!s.isSorted.load(std::memory_order_acquire)) {
+        // Multiple readers might share the Storage, so only one of them sorts it
+        std::lock_guard<std::mutex> lock(s.sortMutex);
+        if (!s.isSorted.load(std::memory_order_relaxed)) {
+            sortEntries(s.entries);
+            s.isSorted.store(true, std::memory_order_release);
+        }
+    }
+    return s.entries;
+}
+
+Dictionary::Entries& Dictionary::mutableEntries() {
+    Storage& s = ownStorage();
+    if (!s.isSorted.load(std::memory_order_relaxed)) {
+        sortEntries(s.entries);
+        s.isSorted.store(true, std::memory_order_relaxed);
+    }
+    return s.entries;
+}
+
+Dictionary::Storage& Dictionary::ownStorage() {
+    if (!_entries) {
+        _entries = std::make_shared<Storage>();
+    }
+    else if (_entries.use_count() > 1) {
+        // Copying the entries only copies the pointers to nested Dictionaries
+        _entries = std::make_shared<Storage>(entries());
+    }
+    else {
+        // use_count is only a relaxed load, so observing the only owner does not order
+        // the following writes after the reads of a copy that was destroyed on another
+        // thread. The fence synchronizes with the release in that copy's destructor
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return *_entries;
 }
 
 bool Dictionary::splitKey(const string& key, string& first, string& rest) const {
@@ -275,6 +459,22 @@ bool Dictionary::splitKey(const string& key, string& first, string& rest) const
     }
 }
 
+const Dictionary* Dictionary::parentDictionary(const DictionaryKey& key) const {
+    const std::vector<std::string>& segments = key.segments();
+    const Dictionary* dict = this;
+    for (size_t i = 0; i < segments.size() - 1; ++i) {
+        auto it = dict->find(segments[i]);
+        if (it == dict->cend()) {
+            return nullptr;
+        }
+        dict = ghoul::any_cast<Dictionary>(&(it->second));
+        if (!dict) {
+            return nullptr;
+        }
+    }
+    return dict;
+}
+
 void Dictionary::setValueAnyHelper(std::string key, ghoul::any value) {
     // Ugly if-else statement is necessary as 'type' cannot be not constexpr
     const std::type_info& type = value.type();
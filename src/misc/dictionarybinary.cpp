@@ -0,0 +1,707 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include <ghoul/misc/dictionarybinary.h>
+
+#include <ghoul/misc/assert.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <ios>
+
+#ifdef WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * The serialized data starts with the magic bytes and the version, followed by the top
+ * level node. Each node consists of the number of its entries and a table with one
+ * Record per entry, sorted by key. The keys and values follow the table, with nested
+ * nodes being written recursively after the key of the entry that contains them. All
+ * offsets are relative to the beginning of the magic bytes and, as nested nodes are
+ * always written after their parent, the offset of a nested node is always larger than
+ * the offset of its parent, which guarantees that even malformed data cannot create a
+ * cycle. As neither the Buffer nor a memory mapped file make any guarantees about the
+ * alignment of the data, all values are read using <code>std::memcpy</code>.
+ */
+
+namespace ghoul {
+
+namespace internal {
+
+struct DictionaryRecord {
+    uint64_t keyOffset;
+    uint64_t valueOffset;
+    uint64_t valueSize;
+    uint32_t keyLength;
+    uint8_t kind;
+    uint8_t components;
+    uint16_t padding;
+};
+
+} // namespace internal
+
+namespace {
+    const std::array<char, 4> Magic = { { 'G', 'D', 'I', 'C' } };
+    const uint32_t Version = 1;
+    const size_t HeaderSize = sizeof(Magic) + sizeof(Version);
+
+    enum class Kind : uint8_t {
+        Bool = 0,
+        Integral,
+        UnsignedIntegral,
+        Floating,
+        String,
+        Dictionary
+    };
+
+    using Record = internal::DictionaryRecord;
+    static_assert(sizeof(Record) == 32, "Record must not contain padding");
+
+    template <typename T, size_t N>
+    bool arrayData(const ghoul::any& value, const T*& data, size_t& components) {
+        const std::array<T, N>* v = ghoul::any_cast<std::array<T, N>>(&value);
+        if (v) {
+            data = v->data();
+            components = N;
+            return true;
+        }
+        return false;
+    }
+
+    // These are all of the sizes that are used by the StorageTypeConverter%s
+    template <typename T>
+    bool arrayData(const ghoul::any& value, const T*& data, size_t& components) {
+        return
+            arrayData<T, 2>(value, data, components) ||
+            arrayData<T, 3>(value, data, components) ||
+            arrayData<T, 4>(value, data, components) ||
+            arrayData<T, 6>(value, data, components) ||
+            arrayData<T, 8>(value, data, components) ||
+            arrayData<T, 9>(value, data, components) ||
+            arrayData<T, 12>(value, data, components) ||
+            arrayData<T, 16>(value, data, components);
+    }
+
+    template <typename T, size_t N>
+    void setArray(Dictionary& dictionary, std::string key, const unsigned char* data) {
+        std::array<T, N> v;
+        std::memcpy(v.data(), data, N * sizeof(T));
+        dictionary.setValue(std::move(key), v);
+    }
+
+    template <typename T>
+    void setNumbers(Dictionary& dictionary, std::string key, const unsigned char* data,
+                    size_t components)
+    {
+        switch (components) {
+            case 1:
+            {
+                T v;
+                std::memcpy(&v, data, sizeof(T));
+                dictionary.setValue(std::move(key), v);
+                break;
+            }
+            case 2:
+                setArray<T, 2>(dictionary, std::move(key), data);
+                break;
+            case 3:
+                setArray<T, 3>(dictionary, std::move(key), data);
+                break;
+            case 4:
+                setArray<T, 4>(dictionary, std::move(key), data);
+                break;
+            case 6:
+                setArray<T, 6>(dictionary, std::move(key), data);
+                break;
+            case 8:
+                setArray<T, 8>(dictionary, std::move(key), data);
+                break;
+            case 9:
+                setArray<T, 9>(dictionary, std::move(key), data);
+                break;
+            case 12:
+                setArray<T, 12>(dictionary, std::move(key), data);
+                break;
+            case 16:
+                setArray<T, 16>(dictionary, std::move(key), data);
+                break;
+            default:
+                throw DictionaryBinaryError(
+                    "Invalid number of components (" + std::to_string(components) +
+                    ") for key '" + key + "'"
+                );
+        }
+    }
+
+    void serializeRaw(Buffer& buffer, const void* data, size_t size) {
+        if (size > 0) {
+            buffer.serialize(reinterpret_cast<const Buffer::value_type*>(data), size);
+        }
+    }
+
+    template <typename T>
+    bool serializeNumbers(const ghoul::any& value, Kind kind, Buffer& buffer,
+                          Record& record)
+    {
+        const T* data = ghoul::any_cast<T>(&value);
+        size_t components = 1;
+        if (data || arrayData<T>(value, data, components)) {
+            record.kind = static_cast<uint8_t>(kind);
+            record.components = static_cast<uint8_t>(components);
+            serializeRaw(buffer, data, components * sizeof(T));
+            return true;
+        }
+        return false;
+    }
+
+    void serializeNode(const Dictionary& dictionary, Buffer& buffer, size_t base,
+                       const std::string& path)
+    {
+        uint64_t count = dictionary.size();
+        buffer.serialize(count);
+
+        // Reserve the table; the Records are filled in once the position of each key
+        // and value is known
+        size_t table = buffer.size();
+        std::vector<Record> records(count, Record{});
+        serializeRaw(buffer, records.data(), count * sizeof(Record));
+
+        size_t i = 0;
+        for (const std::pair<std::string, ghoul::any>& p : dictionary) {
+            Record record = {};
+            record.keyOffset = buffer.size() - base;
+            record.keyLength = static_cast<uint32_t>(p.first.size());
+            serializeRaw(buffer, p.first.data(), p.first.size());
+
+            record.valueOffset = buffer.size() - base;
+            const ghoul::any& value = p.second;
+            bool success =
+                serializeNumbers<internal::IntegralType>(
+                    value, Kind::Integral, buffer, record
+                ) ||
+                serializeNumbers<internal::UnsignedIntegralType>(
+                    value, Kind::UnsignedIntegral, buffer, record
+                ) ||
+                serializeNumbers<internal::FloatingType>(
+                    value, Kind::Floating, buffer, record
+                );
+
+            if (!success) {
+                record.components = 1;
+                if (const bool* b = ghoul::any_cast<bool>(&value)) {
+                    record.kind = static_cast<uint8_t>(Kind::Bool);
+                    uint8_t byte = *b ? 1 : 0;
+                    buffer.serialize(byte);
+                }
+                else if (const std::string* s = ghoul::any_cast<std::string>(&value)) {
+                    record.kind = static_cast<uint8_t>(Kind::String);
+                    serializeRaw(buffer, s->data(), s->size());
+                }
+                else if (const char* const* cs = ghoul::any_cast<const char*>(&value)) {
+                    record.kind = static_cast<uint8_t>(Kind::String);
+                    serializeRaw(buffer, *cs, std::strlen(*cs));
+                }
+                else if (const Dictionary* dict = ghoul::any_cast<Dictionary>(&value)) {
+                    record.kind = static_cast<uint8_t>(Kind::Dictionary);
+                    serializeNode(
+                        *dict,
+                        buffer,
+                        base,
+                        path.empty() ? p.first : path + "." + p.first
+                    );
+                }
+                else {
+                    throw DictionaryBinaryError(
+                        "Value for key '" +
+                        (path.empty() ? p.first : path + "." + p.first) +
+                        "' of type '" + value.type().name() + "' cannot be serialized"
+                    );
+                }
+            }
+            record.valueSize = buffer.size() - base - record.valueOffset;
+
+            std::memcpy(
+                buffer.data() + table + i * sizeof(Record),
+                &record,
+                sizeof(Record)
+            );
+            ++i;
+        }
+    }
+
+    // Compares the key of the record with the provided key in the same order as
+    // std::string
+    int compare(const unsigned char* recordKey, size_t recordLength, const char* key,
+                size_t length)
+    {
+        int res = std::memcmp(recordKey, key, std::min(recordLength, length));
+        if (res != 0) {
+            return res;
+        }
+        if (recordLength == length) {
+            return 0;
+        }
+        return recordLength < length ? -1 : 1;
+    }
+} // namespace
+
+DictionaryBinaryError::DictionaryBinaryError(std::string message)
+    : RuntimeError(std::move(message), "Dictionary")
+{}
+
+void serializeDictionary(const Dictionary& dictionary, Buffer& buffer) {
+    size_t lengthPosition = buffer.size();
+    uint64_t length = 0;
+    buffer.serialize(length);
+
+    size_t base = buffer.size();
+    serializeRaw(buffer, Magic.data(), Magic.size());
+    buffer.serialize(Version);
+    serializeNode(dictionary, buffer, base, "");
+
+    length = buffer.size() - base;
+    std::memcpy(buffer.data() + lengthPosition, &length, sizeof(uint64_t));
+}
+
+Dictionary deserializeDictionary(Buffer& buffer) {
+    if (buffer.remaining() < sizeof(uint64_t)) {
+        throw DictionaryBinaryError("Buffer does not contain a serialized Dictionary");
+    }
+    uint64_t length;
+    buffer.deserialize(length);
+    if (length < HeaderSize) {
+        throw DictionaryBinaryError("Serialized Dictionary is too short");
+    }
+    if (length > buffer.remaining()) {
+        throw DictionaryBinaryError(
+            "Serialized Dictionary of " + std::to_string(length) + " bytes exceeds the " +
+            std::to_string(buffer.remaining()) + " remaining bytes of the Buffer"
+        );
+    }
+
+    std::vector<unsigned char> data(static_cast<size_t>(length));
+    buffer.deserialize(data.data(), data.size());
+    return DictionaryView::root(data.data(), data.size()).materialize();
+}
+
+DictionaryView::DictionaryView(const unsigned char* data, size_t size, uint64_t node)
+    : _data(data)
+    , _size(size)
+    , _node(node)
+{
+    if (_node > _size || _size - _node < sizeof(uint64_t)) {
+        throw DictionaryBinaryError("Node offset is out of bounds");
+    }
+    // Checking the count against the available space up front keeps the offsets of all
+    // records from overflowing
+    uint64_t count;
+    std::memcpy(&count, _data + _node, sizeof(uint64_t));
+    if (count > (_size - _node - sizeof(uint64_t)) / sizeof(Record)) {
+        throw DictionaryBinaryError("Number of records exceeds the data");
+    }
+}
+
+DictionaryView DictionaryView::root(const unsigned char* data, size_t size) {
+    if (size < HeaderSize || std::memcmp(data, Magic.data(), Magic.size()) != 0) {
+        throw DictionaryBinaryError("Data does not contain a serialized Dictionary");
+    }
+    uint32_t version;
+    std::memcpy(&version, data + Magic.size(), sizeof(uint32_t));
+    if (version != Version) {
+        throw DictionaryBinaryError(
+            "Unsupported version " + std::to_string(version) + " of serialized data"
+        );
+    }
+    return DictionaryView(data, size, HeaderSize);
+}
+
+size_t DictionaryView::size() const {
+    uint64_t count;
+    std::memcpy(&count, _data + _node, sizeof(uint64_t));
+    return static_cast<size_t>(count);
+}
+
+bool DictionaryView::empty() const {
+    return size() == 0;
+}
+
+std::vector<std::string> DictionaryView::keys() const {
+    size_t n = size();
+    std::vector<std::string> result;
+    result.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        Record r = record(i);
+        result.emplace_back(reinterpret_cast<const char*>(_data + r.keyOffset),
+            r.keyLength);
+    }
+    return result;
+}
+
+bool DictionaryView::hasKey(const std::string& key) const {
+    ghoul_assert(!key.empty(), "Key must not be empty");
+
+    DictionaryView parent = *this;
+    Record r;
+    std::string::size_type leaf;
+    return findNested(key, parent, r, leaf);
+}
+
+DictionaryView DictionaryView::view(const std::string& key) const {
+    ghoul_assert(!key.empty(), "Key must not be empty");
+
+    DictionaryView parent = *this;
+    Record r;
+    std::string::size_type leaf;
+    if (!findNested(key, parent, r, leaf)) {
+        throw Dictionary::KeyError("Key '" + key + "' was not found");
+    }
+    if (r.kind != static_cast<uint8_t>(Kind::Dictionary)) {
+        throw Dictionary::ConversionError(
+            "Value at key '" + key + "' is not a Dictionary"
+        );
+    }
+    return parent.child(r);
+}
+
+Dictionary DictionaryView::materialize() const {
+    Dictionary result;
+    size_t n = size();
+    for (size_t i = 0; i < n; ++i) {
+        Record r = record(i);
+        materializeEntry(
+            r,
+            std::string(reinterpret_cast<const char*>(_data + r.keyOffset), r.keyLength),
+            result
+        );
+    }
+    return result;
+}
+
+internal::DictionaryRecord DictionaryView::record(uint64_t index) const {
+    uint64_t offset = _node + sizeof(uint64_t) + index * sizeof(Record);
+    if (index >= size() || offset + sizeof(Record) > _size) {
+        throw DictionaryBinaryError("Record is out of bounds");
+    }
+    Record r;
+    std::memcpy(&r, _data + offset, sizeof(Record));
+    if (r.keyOffset > _size || r.keyLength > _size - r.keyOffset ||
+        r.valueOffset > _size || r.valueSize > _size - r.valueOffset)
+    {
+        throw DictionaryBinaryError("Record points outside of the data");
+    }
+    return r;
+}
+
+bool DictionaryView::find(const char* key, size_t length, Record& result) const {
+    // The records are sorted by key, so we can use a binary search
+    uint64_t first = 0;
+    uint64_t last = size();
+    while (first < last) {
+        uint64_t middle = first + (last - first) / 2;
+        Record r = record(middle);
+        int res = compare(_data + r.keyOffset, r.keyLength, key, length);
+        if (res == 0) {
+            result = r;
+            return true;
+        }
+        if (res < 0) {
+            first = middle + 1;
+        }
+        else {
+            last = middle;
+        }
+    }
+    return false;
+}
+
+bool DictionaryView::findNested(const std::string& key, DictionaryView& parent,
+                                Record& result, std::string::size_type& leaf) const
+{
+    parent = *this;
+    std::string::size_type begin = 0;
+    while (true) {
+        std::string::size_type end = key.find('.', begin);
+        if (end == std::string::npos) {
+            leaf = begin;
+            return parent.find(key.data() + begin, key.size() - begin, result);
+        }
+        Record r;
+        if (!parent.find(key.data() + begin, end - begin, r) ||
+            r.kind != static_cast<uint8_t>(Kind::Dictionary))
+        {
+            return false;
+        }
+        parent = parent.child(r);
+        begin = end + 1;
+    }
+}
+
+DictionaryView DictionaryView::child(const Record& record) const {
+    ghoul_assert(
+        record.kind == static_cast<uint8_t>(Kind::Dictionary),
+        "Record must be a Dictionary"
+    );
+    if (record.valueOffset <= _node) {
+        throw DictionaryBinaryError("Nested Dictionary precedes its parent");
+    }
+    return DictionaryView(_data, _size, record.valueOffset);
+}
+
+void DictionaryView::materializeEntry(const Record& record, std::string key,
+                                      Dictionary& dictionary) const
+{
+    const unsigned char* data = _data + record.valueOffset;
+    size_t components = record.components;
+    switch (static_cast<Kind>(record.kind)) {
+        case Kind::Bool:
+            if (record.valueSize != 1) {
+                break;
+            }
+            dictionary.setValue(std::move(key), *data != 0);
+            return;
+        case Kind::Integral:
+            if (record.valueSize != components * sizeof(internal::IntegralType)) {
+                break;
+            }
+            setNumbers<internal::IntegralType>(
+                dictionary, std::move(key), data, components
+            );
+            return;
+        case Kind::UnsignedIntegral:
+            if (record.valueSize !=
+                components * sizeof(internal::UnsignedIntegralType))
+            {
+                break;
+            }
+            setNumbers<internal::UnsignedIntegralType>(
+                dictionary, std::move(key), data, components
+            );
+            return;
+        case Kind::Floating:
+            if (record.valueSize != components * sizeof(internal::FloatingType)) {
+                break;
+            }
+            setNumbers<internal::FloatingType>(
+                dictionary, std::move(key), data, components
+            );
+            return;
+        case Kind::String:
+            dictionary.setValue(
+                std::move(key),
+                std::string(reinterpret_cast<const char*>(data), record.valueSize)
+            );
+            return;
+        case Kind::Dictionary:
+            dictionary.setValue(std::move(key), child(record).materialize());
+            return;
+    }
+    throw DictionaryBinaryError("Malformed value for key '" + key + "'");
+}
+
+bool DictionaryView::materializeEntry(const std::string& key, Dictionary& dictionary,
+                                      std::string& leaf) const
+{
+    ghoul_assert(!key.empty(), "Key must not be empty");
+
+    DictionaryView parent = *this;
+    Record r;
+    std::string::size_type leafBegin;
+    if (!findNested(key, parent, r, leafBegin)) {
+        return false;
+    }
+    leaf = key.substr(leafBegin);
+    parent.materializeEntry(r, leaf, dictionary);
+    return true;
+}
+
+MappedDictionary::MappedDictionary(const std::string& filename)
+    : _mapping(nullptr)
+    , _mappingSize(0)
+#ifdef WIN32
+    , _file(INVALID_HANDLE_VALUE)
+    , _mappingHandle(nullptr)
+#endif
+    , _data(nullptr)
+    , _size(0)
+{
+    ghoul_assert(!filename.empty(), "Filename must not be empty");
+
+#ifdef WIN32
+    _file = CreateFileA(
+        filename.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr
+    );
+    if (_file == INVALID_HANDLE_VALUE) {
+        throw DictionaryBinaryError("Could not open file '" + filename + "'");
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(_file, &fileSize)) {
+        CloseHandle(_file);
+        throw DictionaryBinaryError("Could not determine size of '" + filename + "'");
+    }
+    _mappingSize = static_cast<size_t>(fileSize.QuadPart);
+    if (_mappingSize > 0) {
+        _mappingHandle = CreateFileMappingA(
+            _file,
+            nullptr,
+            PAGE_READONLY,
+            0,
+            0,
+            nullptr
+        );
+        if (_mappingHandle) {
+            _mapping = MapViewOfFile(_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+        }
+        if (!_mapping) {
+            if (_mappingHandle) {
+                CloseHandle(_mappingHandle);
+            }
+            CloseHandle(_file);
+            throw DictionaryBinaryError("Could not map file '" + filename + "'");
+        }
+    }
+#else
+    int descriptor = open(filename.c_str(), O_RDONLY);
+    if (descriptor == -1) {
+        throw DictionaryBinaryError("Could not open file '" + filename + "'");
+    }
+    struct stat status;
+    if (fstat(descriptor, &status) == -1) {
+        close(descriptor);
+        throw DictionaryBinaryError("Could not determine size of '" + filename + "'");
+    }
+    _mappingSize = static_cast<size_t>(status.st_size);
+    if (_mappingSize > 0) {
+        _mapping = mmap(nullptr, _mappingSize, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (_mapping == MAP_FAILED) {
+            _mapping = nullptr;
+        }
+    }
+    // The mapping stays valid after the file descriptor has been closed
+    close(descriptor);
+    if (_mappingSize > 0 && !_mapping) {
+        throw DictionaryBinaryError("Could not map file '" + filename + "'");
+    }
+#endif
+
+    // The layout of the file is determined by Buffer::write; compressed files have to
+    // be decompressed into memory, uncompressed files can be used directly
+    const unsigned char* file = reinterpret_cast<const unsigned char*>(_mapping);
+    const size_t FileHeaderSize = sizeof(bool) + sizeof(size_t);
+    try {
+        if (_mappingSize < FileHeaderSize) {
+            throw DictionaryBinaryError("File '" + filename + "' is too short");
+        }
+
+        const unsigned char* payload;
+        size_t payloadSize;
+        bool compressed;
+        std::memcpy(&compressed, file, sizeof(bool));
+        if (compressed) {
+            try {
+                _buffer.read(filename);
+            }
+            catch (const RuntimeError&) {
+                throw DictionaryBinaryError(
+                    "File '" + filename + "' could not be decompressed"
+                );
+            }
+            catch (const std::ios_base::failure&) {
+                throw DictionaryBinaryError("File '" + filename + "' is truncated");
+            }
+            payload = _buffer.data();
+            payloadSize = _buffer.size();
+        }
+        else {
+            std::memcpy(&payloadSize, file + sizeof(bool), sizeof(size_t));
+            if (payloadSize > _mappingSize - FileHeaderSize) {
+                throw DictionaryBinaryError("File '" + filename + "' is truncated");
+            }
+            payload = file + FileHeaderSize;
+        }
+
+        // The payload starts with the length of the serialized Dictionary
+        uint64_t length;
+        if (payloadSize < sizeof(uint64_t)) {
+            throw DictionaryBinaryError("File '" + filename + "' is truncated");
+        }
+        std::memcpy(&length, payload, sizeof(uint64_t));
+        if (length > payloadSize - sizeof(uint64_t)) {
+            throw DictionaryBinaryError("File '" + filename + "' is truncated");
+        }
+        _data = payload + sizeof(uint64_t);
+        _size = static_cast<size_t>(length);
+
+        // Validate the header once so that errors are reported on construction
+        DictionaryView::root(_data, _size);
+    }
+    catch (...) {
+        unmap();
+        throw;
+    }
+}
+
+MappedDictionary::~MappedDictionary() {
+    unmap();
+}
+
+DictionaryView MappedDictionary::view() const {
+    return DictionaryView::root(_data, _size);
+}
+
+void MappedDictionary::unmap() {
+#ifdef WIN32
+    if (_mapping) {
+        UnmapViewOfFile(_mapping);
+    }
+    if (_mappingHandle) {
+        CloseHandle(_mappingHandle);
+        _mappingHandle = nullptr;
+    }
+    if (_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(_file);
+        _file = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (_mapping) {
+        munmap(_mapping, _mappingSize);
+    }
+#endif
+    _mapping = nullptr;
+}
+
+} // namespace ghoul
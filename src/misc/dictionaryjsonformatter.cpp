@@ -69,8 +69,8 @@ std::string DictionaryJsonFormatter::formatValue(
         float value = dictionary.value<float>(key);
         return std::to_string(value);
     }
-    if (dictionary.hasValue<int>(key)) {
-        int value = dictionary.value<int>(key);
+    if (dictionary.hasValue<long long>(key)) {
+        long long value = dictionary.value<long long>(key);
         return std::to_string(value);
     }
     if (dictionary.hasValue<std::string>(key)) {
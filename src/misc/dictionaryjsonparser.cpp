@@ -0,0 +1,706 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include <ghoul/misc/dictionaryjsonparser.h>
+
+#include <ghoul/misc/assert.h>
+#include <ghoul/misc/dictionary.h>
+
+#include <cstdint>
+#include <cstring>
+#include <locale>
+#include <sstream>
+#include <vector>
+
+namespace {
+    using Handler = ghoul::DictionaryJsonParser::Handler;
+    using JsonParsingError = ghoul::DictionaryJsonParser::JsonParsingError;
+
+    // The contents of strings and whitespace are skipped eight bytes at a time by
+    // testing all bytes of a 64 bit word at once, which only requires portable integer
+    // arithmetic. The tests report whether any of the bytes matches, but not which one,
+    // so the final bytes are always checked one at a time
+    const uint64_t Ones = 0x0101010101010101ULL;
+    const uint64_t Highs = 0x8080808080808080ULL;
+
+    // Returns whether any of the bytes in the word is smaller than n, with n <= 128
+    bool hasByteLess(uint64_t word, unsigned char n) {
+        return ((word - Ones * n) & ~word & Highs) != 0;
+    }
+
+    // Returns whether any of the bytes in the word is equal to c
+    bool hasByte(uint64_t word, unsigned char c) {
+        return hasByteLess(word ^ (Ones * c), 1);
+    }
+
+    // Returns whether any of the bytes in the word ends the fast path of a string
+    bool hasSpecialStringByte(uint64_t word) {
+        return hasByte(word, '"') || hasByte(word, '\\') || hasByteLess(word, 0x20);
+    }
+
+    // Returns whether all of the bytes in the word are spaces
+    bool isAllSpaces(uint64_t word) {
+        return word == Ones * ' ';
+    }
+
+    bool isDigit(char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    JsonParsingError createError(const char* begin, const char* position,
+                                 const std::string& message)
+    {
+        size_t line = 1;
+        const char* lineBegin = begin;
+        for (const char* c = begin; c != position; ++c) {
+            if (*c == '\n') {
+                ++line;
+                lineBegin = c + 1;
+            }
+        }
+        size_t column = static_cast<size_t>(position - lineBegin) + 1;
+        return JsonParsingError(message, line, column);
+    }
+
+    void encodeUtf8(uint32_t codepoint, std::string& result) {
+        if (codepoint < 0x80) {
+            result.push_back(static_cast<char>(codepoint));
+        }
+        else if (codepoint < 0x800) {
+            result.push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+            result.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+        }
+        else if (codepoint < 0x10000) {
+            result.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+            result.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+            result.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+        }
+        else {
+            result.push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+            result.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+            result.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+            result.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+        }
+    }
+
+    class Parser {
+    public:
+        Parser(const char* json, size_t length, Handler& handler)
+            : _begin(json)
+            , _current(json)
+            , _end(json + length)
+            , _token(json)
+            , _handler(handler)
+        {}
+
+        void parse() {
+            try {
+                parseDocument();
+            }
+            catch (const JsonParsingError&) {
+                throw;
+            }
+            catch (const std::exception& e) {
+                // Exceptions thrown by the Handler are reported at the beginning of the
+                // element that was passed to it
+                throw createError(_begin, _token, e.what());
+            }
+        }
+
+    private:
+        enum class Container : char {
+            Object,
+            Array
+        };
+
+        [[noreturn]] void error(const char* position, const std::string& message) {
+            throw createError(_begin, position, message);
+        }
+
+        void parseDocument() {
+            bool expectValue = true;
+            while (true) {
+                if (expectValue) {
+                    expectValue = parseValue();
+                    if (expectValue) {
+                        continue;
+                    }
+                }
+                if (_stack.empty()) {
+                    break;
+                }
+
+                skipWhitespace();
+                const bool isObject = _stack.back() == Container::Object;
+                const char close = isObject ? '}' : ']';
+                if (_current != _end && *_current == ',') {
+                    ++_current;
+                    if (isObject) {
+                        parseKey();
+                    }
+                    expectValue = true;
+                }
+                else if (_current != _end && *_current == close) {
+                    _token = _current;
+                    ++_current;
+                    _stack.pop_back();
+                    if (isObject) {
+                        _handler.endObject();
+                    }
+                    else {
+                        _handler.endArray();
+                    }
+                }
+                else {
+                    error(
+                        _current,
+                        isObject ? "Expected ',' or '}'" : "Expected ',' or ']'"
+                    );
+                }
+            }
+
+            skipWhitespace();
+            if (_current != _end) {
+                error(_current, "Unexpected character after the end of the document");
+            }
+        }
+
+        // Parses the next value and returns whether it opened a container whose first
+        // value has to be parsed next
+        bool parseValue() {
+            skipWhitespace();
+            if (_current == _end) {
+                error(_current, "Unexpected end of the document, expected a value");
+            }
+
+            _token = _current;
+            switch (*_current) {
+                case '{':
+                    ++_current;
+                    _handler.startObject();
+                    skipWhitespace();
+                    if (_current != _end && *_current == '}') {
+                        _token = _current;
+                        ++_current;
+                        _handler.endObject();
+                        return false;
+                    }
+                    _stack.push_back(Container::Object);
+                    parseKey();
+                    return true;
+                case '[':
+                    ++_current;
+                    _handler.startArray();
+                    skipWhitespace();
+                    if (_current != _end && *_current == ']') {
+                        _token = _current;
+                        ++_current;
+                        _handler.endArray();
+                        return false;
+                    }
+                    _stack.push_back(Container::Array);
+                    return true;
+                case '"':
+                    parseString(false);
+                    return false;
+                case 't':
+                    parseLiteral("true");
+                    _handler.booleanValue(true);
+                    return false;
+                case 'f':
+                    parseLiteral("false");
+                    _handler.booleanValue(false);
+                    return false;
+                case 'n':
+                    parseLiteral("null");
+                    _handler.nullValue();
+                    return false;
+                default:
+                    if (*_current == '-' || isDigit(*_current)) {
+                        parseNumber();
+                        return false;
+                    }
+                    error(_current, "Unexpected character, expected a value");
+            }
+        }
+
+        void parseKey() {
+            skipWhitespace();
+            if (_current == _end || *_current != '"') {
+                error(_current, "Expected a string as the key");
+            }
+            _token = _current;
+            parseString(true);
+
+            skipWhitespace();
+            if (_current == _end || *_current != ':') {
+                error(_current, "Expected ':' after the key");
+            }
+            ++_current;
+        }
+
+        void skipWhitespace() {
+            while (_end - _current >= 8) {
+                uint64_t word;
+                std::memcpy(&word, _current, sizeof(uint64_t));
+                if (!isAllSpaces(word)) {
+                    break;
+                }
+                _current += 8;
+            }
+            while (_current != _end &&
+                (*_current == ' ' || *_current == '\n' || *_current == '\r' ||
+                 *_current == '\t'))
+            {
+                ++_current;
+            }
+        }
+
+        void parseLiteral(const char* literal) {
+            size_t length = std::strlen(literal);
+            if (static_cast<size_t>(_end - _current) < length ||
+                std::memcmp(_current, literal, length) != 0)
+            {
+                error(
+                    _current,
+                    "Invalid literal, expected '" + std::string(literal) + "'"
+                );
+            }
+            _current += length;
+        }
+
+        void report(const char* string, size_t length, bool isKey) {
+            if (isKey) {
+                _handler.key(string, length);
+            }
+            else {
+                _handler.stringValue(string, length);
+            }
+        }
+
+        // Skips the bytes of a string that do not need to be handled individually
+        void skipPlainString() {
+            while (_end - _current >= 8) {
+                uint64_t word;
+                std::memcpy(&word, _current, sizeof(uint64_t));
+                if (hasSpecialStringByte(word)) {
+                    break;
+                }
+                _current += 8;
+            }
+            while (_current != _end && *_current != '"' && *_current != '\\' &&
+                   static_cast<unsigned char>(*_current) >= 0x20)
+            {
+                ++_current;
+            }
+        }
+
+        void parseString(bool isKey) {
+            const char* quote = _current;
+            ++_current;
+            const char* begin = _current;
+
+            // Strings without escape sequences are passed on directly
+            skipPlainString();
+            if (_current != _end && *_current == '"') {
+                report(begin, static_cast<size_t>(_current - begin), isKey);
+                ++_current;
+                return;
+            }
+
+            _scratch.assign(begin, _current);
+            while (true) {
+                if (_current == _end) {
+                    error(quote, "Unterminated string");
+                }
+                const char c = *_current;
+                if (c == '"') {
+                    ++_current;
+                    report(_scratch.data(), _scratch.size(), isKey);
+                    return;
+                }
+                if (c == '\\') {
+                    parseEscapeSequence();
+                }
+                else if (static_cast<unsigned char>(c) < 0x20) {
+                    error(_current, "Unescaped control character in string");
+                }
+                else {
+                    const char* run = _current;
+                    skipPlainString();
+                    _scratch.append(run, _current);
+                }
+            }
+        }
+
+        void parseEscapeSequence() {
+            const char* escape = _current;
+            ++_current;
+            if (_current == _end) {
+                error(escape, "Unterminated escape sequence");
+            }
+            switch (*_current) {
+                case '"':
+                    _scratch.push_back('"');
+                    break;
+                case '\\':
+                    _scratch.push_back('\\');
+                    break;
+                case '/':
+                    _scratch.push_back('/');
+                    break;
+                case 'b':
+                    _scratch.push_back('\b');
+                    break;
+                case 'f':
+                    _scratch.push_back('\f');
+                    break;
+                case 'n':
+                    _scratch.push_back('\n');
+                    break;
+                case 'r':
+                    _scratch.push_back('\r');
+                    break;
+                case 't':
+                    _scratch.push_back('\t');
+                    break;
+                case 'u':
+                {
+                    ++_current;
+                    uint32_t codepoint = parseHex(escape);
+                    if (codepoint >= 0xDC00 && codepoint <= 0xDFFF) {
+                        error(escape, "Unpaired low surrogate in escape sequence");
+                    }
+                    if (codepoint >= 0xD800 && codepoint <= 0xDBFF) {
+                        const char* low = _current;
+                        if (_end - _current < 2 || _current[0] != '\\' ||
+                            _current[1] != 'u')
+                        {
+                            error(escape, "Unpaired high surrogate in escape sequence");
+                        }
+                        _current += 2;
+                        uint32_t second = parseHex(low);
+                        if (second < 0xDC00 || second > 0xDFFF) {
+                            error(escape, "Unpaired high surrogate in escape sequence");
+                        }
+                        codepoint = 0x10000 + ((codepoint - 0xD800) << 10) +
+                                    (second - 0xDC00);
+                    }
+                    encodeUtf8(codepoint, _scratch);
+                    return;
+                }
+                default:
+                    error(escape, "Invalid escape sequence");
+            }
+            ++_current;
+        }
+
+        uint32_t parseHex(const char* escape) {
+            if (_end - _current < 4) {
+                error(escape, "Incomplete unicode escape sequence");
+            }
+            uint32_t result = 0;
+            for (int i = 0; i < 4; ++i) {
+                const char c = *_current;
+                uint32_t digit;
+                if (c >= '0' && c <= '9') {
+                    digit = c - '0';
+                }
+                else if (c >= 'a' && c <= 'f') {
+                    digit = c - 'a' + 10;
+                }
+                else if (c >= 'A' && c <= 'F') {
+                    digit = c - 'A' + 10;
+                }
+                else {
+                    error(escape, "Invalid unicode escape sequence");
+                }
+                result = result * 16 + digit;
+                ++_current;
+            }
+            return result;
+        }
+
+        void parseNumber() {
+            const char* begin = _current;
+            const bool isNegative = *_current == '-';
+            if (isNegative) {
+                ++_current;
+            }
+
+            // The significant digits are accumulated as long as they fit into the
+            // mantissa, in which case the conversion is exact if the power of ten is
+            // small enough as well
+            uint64_t mantissa = 0;
+            int nDigits = 0;
+            int exponent = 0;
+            auto addDigit = [&](char c) {
+                if (nDigits < 19) {
+                    mantissa = mantissa * 10 + (c - '0');
+                    if (mantissa != 0) {
+                        ++nDigits;
+                    }
+                    return true;
+                }
+                ++nDigits;
+                return false;
+            };
+
+            if (_current == _end || !isDigit(*_current)) {
+                error(begin, "Invalid number, expected a digit");
+            }
+            if (*_current == '0') {
+                ++_current;
+                if (_current != _end && isDigit(*_current)) {
+                    error(begin, "Invalid number, leading zeros are not allowed");
+                }
+            }
+            else {
+                while (_current != _end && isDigit(*_current)) {
+                    if (!addDigit(*_current)) {
+                        ++exponent;
+                    }
+                    ++_current;
+                }
+            }
+
+            if (_current != _end && *_current == '.') {
+                ++_current;
+                if (_current == _end || !isDigit(*_current)) {
+                    error(begin, "Invalid number, expected a digit after '.'");
+                }
+                while (_current != _end && isDigit(*_current)) {
+                    if (addDigit(*_current)) {
+                        --exponent;
+                    }
+                    ++_current;
+                }
+            }
+
+            if (_current != _end && (*_current == 'e' || *_current == 'E')) {
+                ++_current;
+                bool isNegativeExponent = false;
+                if (_current != _end && (*_current == '+' || *_current == '-')) {
+                    isNegativeExponent = *_current == '-';
+                    ++_current;
+                }
+                if (_current == _end || !isDigit(*_current)) {
+                    error(begin, "Invalid number, expected a digit in the exponent");
+                }
+                int e = 0;
+                while (_current != _end && isDigit(*_current)) {
+                    if (e < 100000) {
+                        e = e * 10 + (*_current - '0');
+                    }
+                    ++_current;
+                }
+                exponent += isNegativeExponent ? -e : e;
+            }
+
+            static const double PowersOfTen[] = {
+                1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+                1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+            };
+            const uint64_t MaxExactMantissa = 1ULL << 53;
+
+            double value;
+            if (nDigits <= 19 && mantissa <= MaxExactMantissa &&
+                exponent >= -22 && exponent <= 22)
+            {
+                value = static_cast<double>(mantissa);
+                if (exponent < 0) {
+                    value /= PowersOfTen[-exponent];
+                }
+                else {
+                    value *= PowersOfTen[exponent];
+                }
+                if (isNegative) {
+                    value = -value;
+                }
+            }
+            else {
+                // Numbers that cannot be converted exactly are rare enough that they are
+                // handled by the standard library, which needs the classic locale to
+                // accept the '.' as the decimal separator
+                std::istringstream stream(std::string(begin, _current));
+                stream.imbue(std::locale::classic());
+                stream >> value;
+            }
+            _handler.numberValue(value);
+        }
+
+        const char* const _begin;
+        const char* _current;
+        const char* const _end;
+
+        // The beginning of the element that was last passed to the Handler
+        const char* _token;
+
+        Handler& _handler;
+        std::vector<Container> _stack;
+        std::string _scratch;
+    };
+
+    // Creates a Dictionary from the elements of the document. Each open object or array
+    // is a Level, which is added to its parent when it is closed
+    class DictionaryBuilder : public Handler {
+    public:
+        void startObject() override {
+            open(false);
+        }
+
+        void endObject() override {
+            close();
+        }
+
+        void startArray() override {
+            open(true);
+        }
+
+        void endArray() override {
+            close();
+        }
+
+        void key(const char* key, size_t length) override {
+            if (length == 0) {
+                throw ghoul::RuntimeError(
+                    "Empty keys cannot be represented in a Dictionary"
+                );
+            }
+            if (std::memchr(key, '.', length)) {
+                throw ghoul::RuntimeError(
+                    "Key '" + std::string(key, length) + "' contains a '.', which " +
+                    "cannot be represented in a Dictionary"
+                );
+            }
+            _levels.back().key.assign(key, length);
+        }
+
+        void stringValue(const char* value, size_t length) override {
+            setValue(std::string(value, length));
+        }
+
+        void numberValue(double value) override {
+            setValue(value);
+        }
+
+        void booleanValue(bool value) override {
+            setValue(value);
+        }
+
+        void nullValue() override {
+            // null values are skipped, but use up an index in an array
+            nextKey();
+        }
+
+        ghoul::Dictionary& result() {
+            return _result;
+        }
+
+    private:
+        struct Level {
+            ghoul::Dictionary dictionary;
+            bool isArray;
+            size_t index;
+            std::string key;
+            std::string keyInParent;
+        };
+
+        std::string nextKey() {
+            if (_levels.empty()) {
+                throw ghoul::RuntimeError(
+                    "The top-level value must be an object or an array"
+                );
+            }
+            Level& level = _levels.back();
+            if (level.isArray) {
+                ++level.index;
+                return std::to_string(level.index);
+            }
+            return std::move(level.key);
+        }
+
+        template <typename T>
+        void setValue(T value) {
+            std::string key = nextKey();
+            _levels.back().dictionary.setValue(std::move(key), std::move(value));
+        }
+
+        void open(bool isArray) {
+            std::string keyInParent;
+            if (!_levels.empty()) {
+                keyInParent = nextKey();
+            }
+            _levels.push_back({ ghoul::Dictionary(), isArray, 0, "", keyInParent });
+        }
+
+        void close() {
+            Level level = std::move(_levels.back());
+            _levels.pop_back();
+            if (_levels.empty()) {
+                _result = std::move(level.dictionary);
+            }
+            else {
+                _levels.back().dictionary.setValue(
+                    std::move(level.keyInParent),
+                    std::move(level.dictionary)
+                );
+            }
+        }
+
+        std::vector<Level> _levels;
+        ghoul::Dictionary _result;
+    };
+} // namespace
+
+namespace ghoul {
+
+DictionaryJsonParser::JsonParsingError::JsonParsingError(const std::string& message,
+                                                         size_t line, size_t column)
+    : RuntimeError(
+        message + " (line " + std::to_string(line) + ", column " +
+        std::to_string(column) + ")",
+        "Dictionary"
+    )
+    , line(line)
+    , column(column)
+{}
+
+void DictionaryJsonParser::parse(const char* json, size_t length,
+                                 Handler& handler) const
+{
+    ghoul_assert(json || length == 0, "JSON document must not be nullptr");
+
+    Parser parser(json, length, handler);
+    parser.parse();
+}
+
+Dictionary DictionaryJsonParser::parse(const std::string& json) const {
+    DictionaryBuilder builder;
+    parse(json.data(), json.size(), builder);
+    return std::move(builder.result());
+}
+
+}  // namespace ghoul
@@ -0,0 +1,130 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include <ghoul/misc/mainthreadexecutor.h>
+
+#include <ghoul/misc/assert.h>
+#include <ghoul/misc/onscopeexit.h>
+
+#include <memory>
+
+namespace ghoul {
+
+MainThreadExecutor::MainThreadExecutor()
+    : _incoming(nullptr)
+    , _pendingFront(nullptr)
+    , _pendingBack(nullptr)
+    , _isPumping(false)
+{}
+
+MainThreadExecutor::~MainThreadExecutor() {
+    collectIncomingTasks();
+    while (_pendingFront) {
+        Node* next = _pendingFront->next;
+        delete _pendingFront;
+        _pendingFront = next;
+    }
+}
+
+int MainThreadExecutor::pump(std::chrono::microseconds timeBudget) {
+    using Clock = std::chrono::steady_clock;
+    ghoul_assert(!_isPumping, "pump must not be called from within an executed task");
+
+    _isPumping = true;
+    OnExit([this]() { _isPumping = false; });
+
+    const Clock::time_point start = Clock::now();
+    collectIncomingTasks();
+
+    int nExecuted = 0;
+    while (_pendingFront) {
+        // The node is removed before the task is executed, so that a throwing task does
+        // not remain in the list
+        std::unique_ptr<Node> node(_pendingFront);
+        _pendingFront = node->next;
+        if (!_pendingFront) {
+            _pendingBack = nullptr;
+        }
+
+        node->task();
+        ++nExecuted;
+
+        // The elapsed time is converted instead of the budget, as the default budget
+        // would overflow when converted to the resolution of the clock
+        const std::chrono::microseconds elapsed =
+            std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start);
+        if (elapsed >= timeBudget) {
+            break;
+        }
+    }
+    return nExecuted;
+}
+
+bool MainThreadExecutor::hasPendingTasks() const {
+    return _pendingFront || _incoming.load(std::memory_order_relaxed);
+}
+
+void MainThreadExecutor::pushTask(Task&& task) {
+    Node* node = new Node{ std::move(task), _incoming.load(std::memory_order_relaxed) };
+    while (!_incoming.compare_exchange_weak(
+        node->next,
+        node,
+        std::memory_order_release,
+        std::memory_order_relaxed
+    ))
+    {
+        // A failed exchange has stored the current head in 'node->next', so we only need
+        // to try again
+    }
+}
+
+void MainThreadExecutor::collectIncomingTasks() {
+    // Taking the whole list at once avoids the ABA problem of popping single nodes
+    Node* incoming = _incoming.exchange(nullptr, std::memory_order_acquire);
+    if (!incoming) {
+        return;
+    }
+
+    // The incoming tasks are linked from the newest to the oldest, so reversing the list
+    // restores the order in which they have been queued
+    Node* front = nullptr;
+    Node* back = incoming;
+    while (incoming) {
+        Node* next = incoming->next;
+        incoming->next = front;
+        front = incoming;
+        incoming = next;
+    }
+
+    if (_pendingBack) {
+        _pendingBack->next = front;
+    }
+    else {
+        _pendingFront = front;
+    }
+    _pendingBack = back;
+}
+
+} // namespace ghoul
@@ -0,0 +1,248 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include <ghoul/misc/pipeline.h>
+
+#include <ghoul/misc/assert.h>
+
+namespace ghoul {
+
+Pipeline::FlowControl::FlowControl()
+    : _isStopped(false)
+{}
+
+void Pipeline::FlowControl::stop() {
+    _isStopped = true;
+}
+
+bool Pipeline::FlowControl::isStopped() const {
+    return _isStopped;
+}
+
+std::future<void> Pipeline::run(ThreadPool& pool, int nTokens, Source source,
+                                std::vector<Stage> stages)
+{
+    ghoul_assert(nTokens > 0, "nTokens must be bigger than 0");
+
+    // The Pipeline is kept alive by the tasks that are processing its items. If the
+    // ThreadPool discards them, the destructor of the promise reports a broken promise
+    std::shared_ptr<Pipeline> pipeline(
+        new Pipeline(pool, nTokens, std::move(source), std::move(stages))
+    );
+    std::future<void> future = pipeline->_promise.get_future();
+    pool.post([pipeline]() { pipeline->produce(); });
+    return future;
+}
+
+Pipeline::Pipeline(ThreadPool& pool, int nTokens, Source source,
+                   std::vector<Stage> stages)
+    : _pool(pool)
+    , _nTokens(nTokens)
+    , _source(std::move(source))
+    , _stages(std::move(stages))
+    , _serialStates(_stages.size())
+    , _nInFlight(0)
+    , _nextSequence(0)
+    , _isProducing(false)
+    , _isSourceFinished(false)
+    , _hasFailed(false)
+{}
+
+void Pipeline::produce() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_isProducing || _isSourceFinished || _nInFlight >= _nTokens) {
+            // Either somebody else is producing and will queue the next production, or
+            // the next production is triggered once a token becomes available again
+            return;
+        }
+        _isProducing = true;
+        ++_nInFlight;
+    }
+
+    Value value;
+    bool isStopped = _hasFailed;
+    if (!isStopped) {
+        FlowControl fc;
+        try {
+            value = _source(fc);
+            isStopped = fc.isStopped();
+        }
+        catch (...) {
+            fail(std::current_exception());
+            isStopped = true;
+        }
+    }
+
+    Item item = { 0, std::move(value), true };
+    bool isFinished = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _isProducing = false;
+        if (isStopped) {
+            // The token that was reserved for this item is not needed anymore
+            _isSourceFinished = true;
+            --_nInFlight;
+            isFinished = (_nInFlight == 0);
+        }
+        else {
+            // The sequence number is only assigned to items that actually exist, so
+            // that the serial stages do not wait for an item that never comes
+            item.sequence = _nextSequence++;
+        }
+    }
+
+    if (isStopped) {
+        if (isFinished) {
+            complete();
+        }
+        return;
+    }
+
+    // Keep filling the pipeline while we are processing this item. Only the first task,
+    // which is queued by 'run', is subject to the capacity of the ThreadPool, as all
+    // further tasks are queued by the Workers and must not be rejected
+    std::shared_ptr<Pipeline> self = shared_from_this();
+    internal::ThreadPoolAccess::postBypassingCapacity(
+        _pool,
+        ThreadPool::Priority::Normal,
+        [self]() { self->produce(); }
+    );
+
+    process(std::move(item), 0);
+}
+
+void Pipeline::process(Item item, size_t first) {
+    for (size_t i = first; i < _stages.size(); ++i) {
+        const Stage& stage = _stages[i];
+        if (stage.mode == Mode::Parallel) {
+            apply(item, stage);
+            continue;
+        }
+
+        SerialState& state = _serialStates[i];
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (item.sequence != state.next) {
+                // Our predecessor has not passed this stage yet, so it will pick us up
+                // once it is finished
+                const uint64_t sequence = item.sequence;
+                state.waiting.emplace(sequence, std::move(item));
+                return;
+            }
+        }
+
+        apply(item, stage);
+
+        // Let the successor, if it is already waiting, enter this stage. It has to be
+        // queued as we continue with our own item
+        Item successor;
+        bool hasSuccessor = false;
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            ++state.next;
+            auto it = state.waiting.find(state.next);
+            if (it != state.waiting.end()) {
+                successor = std::move(it->second);
+                state.waiting.erase(it);
+                hasSuccessor = true;
+            }
+        }
+        if (hasSuccessor) {
+            std::shared_ptr<Pipeline> self = shared_from_this();
+            internal::ThreadPoolAccess::postBypassingCapacity(
+                _pool,
+                ThreadPool::Priority::Normal,
+                [self, s = std::move(successor), i]() mutable {
+                    self->process(std::move(s), i);
+                }
+            );
+        }
+    }
+
+    finishItem();
+}
+
+void Pipeline::apply(Item& item, const Stage& stage) {
+    if (!item.isValid || _hasFailed) {
+        // The item still has to pass through all serial stages to keep them in order
+        item.isValid = false;
+        item.value = nullptr;
+        return;
+    }
+
+    try {
+        item.value = stage.function(std::move(item.value));
+    }
+    catch (...) {
+        item.isValid = false;
+        item.value = nullptr;
+        fail(std::current_exception());
+    }
+}
+
+void Pipeline::finishItem() {
+    bool isFinished = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        --_nInFlight;
+        isFinished = _isSourceFinished && _nInFlight == 0;
+    }
+
+    if (isFinished) {
+        complete();
+    }
+    else {
+        // A token has become available, so we can produce the next item. It is queued
+        // rather than called directly, as the recursion would otherwise grow with every
+        // item that is processed on this thread
+        std::shared_ptr<Pipeline> self = shared_from_this();
+        internal::ThreadPoolAccess::postBypassingCapacity(
+            _pool,
+            ThreadPool::Priority::Normal,
+            [self]() { self->produce(); }
+        );
+    }
+}
+
+void Pipeline::fail(std::exception_ptr e) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_exception) {
+        _exception = std::move(e);
+    }
+    _hasFailed = true;
+}
+
+void Pipeline::complete() {
+    // No item is in flight anymore, so nobody else can access the exception
+    if (_exception) {
+        _promise.set_exception(_exception);
+    }
+    else {
+        _promise.set_value();
+    }
+}
+
+} // namespace ghoul
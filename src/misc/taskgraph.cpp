@@ -0,0 +1,216 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include <ghoul/misc/taskgraph.h>
+
+#include <ghoul/misc/assert.h>
+
+#include <atomic>
+#include <mutex>
+
+namespace ghoul {
+
+struct TaskGraph::Execution {
+    Execution(ThreadPool& p, std::vector<Node> n);
+    ~Execution();
+
+    /// The ThreadPool that executes the tasks
+    ThreadPool& pool;
+    /// A copy of the nodes of the TaskGraph at the time the run was started
+    const std::vector<Node> nodes;
+    /// For each node, the number of predecessors that have not finished yet
+    std::vector<std::atomic_int> nRemainingPredecessors;
+    /// The number of nodes that have not finished yet
+    std::atomic_int nRemainingNodes;
+    /// Is set to <code>true</code> after the first task has thrown an exception
+    std::atomic_bool hasFailed;
+    /// The first exception that was thrown by a task
+    std::exception_ptr exception;
+    /// The mutex protecting the <code>exception</code>
+    std::mutex exceptionMutex;
+    /// The state that receives the result of the run
+    std::shared_ptr<internal::ContinuationState<void>> result;
+};
+
+TaskGraph::Execution::Execution(ThreadPool& p, std::vector<Node> n)
+    : pool(p)
+    , nodes(std::move(n))
+    , nRemainingPredecessors(nodes.size())
+    , nRemainingNodes(static_cast<int>(nodes.size()))
+    , hasFailed(false)
+    , result(std::make_shared<internal::ContinuationState<void>>(p))
+{
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        nRemainingPredecessors[i] = nodes[i].nPredecessors;
+    }
+}
+
+TaskGraph::Execution::~Execution() {
+    // If the ThreadPool discarded some of our tasks without running them, the run can
+    // never finish, so we have to notify everyone that is waiting for it
+    if (!result->isFinished()) {
+        result->setException(
+            std::make_exception_ptr(std::future_error(std::future_errc::broken_promise))
+        );
+    }
+}
+
+TaskGraph::TaskGraphError::TaskGraphError(std::string message)
+    : RuntimeError(std::move(message), "TaskGraph")
+{}
+
+TaskGraph::TaskGraph(ThreadPool& pool)
+    : _pool(pool)
+{}
+
+TaskGraph::NodeId TaskGraph::addTask(std::function<void()> task,
+                                     ThreadPool::Priority priority)
+{
+    ghoul_assert(task, "Task must not be empty");
+
+    _nodes.push_back({ std::move(task), priority, {}, 0 });
+    return static_cast<NodeId>(_nodes.size() - 1);
+}
+
+void TaskGraph::addDependency(NodeId predecessor, NodeId successor) {
+    if (predecessor < 0 || predecessor >= size()) {
+        throw TaskGraphError("Invalid predecessor " + std::to_string(predecessor));
+    }
+    if (successor < 0 || successor >= size()) {
+        throw TaskGraphError("Invalid successor " + std::to_string(successor));
+    }
+    if (predecessor == successor) {
+        throw TaskGraphError(
+            "Task " + std::to_string(predecessor) + " cannot depend on itself"
+        );
+    }
+
+    _nodes[predecessor].successors.push_back(successor);
+    ++_nodes[successor].nPredecessors;
+}
+
+int TaskGraph::size() const {
+    return static_cast<int>(_nodes.size());
+}
+
+Continuable<void> TaskGraph::run() const {
+    if (hasCycle()) {
+        throw TaskGraphError("The dependencies of the TaskGraph contain a cycle");
+    }
+
+    auto execution = std::make_shared<Execution>(_pool, _nodes);
+    Continuable<void> result = internal::ContinuableAccess::create(execution->result);
+
+    if (_nodes.empty()) {
+        execution->result->run([]() {});
+        return result;
+    }
+
+    for (NodeId i = 0; i < size(); ++i) {
+        if (_nodes[i].nPredecessors == 0) {
+            queueNode(execution, i);
+        }
+    }
+    return result;
+}
+
+bool TaskGraph::hasCycle() const {
+    // Kahn's algorithm: we repeatedly remove the nodes without any remaining
+    // predecessors. If we cannot remove all nodes that way, there has to be a cycle
+    std::vector<int> nPredecessors(_nodes.size());
+    std::vector<NodeId> ready;
+    for (size_t i = 0; i < _nodes.size(); ++i) {
+        nPredecessors[i] = _nodes[i].nPredecessors;
+        if (nPredecessors[i] == 0) {
+            ready.push_back(static_cast<NodeId>(i));
+        }
+    }
+
+    size_t nVisited = 0;
+    while (!ready.empty()) {
+        NodeId id = ready.back();
+        ready.pop_back();
+        ++nVisited;
+        for (NodeId s : _nodes[id].successors) {
+            if (--nPredecessors[s] == 0) {
+                ready.push_back(s);
+            }
+        }
+    }
+    return nVisited != _nodes.size();
+}
+
+void TaskGraph::queueNode(const std::shared_ptr<Execution>& execution, NodeId id) {
+    // Nodes are mostly queued by the Workers once their predecessors are finished, so
+    // they cannot be subject to the capacity of the ThreadPool, and the nodes that are
+    // queued by 'run' must not be rejected halfway through the graph either
+    internal::ThreadPoolAccess::postBypassingCapacity(
+        execution->pool,
+        execution->nodes[id].priority,
+        [execution, id]() { executeNode(execution, id); }
+    );
+}
+
+void TaskGraph::executeNode(const std::shared_ptr<Execution>& execution, NodeId id) {
+    const Node& node = execution->nodes[id];
+
+    // After a failure, the remaining nodes are still passed through to keep the
+    // bookkeeping simple, but their tasks are not executed anymore
+    if (!execution->hasFailed) {
+        try {
+            node.task();
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(execution->exceptionMutex);
+            if (!execution->exception) {
+                execution->exception = std::current_exception();
+            }
+            execution->hasFailed = true;
+        }
+    }
+
+    for (NodeId s : node.successors) {
+        if (--execution->nRemainingPredecessors[s] == 0) {
+            queueNode(execution, s);
+        }
+    }
+
+    if (--execution->nRemainingNodes == 0) {
+        // We were the last node, so the run is finished
+        if (execution->hasFailed) {
+            std::exception_ptr e;
+            {
+                std::lock_guard<std::mutex> lock(execution->exceptionMutex);
+                e = execution->exception;
+            }
+            execution->result->setException(e);
+        }
+        else {
+            execution->result->run([]() {});
+        }
+    }
+}
+
+} // namespace ghoul
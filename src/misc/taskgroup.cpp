@@ -0,0 +1,118 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include <ghoul/misc/taskgroup.h>
+
+#include <future>
+
+namespace ghoul {
+
+constexpr std::chrono::microseconds TaskGroup::HelpInterval;
+
+TaskGroup::State::State()
+    : nPending(0)
+{}
+
+void TaskGroup::State::finish(std::exception_ptr e) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (e && !exception) {
+        exception = std::move(e);
+    }
+    // Decreasing the counter while holding the lock guarantees that a waiting thread
+    // either sees the new value or is already waiting for the notification
+    if (--nPending == 0) {
+        allFinished.notify_all();
+    }
+}
+
+TaskGroup::Completion::Completion(std::shared_ptr<State> state)
+    : _state(std::move(state))
+{}
+
+TaskGroup::Completion::Completion(Completion&& other) noexcept
+    : _state(std::move(other._state))
+{}
+
+TaskGroup::Completion::~Completion() {
+    if (_state) {
+        _state->finish(std::make_exception_ptr(
+            std::future_error(std::future_errc::broken_promise)
+        ));
+    }
+}
+
+void TaskGroup::Completion::finish(std::exception_ptr e) {
+    _state->finish(std::move(e));
+    _state = nullptr;
+}
+
+TaskGroup::TaskGroup(ThreadPool& pool, ThreadPool::Priority priority)
+    : _pool(pool)
+    , _priority(priority)
+    , _state(std::make_shared<State>())
+{}
+
+TaskGroup::~TaskGroup() {
+    try {
+        wait();
+    }
+    catch (...) {
+        // The exceptions of the tasks are only reported by an explicit call to 'wait'
+    }
+}
+
+void TaskGroup::wait() {
+    while (_state->nPending > 0) {
+        // Executing any waiting task brings us closer to the end, as the tasks of this
+        // group might be waiting behind other tasks or be nested inside them
+        if (_pool.runPendingTask()) {
+            continue;
+        }
+
+        // All remaining tasks of this group are running on other threads, but they
+        // might still queue new tasks that we can help with
+        std::unique_lock<std::mutex> lock(_state->mutex);
+        _state->allFinished.wait_for(
+            lock,
+            HelpInterval,
+            [this]() { return _state->nPending == 0; }
+        );
+    }
+
+    std::exception_ptr e;
+    {
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        std::swap(e, _state->exception);
+    }
+    if (e) {
+        std::rethrow_exception(e);
+    }
+}
+
+bool TaskGroup::isFinished() const {
+    return _state->nPending == 0;
+}
+
+} // namespace ghoul
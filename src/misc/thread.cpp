@@ -25,14 +25,94 @@
 
 #include <ghoul/misc/thread.h>
 
+#include <ghoul/misc/assert.h>
 #include <ghoul/misc/exception.h>
 
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+
 #ifdef WIN32
 #include <Windows.h>
 #else
 #include <pthread.h>
 #endif
 
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace {
+
+#ifdef __linux__
+// Reads the first line of the file at 'path' into 'line' and returns whether the file
+// could be read
+bool readLine(const std::string& path, std::string& line) {
+    std::ifstream file(path);
+    if (!file.good()) {
+        return false;
+    }
+    std::getline(file, line);
+    return !file.fail();
+}
+
+// Reads a single integer from the file at 'path' or returns the 'defaultValue' if the
+// file could not be read
+int readInt(const std::string& path, int defaultValue) {
+    std::string line;
+    if (!readLine(path, line)) {
+        return defaultValue;
+    }
+    std::istringstream stream(line);
+    int value;
+    if (stream >> value) {
+        return value;
+    }
+    else {
+        return defaultValue;
+    }
+}
+#endif // __linux__
+
+void setAffinity(std::thread::native_handle_type handle, const std::vector<int>& cpus) {
+#ifdef WIN32
+    DWORD_PTR mask = 0;
+    for (int c : cpus) {
+        if (c >= 0 && c < static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+            mask |= DWORD_PTR(1) << c;
+        }
+    }
+    if (SetThreadAffinityMask(handle, mask) == 0) {
+        throw ghoul::RuntimeError(
+            "Error setting thread affinity with error " + std::to_string(GetLastError()),
+            "Thread"
+        );
+    }
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : cpus) {
+        if (c >= 0 && c < CPU_SETSIZE) {
+            CPU_SET(c, &set);
+        }
+    }
+    int res = pthread_setaffinity_np(handle, sizeof(cpu_set_t), &set);
+    if (res != 0) {
+        throw ghoul::RuntimeError(
+            "Error setting thread affinity with error " + std::to_string(res),
+            "Thread"
+        );
+    }
+#else
+    (void)handle;
+    (void)cpus;
+#endif
+}
+
+} // namespace
+
 namespace ghoul {
 namespace thread {
 
@@ -141,6 +221,216 @@ void setPriority(std::thread& t, ThreadPriorityClass priorityClass, ThreadPriori
 #endif
 }
 
+void setAffinity(std::thread& t, const std::vector<int>& cpus) {
+    ghoul_assert(!cpus.empty(), "cpus must not be empty");
+
+    ::setAffinity(t.native_handle(), cpus);
+}
+
+void setCurrentThreadAffinity(const std::vector<int>& cpus) {
+    ghoul_assert(!cpus.empty(), "cpus must not be empty");
+
+#ifdef WIN32
+    ::setAffinity(GetCurrentThread(), cpus);
+#else
+    ::setAffinity(pthread_self(), cpus);
+#endif
+}
+
+std::vector<int> parseCpuList(const std::string& list) {
+    std::set<int> result;
+
+    std::istringstream stream(list);
+    std::string token;
+    while (std::getline(stream, token, ',')) {
+        std::istringstream range(token);
+        int first;
+        if (!(range >> first) || first < 0) {
+            continue;
+        }
+        int last = first;
+        char separator;
+        if (range >> separator) {
+            if (separator != '-' || !(range >> last) || last < first) {
+                continue;
+            }
+        }
+        for (int i = first; i <= last; ++i) {
+            result.insert(i);
+        }
+    }
+
+    return std::vector<int>(result.begin(), result.end());
+}
+
+std::vector<int> allowedCpus() {
+    std::vector<int> result;
+#ifdef WIN32
+    DWORD_PTR processMask;
+    DWORD_PTR systemMask;
+    if (GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask)) {
+        for (int c = 0; c < static_cast<int>(sizeof(DWORD_PTR) * 8); ++c) {
+            if (processMask & (DWORD_PTR(1) << c)) {
+                result.push_back(c);
+            }
+        }
+    }
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &set) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+            if (CPU_ISSET(c, &set)) {
+                result.push_back(c);
+            }
+        }
+    }
+#endif
+    return result;
+}
+
+std::vector<LogicalCpu> cpuTopology(const std::string& sysfsRoot) {
+    return cpuTopology(sysfsRoot, allowedCpus());
+}
+
+std::vector<LogicalCpu> cpuTopology(const std::string& sysfsRoot,
+                                    const std::vector<int>& allowed)
+{
+    ghoul_assert(
+        std::is_sorted(allowed.begin(), allowed.end()),
+        "allowed must be sorted"
+    );
+
+    std::vector<LogicalCpu> result;
+
+#ifdef __linux__
+    std::string online;
+    if (readLine(sysfsRoot + "/cpu/online", online)) {
+        for (int id : parseCpuList(online)) {
+            // Pinning a thread to a CPU outside of its affinity mask fails, so these
+            // CPUs cannot be used even though they are online
+            if (!allowed.empty() &&
+                !std::binary_search(allowed.begin(), allowed.end(), id))
+            {
+                continue;
+            }
+            const std::string base =
+                sysfsRoot + "/cpu/cpu" + std::to_string(id) + "/topology/";
+            result.push_back({
+                id,
+                readInt(base + "core_id", id),
+                readInt(base + "physical_package_id", 0),
+                0
+            });
+        }
+
+        // Without NUMA support in the kernel, there is no node information and all CPUs
+        // stay on node 0
+        std::string nodes;
+        if (readLine(sysfsRoot + "/node/online", nodes)) {
+            for (int node : parseCpuList(nodes)) {
+                std::string cpus;
+                const std::string path =
+                    sysfsRoot + "/node/node" + std::to_string(node) + "/cpulist";
+                if (!readLine(path, cpus)) {
+                    continue;
+                }
+                for (int id : parseCpuList(cpus)) {
+                    // 'result' is sorted by the id as it was created from a sorted list
+                    auto it = std::lower_bound(
+                        result.begin(),
+                        result.end(),
+                        id,
+                        [](const LogicalCpu& cpu, int i) { return cpu.id < i; }
+                    );
+                    if (it != result.end() && it->id == id) {
+                        it->numaNode = node;
+                    }
+                }
+            }
+        }
+    }
+#else
+    (void)sysfsRoot;
+#endif
+
+    if (result.empty() && !allowed.empty()) {
+        for (int id : allowed) {
+            result.push_back({ id, id, 0, 0 });
+        }
+    }
+    if (result.empty()) {
+        const int n = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        for (int i = 0; i < n; ++i) {
+            result.push_back({ i, i, 0, 0 });
+        }
+    }
+    return result;
+}
+
+std::vector<int> cpuOrder(const std::vector<LogicalCpu>& topology, Placement placement) {
+    if (placement == Placement::None || topology.empty()) {
+        return {};
+    }
+
+    // For each logical CPU, determine how many of its siblings on the same physical core
+    // come before it. Sorting by this rank first uses all physical cores before any of
+    // the hyperthreads
+    struct Entry {
+        LogicalCpu cpu;
+        int siblingRank;
+    };
+    std::map<int, std::vector<Entry>> nodes;
+    std::map<std::pair<int, int>, int> nSiblings;
+    std::vector<LogicalCpu> sorted = topology;
+    std::sort(
+        sorted.begin(),
+        sorted.end(),
+        [](const LogicalCpu& lhs, const LogicalCpu& rhs) { return lhs.id < rhs.id; }
+    );
+    for (const LogicalCpu& cpu : sorted) {
+        const int rank = nSiblings[{ cpu.package, cpu.core }]++;
+        nodes[cpu.numaNode].push_back({ cpu, rank });
+    }
+
+    for (std::pair<const int, std::vector<Entry>>& node : nodes) {
+        std::stable_sort(
+            node.second.begin(),
+            node.second.end(),
+            [](const Entry& lhs, const Entry& rhs) {
+                if (lhs.siblingRank != rhs.siblingRank) {
+                    return lhs.siblingRank < rhs.siblingRank;
+                }
+                if (lhs.cpu.package != rhs.cpu.package) {
+                    return lhs.cpu.package < rhs.cpu.package;
+                }
+                return lhs.cpu.core < rhs.cpu.core;
+            }
+        );
+    }
+
+    std::vector<int> result;
+    result.reserve(topology.size());
+    if (placement == Placement::Compact) {
+        for (const std::pair<const int, std::vector<Entry>>& node : nodes) {
+            for (const Entry& e : node.second) {
+                result.push_back(e.cpu.id);
+            }
+        }
+    }
+    else {
+        // Placement::Spread takes one CPU of each node in turn
+        for (size_t i = 0; result.size() < topology.size(); ++i) {
+            for (const std::pair<const int, std::vector<Entry>>& node : nodes) {
+                if (i < node.second.size()) {
+                    result.push_back(node.second[i].cpu.id);
+                }
+            }
+        }
+    }
+    return result;
+}
+
 void setThreadBackground(std::thread& t, Background background) {
 #ifdef WIN32
     int m;
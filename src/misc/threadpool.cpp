@@ -27,28 +27,90 @@
 
 #include <ghoul/logging/logmanager.h>
 #include <ghoul/misc/assert.h>
+#include <ghoul/misc/dictionary.h>
+#include <ghoul/misc/dictionaryjsonformatter.h>
 
 #include <ghoul/misc/onscopeexit.h>
+
+#include <algorithm>
 #include <chrono>
+#include <iterator>
 
 namespace {
-    // The wait-out time for the condition_variable inside the worker threads
-    const std::chrono::seconds WaitTime(1);
+    // The number of times a non-empty lane of a TaskQueue can be passed over in favor of
+    // a lane with a higher priority before it is served regardless
+    const int StarvationLimit = 16;
+
+    // The interval in which a producer that is blocked by a full ThreadPool checks
+    // whether waiting tasks have been cancelled, as cancelling a token does not wake it
+    constexpr std::chrono::milliseconds CancellationCheckInterval(10);
+
+    using Clock = std::chrono::steady_clock;
+
+    // Returns the bucket of a ThreadPool::Histogram into which the duration falls
+    int histogramBucket(std::chrono::nanoseconds duration) {
+        using namespace std::chrono;
+        long long us = duration_cast<microseconds>(duration).count();
+        int bucket = 0;
+        while (us > 0 && bucket < ghoul::ThreadPool::NHistogramBuckets - 1) {
+            us >>= 1;
+            ++bucket;
+        }
+        return bucket;
+    }
+
+    ghoul::Dictionary histogramToDictionary(const ghoul::ThreadPool::Histogram& h) {
+        ghoul::Dictionary result;
+        for (size_t i = 0; i < h.size(); ++i) {
+            result.setValue(std::to_string(i + 1), static_cast<long long>(h[i]));
+        }
+        return result;
+    }
 }
 
 namespace ghoul {
 
 using Func = std::function<void()>;
 using namespace thread;
+
+thread_local ThreadPool::TaskQueue* ThreadPool::_currentLocalQueue = nullptr;
+thread_local const ThreadPool::LocalQueues* ThreadPool::_currentLocalQueues = nullptr;
+thread_local ThreadPool::WorkerCounters* ThreadPool::_currentCounters = nullptr;
+thread_local ThreadPool::WorkerLocalStorage* ThreadPool::_currentStorage = nullptr;
+
+ThreadPool::QueueFullError::QueueFullError(int c)
+    : RuntimeError(
+        "Task rejected as the queue reached its capacity of " + std::to_string(c),
+        "ThreadPool"
+    )
+    , capacity(c)
+{}
     
 ThreadPool::ThreadPool(int nThreads, Func workerInit, Func workerDeinit,
-                       ThreadPriorityClass tpc, ThreadPriorityLevel tpl, Background bg)
+                       ThreadPriorityClass tpc, ThreadPriorityLevel tpl, Background bg,
+                       WorkStealing workStealing, std::chrono::microseconds spinDuration,
+                       Placement placement)
     : _workers(nThreads)
+    , _nWorkers(nThreads)
     , _taskQueue(std::make_shared<TaskQueue>())
+    , _localQueues(std::make_shared<LocalQueues>())
+    , _backpressure(std::make_shared<Backpressure>())
+    , _workStealing(workStealing)
     , _isRunning(std::make_shared<std::atomic_bool>(true))
-    , _nWaiting(std::make_shared<std::atomic_int>(0))
-    , _mutex(std::make_shared<std::mutex>())
-    , _cv(std::make_shared<std::condition_variable>())
+    , _signal(std::make_shared<WakeupSignal>())
+    , _isInstrumented(std::make_shared<std::atomic_bool>(false))
+    , _isAutoScaling(false)
+    , _shouldStopSupervisor(false)
+    , _shouldStopTimers(false)
+    , _spinDuration(spinDuration)
+    , _placement(placement)
+    // Reading the topology touches several files per CPU, so we skip it if the Workers
+    // are not pinned anyway
+    , _cpuOrder(
+        placement == Placement::None ?
+            std::vector<int>() :
+            cpuOrder(cpuTopology(), placement)
+    )
     , _workerInitialization(std::move(workerInit))
     , _workerDeinitialization(std::move(workerDeinit))
     , _threadPriorityClass(tpc)
@@ -58,16 +120,28 @@ ThreadPool::ThreadPool(int nThreads, Func workerInit, Func workerDeinit,
     ghoul_assert(nThreads > 0, "nThreads must be bigger than 0");
     ghoul_assert(_workerInitialization, "workerInit must not be empty");
     ghoul_assert(_workerDeinitialization, "workerDeinit must not be empty");
+    ghoul_assert(spinDuration.count() >= 0, "spinDuration must not be negative");
 
     // Activate the workers
-    for (Worker& w : _workers) {
-        activateWorker(w);
-    }
+    std::lock_guard<std::mutex> lock(_workersMutex);
+    activateWorkers(0, nThreads);
 
     ghoul_assert(isRunning(), "ThreadPool is not running");
 }
     
 ThreadPool::~ThreadPool() {
+    // The timer and supervising threads access this object, so they have to be finished
+    // first. Timers that have not expired yet are discarded with the TimerWheel
+    {
+        std::lock_guard<std::mutex> lock(_timerMutex);
+        _shouldStopTimers = true;
+    }
+    _timerCv.notify_one();
+    if (_timerThread.joinable()) {
+        _timerThread.join();
+    }
+    disableAutoScaling();
+
     if (isRunning()) {
         // The stop method cannot guarantee to be noexcept, so we have to catch potential
         // exceptions that might occur there. Though any exceptions will likely be coming
@@ -87,11 +161,10 @@ ThreadPool::~ThreadPool() {
 void ThreadPool::start() {
     ghoul_assert(!isRunning(), "ThreadPool must not be running");
     
+    std::lock_guard<std::mutex> lock(_workersMutex);
     *_isRunning = true;
 
-    for (Worker& w : _workers) {
-        activateWorker(w);
-    }
+    activateWorkers(0, static_cast<int>(_workers.size()));
 
     ghoul_assert(isRunning(), "ThreadPool is not running");
 }
@@ -108,30 +181,36 @@ void ThreadPool::stop(RunRemainingTasks runTasks, DetachThreads detachThreads) {
         clearRemainingTasks();
     }
 
-    // We first have to set '_isRunning' to false before waking up all threads as they
-    // otherwise might go to sleep immediately again
-    *_isRunning = false;
+    // The threads are taken out of the Workers so that we do not have to hold the lock
+    // while waiting for them. We don't want to actually delete the Workers as we would
+    // otherwise lose information about their sizes and their counters
+    std::vector<std::unique_ptr<std::thread>> threads;
+    {
+        std::lock_guard<std::mutex> lock(_workersMutex);
 
-    // Wake up all of the threads, all of the threads that cannot find tasks will
-    // terminate
-    for (Worker& w : _workers) {
-        _cv->notify_all();
+        // We first have to set '_isRunning' to false before waking up all threads as
+        // they otherwise might go to sleep immediately again
+        *_isRunning = false;
+
+        // Wake up all of the threads, all of the threads that cannot find tasks will
+        // terminate
+        _signal->notifyAll();
+
+        for (Worker& w : _workers) {
+            threads.push_back(std::move(w.thread));
+            w.shouldTerminate = nullptr;
+        }
+    }
+
+    for (std::unique_ptr<std::thread>& t : threads) {
         if (detachThreads) {
             // Detaching the thread to let it finish it's work independently
-            w.thread->detach();
+            t->detach();
         }
         else {
             // Block until the thread is finished
-            w.thread->join();
+            t->join();
         }
-
-
-    }
-
-    // Delete all the workers. We don't want to actually delete them as we would otherwise
-    // lose information about their sizes
-    for (Worker& w : _workers) {
-        w = { nullptr, nullptr };
     }
 
     ghoul_assert(!isRunning(), "The ThreadPool is still running");
@@ -144,30 +223,40 @@ bool ThreadPool::isRunning() const {
 void ThreadPool::resize(int nThreads) {
     ghoul_assert(nThreads > 0, "nThreads must be bigger than 0");
 
-    int oldNThreads = size();
+    std::lock_guard<std::mutex> lock(_workersMutex);
+    resizeWorkers(nThreads);
+}
+
+void ThreadPool::resizeWorkers(int nThreads) {
+    const int oldNThreads = static_cast<int>(_workers.size());
+    // Published first so that tasks running on the new workers already see the new size
+    _nWorkers = nThreads;
     if (oldNThreads <= nThreads) {
         // if the number of threads has increased
         _workers.resize(nThreads);
 
         // We only want to activate the new workers if we are not currently running
         if (*_isRunning) {
-            for (int i = oldNThreads; i < nThreads; ++i) {
-                activateWorker(_workers[i]);
-            }
+            activateWorkers(oldNThreads, nThreads);
         }
     }
     else {
         // the number of threads has decreased
         for (int i = oldNThreads - 1; i >= nThreads; --i) {
-            // Tell the superfluous threads to finish
-            *(_workers[i].shouldTerminate) = true;
-
-            // And detach the thread so we can safely remove the Worker object
-            _workers[i].thread->detach();
+            // Tell the superfluous threads to finish and detach them so we can safely
+            // remove the Worker object. If the ThreadPool is stopped, there is neither a
+            // thread that could be detached nor a termination flag. A terminating Worker
+            // hands the tasks of its local queue to the shared queue
+            if (_workers[i].shouldTerminate) {
+                *(_workers[i].shouldTerminate) = true;
+            }
+            if (_workers[i].thread) {
+                _workers[i].thread->detach();
+            }
         }
         // The notification will do nothing for the first 'nThreads' threads, but it
         // will cause the remaining 'nThreads - oldNThreads' to return
-        _cv->notify_all();
+        _signal->notifyAll();
 
         // safe to delete because the threads are detached
         _workers.resize(nThreads);
@@ -176,68 +265,655 @@ void ThreadPool::resize(int nThreads) {
 }
 
 int ThreadPool::size() const {
-    return static_cast<int>(_workers.size());
+    return _nWorkers;
+}
+
+void ThreadPool::enableAutoScaling(AutoScaling policy) {
+    ghoul_assert(policy.minThreads > 0, "minThreads must be bigger than 0");
+    ghoul_assert(
+        policy.maxThreads == 0 || policy.maxThreads >= policy.minThreads,
+        "maxThreads must not be smaller than minThreads"
+    );
+    ghoul_assert(policy.interval.count() > 0, "interval must be positive");
+
+    disableAutoScaling();
+
+    if (policy.maxThreads == 0) {
+        policy.maxThreads = std::max(
+            policy.minThreads,
+            static_cast<int>(std::thread::hardware_concurrency())
+        );
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_workersMutex);
+        const int nThreads = std::min(
+            std::max(static_cast<int>(_workers.size()), policy.minThreads),
+            policy.maxThreads
+        );
+        if (nThreads != static_cast<int>(_workers.size())) {
+            resizeWorkers(nThreads);
+        }
+    }
+
+    _shouldStopSupervisor = false;
+    _isAutoScaling = true;
+    _supervisor = std::thread(&ThreadPool::supervise, this, policy);
+}
+
+void ThreadPool::disableAutoScaling() {
+    if (!_supervisor.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_supervisorMutex);
+        _shouldStopSupervisor = true;
+    }
+    _supervisorCv.notify_one();
+    _supervisor.join();
+    _isAutoScaling = false;
+}
+
+bool ThreadPool::isAutoScaling() const {
+    return _isAutoScaling;
+}
+
+void ThreadPool::setCapacity(int capacity, OverflowPolicy policy) {
+    ghoul_assert(capacity >= 0, "capacity must not be negative");
+
+    _backpressure->capacity = capacity;
+    _backpressure->policy = policy;
+
+    // Producers that are blocked might fit now or might have to apply a different policy
+    _backpressure->notifyAll();
+}
+
+int ThreadPool::capacity() const {
+    return _backpressure->capacity;
+}
+
+ThreadPool::OverflowPolicy ThreadPool::overflowPolicy() const {
+    return _backpressure->policy;
+}
+
+void ThreadPool::supervise(AutoScaling policy) {
+    // Since when at least one Worker has been idle
+    bool isIdle = false;
+    Clock::time_point idleSince;
+    // Since when tasks have been waiting while no Worker was idle. This detects tasks
+    // that cannot start at all because all Workers are occupied by long tasks, in which
+    // case no queue wait time would be recorded
+    bool isSaturated = false;
+    Clock::time_point saturatedSince;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(_supervisorMutex);
+            const bool shouldStop = _supervisorCv.wait_for(
+                lock,
+                policy.interval,
+                [this]() { return _shouldStopSupervisor; }
+            );
+            if (shouldStop) {
+                return;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(_workersMutex);
+        if (!*_isRunning) {
+            isIdle = false;
+            isSaturated = false;
+            continue;
+        }
+
+        std::chrono::nanoseconds maxQueueWait(0);
+        for (Worker& w : _workers) {
+            if (w.counters) {
+                maxQueueWait = std::max(
+                    maxQueueWait,
+                    w.counters->takeMaxQueueWaitTime()
+                );
+            }
+        }
+
+        const Clock::time_point now = Clock::now();
+        const int nThreads = static_cast<int>(_workers.size());
+        const int nIdle = _signal->nIdle();
+
+        if (nIdle == 0 && remainingTasks() > 0) {
+            if (!isSaturated) {
+                isSaturated = true;
+                saturatedSince = now;
+            }
+        }
+        else {
+            isSaturated = false;
+        }
+
+        if (nIdle > 0) {
+            if (!isIdle) {
+                isIdle = true;
+                idleSince = now;
+            }
+        }
+        else {
+            isIdle = false;
+        }
+
+        const bool isOverloaded = (maxQueueWait >= policy.queueWaitThreshold) ||
+            (isSaturated && now - saturatedSince >= policy.queueWaitThreshold);
+
+        if (isOverloaded && nThreads < policy.maxThreads) {
+            resizeWorkers(nThreads + 1);
+            // Give the new Worker a chance before deciding to add another one
+            isSaturated = false;
+            isIdle = false;
+        }
+        else if (isIdle && now - idleSince >= policy.idleTimeout &&
+                 nThreads > policy.minThreads)
+        {
+            resizeWorkers(nThreads - 1);
+            // The next Worker is only removed after another full timeout
+            idleSince = now;
+        }
+    }
 }
 
 int ThreadPool::idleThreads() const {
-    return *_nWaiting;
+    return _signal->nIdle();
 }
 
 int ThreadPool::remainingTasks() const {
-    return _taskQueue->size();
+    return _taskQueue->size() + _localQueues->size();
+}
+
+int ThreadPool::remainingTasks(Priority priority) const {
+    return _taskQueue->size(priority) + _localQueues->size(priority);
+}
+
+bool ThreadPool::isWorkStealing() const {
+    return _workStealing;
+}
+
+std::chrono::microseconds ThreadPool::spinDuration() const {
+    return _spinDuration;
+}
+
+Placement ThreadPool::placement() const {
+    return _placement;
+}
+
+void ThreadPool::setInstrumentationEnabled(bool enabled) {
+    *_isInstrumented = enabled;
+}
+
+bool ThreadPool::isInstrumentationEnabled() const {
+    return *_isInstrumented;
+}
+
+ThreadPool::Statistics ThreadPool::statistics() const {
+    std::lock_guard<std::mutex> lock(_workersMutex);
+
+    Statistics result;
+    result.workers.reserve(_workers.size());
+    for (const Worker& w : _workers) {
+        // A Worker that was added while the ThreadPool was stopped has no counters yet
+        if (w.counters) {
+            result.workers.push_back(w.counters->snapshot());
+        }
+        else {
+            result.workers.push_back(WorkerStatistics());
+        }
+    }
+    result.nRemainingTasks = remainingTasks();
+    return result;
+}
+
+void ThreadPool::resetStatistics() {
+    std::lock_guard<std::mutex> lock(_workersMutex);
+    for (Worker& w : _workers) {
+        if (w.counters) {
+            w.counters->reset();
+        }
+    }
+}
+
+Dictionary ThreadPool::Statistics::toDictionary() const {
+    using Seconds = std::chrono::duration<double>;
+
+    Dictionary ws;
+    for (size_t i = 0; i < workers.size(); ++i) {
+        const WorkerStatistics& w = workers[i];
+        Dictionary d;
+        d.setValue("TasksExecuted", static_cast<long long>(w.nTasksExecuted));
+        d.setValue("TasksStolen", static_cast<long long>(w.nTasksStolen));
+        d.setValue("BusyTime", std::chrono::duration_cast<Seconds>(w.busyTime).count());
+        d.setValue("IdleTime", std::chrono::duration_cast<Seconds>(w.idleTime).count());
+        d.setValue("QueueWaitTime", histogramToDictionary(w.queueWaitTime));
+        d.setValue("RunTime", histogramToDictionary(w.runTime));
+        ws.setValue(std::to_string(i + 1), std::move(d));
+    }
+
+    Dictionary result;
+    result.setValue("RemainingTasks", nRemainingTasks);
+    result.setValue("Workers", std::move(ws));
+    return result;
+}
+
+std::string ThreadPool::Statistics::toJson() const {
+    return DictionaryJsonFormatter().format(toDictionary());
 }
 
 void ThreadPool::clearRemainingTasks() {
-    while (!_taskQueue->isEmpty()) {
-        _taskQueue->pop();
+    _taskQueue->clear();
+    _localQueues->clear();
+    _backpressure->notifyAll();
+
+    // We cannot assert that the queues are empty at this point, as destroying a task
+    // might queue new tasks, for example to notify a continuation that it was discarded
+}
+
+void ThreadPool::pushTask(Task&& task, Priority priority, BypassCapacity bypassCapacity,
+                          const CancellationToken* token)
+{
+    // Only tasks that are queued from within one of our own Workers are allowed to go to
+    // the local queue. A Worker of a different ThreadPool has to use our shared queue
+    const bool isOwnWorker = (_currentLocalQueues == _localQueues.get());
+    if (!bypassCapacity && applyOverflowPolicy(task, isOwnWorker)) {
+        return;
+    }
+
+    const bool isInstrumented = *_isInstrumented;
+    if (isInstrumented || _isAutoScaling) {
+        task = timestamped(std::move(task), isInstrumented);
+    }
+
+    if (_workStealing && isOwnWorker && _currentLocalQueue) {
+        _currentLocalQueue->push(std::move(task), priority, token);
+    }
+    else {
+        _taskQueue->push(std::move(task), priority, token);
+    }
+
+    // Notify a potentially waiting thread that a new task is available. If the task was
+    // pushed into the local queue, the waiting thread will steal it
+    _signal->notifyOne();
+}
+
+void ThreadPool::pushTasks(std::vector<Task>&& tasks, Priority priority) {
+    if (_backpressure->capacity > 0) {
+        // The capacity has to be checked for every single task
+        for (Task& t : tasks) {
+            pushTask(std::move(t), priority);
+        }
+        return;
+    }
+
+    const int nTasks = static_cast<int>(tasks.size());
+    const bool isInstrumented = *_isInstrumented;
+    if (isInstrumented || _isAutoScaling) {
+        for (Task& t : tasks) {
+            t = timestamped(std::move(t), isInstrumented);
+        }
+    }
+
+    const bool isOwnWorker = (_currentLocalQueues == _localQueues.get());
+    if (_workStealing && isOwnWorker && _currentLocalQueue) {
+        _currentLocalQueue->push(std::move(tasks), priority);
+    }
+    else {
+        _taskQueue->push(std::move(tasks), priority);
+    }
+
+    // Only wake up as many threads as there are tasks in the batch
+    _signal->notify(nTasks);
+}
+
+bool ThreadPool::runPendingTask() {
+    const bool isOwnWorker = (_currentLocalQueues == _localQueues.get());
+    TaskQueue* localQueue = isOwnWorker ? _currentLocalQueue : nullptr;
+
+    std::tuple<Task, bool> t = std::make_tuple(Task(), false);
+    if (_workStealing && localQueue) {
+        t = localQueue->popBack();
+    }
+    if (!std::get<1>(t)) {
+        t = _taskQueue->pop();
+    }
+    if (!std::get<1>(t) && _workStealing) {
+        t = _localQueues->steal(localQueue);
+    }
+    if (!std::get<1>(t)) {
+        return false;
+    }
+
+    _backpressure->notifyOne();
+    std::get<0>(t)();
+    return true;
+}
+
+bool ThreadPool::applyOverflowPolicy(Task& task, bool isOwnWorker) {
+    Backpressure& bp = *_backpressure;
+    const int capacity = bp.capacity;
+    if (capacity == 0 || _taskQueue->nStoredTasks() + _localQueues->nStoredTasks() <
+        capacity)
+    {
+        return false;
     }
 
-    ghoul_assert(_taskQueue->isEmpty(), "Task queue is not empty");
+    // Tasks that have been cancelled while waiting must neither keep a producer waiting
+    // nor cause a live task to be dropped
+    _taskQueue->purgeCancelled();
+    _localQueues->purgeCancelled();
+    if (_taskQueue->nStoredTasks() + _localQueues->nStoredTasks() < capacity) {
+        return false;
+    }
+
+    OverflowPolicy policy = bp.policy;
+    if (policy == OverflowPolicy::Block && isOwnWorker) {
+        // If all Workers were blocked, nobody would be left to make space in the queue
+        policy = OverflowPolicy::CallerRuns;
+    }
+
+    switch (policy) {
+        case OverflowPolicy::Block:
+        {
+            std::unique_lock<std::mutex> lock(bp.mutex);
+            ++bp.nWaiting;
+            // The waiting tasks that are cancelled no longer count toward the capacity
+            auto hasSpace = [this, &bp]() {
+                const int c = bp.capacity;
+                return c == 0 || remainingTasks() < c;
+            };
+            while (!bp.cv.wait_for(lock, CancellationCheckInterval, hasSpace)) {}
+            --bp.nWaiting;
+            return false;
+        }
+        case OverflowPolicy::CallerRuns:
+            task();
+            return true;
+        case OverflowPolicy::Reject:
+            throw QueueFullError(capacity);
+        case OverflowPolicy::DropOldest:
+        {
+            std::tuple<Task, bool> t = _taskQueue->popLowestPriority();
+            if (!std::get<1>(t)) {
+                // All waiting tasks are in the local queues of the Workers
+                t = _localQueues->steal(nullptr);
+            }
+            // The dropped task is destroyed here, outside of any lock, which stores a
+            // broken promise in its future if it has one
+            return false;
+        }
+    }
+    return false;
+}
+
+ThreadPool::PeriodicTask::PeriodicTask(std::function<void()> f,
+                                       TimerWheel::Clock::duration p, Priority prio)
+    : function(std::move(f))
+    , period(p)
+    , priority(prio)
+    , isQueued(false)
+{}
+
+void ThreadPool::addTimer(TimerWheel::Clock::time_point expiration, Task&& callback) {
+    {
+        std::lock_guard<std::mutex> lock(_timerMutex);
+        if (!_timerThread.joinable()) {
+            _timerThread = std::thread(&ThreadPool::runTimers, this);
+        }
+        _timerWheel.add(expiration, std::move(callback));
+    }
+    // The new timer might expire before the one the timer thread is waiting for
+    _timerCv.notify_one();
 }
 
-void ThreadPool::activateWorker(Worker& worker) {
+void ThreadPool::schedulePeriodic(std::shared_ptr<PeriodicTask> task,
+                                  TimerWheel::Clock::time_point expiration)
+{
+    addTimer(expiration, [this, task, expiration]() {
+        if (task->token.isCancelled()) {
+            // Not adding the next timer ends the repetition
+            return;
+        }
+        // The next expiration is computed from this one, so that the period does not
+        // drift by the time it takes to call this function
+        schedulePeriodic(task, expiration + task->period);
+
+        if (task->isQueued.exchange(true)) {
+            // The previous execution has not finished yet, so we skip this one
+            return;
+        }
+
+        // The flag is reset once the queued task is destroyed, which also happens if it
+        // is discarded without being executed
+        std::shared_ptr<PeriodicTask> queued(
+            task.get(),
+            [task](PeriodicTask* t) { t->isQueued = false; }
+        );
+        // The timer thread must neither block nor execute the task itself, so the
+        // capacity does not apply to it
+        pushTask(
+            [queued]() {
+                if (!queued->token.isCancelled()) {
+                    queued->function();
+                }
+            },
+            task->priority,
+            BypassCapacity::Yes,
+            &task->token
+        );
+    });
+}
+
+void ThreadPool::runTimers() {
+    std::unique_lock<std::mutex> lock(_timerMutex);
+    while (!_shouldStopTimers) {
+        std::vector<TimerWheel::Callback> expired = _timerWheel.advance(Clock::now());
+        if (expired.empty()) {
+            const TimerWheel::Clock::time_point next = _timerWheel.nextExpiration();
+            if (next == TimerWheel::Clock::time_point::max()) {
+                _timerCv.wait(lock);
+            }
+            else {
+                _timerCv.wait_until(lock, next);
+            }
+            continue;
+        }
+
+        // The callbacks queue tasks and add new timers, so they must be called without
+        // holding the lock
+        lock.unlock();
+        for (TimerWheel::Callback& callback : expired) {
+            // An exception must not end the timer thread, as that would stop all other
+            // timers. The task is discarded together with the callback; a periodic task
+            // has already added the timer for its next execution
+            try {
+                callback();
+            }
+            catch (const std::exception& e) {
+                LERRORC("ThreadPool", std::string("Timer failed: ") + e.what());
+            }
+            catch (...) {
+                LERRORC("ThreadPool", "Timer failed with an unknown exception");
+            }
+        }
+        expired.clear();
+        lock.lock();
+    }
+}
+
+ThreadPool::Task ThreadPool::timestamped(Task&& task, bool updateHistogram) {
+    return Task(
+        [t = std::move(task), queued = Clock::now(), updateHistogram]() mutable {
+            if (_currentCounters) {
+                _currentCounters->addQueueWaitTime(
+                    Clock::now() - queued,
+                    updateHistogram
+                );
+            }
+            t();
+        }
+    );
+}
+
+std::future<void> ThreadPool::activateWorker(Worker& worker, int cpu) {
     // a copy of the shared ptr to the flag
     auto shouldTerminate = std::make_shared<std::atomic_bool>(false);
 
+    // The counters are kept if the Worker was active before
+    if (!worker.counters) {
+        worker.counters = std::make_shared<WorkerCounters>();
+    }
+    std::shared_ptr<WorkerCounters> counters = worker.counters;
+
     // We create local copies of the important variables so that we are guaranteed that
     // they continue to exist when we pass them to the 'workerLoop' lamdba. Otherwise,
     // the ThreadPool might be destructed before the workers have finished (for example
     // when they are detached) and would then access already freed memory
     std::shared_ptr<std::atomic_bool> threadPoolIsRunning = _isRunning;
-    std::shared_ptr<std::atomic_int> nWaiting = _nWaiting;
     std::shared_ptr<TaskQueue> taskQueue = _taskQueue;
-    std::shared_ptr<std::mutex> mutex = _mutex;
-    std::shared_ptr<std::condition_variable> cv = _cv;
+    std::shared_ptr<LocalQueues> localQueues = _localQueues;
+    std::shared_ptr<Backpressure> backpressure = _backpressure;
+    std::shared_ptr<WakeupSignal> signal = _signal;
+    std::shared_ptr<std::atomic_bool> isInstrumented = _isInstrumented;
+    const bool workStealing = _workStealing;
+    const std::chrono::microseconds spinDuration = _spinDuration;
 
     std::function<void()> workerInitialization = _workerInitialization;
     std::function<void()> workerDeinitialization = _workerDeinitialization;
 
-
-    volatile bool finishedInitializing = false;
+    // The promise is fulfilled by the worker thread once it has been initialized
+    std::promise<void> initialized;
+    std::future<void> finishedInitializing = initialized.get_future();
 
     // capturing the shared_ptrs by value to maintain a copy
     auto workerLoop = [
-        shouldTerminate, threadPoolIsRunning, &finishedInitializing, nWaiting, taskQueue,
-        mutex, cv, workerInitialization, workerDeinitialization
-    ]() {
+        shouldTerminate, threadPoolIsRunning, taskQueue, localQueues, backpressure,
+        signal, counters, isInstrumented, workStealing, spinDuration, cpu,
+        workerInitialization, workerDeinitialization,
+        initialized = std::move(initialized)
+    ]() mutable {
+        // Pin ourselves first, so that all memory that we allocate from here on is
+        // placed on our NUMA node by the first-touch policy of the operating system
+        // This fails if the affinity of the process was restricted after the ThreadPool
+        // was created, in which case the worker is left unpinned rather than
+        // terminating the application from a thread that cannot report the error
+        if (cpu >= 0) {
+            try {
+                setCurrentThreadAffinity({ cpu });
+            }
+            catch (const RuntimeError& e) {
+                LWARNINGC(
+                    "ThreadPool",
+                    "Could not pin worker to CPU " + std::to_string(cpu) + ": " + e.what()
+                );
+            }
+        }
+
+        // The local queue of this worker, which is only used if work stealing is
+        // enabled. It is created here rather than in the ThreadPool for the same reason
+        auto localQueue = std::make_shared<TaskQueue>();
+
         // Invoke the user-defined initialization function
         workerInitialization();
         // And invoke the user-defined deinitialization function when the scope is exited
         OnExit([&]() { workerDeinitialization(); });
+
+        // The objects created by 'workerLocal'. As this is destroyed before the
+        // deinitialization function is called, the objects can still use anything that
+        // the initialization function has set up
+        WorkerLocalStorage storage;
+
+        // Make the local queue known to the 'pushTask' function of the ThreadPool and,
+        // if we use work stealing, to the other workers
+        _currentLocalQueue = localQueue.get();
+        _currentLocalQueues = localQueues.get();
+        _currentCounters = counters.get();
+        _currentStorage = &storage;
+        if (workStealing) {
+            localQueues->add(localQueue);
+        }
+        OnExit([&]() {
+            if (workStealing) {
+                localQueues->remove(localQueue);
+                // If we were asked to terminate, there might be tasks left that have
+                // been pushed by a task we executed but that nobody has stolen yet. We
+                // give them to the shared queue so that the other workers can find them
+                localQueue->moveTasksTo(*taskQueue);
+                signal->notifyAll();
+            }
+            _currentLocalQueue = nullptr;
+            _currentLocalQueues = nullptr;
+            _currentCounters = nullptr;
+            _currentStorage = nullptr;
+        });
+
+        // From here on, we are ready to accept tasks
+        initialized.set_value();
+
+        // Retrieves the next task for this worker. Our own local queue is processed in
+        // LIFO order as the most recent task is most likely to still be in the cache.
+        // Afterwards, we try the shared queue and lastly we try to steal the oldest task
+        // from one of the other workers. High priority tasks in the shared queue take
+        // precedence over our local queue, however
+        auto findTask = [&]() -> std::tuple<Task, bool> {
+            if (workStealing && taskQueue->size(Priority::High) > 0) {
+                std::tuple<Task, bool> t = taskQueue->pop();
+                if (std::get<1>(t)) {
+                    return t;
+                }
+            }
+
+            if (workStealing) {
+                std::tuple<Task, bool> t = localQueue->popBack();
+                if (std::get<1>(t)) {
+                    return t;
+                }
+            }
+
+            std::tuple<Task, bool> t = taskQueue->pop();
+            if (std::get<1>(t) || !workStealing) {
+                return t;
+            }
+
+            t = localQueues->steal(localQueue.get());
+            if (std::get<1>(t) && isInstrumented->load(std::memory_order_relaxed)) {
+                counters->addStolenTask();
+            }
+            return t;
+        };
+
+        // Every task that we take out of a queue makes space for a blocked producer
+        auto nextTask = [&]() -> std::tuple<Task, bool> {
+            std::tuple<Task, bool> t = findTask();
+            if (std::get<1>(t)) {
+                backpressure->notifyOne();
+            }
+            return t;
+        };
         
-        std::function<void()> task;
+        Task task;
         bool hasTask;
-        std::tie(task, hasTask) = taskQueue->pop();
+        std::tie(task, hasTask) = nextTask();
         
         // Infinite look that only gets broken if this thread should terminate or if it
         // gets woken up without there being a task
         while (true) {  // loop #1
             // If there is something in the queue
             while (hasTask) { // loop #2
-                finishedInitializing = true;
-                
-                // Do the task
-                task();
+                // Do the task, measuring its run time only if requested so that the
+                // clock is not read otherwise
+                if (isInstrumented->load(std::memory_order_relaxed)) {
+                    const Clock::time_point start = Clock::now();
+                    task();
+                    counters->addTask(Clock::now() - start);
+                }
+                else {
+                    task();
+                }
                 
                 // We cannot check for shouldTerminate earlier as if hasTask is true,
                 // we have already retrieved that value from the stack and if we don't
@@ -249,35 +925,37 @@ void ThreadPool::activateWorker(Worker& worker) {
                 // If we shouldn't terminate, we can check if there is more work
                 // if there is, we stay in this inner loop until there is no more work to
                 // be done
-                std::tie(task, hasTask) = taskQueue->pop();
+                std::tie(task, hasTask) = nextTask();
             }
 
             // If the ThreadPool has stopped running and there are no more tasks, we don't
             // need to sleep first, but can return immediately
             if (!*threadPoolIsRunning) {
-                finishedInitializing = true;
                 return;
             }
 
             // If we get here, there is no more work to be done and the ThreadPool is
             // still running, so we can sleep until there is more work
-            (*nWaiting)++;
+            signal->enterIdle();
+            const bool measureIdle = isInstrumented->load(std::memory_order_relaxed);
+            const Clock::time_point idleStart = measureIdle ?
+                Clock::now() :
+                Clock::time_point();
+            auto leaveIdle = [&]() {
+                signal->leaveIdle();
+                if (measureIdle) {
+                    counters->addIdleTime(Clock::now() - idleStart);
+                }
+            };
             while (true) { // loop #3
-                finishedInitializing = true;
-                
-                // We are doing this in an infinite loop, as we want to check regularly
-                // if there is more work. This shouldn't be necessary in normal cases, but
-                // is more of a last resort protection
-                std::unique_lock<std::mutex> lock(*mutex);
-                cv->wait_for(
-                    lock,
-                    WaitTime
-                );
+                // We have to read the generation before looking for a task. If a task is
+                // pushed after we looked, the generation will have changed and 'wait'
+                // returns immediately
+                const uint64_t generation = signal->generation();
 
-                // We woke up, so either there is work to be done
-                std::tie(task, hasTask) = taskQueue->pop();
+                std::tie(task, hasTask) = nextTask();
                 if (hasTask) {
-                    (*nWaiting)--;
+                    leaveIdle();
                     // We have a task now, so if we break we start over with loop #1 and
                     // do the work as we enter loop #2
                     break;
@@ -285,19 +963,21 @@ void ThreadPool::activateWorker(Worker& worker) {
 
                 // Or we were asked to terminate or the ThreadPool is finished
                 if (*shouldTerminate || !*threadPoolIsRunning) {
-                    (*nWaiting)--;
+                    leaveIdle();
                     return;
                 }
 
-                // If we reach this place, we just woke up spuriously or due to the timer
-                // so we stay in loop #3 and go to sleep again
+                // Sleep until the next notification
+                signal->wait(generation, spinDuration);
             }
         }
     };
 
     // We create the thread running our worker loop. It will start immediately, but that
     // is not a problem
-    std::unique_ptr<std::thread> thread = std::make_unique<std::thread>(workerLoop);
+    std::unique_ptr<std::thread> thread = std::make_unique<std::thread>(
+        std::move(workerLoop)
+    );
 
     // Set the threa priority to the desired class and level
     thread::setPriority(*thread, _threadPriorityClass, _threadPriorityLevel);
@@ -307,44 +987,548 @@ void ThreadPool::activateWorker(Worker& worker) {
         thread::setThreadBackground(*thread, thread::Background::Yes);
     }
     
-    // Overwrite the worker and we are done
-    worker = {
-        std::move(thread),
-        std::move(shouldTerminate)
-    };
+    // Overwrite the worker and we are done. The counters have already been set
+    worker.thread = std::move(thread);
+    worker.shouldTerminate = std::move(shouldTerminate);
+
+    return finishedInitializing;
+}
+
+void ThreadPool::activateWorkers(int first, int last) {
+    ghoul_assert(first >= 0, "first must not be negative");
+    ghoul_assert(
+        last <= static_cast<int>(_workers.size()),
+        "last must not be bigger than the number of workers"
+    );
+
+    std::vector<std::future<void>> initialized;
+    initialized.reserve(last - first);
+    for (int i = first; i < last; ++i) {
+        const int cpu = _cpuOrder.empty() ?
+            -1 :
+            _cpuOrder[static_cast<size_t>(i) % _cpuOrder.size()];
+        initialized.push_back(activateWorker(_workers[i], cpu));
+    }
+
+    // Only wait after all threads have been started so that they initialize in parallel
+    for (std::future<void>& f : initialized) {
+        f.wait();
+    }
+}
+
+ThreadPool::WorkerCounters::WorkerCounters() {
+    reset();
+}
+
+void ThreadPool::WorkerCounters::addTask(std::chrono::nanoseconds duration) {
+    nTasksExecuted.fetch_add(1, std::memory_order_relaxed);
+    busyTime.fetch_add(duration.count(), std::memory_order_relaxed);
+    runTime[histogramBucket(duration)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void ThreadPool::WorkerCounters::addQueueWaitTime(std::chrono::nanoseconds duration,
+                                                  bool updateHistogram)
+{
+    // Only this Worker increases the maximum, so we do not need a compare-exchange loop
+    const uint64_t ns = duration.count();
+    if (ns > maxQueueWaitTime.load(std::memory_order_relaxed)) {
+        maxQueueWaitTime.store(ns, std::memory_order_relaxed);
+    }
+
+    if (updateHistogram) {
+        queueWaitTime[histogramBucket(duration)].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+std::chrono::nanoseconds ThreadPool::WorkerCounters::takeMaxQueueWaitTime() {
+    const uint64_t ns = maxQueueWaitTime.exchange(0, std::memory_order_relaxed);
+    return std::chrono::nanoseconds(ns);
+}
+
+void ThreadPool::WorkerCounters::addIdleTime(std::chrono::nanoseconds duration) {
+    idleTime.fetch_add(duration.count(), std::memory_order_relaxed);
+}
+
+void ThreadPool::WorkerCounters::addStolenTask() {
+    nTasksStolen.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ThreadPool::WorkerCounters::reset() {
+    nTasksExecuted.store(0, std::memory_order_relaxed);
+    nTasksStolen.store(0, std::memory_order_relaxed);
+    busyTime.store(0, std::memory_order_relaxed);
+    idleTime.store(0, std::memory_order_relaxed);
+    maxQueueWaitTime.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < NHistogramBuckets; ++i) {
+        queueWaitTime[i].store(0, std::memory_order_relaxed);
+        runTime[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+ThreadPool::WorkerStatistics ThreadPool::WorkerCounters::snapshot() const {
+    WorkerStatistics result;
+    result.nTasksExecuted = nTasksExecuted.load(std::memory_order_relaxed);
+    result.nTasksStolen = nTasksStolen.load(std::memory_order_relaxed);
+    result.busyTime = std::chrono::nanoseconds(busyTime.load(std::memory_order_relaxed));
+    result.idleTime = std::chrono::nanoseconds(idleTime.load(std::memory_order_relaxed));
+    for (int i = 0; i < NHistogramBuckets; ++i) {
+        result.queueWaitTime[i] = queueWaitTime[i].load(std::memory_order_relaxed);
+        result.runTime[i] = runTime[i].load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+ThreadPool::WorkerLocalStorage::~WorkerLocalStorage() {
+    for (auto it = _creationOrder.rbegin(); it != _creationOrder.rend(); ++it) {
+        Entry& e = _entries[*it];
+        e.deleter(e.object);
+        e.object = nullptr;
+    }
+}
+
+int ThreadPool::WorkerLocalStorage::nextTypeIndex() {
+    static std::atomic_int NextIndex(0);
+    return NextIndex++;
+}
+
+ThreadPool::WorkerLocalStorage& ThreadPool::currentStorage() {
+    if (_currentStorage) {
+        return *_currentStorage;
+    }
+    // The calling thread is not a Worker, so its objects are kept until the thread exits
+    thread_local WorkerLocalStorage CallerStorage;
+    return CallerStorage;
+}
+
+ThreadPool::Backpressure::Backpressure()
+    : capacity(0)
+    , policy(OverflowPolicy::Block)
+    , nWaiting(0)
+{}
+
+void ThreadPool::Backpressure::notifyOne() {
+    // The size of the queue has already been decreased, so a producer that registers
+    // itself after this check will see the new size before it goes to sleep
+    if (nWaiting > 0) {
+        // Locking the mutex ensures that a producer that has registered itself is
+        // waiting on the condition variable and does not miss the notification
+        { std::lock_guard<std::mutex> lock(mutex); }
+        cv.notify_one();
+    }
+}
+
+void ThreadPool::Backpressure::notifyAll() {
+    { std::lock_guard<std::mutex> lock(mutex); }
+    cv.notify_all();
+}
+
+ThreadPool::WakeupSignal::WakeupSignal()
+    : _generation(0)
+    , _nIdle(0)
+{}
+
+uint64_t ThreadPool::WakeupSignal::generation() const {
+    return _generation;
+}
+
+void ThreadPool::WakeupSignal::notifyOne() {
+    ++_generation;
+
+    // A Worker always becomes idle before it reads the generation. So if there is no idle
+    // Worker now, any Worker that becomes idle later will see the new generation and
+    // nobody can be sleeping on an older generation
+    if (_nIdle > 0) {
+        // Taking the lock guarantees that a Worker that has checked the generation in
+        // 'wait' is already waiting on the condition variable and will be notified
+        { std::lock_guard<std::mutex> lock(_mutex); }
+        _cv.notify_one();
+    }
+}
+
+void ThreadPool::WakeupSignal::notifyAll() {
+    ++_generation;
+    { std::lock_guard<std::mutex> lock(_mutex); }
+    _cv.notify_all();
+}
+
+void ThreadPool::WakeupSignal::notify(int n) {
+    ++_generation;
+
+    // As in 'notifyOne', nobody can be sleeping on an older generation if no Worker is
+    // idle
+    const int nIdle = _nIdle;
+    if (n <= 0 || nIdle == 0) {
+        return;
+    }
+
+    { std::lock_guard<std::mutex> lock(_mutex); }
+    if (n >= nIdle) {
+        _cv.notify_all();
+    }
+    else {
+        for (int i = 0; i < n; ++i) {
+            _cv.notify_one();
+        }
+    }
+}
+
+void ThreadPool::WakeupSignal::wait(uint64_t generation,
+                                    std::chrono::microseconds spinDuration)
+{
+    if (spinDuration.count() > 0) {
+        auto end = std::chrono::steady_clock::now() + spinDuration;
+        do {
+            if (_generation != generation) {
+                return;
+            }
+            std::this_thread::yield();
+        } while (std::chrono::steady_clock::now() < end);
+    }
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _cv.wait(lock, [this, generation]() { return _generation != generation; });
+}
+
+void ThreadPool::WakeupSignal::enterIdle() {
+    ++_nIdle;
+}
+
+void ThreadPool::WakeupSignal::leaveIdle() {
+    --_nIdle;
+}
+
+int ThreadPool::WakeupSignal::nIdle() const {
+    return _nIdle;
+}
+
+ThreadPool::TaskQueue::TaskQueue()
+    : _nCancellable(0)
+{
+    _nPassedOver.fill(0);
+    for (std::atomic_int& s : _sizes) {
+        s = 0;
+    }
+}
 
-    while (!finishedInitializing) {}
+int ThreadPool::TaskQueue::nextLane() {
+    // Find the highest non-empty lane
+    int lane = -1;
+    for (int i = 0; i < NPriorities; ++i) {
+        if (!_lanes[i].empty()) {
+            lane = i;
+            break;
+        }
+    }
+    if (lane == -1) {
+        return -1;
+    }
+
+    // If a lower lane has been passed over too often, it gets served instead. We start
+    // with the lowest lane as it is the one most likely to starve
+    for (int i = NPriorities - 1; i > lane; --i) {
+        if (!_lanes[i].empty() && _nPassedOver[i] >= StarvationLimit) {
+            lane = i;
+            break;
+        }
+    }
+
+    // Every non-empty lane below the chosen one was passed over once more, the chosen
+    // lane and all lanes above it start over
+    for (int i = 0; i < NPriorities; ++i) {
+        if (i > lane && !_lanes[i].empty()) {
+            ++_nPassedOver[i];
+        }
+        else {
+            _nPassedOver[i] = 0;
+        }
+    }
+    return lane;
 }
 
 std::tuple<ThreadPool::Task, bool> ThreadPool::TaskQueue::pop() {
     std::lock_guard<std::mutex> lock(_queueMutex);
-    if (_queue.empty()) {
+    const int lane = nextLane();
+    if (lane == -1) {
         // No work to be done, the default constructed Task is never read
         return std::make_tuple(Task(), false);
     }
     else {
         // We have a task, so we move it out of the queue
-        Task t = std::move(_queue.front());
+        Entry e = std::move(_lanes[lane].front());
         // and remove the item
-        _queue.pop();
+        _lanes[lane].pop_front();
+        --_sizes[lane];
+        if (e.token) {
+            --_nCancellable;
+        }
         // and return the task together with a positive reply
-        return std::make_tuple(std::move(t), true);
+        return std::make_tuple(std::move(e.task), true);
     }
 }
-    
-void ThreadPool::TaskQueue::push(ThreadPool::Task&& task) {
+
+std::tuple<ThreadPool::Task, bool> ThreadPool::TaskQueue::popLowestPriority() {
     std::lock_guard<std::mutex> lock(_queueMutex);
-    _queue.push(task);
+    for (int lane = NPriorities - 1; lane >= 0; --lane) {
+        if (!_lanes[lane].empty()) {
+            Entry e = std::move(_lanes[lane].front());
+            _lanes[lane].pop_front();
+            --_sizes[lane];
+            if (e.token) {
+                --_nCancellable;
+            }
+            return std::make_tuple(std::move(e.task), true);
+        }
+    }
+    return std::make_tuple(Task(), false);
+}
+
+std::tuple<ThreadPool::Task, bool> ThreadPool::TaskQueue::popBack() {
+    std::lock_guard<std::mutex> lock(_queueMutex);
+    const int lane = nextLane();
+    if (lane == -1) {
+        return std::make_tuple(Task(), false);
+    }
+    else {
+        Entry e = std::move(_lanes[lane].back());
+        _lanes[lane].pop_back();
+        --_sizes[lane];
+        if (e.token) {
+            --_nCancellable;
+        }
+        return std::make_tuple(std::move(e.task), true);
+    }
 }
     
-bool ThreadPool::TaskQueue::isEmpty() const {
+void ThreadPool::TaskQueue::push(ThreadPool::Task&& task, Priority priority,
+                                 const CancellationToken* token)
+{
+    const int lane = static_cast<int>(priority);
+    ghoul_assert(lane >= 0 && lane < NPriorities, "Invalid priority");
+
+    // Only tasks that can be cancelled pay for storing a copy of the token
+    Entry e = {
+        std::move(task),
+        token ? std::make_unique<const CancellationToken>(*token) : nullptr
+    };
+
     std::lock_guard<std::mutex> lock(_queueMutex);
-    return _queue.empty();
+    if (e.token) {
+        ++_nCancellable;
+    }
+    _lanes[lane].push_back(std::move(e));
+    ++_sizes[lane];
+}
+
+void ThreadPool::TaskQueue::push(std::vector<Task>&& tasks, Priority priority) {
+    const int lane = static_cast<int>(priority);
+    ghoul_assert(lane >= 0 && lane < NPriorities, "Invalid priority");
+
+    std::lock_guard<std::mutex> lock(_queueMutex);
+    for (Task& t : tasks) {
+        _lanes[lane].push_back({ std::move(t), nullptr });
+    }
+    _sizes[lane] += static_cast<int>(tasks.size());
+}
+
+void ThreadPool::TaskQueue::moveTasksTo(TaskQueue& target) {
+    ghoul_assert(&target != this, "Target queue must not be this queue");
+
+    // Take the tasks out first so that we never hold both locks at the same time
+    std::array<std::deque<Entry>, NPriorities> lanes;
+    int nCancellable = 0;
+    {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        for (int i = 0; i < NPriorities; ++i) {
+            lanes[i].swap(_lanes[i]);
+            _sizes[i] = 0;
+        }
+        nCancellable = _nCancellable.exchange(0);
+    }
+
+    std::lock_guard<std::mutex> lock(target._queueMutex);
+    target._nCancellable += nCancellable;
+    for (int i = 0; i < NPriorities; ++i) {
+        std::move(
+            lanes[i].begin(),
+            lanes[i].end(),
+            std::back_inserter(target._lanes[i])
+        );
+        target._sizes[i] += static_cast<int>(lanes[i].size());
+    }
+}
+
+void ThreadPool::TaskQueue::clear() {
+    std::array<std::deque<Entry>, NPriorities> lanes;
+    {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        for (int i = 0; i < NPriorities; ++i) {
+            lanes[i].swap(_lanes[i]);
+            _sizes[i] = 0;
+        }
+        _nPassedOver.fill(0);
+        _nCancellable = 0;
+    }
+    // The tasks are destroyed outside of the lock as destroying a task might run
+    // arbitrary code, for example setting a broken promise
+}
+
+void ThreadPool::TaskQueue::purgeCancelled() {
+    if (_nCancellable == 0) {
+        return;
+    }
+
+    std::vector<Task> purged;
+    {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        for (int i = 0; i < NPriorities; ++i) {
+            std::deque<Entry>& lane = _lanes[i];
+            auto it = std::stable_partition(
+                lane.begin(),
+                lane.end(),
+                [](const Entry& e) { return !e.token || !e.token->isCancelled(); }
+            );
+            for (auto p = it; p != lane.end(); ++p) {
+                purged.push_back(std::move(p->task));
+            }
+            const int nPurged = static_cast<int>(std::distance(it, lane.end()));
+            lane.erase(it, lane.end());
+            _sizes[i] -= nPurged;
+            _nCancellable -= nPurged;
+        }
+    }
+    // Just as in 'clear', the tasks are destroyed outside of the lock
+}
+
+bool ThreadPool::TaskQueue::isEmpty() const {
+    return size() == 0;
 }
     
 int ThreadPool::TaskQueue::size() const {
+    int result = 0;
+    for (const std::atomic_int& s : _sizes) {
+        result += s;
+    }
+    if (_nCancellable == 0) {
+        return result;
+    }
+
+    std::lock_guard<std::mutex> lock(_queueMutex);
+    for (int i = 0; i < NPriorities; ++i) {
+        result -= nCancelled(i);
+    }
+    return result;
+}
+
+int ThreadPool::TaskQueue::size(Priority priority) const {
+    const int lane = static_cast<int>(priority);
+    ghoul_assert(lane >= 0 && lane < NPriorities, "Invalid priority");
+
+    if (_nCancellable == 0) {
+        return _sizes[lane];
+    }
+
     std::lock_guard<std::mutex> lock(_queueMutex);
-    return _queue.size();
+    return _sizes[lane] - nCancelled(lane);
+}
+
+int ThreadPool::TaskQueue::nStoredTasks() const {
+    int result = 0;
+    for (const std::atomic_int& s : _sizes) {
+        result += s;
+    }
+    return result;
+}
+
+int ThreadPool::TaskQueue::nCancelled(int lane) const {
+    return static_cast<int>(std::count_if(
+        _lanes[lane].begin(),
+        _lanes[lane].end(),
+        [](const Entry& e) { return e.token && e.token->isCancelled(); }
+    ));
+}
+
+ThreadPool::LocalQueues::LocalQueues()
+    : _queues(std::make_shared<const Queues>())
+    , _nextVictim(0)
+{}
+
+void ThreadPool::LocalQueues::add(std::shared_ptr<TaskQueue> queue) {
+    std::lock_guard<std::mutex> lock(_writeMutex);
+    auto queues = std::make_shared<Queues>(*std::atomic_load(&_queues));
+    queues->push_back(std::move(queue));
+    std::atomic_store(&_queues, std::shared_ptr<const Queues>(std::move(queues)));
+}
+
+void ThreadPool::LocalQueues::remove(const std::shared_ptr<TaskQueue>& queue) {
+    std::lock_guard<std::mutex> lock(_writeMutex);
+    auto queues = std::make_shared<Queues>(*std::atomic_load(&_queues));
+    queues->erase(std::remove(queues->begin(), queues->end(), queue), queues->end());
+    std::atomic_store(&_queues, std::shared_ptr<const Queues>(std::move(queues)));
+}
+
+std::tuple<ThreadPool::Task, bool> ThreadPool::LocalQueues::steal(const TaskQueue* thief)
+{
+    std::shared_ptr<const Queues> queues = std::atomic_load(&_queues);
+    const size_t n = queues->size();
+    if (n == 0) {
+        return std::make_tuple(Task(), false);
+    }
+
+    // Every call starts at a different victim so that the thieves spread out
+    const size_t start = _nextVictim++ % n;
+    for (size_t i = 0; i < n; ++i) {
+        TaskQueue* victim = (*queues)[(start + i) % n].get();
+        if (victim == thief) {
+            continue;
+        }
+
+        std::tuple<Task, bool> t = victim->pop();
+        if (std::get<1>(t)) {
+            return t;
+        }
+    }
+    return std::make_tuple(Task(), false);
+}
+
+void ThreadPool::LocalQueues::clear() {
+    std::shared_ptr<const Queues> queues = std::atomic_load(&_queues);
+    for (const std::shared_ptr<TaskQueue>& q : *queues) {
+        q->clear();
+    }
+}
+
+void ThreadPool::LocalQueues::purgeCancelled() {
+    std::shared_ptr<const Queues> queues = std::atomic_load(&_queues);
+    for (const std::shared_ptr<TaskQueue>& q : *queues) {
+        q->purgeCancelled();
+    }
+}
+
+int ThreadPool::LocalQueues::size() const {
+    std::shared_ptr<const Queues> queues = std::atomic_load(&_queues);
+    int result = 0;
+    for (const std::shared_ptr<TaskQueue>& q : *queues) {
+        result += q->size();
+    }
+    return result;
+}
+
+int ThreadPool::LocalQueues::size(Priority priority) const {
+    std::shared_ptr<const Queues> queues = std::atomic_load(&_queues);
+    int result = 0;
+    for (const std::shared_ptr<TaskQueue>& q : *queues) {
+        result += q->size(priority);
+    }
+    return result;
+}
+
+int ThreadPool::LocalQueues::nStoredTasks() const {
+    std::shared_ptr<const Queues> queues = std::atomic_load(&_queues);
+    int result = 0;
+    for (const std::shared_ptr<TaskQueue>& q : *queues) {
+        result += q->nStoredTasks();
+    }
+    return result;
 }
 
 } // namespace openspace
@@ -0,0 +1,159 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include <ghoul/misc/timerwheel.h>
+
+#include <ghoul/misc/assert.h>
+
+#include <algorithm>
+
+namespace {
+    const uint64_t SlotMask = ghoul::TimerWheel::NSlots - 1;
+} // namespace
+
+namespace ghoul {
+
+TimerWheel::TimerWheel(Clock::duration resolution, Clock::time_point start)
+    : _resolution(resolution)
+    , _start(start)
+    , _currentTick(0)
+    , _size(0)
+{
+    ghoul_assert(resolution.count() > 0, "resolution must be positive");
+}
+
+void TimerWheel::add(Clock::time_point expiration, Callback callback) {
+    // Rounding up guarantees that a timer never expires early
+    uint64_t tick = 0;
+    if (expiration > _start) {
+        const Clock::duration d = expiration - _start + _resolution - Clock::duration(1);
+        tick = static_cast<uint64_t>(d / _resolution);
+    }
+    // The current tick has already been collected
+    tick = std::max(tick, _currentTick + 1);
+
+    insert({ tick, std::move(callback) });
+    ++_size;
+}
+
+std::vector<TimerWheel::Callback> TimerWheel::advance(Clock::time_point now) {
+    std::vector<Callback> expired;
+    if (now < _start) {
+        return expired;
+    }
+
+    const uint64_t target = static_cast<uint64_t>((now - _start) / _resolution);
+    while (_currentTick < target) {
+        if (_size == 0) {
+            // Nothing can expire, so we can skip all remaining ticks at once
+            _currentTick = target;
+            break;
+        }
+        step(expired);
+    }
+    return expired;
+}
+
+TimerWheel::Clock::time_point TimerWheel::nextExpiration() const {
+    if (_size == 0) {
+        return Clock::time_point::max();
+    }
+
+    // Timers in the lowest level expire within the current block of NSlots ticks. At the
+    // start of the next block, a slot of a higher level is redistributed and the next
+    // expiration has to be determined again
+    for (uint64_t t = _currentTick + 1; ; ++t) {
+        if ((t & SlotMask) == 0 || !_levels[0][t & SlotMask].empty()) {
+            return timeOf(t);
+        }
+    }
+}
+
+int TimerWheel::size() const {
+    return _size;
+}
+
+bool TimerWheel::isEmpty() const {
+    return _size == 0;
+}
+
+void TimerWheel::insert(Timer&& timer) {
+    // The timer belongs into the lowest level in which its tick falls into a different
+    // slot than the current tick. All higher bits are the same, so the slot is reached
+    // before the level wraps around
+    const uint64_t diff = timer.tick ^ _currentTick;
+    int level = 0;
+    while (level < NLevels && (diff >> (NSlotBits * (level + 1))) != 0) {
+        ++level;
+    }
+
+    if (level == NLevels) {
+        _overflow.push_back(std::move(timer));
+    }
+    else {
+        const uint64_t slot = (timer.tick >> (NSlotBits * level)) & SlotMask;
+        _levels[level][slot].push_back(std::move(timer));
+    }
+}
+
+void TimerWheel::step(std::vector<Callback>& expired) {
+    ++_currentTick;
+    const uint64_t t = _currentTick;
+
+    // Redistribute the timers of all slots that start at this tick, beginning with the
+    // highest level as its timers might end up in a slot of a lower level that is
+    // redistributed as well
+    const int overflowShift = NSlotBits * NLevels;
+    if ((t & ((uint64_t(1) << overflowShift) - 1)) == 0) {
+        Slot overflow;
+        overflow.swap(_overflow);
+        for (Timer& timer : overflow) {
+            insert(std::move(timer));
+        }
+    }
+    for (int level = NLevels - 1; level > 0; --level) {
+        const int shift = NSlotBits * level;
+        if ((t & ((uint64_t(1) << shift) - 1)) == 0) {
+            Slot slot;
+            slot.swap(_levels[level][(t >> shift) & SlotMask]);
+            for (Timer& timer : slot) {
+                insert(std::move(timer));
+            }
+        }
+    }
+
+    Slot& slot = _levels[0][t & SlotMask];
+    for (Timer& timer : slot) {
+        expired.push_back(std::move(timer.callback));
+    }
+    _size -= static_cast<int>(slot.size());
+    slot.clear();
+}
+
+TimerWheel::Clock::time_point TimerWheel::timeOf(uint64_t tick) const {
+    return _start + _resolution * static_cast<Clock::rep>(tick);
+}
+
+} // namespace ghoul
@@ -34,15 +34,28 @@
 #include <ghoul/filesystem/filesystem>
 #include <ghoul/logging/logging>
 
+#include "tests/test_any.inl"
 #include "tests/test_buffer.inl"
 #include "tests/test_commandlineparser.inl"
 #include "tests/test_common.inl"
+#include "tests/test_continuation.inl"
+#include "tests/test_coroutine.inl"
 //#include "tests/test_configurationmanager.inl"
 #include "tests/test_dictionary.inl"
+#include "tests/test_dictionarybinary.inl"
+#include "tests/test_dictionaryjsonparser.inl"
 #include "tests/test_filesystem.inl"
+#include "tests/test_inplacefunction.inl"
 #include "tests/test_luatodictionary.inl"
+#include "tests/test_mainthreadexecutor.inl"
+#include "tests/test_parallel.inl"
+#include "tests/test_pipeline.inl"
+#include "tests/test_taskgraph.inl"
+#include "tests/test_taskgroup.inl"
 #include "tests/test_templatefactory.inl"
+#include "tests/test_thread.inl"
 #include "tests/test_threadpool.inl"
+#include "tests/test_timerwheel.inl"
 
 using namespace ghoul::cmdparser;
 using namespace ghoul::filesystem;
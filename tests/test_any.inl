@@ -0,0 +1,128 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include <ghoul/misc/any.h>
+#include <ghoul/glm.h>
+
+#include <array>
+#include <memory>
+#include <string>
+
+namespace {
+    // Counts the number of living instances to detect leaks and double destructions
+    struct AnyInstanceCounter {
+        explicit AnyInstanceCounter(int& c) : counter(&c) { ++(*counter); }
+        AnyInstanceCounter(const AnyInstanceCounter& other) : counter(other.counter) {
+            ++(*counter);
+        }
+        ~AnyInstanceCounter() { --(*counter); }
+
+        int* counter;
+    };
+} // namespace
+
+class AnyTest : public testing::Test {};
+
+TEST_F(AnyTest, Empty) {
+    ghoul::any a;
+    EXPECT_TRUE(a.empty());
+    EXPECT_EQ(typeid(void), a.type());
+    EXPECT_EQ(nullptr, ghoul::any_cast<int>(&a));
+    EXPECT_THROW(ghoul::any_cast<int>(a), ghoul::bad_any_cast);
+}
+
+TEST_F(AnyTest, Inplace) {
+    EXPECT_TRUE(ghoul::any::fitsInplace<double>());
+    EXPECT_TRUE(ghoul::any::fitsInplace<glm::dvec4>());
+    EXPECT_TRUE((ghoul::any::fitsInplace<std::array<double, 4>>()));
+    EXPECT_FALSE((ghoul::any::fitsInplace<std::array<double, 16>>()));
+    EXPECT_FALSE(ghoul::any::fitsInplace<std::string>());
+
+    ghoul::any a = 5.0;
+    EXPECT_TRUE(a.isStoredInplace());
+    EXPECT_EQ(typeid(double), a.type());
+    EXPECT_EQ(5.0, ghoul::any_cast<double>(a));
+    EXPECT_EQ(nullptr, ghoul::any_cast<int>(&a));
+
+    ghoul::any b = std::array<double, 4>{ { 1.0, 2.0, 3.0, 4.0 } };
+    EXPECT_TRUE(b.isStoredInplace());
+    ghoul::any c = b;
+    (*ghoul::any_cast<std::array<double, 4>>(&b))[0] = 0.0;
+    EXPECT_EQ(1.0, (ghoul::any_cast<std::array<double, 4>>(c)[0]));
+    EXPECT_EQ(0.0, (ghoul::any_cast<std::array<double, 4>>(b)[0]));
+}
+
+TEST_F(AnyTest, Heap) {
+    ghoul::any a = std::string("abc");
+    EXPECT_FALSE(a.isStoredInplace());
+    ghoul::any b = a;
+    *ghoul::any_cast<std::string>(&a) = "def";
+    EXPECT_EQ("def", ghoul::any_cast<std::string>(a));
+    EXPECT_EQ("abc", ghoul::any_cast<std::string>(b));
+
+    ghoul::any m = std::array<double, 16>();
+    EXPECT_FALSE(m.isStoredInplace());
+}
+
+TEST_F(AnyTest, AssignAndSwap) {
+    ghoul::any a = 1;
+    ghoul::any b = std::string("abc");
+    a.swap(b);
+    EXPECT_EQ("abc", ghoul::any_cast<std::string>(a));
+    EXPECT_EQ(1, ghoul::any_cast<int>(b));
+
+    b = a;
+    EXPECT_EQ("abc", ghoul::any_cast<std::string>(b));
+    a = 2.f;
+    EXPECT_EQ(2.f, ghoul::any_cast<float>(a));
+
+    ghoul::any c = std::move(b);
+    EXPECT_TRUE(b.empty());
+    EXPECT_EQ("abc", ghoul::any_cast<std::string>(c));
+
+    c.clear();
+    EXPECT_TRUE(c.empty());
+}
+
+TEST_F(AnyTest, Lifetime) {
+    int counter = 0;
+    {
+        ghoul::any a = AnyInstanceCounter(counter);
+        EXPECT_FALSE(a.isStoredInplace());
+        EXPECT_EQ(1, counter);
+
+        ghoul::any b = a;
+        EXPECT_EQ(2, counter);
+
+        ghoul::any c = std::move(a);
+        EXPECT_EQ(2, counter);
+
+        b = 1;
+        EXPECT_EQ(1, counter);
+    }
+    EXPECT_EQ(0, counter);
+}
@@ -0,0 +1,211 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include <ghoul/misc/continuation.h>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+class ContinuationTest : public testing::Test {};
+
+TEST_F(ContinuationTest, Submit) {
+    ghoul::ThreadPool pool(2);
+
+    ghoul::Continuable<int> c = ghoul::submit(pool, []() { return 42; });
+    ASSERT_TRUE(c.isValid());
+    EXPECT_EQ(42, c.get());
+    EXPECT_TRUE(c.isReady());
+
+    ghoul::Continuable<int> invalid;
+    EXPECT_FALSE(invalid.isValid());
+}
+
+TEST_F(ContinuationTest, ThenChain) {
+    ghoul::ThreadPool pool(2);
+
+    ghoul::Continuable<std::string> c = ghoul::submit(pool, []() { return 2; })
+        .then([](int i) { return i * 21; })
+        .then(ghoul::ThreadPool::Priority::High, [](int i) { return std::to_string(i); });
+    EXPECT_EQ("42", c.get());
+
+    std::atomic_int counter(0);
+    ghoul::Continuable<void> v = ghoul::submit(pool, [&counter]() { ++counter; })
+        .then([&counter]() { ++counter; })
+        .then([&counter]() { return counter.load(); })
+        .then([&counter](int i) { counter = 10 * i; });
+    v.wait();
+    EXPECT_EQ(20, counter);
+}
+
+TEST_F(ContinuationTest, ThenAfterFinished) {
+    ghoul::ThreadPool pool(1);
+
+    ghoul::Continuable<int> c = ghoul::submit(pool, []() { return 1; });
+    c.wait();
+    EXPECT_EQ(2, c.then([](int i) { return i + 1; }).get());
+    EXPECT_EQ(3, c.then([](int i) { return i + 2; }).get());
+}
+
+TEST_F(ContinuationTest, MoveOnlyContinuation) {
+    ghoul::ThreadPool pool(2);
+
+    ghoul::Continuable<int> c = ghoul::submit(
+        pool,
+        [p = std::make_unique<int>(1)]() { return *p; }
+    ).then([p = std::make_unique<int>(2)](int i) { return i + *p; });
+    EXPECT_EQ(3, c.get());
+
+    // A continuation that is added to a finished Continuable is queued immediately
+    EXPECT_EQ(6, c.then([p = std::make_unique<int>(3)](int i) { return i + *p; }).get());
+}
+
+TEST_F(ContinuationTest, ChainDoesNotBlockWorker) {
+    // A long chain on a single Worker would deadlock if any continuation was waiting for
+    // its predecessor on a Worker
+    ghoul::ThreadPool pool(1);
+
+    ghoul::Continuable<int> c = ghoul::submit(pool, []() { return 0; });
+    for (int i = 0; i < 100; ++i) {
+        c = c.then([](int v) { return v + 1; });
+    }
+    EXPECT_EQ(100, c.get());
+}
+
+TEST_F(ContinuationTest, ExceptionPropagation) {
+    ghoul::ThreadPool pool(2);
+
+    std::atomic_bool called(false);
+    ghoul::Continuable<int> c = ghoul::submit(pool, []() -> int {
+        throw std::runtime_error("error");
+    }).then([&called](int i) { called = true; return i; });
+
+    EXPECT_THROW(c.get(), std::runtime_error);
+    EXPECT_FALSE(called);
+}
+
+TEST_F(ContinuationTest, WhenAll) {
+    ghoul::ThreadPool pool(4);
+
+    std::vector<ghoul::Continuable<int>> tasks;
+    for (int i = 0; i < 20; ++i) {
+        tasks.push_back(ghoul::submit(pool, [i]() { return i * i; }));
+    }
+
+    ghoul::Continuable<int> sum = ghoul::whenAll(tasks).then([](
+                                                               const std::vector<int>& v)
+    {
+        int s = 0;
+        for (int i : v) {
+            s += i;
+        }
+        return s;
+    });
+    EXPECT_EQ(2470, sum.get());
+
+    std::atomic_int counter(0);
+    std::vector<ghoul::Continuable<void>> voidTasks;
+    for (int i = 0; i < 20; ++i) {
+        voidTasks.push_back(ghoul::submit(pool, [&counter]() { ++counter; }));
+    }
+    ghoul::whenAll(voidTasks).wait();
+    EXPECT_EQ(20, counter);
+}
+
+TEST_F(ContinuationTest, WhenAllException) {
+    ghoul::ThreadPool pool(2);
+
+    std::vector<ghoul::Continuable<int>> tasks;
+    tasks.push_back(ghoul::submit(pool, []() { return 1; }));
+    tasks.push_back(ghoul::submit(pool, []() -> int {
+        throw std::runtime_error("error");
+    }));
+    EXPECT_THROW(ghoul::whenAll(tasks).get(), std::runtime_error);
+}
+
+TEST_F(ContinuationTest, WhenAny) {
+    ghoul::ThreadPool pool(2);
+
+    std::atomic_bool release(false);
+    std::vector<ghoul::Continuable<int>> tasks;
+    tasks.push_back(ghoul::submit(pool, [&release]() {
+        while (!release) {
+            std::this_thread::yield();
+        }
+        return 0;
+    }));
+    tasks.push_back(ghoul::submit(pool, []() { return 1; }));
+
+    EXPECT_EQ(1, ghoul::whenAny(tasks).get());
+    release = true;
+}
+
+TEST_F(ContinuationTest, BrokenPromise) {
+    ghoul::ThreadPool pool(1);
+
+    std::atomic_bool release(false);
+    pool.queue([&release]() {
+        while (!release) {
+            std::this_thread::yield();
+        }
+    });
+    ghoul::Continuable<int> c = ghoul::submit(pool, []() { return 1; });
+    ghoul::Continuable<int> d = c.then([](int i) { return i; });
+
+    pool.clearRemainingTasks();
+    release = true;
+
+    EXPECT_THROW(c.get(), std::future_error);
+    EXPECT_THROW(d.get(), std::future_error);
+}
+
+TEST_F(ContinuationTest, FullPool) {
+    using OverflowPolicy = ghoul::ThreadPool::OverflowPolicy;
+    ghoul::ThreadPool pool(1);
+
+    std::promise<void> started;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    ghoul::Continuable<int> c = ghoul::submit(pool, [&started, released]() {
+        started.set_value();
+        released.wait();
+        return 1;
+    }).then([](int i) { return i + 1; });
+    started.get_future().wait();
+
+    // The continuation is queued by the Worker while the queue is full, which must
+    // neither reject it nor let the exception escape the Worker
+    pool.setCapacity(1, OverflowPolicy::Reject);
+    std::future<int> waiting = pool.queue([]() { return 3; });
+    EXPECT_THROW(pool.post([]() {}), ghoul::ThreadPool::QueueFullError);
+
+    release.set_value();
+    EXPECT_EQ(2, c.get());
+    EXPECT_EQ(3, waiting.get());
+}
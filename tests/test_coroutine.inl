@@ -0,0 +1,175 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include <ghoul/misc/coroutine.h>
+
+// The coroutine support is only available if the compiler implements C++20 coroutines
+#ifdef __cpp_impl_coroutine
+
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+    ghoul::Task<std::thread::id> workerThreadId(ghoul::ThreadPool& pool) {
+        co_await pool.schedule();
+        co_return std::this_thread::get_id();
+    }
+
+    ghoul::Task<int> add(int a, int b) {
+        co_return a + b;
+    }
+
+    ghoul::Task<int> sum(ghoul::ThreadPool& pool, int n) {
+        co_await pool.schedule();
+        int result = 0;
+        for (int i = 1; i <= n; ++i) {
+            result = co_await add(result, i);
+        }
+        co_return result;
+    }
+
+    ghoul::Task<> fail(ghoul::ThreadPool& pool) {
+        co_await pool.schedule(ghoul::ThreadPool::Priority::High);
+        throw std::runtime_error("error");
+    }
+
+    ghoul::Task<std::string> catchFailure(ghoul::ThreadPool& pool) {
+        try {
+            co_await fail(pool);
+        }
+        catch (const std::runtime_error& e) {
+            co_return e.what();
+        }
+        co_return "";
+    }
+
+    ghoul::Task<int> awaitContinuables(ghoul::ThreadPool& pool) {
+        co_await pool.schedule();
+        // If awaiting blocked the Worker, this would deadlock in a pool with one Worker
+        int a = co_await ghoul::submit(pool, []() { return 20; });
+        int b = co_await ghoul::submit(pool, []() { return 22; }).then(
+            [](int v) { return v; }
+        );
+        co_await ghoul::submit(pool, []() {});
+        co_return a + b;
+    }
+
+    ghoul::Task<> waitForever(ghoul::ThreadPool& pool) {
+        co_await pool.schedule();
+    }
+} // namespace
+
+class CoroutineTest : public testing::Test {};
+
+TEST_F(CoroutineTest, Schedule) {
+    ghoul::ThreadPool pool(2);
+
+    ghoul::Continuable<std::thread::id> id = ghoul::spawn(pool, workerThreadId(pool));
+    EXPECT_NE(std::this_thread::get_id(), id.get());
+}
+
+TEST_F(CoroutineTest, AwaitTask) {
+    ghoul::ThreadPool pool(2);
+
+    // Many nested awaits must not grow the stack
+    const int n = 10000;
+    ghoul::Continuable<int> result = ghoul::spawn(pool, sum(pool, n));
+    EXPECT_EQ(n / 2 * (n + 1), result.get());
+
+    ghoul::Task<int> unused = add(1, 2);
+    EXPECT_TRUE(unused.isValid());
+    ghoul::Task<int> moved = std::move(unused);
+    EXPECT_FALSE(unused.isValid());
+    EXPECT_TRUE(moved.isValid());
+}
+
+TEST_F(CoroutineTest, Exception) {
+    ghoul::ThreadPool pool(2);
+
+    EXPECT_THROW(ghoul::spawn(pool, fail(pool)).get(), std::runtime_error);
+    EXPECT_EQ("error", ghoul::spawn(pool, catchFailure(pool)).get());
+}
+
+TEST_F(CoroutineTest, AwaitContinuable) {
+    ghoul::ThreadPool pool(1);
+
+    ghoul::Continuable<int> result = ghoul::spawn(pool, awaitContinuables(pool));
+    EXPECT_EQ(42, result.get());
+}
+
+TEST_F(CoroutineTest, BrokenPromise) {
+    ghoul::ThreadPool pool(1);
+
+    // Block the only Worker so that the coroutine stays in the queue
+    std::promise<void> started;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::future<void> blocker = pool.queue([&started, released]() {
+        started.set_value();
+        released.wait();
+    });
+    started.get_future().wait();
+
+    ghoul::Continuable<void> result = ghoul::spawn(pool, waitForever(pool));
+    pool.clearRemainingTasks();
+    release.set_value();
+    blocker.get();
+
+    EXPECT_THROW(result.get(), std::future_error);
+}
+
+TEST_F(CoroutineTest, FullPool) {
+    using OverflowPolicy = ghoul::ThreadPool::OverflowPolicy;
+    for (OverflowPolicy policy : { OverflowPolicy::Reject, OverflowPolicy::DropOldest }) {
+        ghoul::ThreadPool pool(1);
+
+        // Block the only Worker and fill the queue up to its capacity
+        std::promise<void> started;
+        std::promise<void> release;
+        std::shared_future<void> released = release.get_future().share();
+        std::future<void> blocker = pool.queue([&started, released]() {
+            started.set_value();
+            released.wait();
+        });
+        started.get_future().wait();
+        pool.setCapacity(1, policy);
+        std::future<int> waiting = pool.queue([]() { return 1; });
+
+        // A coroutine that is already running is queued regardless of the capacity, so
+        // it is neither rejected nor does it replace the waiting task
+        ghoul::Continuable<std::thread::id> id = ghoul::spawn(pool, workerThreadId(pool));
+
+        release.set_value();
+        blocker.get();
+        EXPECT_EQ(1, waiting.get());
+        EXPECT_NE(std::this_thread::get_id(), id.get());
+    }
+}
+
+#endif // __cpp_impl_coroutine
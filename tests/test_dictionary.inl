@@ -25,8 +25,10 @@
 
 #include <ghoul/misc/dictionary.h>
 #include <ghoul/glm.h>
+#include <algorithm>
 #include <fstream>
 #include <sstream>
+#include <thread>
 
 /*
 Test checklist:
@@ -8855,3 +8857,250 @@ TEST_F(DictionaryTest, RecursiveAccessSetValue) {
     // false values
     ASSERT_THROW(d.setValue("e.g.a", 1), ghoul::Dictionary::KeyError);
 }
+
+TEST_F(DictionaryTest, ManyKeys) {
+    ghoul::Dictionary d;
+    // Insert the keys in a scrambled order to exercise the sorted insertion
+    const int n = 1000;
+    for (int i = 0; i < n; ++i) {
+        const int k = (i * 7919) % n;
+        d.setValue(std::to_string(k), k);
+    }
+    ASSERT_EQ(static_cast<size_t>(n), d.size());
+
+    // Overwriting an existing key must not add a new entry
+    d.setValue("500", -500);
+    ASSERT_EQ(static_cast<size_t>(n), d.size());
+    EXPECT_EQ(-500, d.value<int>("500"));
+
+    const std::vector<std::string> keys = d.keys();
+    EXPECT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+    for (int i = 0; i < n; i += 37) {
+        if (i != 500) {
+            EXPECT_EQ(i, d.value<int>(std::to_string(i))) << "key " << i;
+        }
+    }
+
+    for (int i = 0; i < n; i += 2) {
+        EXPECT_TRUE(d.removeKey(std::to_string(i)));
+    }
+    EXPECT_FALSE(d.removeKey("0"));
+    ASSERT_EQ(static_cast<size_t>(n / 2), d.size());
+    EXPECT_FALSE(d.hasKey("2"));
+    EXPECT_TRUE(d.hasKey("3"));
+    EXPECT_EQ(3, d.value<int>("3"));
+}
+
+TEST_F(DictionaryTest, DictionaryKey) {
+    ghoul::Dictionary d = { { "a", 1 } };
+    ghoul::Dictionary e = { { "b", 2.0 }, { "s", std::string("abc") } };
+    e.setValue("v", glm::dvec3(1.0, 2.0, 3.0));
+    d.setValue("e", e);
+
+    const ghoul::DictionaryKey a("a");
+    const ghoul::DictionaryKey eb("e.b");
+    const ghoul::DictionaryKey es("e.s");
+    const ghoul::DictionaryKey ev("e.v");
+    ASSERT_EQ(2u, eb.segments().size());
+    EXPECT_EQ("e", eb.segments()[0]);
+    EXPECT_EQ("b", eb.segments()[1]);
+    EXPECT_EQ("e.b", eb.key());
+
+    EXPECT_TRUE(d.hasKey(a));
+    EXPECT_TRUE(d.hasKey(eb));
+    EXPECT_TRUE(d.hasKeyAndValue<double>(eb));
+    EXPECT_TRUE(d.hasValue<float>(eb));
+    EXPECT_FALSE(d.hasValue<std::string>(eb));
+    EXPECT_EQ(1, d.value<int>(a));
+    EXPECT_EQ(2.0, d.value<double>(eb));
+    EXPECT_EQ("abc", d.value<std::string>(es));
+    EXPECT_EQ(glm::dvec3(1.0, 2.0, 3.0), d.value<glm::dvec3>(ev));
+
+    ghoul::Dictionary sub;
+    EXPECT_TRUE(d.getValue(ghoul::DictionaryKey("e"), sub));
+    EXPECT_EQ(3u, sub.size());
+
+    // The same key can be used for multiple Dictionaries
+    EXPECT_EQ(2.0, e.value<double>(ghoul::DictionaryKey("b")));
+
+    // false values
+    const ghoul::DictionaryKey missing("e.c");
+    const ghoul::DictionaryKey missingParent("f.b");
+    const ghoul::DictionaryKey notADictionary("a.b");
+    EXPECT_FALSE(d.hasKey(missing));
+    EXPECT_FALSE(d.hasKey(missingParent));
+    EXPECT_FALSE(d.hasKey(notADictionary));
+    EXPECT_FALSE(d.hasKeyAndValue<double>(missingParent));
+    double value = -1.0;
+    EXPECT_FALSE(d.getValue(missingParent, value));
+    EXPECT_FALSE(d.getValue(es, value));
+    EXPECT_EQ(-1.0, value);
+    EXPECT_THROW(d.value<double>(missing), ghoul::Dictionary::KeyError);
+    EXPECT_THROW(d.value<double>(missingParent), ghoul::Dictionary::KeyError);
+    EXPECT_THROW(d.value<double>(es), ghoul::Dictionary::ConversionError);
+}
+
+TEST_F(DictionaryTest, NumberedArray) {
+    // Numbered keys do not arrive in sorted order ("10" < "9"), which must not make
+    // filling a large array quadratic
+    ghoul::Dictionary d;
+    const int n = 200000;
+    for (int i = 1; i <= n; ++i) {
+        d.setValue(std::to_string(i), i);
+    }
+
+    // Overwriting keys before the entries were read again, the last value wins
+    d.setValue("10", -1);
+    d.setValue("10", -10);
+    d.setValue("1", -1);
+
+    // A copy that shares the unsorted entries must see the same values
+    const ghoul::Dictionary copy = d;
+    d.setValue("0", 0);
+
+    ASSERT_EQ(static_cast<size_t>(n + 1), d.size());
+    ASSERT_EQ(static_cast<size_t>(n), copy.size());
+    EXPECT_EQ(-1, d.value<int>("1"));
+    EXPECT_EQ(-10, d.value<int>("10"));
+    EXPECT_EQ(-10, copy.value<int>("10"));
+    EXPECT_EQ(0, d.value<int>("0"));
+    EXPECT_FALSE(copy.hasKey("0"));
+    for (int i = 11; i <= n; i += 997) {
+        EXPECT_EQ(i, d.value<int>(std::to_string(i))) << "key " << i;
+        EXPECT_EQ(i, copy.value<int>(std::to_string(i))) << "key " << i;
+    }
+
+    const std::vector<std::string> keys = copy.keys();
+    EXPECT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+    EXPECT_EQ(keys.end(), std::adjacent_find(keys.begin(), keys.end()));
+}
+
+TEST_F(DictionaryTest, CopyOnWrite) {
+    ghoul::Dictionary d;
+    d.setValue("a", 1);
+    d.setValue("b.c.d", 2, ghoul::Dictionary::CreateIntermediate::Yes);
+    d.setValue("b.e.f", 3, ghoul::Dictionary::CreateIntermediate::Yes);
+
+    // Modifying a copy must not change the original at any level
+    ghoul::Dictionary copy = d;
+    copy.setValue("a", 10);
+    copy.setValue("b.c.d", 20);
+    copy.setValue("b.c.g", 30);
+    EXPECT_EQ(1, d.value<int>("a"));
+    EXPECT_EQ(2, d.value<int>("b.c.d"));
+    EXPECT_FALSE(d.hasKey("b.c.g"));
+    EXPECT_EQ(3, d.value<int>("b.e.f"));
+    EXPECT_EQ(10, copy.value<int>("a"));
+    EXPECT_EQ(20, copy.value<int>("b.c.d"));
+    EXPECT_EQ(30, copy.value<int>("b.c.g"));
+
+    // Modifying the original must not change a subtree that was retrieved before
+    ghoul::Dictionary sub = d.value<ghoul::Dictionary>("b");
+    d.setValue("b.e.f", 4);
+    d.removeKey("a");
+    EXPECT_EQ(3, sub.value<int>("e.f"));
+    EXPECT_EQ(4, d.value<int>("b.e.f"));
+    EXPECT_FALSE(d.hasKey("a"));
+
+    // Clearing a copy leaves the original intact
+    ghoul::Dictionary cleared = d;
+    cleared.clear();
+    EXPECT_TRUE(cleared.empty());
+    EXPECT_EQ(1u, d.size());
+    cleared.setValue("x", 5);
+    EXPECT_FALSE(d.hasKey("x"));
+}
+
+TEST_F(DictionaryTest, ConcurrentCopies) {
+    ghoul::Dictionary d;
+    const int n = 5000;
+    for (int i = n; i > 0; --i) {
+        d.setValue(std::to_string(i), i);
+    }
+
+    // All copies share the unsorted entries, which the first reader has to sort, while
+    // the original is modified concurrently
+    std::vector<std::thread> threads;
+    std::vector<int> sums(4, 0);
+    for (size_t t = 0; t < sums.size(); ++t) {
+        threads.emplace_back([copy = ghoul::Dictionary(d), &sum = sums[t]]() {
+            for (int i = 1; i <= n; ++i) {
+                sum += copy.value<int>(std::to_string(i)) == i ? 1 : 0;
+            }
+        });
+    }
+    for (int i = 1; i <= n; ++i) {
+        d.setValue(std::to_string(i), -i);
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    for (int sum : sums) {
+        EXPECT_EQ(n, sum);
+    }
+    EXPECT_EQ(-1, d.value<int>("1"));
+    EXPECT_EQ(static_cast<size_t>(n), d.size());
+}
+
+TEST_F(DictionaryTest, FindValue) {
+    ghoul::Dictionary d = {
+        { "a", 1 },
+        { "b", 2.0 },
+        { "s", std::string("abc") }
+    };
+    d.setValue("e.f", std::string("def"), ghoul::Dictionary::CreateIntermediate::Yes);
+    d.setValue("e.g", glm::dvec2(1.0, 2.0));
+
+    const std::string* s = d.findValue<std::string>("s");
+    ASSERT_NE(nullptr, s);
+    EXPECT_EQ("abc", *s);
+    // The pointer refers to the stored value rather than to a copy
+    EXPECT_EQ(s, d.findValue<std::string>("s"));
+
+    const double* b = d.findValue<double>("b");
+    ASSERT_NE(nullptr, b);
+    EXPECT_EQ(2.0, *b);
+
+    const long long* a = d.findValue<long long>("a");
+    ASSERT_NE(nullptr, a);
+    EXPECT_EQ(1, *a);
+
+    const ghoul::Dictionary* e = d.findValue<ghoul::Dictionary>("e");
+    ASSERT_NE(nullptr, e);
+    EXPECT_EQ(2u, e->size());
+    EXPECT_EQ(e->findValue<std::string>("f"), d.findValue<std::string>("e.f"));
+    EXPECT_EQ(
+        d.findValue<std::string>("e.f"),
+        d.findValue<std::string>(ghoul::DictionaryKey("e.f"))
+    );
+
+    const std::array<double, 2>* g = d.findValue<std::array<double, 2>>("e.g");
+    ASSERT_NE(nullptr, g);
+    EXPECT_EQ(2.0, (*g)[1]);
+
+    // false values
+    EXPECT_EQ(nullptr, d.findValue<std::string>("b"));
+    EXPECT_EQ(nullptr, d.findValue<double>("c"));
+    EXPECT_EQ(nullptr, d.findValue<double>("e.c"));
+    EXPECT_EQ(nullptr, d.findValue<double>("a.c"));
+    EXPECT_EQ(nullptr, d.findValue<double>(ghoul::DictionaryKey("x.y")));
+    EXPECT_EQ(nullptr, d.findValue<std::string>(ghoul::DictionaryKey("e.g")));
+}
+
+TEST_F(DictionaryTest, Iteration) {
+    ghoul::Dictionary empty;
+    EXPECT_EQ(empty.begin(), empty.end());
+
+    ghoul::Dictionary d = { { "c", 3 }, { "a", 1 }, { "b", 2 } };
+    std::vector<std::string> keys;
+    long long sum = 0;
+    for (const std::pair<std::string, ghoul::any>& p : d) {
+        keys.push_back(p.first);
+        const long long* v = ghoul::any_cast<long long>(&p.second);
+        ASSERT_NE(nullptr, v);
+        sum += *v;
+    }
+    EXPECT_EQ(d.keys(), keys);
+    EXPECT_EQ(6, sum);
+}
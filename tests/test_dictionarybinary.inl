@@ -0,0 +1,202 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include <ghoul/misc/dictionarybinary.h>
+#include <ghoul/glm.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+class DictionaryBinaryTest : public testing::Test {
+protected:
+    DictionaryBinaryTest() {
+        _dict.setValue("Bool", true);
+        _dict.setValue("Int", -5);
+        _dict.setValue("Unsigned", 7u);
+        _dict.setValue("Double", 1.5);
+        _dict.setValue("String", std::string("string"));
+        _dict.setValue("Literal", "literal");
+        _dict.setValue("Vec3", glm::vec3(1.f, 2.f, 3.f));
+        _dict.setValue("IVec2", glm::ivec2(-1, 2));
+        _dict.setValue("UVec4", glm::uvec4(1, 2, 3, 4));
+        _dict.setValue("DMat4", glm::dmat4(2.0));
+        _dict.setValue("Mat2x3", glm::mat2x3(3.f));
+        _dict.setValue(
+            "Nested.Value",
+            10,
+            ghoul::Dictionary::CreateIntermediate::Yes
+        );
+        _dict.setValue(
+            "Nested.Deeper.Value",
+            std::string("deep"),
+            ghoul::Dictionary::CreateIntermediate::Yes
+        );
+        _dict.setValue("Empty", ghoul::Dictionary());
+    }
+
+    void checkContent(const ghoul::Dictionary& d) {
+        EXPECT_EQ(_dict.keys(), d.keys());
+        EXPECT_EQ(true, d.value<bool>("Bool"));
+        EXPECT_EQ(-5, d.value<int>("Int"));
+        EXPECT_EQ(7u, d.value<unsigned int>("Unsigned"));
+        EXPECT_EQ(1.5, d.value<double>("Double"));
+        EXPECT_EQ("string", d.value<std::string>("String"));
+        EXPECT_EQ("literal", d.value<std::string>("Literal"));
+        EXPECT_EQ(glm::vec3(1.f, 2.f, 3.f), d.value<glm::vec3>("Vec3"));
+        EXPECT_EQ(glm::ivec2(-1, 2), d.value<glm::ivec2>("IVec2"));
+        EXPECT_EQ(glm::uvec4(1, 2, 3, 4), d.value<glm::uvec4>("UVec4"));
+        EXPECT_EQ(glm::dmat4(2.0), d.value<glm::dmat4>("DMat4"));
+        EXPECT_EQ(glm::mat2x3(3.f), d.value<glm::mat2x3>("Mat2x3"));
+        EXPECT_EQ(10, d.value<int>("Nested.Value"));
+        EXPECT_EQ("deep", d.value<std::string>("Nested.Deeper.Value"));
+        EXPECT_TRUE(d.value<ghoul::Dictionary>("Empty").empty());
+    }
+
+    ghoul::Dictionary _dict;
+};
+
+TEST_F(DictionaryBinaryTest, RoundTrip) {
+    ghoul::Buffer buffer;
+    buffer.serialize(std::string("before"));
+    ghoul::serializeDictionary(_dict, buffer);
+    buffer.serialize(42);
+
+    std::string before;
+    buffer.deserialize(before);
+    EXPECT_EQ("before", before);
+    ghoul::Dictionary d = ghoul::deserializeDictionary(buffer);
+    int after = 0;
+    buffer.deserialize(after);
+    EXPECT_EQ(42, after);
+
+    checkContent(d);
+}
+
+TEST_F(DictionaryBinaryTest, UnsupportedType) {
+    struct Unsupported {};
+    ghoul::Dictionary d;
+    d.setValue("A.B", Unsupported(), ghoul::Dictionary::CreateIntermediate::Yes);
+
+    ghoul::Buffer buffer;
+    EXPECT_THROW(
+        ghoul::serializeDictionary(d, buffer),
+        ghoul::DictionaryBinaryError
+    );
+}
+
+TEST_F(DictionaryBinaryTest, Malformed) {
+    ghoul::Buffer buffer;
+    ghoul::serializeDictionary(_dict, buffer);
+
+    // Overwrite the magic bytes that follow the length
+    buffer.data()[sizeof(uint64_t)] = 'X';
+    EXPECT_THROW(ghoul::deserializeDictionary(buffer), ghoul::DictionaryBinaryError);
+
+    // Point the offset of the first key outside of the data
+    ghoul::Buffer truncated;
+    ghoul::serializeDictionary(_dict, truncated);
+    const size_t table = sizeof(uint64_t) + 8 + sizeof(uint64_t);
+    uint64_t offset = truncated.size();
+    std::memcpy(truncated.data() + table, &offset, sizeof(uint64_t));
+    EXPECT_THROW(ghoul::deserializeDictionary(truncated), ghoul::DictionaryBinaryError);
+
+    // A length that exceeds the bytes that are left in the Buffer
+    ghoul::Buffer tooLong;
+    ghoul::serializeDictionary(_dict, tooLong);
+    const uint64_t length = std::numeric_limits<uint64_t>::max();
+    std::memcpy(tooLong.data(), &length, sizeof(uint64_t));
+    EXPECT_THROW(ghoul::deserializeDictionary(tooLong), ghoul::DictionaryBinaryError);
+
+    ghoul::Buffer empty;
+    EXPECT_THROW(ghoul::deserializeDictionary(empty), ghoul::DictionaryBinaryError);
+
+    // A count for which the offsets of the records would wrap around
+    ghoul::Buffer tooMany;
+    ghoul::serializeDictionary(_dict, tooMany);
+    const uint64_t count = uint64_t(1) << 59;
+    std::memcpy(tooMany.data() + sizeof(uint64_t) + 8, &count, sizeof(uint64_t));
+    EXPECT_THROW(ghoul::deserializeDictionary(tooMany), ghoul::DictionaryBinaryError);
+
+    // A compressed file whose data ends early, so that only the beginning of the
+    // serialized Dictionary, including its valid header, can be decompressed
+    _dict.setValue("Padding", std::string(4096, 'x'));
+    ghoul::Buffer compressed;
+    ghoul::serializeDictionary(_dict, compressed);
+    compressed.write("corrupt.bin", ghoul::Buffer::Compress::Yes);
+    {
+        std::fstream file("corrupt.bin", std::ios::binary | std::ios::in | std::ios::out);
+        file.seekg(sizeof(bool) + sizeof(size_t));
+        size_t size;
+        file.read(reinterpret_cast<char*>(&size), sizeof(size_t));
+        size /= 2;
+        file.seekp(sizeof(bool) + sizeof(size_t));
+        file.write(reinterpret_cast<const char*>(&size), sizeof(size_t));
+    }
+    EXPECT_THROW(ghoul::MappedDictionary("corrupt.bin"), ghoul::DictionaryBinaryError);
+    std::remove("corrupt.bin");
+}
+
+TEST_F(DictionaryBinaryTest, MappedView) {
+    for (ghoul::Buffer::Compress compress :
+        { ghoul::Buffer::Compress::No, ghoul::Buffer::Compress::Yes })
+    {
+        {
+            ghoul::Buffer buffer;
+            ghoul::serializeDictionary(_dict, buffer);
+            buffer.write("dictionary.bin", compress);
+        }
+
+        ghoul::MappedDictionary mapped("dictionary.bin");
+        ghoul::DictionaryView view = mapped.view();
+        EXPECT_EQ(_dict.size(), view.size());
+        EXPECT_EQ(_dict.keys(), view.keys());
+        EXPECT_TRUE(view.hasKey("Nested.Deeper.Value"));
+        EXPECT_FALSE(view.hasKey("Nested.Missing"));
+        EXPECT_FALSE(view.hasKey("Int.Value"));
+
+        int i = 0;
+        EXPECT_TRUE(view.getValue("Int", i));
+        EXPECT_EQ(-5, i);
+        glm::dmat4 m;
+        EXPECT_TRUE(view.getValue("DMat4", m));
+        EXPECT_EQ(glm::dmat4(2.0), m);
+        std::string s;
+        EXPECT_FALSE(view.getValue("Int", s));
+        EXPECT_FALSE(view.getValue("Missing", s));
+        EXPECT_TRUE(view.getValue("Nested.Deeper.Value", s));
+        EXPECT_EQ("deep", s);
+
+        ghoul::DictionaryView nested = view.view("Nested");
+        EXPECT_EQ(2, nested.size());
+        EXPECT_EQ(10, nested.materialize().value<int>("Value"));
+        EXPECT_TRUE(view.view("Empty").empty());
+        EXPECT_THROW(view.view("Missing"), ghoul::Dictionary::KeyError);
+        EXPECT_THROW(view.view("Int"), ghoul::Dictionary::ConversionError);
+
+        checkContent(view.materialize());
+    }
+    std::remove("dictionary.bin");
+}
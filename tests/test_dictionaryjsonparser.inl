@@ -0,0 +1,175 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include <ghoul/misc/dictionaryjsonparser.h>
+#include <ghoul/misc/dictionary.h>
+
+class DictionaryJsonParserTest : public testing::Test {
+protected:
+    // Returns the line and column of the error in the document, or (0, 0) if the
+    // document could be parsed
+    std::pair<size_t, size_t> errorLocation(const std::string& json) {
+        try {
+            _parser.parse(json);
+        }
+        catch (const ghoul::DictionaryJsonParser::JsonParsingError& e) {
+            return { e.line, e.column };
+        }
+        return { 0, 0 };
+    }
+
+    ghoul::DictionaryJsonParser _parser;
+};
+
+TEST_F(DictionaryJsonParserTest, Values) {
+    ghoul::Dictionary d = _parser.parse(
+        "{ \"string\": \"value\", \"int\": 5, \"negative\": -2.5e-3, \"big\": 1e300,"
+        "\"precise\": 0.1, \"true\": true, \"false\": false, \"null\": null,"
+        "\"nested\": { \"a\": { \"b\": \"c\" } }, \"empty\": {} }"
+    );
+
+    EXPECT_EQ(9, d.size());
+    EXPECT_EQ("value", d.value<std::string>("string"));
+    EXPECT_EQ(5.0, d.value<double>("int"));
+    EXPECT_EQ(-2.5e-3, d.value<double>("negative"));
+    EXPECT_EQ(1e300, d.value<double>("big"));
+    EXPECT_EQ(0.1, d.value<double>("precise"));
+    EXPECT_EQ(true, d.value<bool>("true"));
+    EXPECT_EQ(false, d.value<bool>("false"));
+    EXPECT_FALSE(d.hasKey("null"));
+    EXPECT_EQ("c", d.value<std::string>("nested.a.b"));
+    EXPECT_TRUE(d.value<ghoul::Dictionary>("empty").empty());
+}
+
+TEST_F(DictionaryJsonParserTest, Arrays) {
+    ghoul::Dictionary d = _parser.parse(
+        "{\"vec\":[1,2,3],\"mixed\":[\"a\",null,[true]],\"empty\":[]}"
+    );
+
+    // Arrays use the same numbered keys as Lua tables, so vectors can be converted
+    EXPECT_EQ(glm::vec3(1.f, 2.f, 3.f), d.value<glm::vec3>("vec"));
+    EXPECT_EQ("a", d.value<std::string>("mixed.1"));
+    EXPECT_FALSE(d.hasKey("mixed.2"));
+    EXPECT_EQ(true, d.value<bool>("mixed.3.1"));
+    EXPECT_TRUE(d.value<ghoul::Dictionary>("empty").empty());
+
+    ghoul::Dictionary top = _parser.parse("[ {\"a\": 1}, 2 ]");
+    EXPECT_EQ(1.0, top.value<double>("1.a"));
+    EXPECT_EQ(2.0, top.value<double>("2"));
+}
+
+TEST_F(DictionaryJsonParserTest, Strings) {
+    ghoul::Dictionary d = _parser.parse(
+        "{\"escapes\":\"a\\\"b\\\\c\\/d\\n\\t\","
+        "\"unicode\":\"\\u00e4\\u20AC\\ud83d\\ude00\","
+        "\"long\":\"0123456789abcdefghijklmnopqrstuvwxyz\\n0123456789abcdefghijk\"}"
+    );
+
+    EXPECT_EQ("a\"b\\c/d\n\t", d.value<std::string>("escapes"));
+    EXPECT_EQ("\xc3\xa4\xe2\x82\xac\xf0\x9f\x98\x80", d.value<std::string>("unicode"));
+    EXPECT_EQ(
+        "0123456789abcdefghijklmnopqrstuvwxyz\n0123456789abcdefghijk",
+        d.value<std::string>("long")
+    );
+}
+
+TEST_F(DictionaryJsonParserTest, DeepNesting) {
+    struct DepthCounter : public ghoul::DictionaryJsonParser::Handler {
+        void startObject() override {}
+        void endObject() override {}
+        void startArray() override { maxDepth = std::max(maxDepth, ++depth); }
+        void endArray() override { --depth; }
+        void key(const char*, size_t) override {}
+        void stringValue(const char*, size_t) override {}
+        void numberValue(double) override {}
+        void booleanValue(bool) override {}
+        void nullValue() override {}
+
+        int depth = 0;
+        int maxDepth = 0;
+    };
+
+    // The parser does not use recursion, so the depth is not limited by the stack
+    const int Depth = 1000000;
+    std::string json = std::string(Depth, '[') + std::string(Depth, ']');
+    DepthCounter counter;
+    _parser.parse(json.data(), json.size(), counter);
+    EXPECT_EQ(Depth, counter.maxDepth);
+    EXPECT_EQ(0, counter.depth);
+
+    std::string nested = std::string(100, '[') + "1" + std::string(100, ']');
+    ghoul::Dictionary d = _parser.parse(nested);
+    std::string key = "1";
+    for (int i = 0; i < 99; ++i) {
+        key += ".1";
+    }
+    EXPECT_EQ(1.0, d.value<double>(key));
+}
+
+TEST_F(DictionaryJsonParserTest, ErrorLocations) {
+    using Location = std::pair<size_t, size_t>;
+    EXPECT_EQ(Location(0, 0), errorLocation("{\"a\": 1}"));
+    EXPECT_EQ(Location(1, 1), errorLocation(""));
+    EXPECT_EQ(Location(1, 9), errorLocation("{\"a\": 1 \"b\": 2}"));
+    EXPECT_EQ(Location(2, 8), errorLocation("{\n  \"a\": tru\n}"));
+    EXPECT_EQ(Location(3, 8), errorLocation("{\n\"a\":\n  \"open\n}"));
+    EXPECT_EQ(Location(1, 7), errorLocation("{\"a\": \"open"));
+    EXPECT_EQ(Location(1, 7), errorLocation("{\"a\": 01}"));
+    EXPECT_EQ(Location(1, 8), errorLocation("{\"a\": \"\\x\"}"));
+    EXPECT_EQ(Location(1, 10), errorLocation("{\"a\": 1} x"));
+    EXPECT_EQ(Location(1, 2), errorLocation("{1: 2}"));
+    EXPECT_EQ(Location(1, 6), errorLocation("[1, 2"));
+
+    // Errors reported while building the Dictionary
+    EXPECT_EQ(Location(1, 1), errorLocation("5"));
+    EXPECT_EQ(Location(1, 2), errorLocation("{\"a.b\": 1}"));
+    EXPECT_EQ(Location(1, 2), errorLocation("{\"\": 1}"));
+}
+
+TEST_F(DictionaryJsonParserTest, Handler) {
+    struct Recorder : public ghoul::DictionaryJsonParser::Handler {
+        void startObject() override { events += "{"; }
+        void endObject() override { events += "}"; }
+        void startArray() override { events += "["; }
+        void endArray() override { events += "]"; }
+        void key(const char* key, size_t length) override {
+            events += std::string(key, length) + ":";
+        }
+        void stringValue(const char* value, size_t length) override {
+            events += "'" + std::string(value, length) + "'";
+        }
+        void numberValue(double value) override { events += std::to_string(value); }
+        void booleanValue(bool value) override { events += value ? "T" : "F"; }
+        void nullValue() override { events += "N"; }
+
+        std::string events;
+    };
+
+    Recorder recorder;
+    const std::string json = "{\"a\":[1.5,\"s\",true,null],\"b\":{}} trailing";
+    // Only parse the document without the trailing text
+    _parser.parse(json.data(), json.find(' '), recorder);
+    EXPECT_EQ("{a:[1.500000's'TN]b:{}}", recorder.events);
+}
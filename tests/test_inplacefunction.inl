@@ -0,0 +1,140 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include <ghoul/misc/inplacefunction.h>
+
+#include <array>
+#include <memory>
+#include <string>
+
+namespace {
+    // Counts the number of living instances to detect leaks and double destructions
+    struct InstanceCounter {
+        explicit InstanceCounter(int& c) : counter(&c) { ++(*counter); }
+        InstanceCounter(const InstanceCounter& other) : counter(other.counter) {
+            ++(*counter);
+        }
+        InstanceCounter(InstanceCounter&& other) noexcept : counter(other.counter) {
+            ++(*counter);
+        }
+        ~InstanceCounter() { --(*counter); }
+
+        int* counter;
+    };
+} // namespace
+
+class InplaceFunctionTest : public testing::Test {};
+
+TEST_F(InplaceFunctionTest, Empty) {
+    ghoul::InplaceFunction<void()> f;
+    EXPECT_FALSE(f);
+
+    ghoul::InplaceFunction<void()> g = nullptr;
+    EXPECT_FALSE(g);
+}
+
+TEST_F(InplaceFunctionTest, CallWithArguments) {
+    ghoul::InplaceFunction<int(int, int)> f = [](int a, int b) { return a + b; };
+    ASSERT_TRUE(f);
+    EXPECT_TRUE(f.isStoredInplace());
+    EXPECT_EQ(5, f(2, 3));
+
+    int value = 0;
+    ghoul::InplaceFunction<void(int&)> g = [](int& v) { v = 42; };
+    g(value);
+    EXPECT_EQ(42, value);
+
+    std::string s = "foo";
+    ghoul::InplaceFunction<std::string(std::string)> h = [s](std::string t) {
+        return s + t;
+    };
+    EXPECT_EQ("foobar", h("bar"));
+}
+
+TEST_F(InplaceFunctionTest, MoveOnly) {
+    auto ptr = std::make_unique<int>(5);
+    ghoul::InplaceFunction<int()> f = [p = std::move(ptr)]() { return *p; };
+    EXPECT_TRUE(f.isStoredInplace());
+    EXPECT_EQ(5, f());
+
+    ghoul::InplaceFunction<int()> g = std::move(f);
+    EXPECT_FALSE(f);
+    ASSERT_TRUE(g);
+    EXPECT_EQ(5, g());
+
+    ghoul::InplaceFunction<int()> h;
+    h = std::move(g);
+    EXPECT_FALSE(g);
+    EXPECT_EQ(5, h());
+}
+
+TEST_F(InplaceFunctionTest, HeapFallback) {
+    std::array<int, 64> values;
+    values.fill(1);
+    ghoul::InplaceFunction<int()> f = [values]() {
+        int sum = 0;
+        for (int v : values) {
+            sum += v;
+        }
+        return sum;
+    };
+    EXPECT_FALSE(f.isStoredInplace());
+    EXPECT_EQ(64, f());
+
+    ghoul::InplaceFunction<int()> g = std::move(f);
+    EXPECT_FALSE(f);
+    EXPECT_EQ(64, g());
+
+    using Small = ghoul::InplaceFunction<int(), 16>;
+    EXPECT_TRUE((Small::fitsInplace<std::array<char, 16>>()));
+    EXPECT_FALSE((Small::fitsInplace<std::array<char, 17>>()));
+}
+
+TEST_F(InplaceFunctionTest, Lifetime) {
+    int nInstances = 0;
+    {
+        InstanceCounter c(nInstances);
+        ghoul::InplaceFunction<void()> f = [c]() {};
+        EXPECT_EQ(2, nInstances);
+
+        ghoul::InplaceFunction<void()> g = std::move(f);
+        EXPECT_EQ(2, nInstances);
+
+        g = [c]() {};
+        EXPECT_EQ(2, nInstances);
+
+        std::array<char, 128> large = {};
+        ghoul::InplaceFunction<void()> h = [c, large]() {};
+        EXPECT_FALSE(h.isStoredInplace());
+        EXPECT_EQ(3, nInstances);
+        g = std::move(h);
+        EXPECT_EQ(2, nInstances);
+        g = nullptr;
+        EXPECT_EQ(1, nInstances);
+    }
+    EXPECT_EQ(0, nInstances);
+}
@@ -0,0 +1,167 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include <ghoul/misc/mainthreadexecutor.h>
+#include <ghoul/misc/threadpool.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+class MainThreadExecutorTest : public testing::Test {};
+
+TEST_F(MainThreadExecutorTest, Order) {
+    ghoul::MainThreadExecutor executor;
+    EXPECT_FALSE(executor.hasPendingTasks());
+    EXPECT_EQ(0, executor.pump());
+
+    std::vector<int> order;
+    for (int i = 0; i < 10; ++i) {
+        executor.post([&order, i]() { order.push_back(i); });
+    }
+    std::future<int> f = executor.queue([](int a, int b) { return a + b; }, 1, 2);
+    EXPECT_TRUE(executor.hasPendingTasks());
+
+    EXPECT_EQ(11, executor.pump());
+    EXPECT_FALSE(executor.hasPendingTasks());
+    EXPECT_EQ(3, f.get());
+    ASSERT_EQ(10, order.size());
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(i, order[i]);
+    }
+}
+
+TEST_F(MainThreadExecutorTest, MultipleProducers) {
+    ghoul::MainThreadExecutor executor;
+    const std::thread::id mainThread = std::this_thread::get_id();
+
+    constexpr const int nThreads = 4;
+    constexpr const int nTasks = 1000;
+    std::atomic_int nWrongThread(0);
+    std::vector<std::vector<int>> results(nThreads);
+    {
+        ghoul::ThreadPool pool(nThreads);
+        for (int i = 0; i < nThreads; ++i) {
+            pool.post([&, i]() {
+                for (int j = 0; j < nTasks; ++j) {
+                    executor.post([&, i, j]() {
+                        if (std::this_thread::get_id() != mainThread) {
+                            ++nWrongThread;
+                        }
+                        results[i].push_back(j);
+                    });
+                }
+            });
+        }
+
+        // Pumping while the tasks are produced
+        int nExecuted = 0;
+        while (nExecuted < nThreads * nTasks) {
+            nExecuted += executor.pump(std::chrono::microseconds(100));
+        }
+    }
+
+    EXPECT_EQ(0, nWrongThread);
+    for (const std::vector<int>& r : results) {
+        // The tasks of each producer are executed in the order in which they were queued
+        ASSERT_EQ(nTasks, r.size());
+        for (int j = 0; j < nTasks; ++j) {
+            EXPECT_EQ(j, r[j]);
+        }
+    }
+}
+
+TEST_F(MainThreadExecutorTest, TimeBudget) {
+    ghoul::MainThreadExecutor executor;
+    int nExecuted = 0;
+    for (int i = 0; i < 10; ++i) {
+        executor.post([&nExecuted]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            ++nExecuted;
+        });
+    }
+
+    // The budget is exhausted after the first task, but at least one task is executed
+    EXPECT_EQ(1, executor.pump(std::chrono::microseconds(0)));
+    EXPECT_EQ(1, nExecuted);
+
+    const int n = executor.pump(std::chrono::milliseconds(12));
+    EXPECT_LE(1, n);
+    EXPECT_GE(3, n);
+    EXPECT_EQ(1 + n, nExecuted);
+
+    executor.pump();
+    EXPECT_EQ(10, nExecuted);
+    EXPECT_FALSE(executor.hasPendingTasks());
+}
+
+TEST_F(MainThreadExecutorTest, TasksQueuedDuringPump) {
+    ghoul::MainThreadExecutor executor;
+    int nExecuted = 0;
+    executor.post([&executor, &nExecuted]() {
+        ++nExecuted;
+        executor.post([&nExecuted]() { ++nExecuted; });
+    });
+
+    // The task queued by the first task is only executed by the next pump
+    EXPECT_EQ(1, executor.pump());
+    EXPECT_TRUE(executor.hasPendingTasks());
+    EXPECT_EQ(1, executor.pump());
+    EXPECT_EQ(2, nExecuted);
+}
+
+TEST_F(MainThreadExecutorTest, Exception) {
+    ghoul::MainThreadExecutor executor;
+    std::future<int> f = executor.queue([]() -> int { throw std::runtime_error("a"); });
+    int nExecuted = 0;
+    executor.post([]() { throw std::runtime_error("b"); });
+    executor.post([&nExecuted]() { ++nExecuted; });
+
+    // The exception of the queued function is stored in the future
+    EXPECT_THROW(executor.pump(), std::runtime_error);
+    EXPECT_THROW(f.get(), std::runtime_error);
+    EXPECT_EQ(0, nExecuted);
+
+    EXPECT_EQ(1, executor.pump());
+    EXPECT_EQ(1, nExecuted);
+}
+
+TEST_F(MainThreadExecutorTest, BrokenPromise) {
+    std::future<int> f;
+    std::shared_ptr<int> resource = std::make_shared<int>(1);
+    {
+        ghoul::MainThreadExecutor executor;
+        f = executor.queue([]() { return 1; });
+        executor.post([resource]() {});
+        EXPECT_EQ(2, resource.use_count());
+    }
+    EXPECT_EQ(1, resource.use_count());
+    EXPECT_THROW(f.get(), std::future_error);
+}
@@ -0,0 +1,198 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include <ghoul/misc/parallel.h>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+class ParallelTest : public testing::Test {};
+
+TEST_F(ParallelTest, ParallelForVisitsAll) {
+    ghoul::ThreadPool pool(4);
+
+    std::vector<int> v(100000, 0);
+    ghoul::parallelFor(pool, size_t(0), v.size(), size_t(64), [&v](size_t i) {
+        v[i] += static_cast<int>(i);
+    });
+
+    for (size_t i = 0; i < v.size(); ++i) {
+        ASSERT_EQ(static_cast<int>(i), v[i]);
+    }
+}
+
+TEST_F(ParallelTest, ParallelForEmptyAndSmallRanges) {
+    ghoul::ThreadPool pool(4);
+
+    std::atomic_int counter(0);
+    ghoul::parallelFor(pool, 5, 5, 1, [&counter](int) { ++counter; });
+    EXPECT_EQ(0, counter);
+
+    ghoul::parallelFor(pool, 10, 5, 1, [&counter](int) { ++counter; });
+    EXPECT_EQ(0, counter);
+
+    ghoul::parallelFor(pool, 0, 3, 100, [&counter](int) { ++counter; });
+    EXPECT_EQ(3, counter);
+
+    ghoul::parallelFor(pool, -50, 50, 1, [&counter](int) { ++counter; });
+    EXPECT_EQ(103, counter);
+}
+
+TEST_F(ParallelTest, ParallelForUsesWorkers) {
+    ghoul::ThreadPool pool(4);
+
+    std::mutex idMutex;
+    std::vector<std::thread::id> ids;
+    ghoul::parallelFor(pool, 0, 256, 1, [&](int) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::lock_guard<std::mutex> lock(idMutex);
+        ids.push_back(std::this_thread::get_id());
+    });
+
+    ASSERT_EQ(256, static_cast<int>(ids.size()));
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    EXPECT_LT(1, static_cast<int>(ids.size()));
+}
+
+TEST_F(ParallelTest, ParallelForException) {
+    ghoul::ThreadPool pool(4);
+
+    std::atomic_int counter(0);
+    EXPECT_THROW(
+        ghoul::parallelFor(pool, 0, 10000, 10, [&counter](int i) {
+            ++counter;
+            if (i == 5000) {
+                throw std::runtime_error("foobar");
+            }
+        }),
+        std::runtime_error
+    );
+    EXPECT_GE(10000, counter);
+
+    // The pool has to be usable afterwards
+    std::future<int> f = pool.queue([]() { return 1337; });
+    EXPECT_EQ(1337, f.get());
+}
+
+TEST_F(ParallelTest, ParallelForFullPool) {
+    using OverflowPolicy = ghoul::ThreadPool::OverflowPolicy;
+    ghoul::ThreadPool pool(4);
+
+    // Block all Workers, so that the helpers that can be queued only start after
+    // parallelFor has returned
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic_int nStarted(0);
+    std::vector<std::future<void>> blockers;
+    for (int i = 0; i < 4; ++i) {
+        blockers.push_back(pool.queue([&nStarted, released]() {
+            ++nStarted;
+            released.wait();
+        }));
+    }
+    while (nStarted < 4) {
+        std::this_thread::yield();
+    }
+    pool.setCapacity(2, OverflowPolicy::Reject);
+
+    // Two helpers are queued before the third one is rejected. The calling thread has to
+    // process the whole range before the error is reported
+    std::vector<int> visited(1000, 0);
+    EXPECT_THROW(
+        ghoul::parallelFor(pool, 0, 1000, 10, [&visited](int i) { ++visited[i]; }),
+        ghoul::ThreadPool::QueueFullError
+    );
+    EXPECT_EQ(std::vector<int>(1000, 1), visited);
+
+    // The queued helpers do not find any work anymore
+    release.set_value();
+    for (std::future<void>& f : blockers) {
+        f.get();
+    }
+    pool.stop();
+    EXPECT_EQ(std::vector<int>(1000, 1), visited);
+}
+
+TEST_F(ParallelTest, ParallelForNestedInSingleWorker) {
+    // Calling parallelFor from inside the only Worker of a pool must not deadlock
+    ghoul::ThreadPool pool(1);
+
+    std::future<int> f = pool.queue([&pool]() {
+        std::atomic_int counter(0);
+        ghoul::parallelFor(pool, 0, 1000, 10, [&counter](int) { ++counter; });
+        return counter.load();
+    });
+
+    EXPECT_EQ(1000, f.get());
+}
+
+TEST_F(ParallelTest, ParallelReduce) {
+    ghoul::ThreadPool pool(4);
+
+    long long sum = ghoul::parallelReduce(
+        pool, 0, 100000, 128, 0LL,
+        [](int i) { return static_cast<long long>(i); },
+        [](long long a, long long b) { return a + b; }
+    );
+    EXPECT_EQ(100000LL * 99999LL / 2, sum);
+
+    int max = ghoul::parallelReduce(
+        pool, 0, 5000, 16, std::numeric_limits<int>::min(),
+        [](int i) { return (i * 7919) % 5000; },
+        [](int a, int b) { return std::max(a, b); }
+    );
+    EXPECT_EQ(4999, max);
+
+    int empty = ghoul::parallelReduce(
+        pool, 0, 0, 16, 42,
+        [](int i) { return i; },
+        [](int a, int b) { return a + b; }
+    );
+    EXPECT_EQ(42, empty);
+}
+
+TEST_F(ParallelTest, ParallelTransform) {
+    ghoul::ThreadPool pool(4);
+
+    std::vector<int> input(50000);
+    std::iota(input.begin(), input.end(), 0);
+    std::vector<double> output(input.size());
+
+    auto it = ghoul::parallelTransform(
+        pool, input.begin(), input.end(), output.begin(), 256,
+        [](int i) { return i * 0.5; }
+    );
+    EXPECT_TRUE(it == output.end());
+
+    for (size_t i = 0; i < input.size(); ++i) {
+        ASSERT_EQ(input[i] * 0.5, output[i]);
+    }
+}
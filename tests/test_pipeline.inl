@@ -0,0 +1,181 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include <ghoul/misc/pipeline.h>
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+    // Returns a source that produces the numbers 0 to n-1
+    auto counter(int n) {
+        return [n, i = 0](ghoul::Pipeline::FlowControl& fc) mutable {
+            if (i == n) {
+                fc.stop();
+                return 0;
+            }
+            return i++;
+        };
+    }
+} // namespace
+
+class PipelineTest : public testing::Test {};
+
+TEST_F(PipelineTest, SerialOrder) {
+    using Mode = ghoul::Pipeline::Mode;
+    ghoul::ThreadPool pool(4);
+
+    std::vector<std::string> result;
+    std::future<void> f = ghoul::makePipeline(pool, 8, counter(1000))
+        .then(Mode::Parallel, [](int i) { return i * 2; })
+        .then(Mode::Parallel, [](int i) { return std::to_string(i); })
+        .run(Mode::Serial, [&result](std::string s) { result.push_back(std::move(s)); });
+    f.get();
+
+    // The serial sink receives the items in the order in which they were produced
+    ASSERT_EQ(1000, result.size());
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_EQ(std::to_string(i * 2), result[i]);
+    }
+}
+
+TEST_F(PipelineTest, SerialStageInBetween) {
+    using Mode = ghoul::Pipeline::Mode;
+    ghoul::ThreadPool pool(4);
+
+    // A stateful serial stage sees the items in order and never concurrently
+    std::atomic_int nInside(0);
+    std::atomic_int sum(0);
+    std::future<void> f = ghoul::makePipeline(pool, 4, counter(500))
+        .then(Mode::Serial, [&nInside, expected = 0](int i) mutable {
+            EXPECT_EQ(1, ++nInside);
+            EXPECT_EQ(expected, i);
+            ++expected;
+            --nInside;
+            return i;
+        })
+        .run(Mode::Parallel, [&sum](int i) { sum += i; });
+    f.get();
+    EXPECT_EQ(500 * 499 / 2, sum);
+}
+
+TEST_F(PipelineTest, BoundedTokens) {
+    using Mode = ghoul::Pipeline::Mode;
+    ghoul::ThreadPool pool(8);
+
+    std::atomic_int nInFlight(0);
+    std::atomic_int nMaxInFlight(0);
+    std::atomic_int nProcessed(0);
+    std::future<void> f = ghoul::makePipeline(
+        pool,
+        3,
+        [&nInFlight, &nMaxInFlight, i = 0](ghoul::Pipeline::FlowControl& fc) mutable {
+            if (i == 200) {
+                fc.stop();
+                return 0;
+            }
+            const int n = ++nInFlight;
+            int m = nMaxInFlight;
+            while (n > m && !nMaxInFlight.compare_exchange_weak(m, n)) {}
+            return i++;
+        })
+        .then(Mode::Parallel, [](int i) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            return i;
+        })
+        .run(Mode::Serial, [&nInFlight, &nProcessed](int) {
+            --nInFlight;
+            ++nProcessed;
+        });
+    f.get();
+
+    EXPECT_EQ(200, nProcessed);
+    EXPECT_LE(nMaxInFlight, 3);
+}
+
+TEST_F(PipelineTest, EmptySource) {
+    ghoul::ThreadPool pool(1);
+    int nCalled = 0;
+    std::future<void> f = ghoul::makePipeline(pool, 2, counter(0))
+        .run(ghoul::Pipeline::Mode::Serial, [&nCalled](int) { ++nCalled; });
+    f.get();
+    EXPECT_EQ(0, nCalled);
+}
+
+TEST_F(PipelineTest, Exception) {
+    using Mode = ghoul::Pipeline::Mode;
+    ghoul::ThreadPool pool(2);
+
+    std::atomic_int nSink(0);
+    std::future<void> f = ghoul::makePipeline(pool, 4, counter(1000000))
+        .then(Mode::Parallel, [](int i) {
+            if (i == 10) {
+                throw std::runtime_error("Error");
+            }
+            return i;
+        })
+        .run(Mode::Serial, [&nSink](int) { ++nSink; });
+
+    // The source stops producing after the exception, so the pipeline finishes early
+    EXPECT_THROW(f.get(), std::runtime_error);
+    EXPECT_LE(nSink, 10);
+}
+
+TEST_F(PipelineTest, FullPool) {
+    using Mode = ghoul::Pipeline::Mode;
+    using OverflowPolicy = ghoul::ThreadPool::OverflowPolicy;
+    ghoul::ThreadPool pool(1);
+
+    std::promise<void> started;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic_int sum(0);
+    std::future<void> f = ghoul::makePipeline(pool, 2, counter(100))
+        .then(Mode::Parallel, [&started, released](int i) {
+            if (i == 0) {
+                started.set_value();
+                released.wait();
+            }
+            return i;
+        })
+        .run(Mode::Serial, [&sum](int i) { sum += i; });
+    started.get_future().wait();
+
+    // The task that produces the next item is already waiting. All further tasks are
+    // queued by the Worker while the queue is full
+    pool.setCapacity(2, OverflowPolicy::Reject);
+    std::future<int> waiting = pool.queue([]() { return 3; });
+    EXPECT_THROW(pool.post([]() {}), ghoul::ThreadPool::QueueFullError);
+
+    release.set_value();
+    f.get();
+    EXPECT_EQ(100 * 99 / 2, sum);
+    EXPECT_EQ(3, waiting.get());
+}
@@ -0,0 +1,177 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include <ghoul/misc/taskgraph.h>
+
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+class TaskGraphTest : public testing::Test {};
+
+TEST_F(TaskGraphTest, Empty) {
+    ghoul::ThreadPool pool(2);
+    ghoul::TaskGraph graph(pool);
+    EXPECT_EQ(0, graph.size());
+
+    ghoul::Continuable<void> c = graph.run();
+    EXPECT_TRUE(c.isReady());
+}
+
+TEST_F(TaskGraphTest, Chain) {
+    ghoul::ThreadPool pool(4);
+    ghoul::TaskGraph graph(pool);
+
+    std::mutex mutex;
+    std::vector<int> order;
+    auto f = [&](int i) {
+        return [&, i]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(i);
+        };
+    };
+
+    ghoul::TaskGraph::NodeId decode = graph.addTask(f(0));
+    ghoul::TaskGraph::NodeId convert = graph.addTask(f(1));
+    ghoul::TaskGraph::NodeId compress = graph.addTask(f(2));
+    ghoul::TaskGraph::NodeId write = graph.addTask(f(3));
+    graph.addDependency(compress, write);
+    graph.addDependency(decode, convert);
+    graph.addDependency(convert, compress);
+    EXPECT_EQ(4, graph.size());
+
+    graph.run().get();
+    ASSERT_EQ(4, order.size());
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(i, order[i]);
+    }
+
+    // Running the same graph again executes all tasks again
+    graph.run().get();
+    EXPECT_EQ(8, order.size());
+}
+
+TEST_F(TaskGraphTest, Diamond) {
+    ghoul::ThreadPool pool(4);
+    ghoul::TaskGraph graph(pool);
+
+    std::atomic_int a(0);
+    std::atomic_int b(0);
+    std::atomic_int c(0);
+    std::atomic_int d(0);
+    ghoul::TaskGraph::NodeId top = graph.addTask([&]() { a = 1; });
+    ghoul::TaskGraph::NodeId left = graph.addTask([&]() { b = a + 1; });
+    ghoul::TaskGraph::NodeId right = graph.addTask([&]() { c = a + 2; });
+    ghoul::TaskGraph::NodeId bottom = graph.addTask([&]() { d = b + c; });
+    graph.addDependency(top, left);
+    graph.addDependency(top, right);
+    graph.addDependency(left, bottom);
+    graph.addDependency(right, bottom);
+
+    graph.run().wait();
+    EXPECT_EQ(5, d);
+}
+
+TEST_F(TaskGraphTest, ManyRunsOnSingleWorker) {
+    ghoul::ThreadPool pool(1);
+    ghoul::TaskGraph graph(pool);
+
+    std::atomic_int counter(0);
+    ghoul::TaskGraph::NodeId root = graph.addTask([&counter]() { ++counter; });
+    for (int i = 0; i < 50; ++i) {
+        ghoul::TaskGraph::NodeId n = graph.addTask([&counter]() { ++counter; });
+        graph.addDependency(root, n);
+    }
+
+    std::vector<ghoul::Continuable<void>> runs;
+    for (int i = 0; i < 10; ++i) {
+        runs.push_back(graph.run());
+    }
+    ghoul::whenAll(runs).get();
+    EXPECT_EQ(510, counter);
+}
+
+TEST_F(TaskGraphTest, Exception) {
+    ghoul::ThreadPool pool(2);
+    ghoul::TaskGraph graph(pool);
+
+    std::atomic_bool called(false);
+    ghoul::TaskGraph::NodeId first = graph.addTask([]() {
+        throw std::runtime_error("error");
+    });
+    ghoul::TaskGraph::NodeId second = graph.addTask([&called]() { called = true; });
+    graph.addDependency(first, second);
+
+    EXPECT_THROW(graph.run().get(), std::runtime_error);
+    EXPECT_FALSE(called);
+}
+
+TEST_F(TaskGraphTest, InvalidDependencies) {
+    ghoul::ThreadPool pool(2);
+    ghoul::TaskGraph graph(pool);
+
+    ghoul::TaskGraph::NodeId a = graph.addTask([]() {});
+    ghoul::TaskGraph::NodeId b = graph.addTask([]() {});
+    EXPECT_THROW(graph.addDependency(a, a), ghoul::TaskGraph::TaskGraphError);
+    EXPECT_THROW(graph.addDependency(a, 5), ghoul::TaskGraph::TaskGraphError);
+    EXPECT_THROW(graph.addDependency(-1, b), ghoul::TaskGraph::TaskGraphError);
+
+    graph.addDependency(a, b);
+    graph.addDependency(b, a);
+    EXPECT_THROW(graph.run(), ghoul::TaskGraph::TaskGraphError);
+}
+
+TEST_F(TaskGraphTest, FullPool) {
+    using OverflowPolicy = ghoul::ThreadPool::OverflowPolicy;
+    ghoul::ThreadPool pool(1);
+    ghoul::TaskGraph graph(pool);
+
+    std::promise<void> started;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic_int value(0);
+    ghoul::TaskGraph::NodeId first = graph.addTask([&started, released]() {
+        started.set_value();
+        released.wait();
+    });
+    ghoul::TaskGraph::NodeId second = graph.addTask([&value]() { value = 1; });
+    graph.addDependency(first, second);
+
+    ghoul::Continuable<void> run = graph.run();
+    started.get_future().wait();
+
+    // The second node is queued by the Worker while the queue is full
+    pool.setCapacity(1, OverflowPolicy::Reject);
+    std::future<int> waiting = pool.queue([]() { return 3; });
+    EXPECT_THROW(pool.post([]() {}), ghoul::ThreadPool::QueueFullError);
+
+    release.set_value();
+    run.get();
+    EXPECT_EQ(1, value);
+    EXPECT_EQ(3, waiting.get());
+}
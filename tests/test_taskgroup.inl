@@ -0,0 +1,136 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include <ghoul/misc/taskgroup.h>
+
+#include <atomic>
+#include <future>
+#include <stdexcept>
+
+namespace {
+    // Splits the computation recursively and waits for the subtasks inside the tasks,
+    // which would deadlock a small ThreadPool if the waiting blocked the Worker
+    int fibonacci(ghoul::ThreadPool& pool, int n) {
+        if (n < 2) {
+            return n;
+        }
+
+        int a = 0;
+        int b = 0;
+        ghoul::TaskGroup group(pool);
+        group.run([&pool, &a, n]() { a = fibonacci(pool, n - 1); });
+        group.run([&pool, &b, n]() { b = fibonacci(pool, n - 2); });
+        group.wait();
+        return a + b;
+    }
+} // namespace
+
+class TaskGroupTest : public testing::Test {};
+
+TEST_F(TaskGroupTest, Run) {
+    ghoul::ThreadPool pool(2);
+    ghoul::TaskGroup group(pool);
+    EXPECT_TRUE(group.isFinished());
+
+    std::atomic_int sum(0);
+    for (int i = 1; i <= 100; ++i) {
+        group.run([&sum, i]() { sum += i; });
+    }
+    group.wait();
+    EXPECT_TRUE(group.isFinished());
+    EXPECT_EQ(5050, sum);
+
+    // The group can be reused
+    group.run([&sum]() { sum = 0; });
+    group.wait();
+    EXPECT_EQ(0, sum);
+}
+
+TEST_F(TaskGroupTest, RecursiveSingleWorker) {
+    ghoul::ThreadPool pool(1);
+    std::future<int> f = pool.queue([&pool]() { return fibonacci(pool, 15); });
+    EXPECT_EQ(610, f.get());
+}
+
+TEST_F(TaskGroupTest, RecursiveWorkStealing) {
+    ghoul::ThreadPool pool(
+        4,
+        []() {},
+        []() {},
+        ghoul::thread::ThreadPriorityClass::Normal,
+        ghoul::thread::ThreadPriorityLevel::Normal,
+        ghoul::thread::Background::No,
+        ghoul::ThreadPool::WorkStealing::Yes
+    );
+    EXPECT_EQ(6765, fibonacci(pool, 20));
+}
+
+TEST_F(TaskGroupTest, WaitOnStoppedPool) {
+    // The waiting thread executes the tasks itself if no Worker is running
+    ghoul::ThreadPool pool(1);
+    pool.stop();
+
+    int sum = 0;
+    ghoul::TaskGroup group(pool);
+    for (int i = 1; i <= 10; ++i) {
+        group.run([&sum, i]() { sum += i; });
+    }
+    group.wait();
+    EXPECT_EQ(55, sum);
+}
+
+TEST_F(TaskGroupTest, Exception) {
+    ghoul::ThreadPool pool(2);
+    ghoul::TaskGroup group(pool);
+
+    std::atomic_int nExecuted(0);
+    for (int i = 0; i < 10; ++i) {
+        group.run([&nExecuted, i]() {
+            ++nExecuted;
+            if (i == 5) {
+                throw std::runtime_error("Error");
+            }
+        });
+    }
+    EXPECT_THROW(group.wait(), std::runtime_error);
+    EXPECT_EQ(10, nExecuted);
+
+    // The exception is only reported once
+    group.wait();
+}
+
+TEST_F(TaskGroupTest, DiscardedTask) {
+    ghoul::ThreadPool pool(1);
+    pool.stop();
+
+    ghoul::TaskGroup group(pool);
+    group.run([]() {});
+    pool.clearRemainingTasks();
+
+    EXPECT_TRUE(group.isFinished());
+    EXPECT_THROW(group.wait(), std::future_error);
+}
@@ -0,0 +1,205 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include <ghoul/misc/thread.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+class ThreadTest : public testing::Test {
+protected:
+#ifdef __linux__
+    // Creates a sysfs in the directory 'FakeSysfs' that describes two NUMA nodes with
+    // two logical CPUs each, all of which are on separate cores
+    void createFakeSysfs() {
+        mkdir(FakeSysfs, 0755);
+        mkdir((std::string(FakeSysfs) + "/cpu").c_str(), 0755);
+        mkdir((std::string(FakeSysfs) + "/node").c_str(), 0755);
+        writeFile("cpu/online", "0-3");
+        writeFile("node/online", "0-1");
+        for (int node = 0; node < 2; ++node) {
+            const std::string n = "node/node" + std::to_string(node);
+            mkdir((std::string(FakeSysfs) + "/" + n).c_str(), 0755);
+            writeFile(n + "/cpulist", node == 0 ? "0-1" : "2-3");
+        }
+        for (int cpu = 0; cpu < 4; ++cpu) {
+            const std::string c = "cpu/cpu" + std::to_string(cpu);
+            mkdir((std::string(FakeSysfs) + "/" + c).c_str(), 0755);
+            mkdir((std::string(FakeSysfs) + "/" + c + "/topology").c_str(), 0755);
+            writeFile(c + "/topology/core_id", std::to_string(cpu));
+            writeFile(c + "/topology/physical_package_id", "0");
+        }
+    }
+
+    void removeFakeSysfs() {
+        for (int cpu = 0; cpu < 4; ++cpu) {
+            const std::string c =
+                std::string(FakeSysfs) + "/cpu/cpu" + std::to_string(cpu);
+            std::remove((c + "/topology/core_id").c_str());
+            std::remove((c + "/topology/physical_package_id").c_str());
+            rmdir((c + "/topology").c_str());
+            rmdir(c.c_str());
+        }
+        for (int node = 0; node < 2; ++node) {
+            const std::string n =
+                std::string(FakeSysfs) + "/node/node" + std::to_string(node);
+            std::remove((n + "/cpulist").c_str());
+            rmdir(n.c_str());
+        }
+        std::remove((std::string(FakeSysfs) + "/cpu/online").c_str());
+        std::remove((std::string(FakeSysfs) + "/node/online").c_str());
+        rmdir((std::string(FakeSysfs) + "/cpu").c_str());
+        rmdir((std::string(FakeSysfs) + "/node").c_str());
+        rmdir(FakeSysfs);
+    }
+
+    void writeFile(const std::string& path, const std::string& content) {
+        std::ofstream file(std::string(FakeSysfs) + "/" + path);
+        file << content << '\n';
+    }
+
+    const char* FakeSysfs = "fakesysfs";
+#endif
+};
+
+TEST_F(ThreadTest, ParseCpuList) {
+    using ghoul::thread::parseCpuList;
+
+    EXPECT_EQ(std::vector<int>({ 0 }), parseCpuList("0"));
+    EXPECT_EQ(std::vector<int>({ 0, 1, 2, 3 }), parseCpuList("0-3"));
+    EXPECT_EQ(std::vector<int>({ 0, 1, 2, 3, 8, 10, 11 }), parseCpuList("0-3,8,10-11"));
+    EXPECT_EQ(std::vector<int>({ 1, 2, 3 }), parseCpuList("3,1-2,2"));
+    EXPECT_EQ(std::vector<int>(), parseCpuList(""));
+    EXPECT_EQ(std::vector<int>({ 4 }), parseCpuList("x,3-1,4"));
+}
+
+TEST_F(ThreadTest, Topology) {
+    std::vector<ghoul::thread::LogicalCpu> topology = ghoul::thread::cpuTopology();
+    ASSERT_FALSE(topology.empty());
+    for (size_t i = 1; i < topology.size(); ++i) {
+        EXPECT_LT(topology[i - 1].id, topology[i].id);
+    }
+
+    // Only CPUs that this thread is allowed to run on are part of the topology
+    std::vector<int> allowed = ghoul::thread::allowedCpus();
+    if (!allowed.empty()) {
+        for (const ghoul::thread::LogicalCpu& cpu : topology) {
+            EXPECT_TRUE(std::binary_search(allowed.begin(), allowed.end(), cpu.id));
+        }
+    }
+
+    // A missing sysfs falls back to one CPU per hardware thread
+    std::vector<ghoul::thread::LogicalCpu> fallback = ghoul::thread::cpuTopology(
+        "/this/path/does/not/exist",
+        {}
+    );
+    ASSERT_FALSE(fallback.empty());
+    EXPECT_EQ(0, fallback.front().numaNode);
+
+    // or, if the allowed CPUs are known, to one CPU per allowed CPU
+    fallback = ghoul::thread::cpuTopology("/this/path/does/not/exist", { 2, 5 });
+    ASSERT_EQ(2, fallback.size());
+    EXPECT_EQ(2, fallback[0].id);
+    EXPECT_EQ(5, fallback[1].id);
+}
+
+#ifdef __linux__
+TEST_F(ThreadTest, TopologyFromSysfs) {
+    createFakeSysfs();
+
+    std::vector<ghoul::thread::LogicalCpu> all = ghoul::thread::cpuTopology(
+        FakeSysfs,
+        {}
+    );
+    ASSERT_EQ(4, all.size());
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(i, all[i].id);
+        EXPECT_EQ(i, all[i].core);
+        EXPECT_EQ(i < 2 ? 0 : 1, all[i].numaNode);
+    }
+
+    // CPUs that are online but not allowed, for example due to 'taskset', are removed
+    std::vector<ghoul::thread::LogicalCpu> restricted = ghoul::thread::cpuTopology(
+        FakeSysfs,
+        { 1, 3, 8 }
+    );
+    ASSERT_EQ(2, restricted.size());
+    EXPECT_EQ(1, restricted[0].id);
+    EXPECT_EQ(0, restricted[0].numaNode);
+    EXPECT_EQ(3, restricted[1].id);
+    EXPECT_EQ(1, restricted[1].numaNode);
+
+    removeFakeSysfs();
+}
+#endif // __linux__
+
+TEST_F(ThreadTest, CpuOrder) {
+    using ghoul::thread::Placement;
+
+    // Two NUMA nodes with two cores and two hyperthreads each:
+    //   node 0: cpu 0 + 4 on core 0, cpu 1 + 5 on core 1
+    //   node 1: cpu 2 + 6 on core 0, cpu 3 + 7 on core 1
+    std::vector<ghoul::thread::LogicalCpu> topology = {
+        { 0, 0, 0, 0 }, { 1, 1, 0, 0 }, { 2, 0, 1, 1 }, { 3, 1, 1, 1 },
+        { 4, 0, 0, 0 }, { 5, 1, 0, 0 }, { 6, 0, 1, 1 }, { 7, 1, 1, 1 }
+    };
+
+    EXPECT_TRUE(ghoul::thread::cpuOrder(topology, Placement::None).empty());
+    EXPECT_EQ(
+        std::vector<int>({ 0, 1, 4, 5, 2, 3, 6, 7 }),
+        ghoul::thread::cpuOrder(topology, Placement::Compact)
+    );
+    EXPECT_EQ(
+        std::vector<int>({ 0, 2, 1, 3, 4, 6, 5, 7 }),
+        ghoul::thread::cpuOrder(topology, Placement::Spread)
+    );
+}
+
+TEST_F(ThreadTest, CurrentThreadAffinity) {
+    std::vector<int> allowed = ghoul::thread::allowedCpus();
+    if (allowed.empty()) {
+        // Affinities are not supported on this platform
+        return;
+    }
+    const int cpu = allowed.back();
+
+    std::thread t([cpu]() {
+        ghoul::thread::setCurrentThreadAffinity({ cpu });
+#ifdef __linux__
+        EXPECT_EQ(cpu, sched_getcpu());
+#endif
+    });
+    t.join();
+}
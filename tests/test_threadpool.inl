@@ -25,8 +25,14 @@
 
 #include "gtest/gtest.h"
 
+#include <ghoul/misc/dictionary.h>
 #include <ghoul/misc/threadpool.h>
 
+#include <algorithm>
+#include <ctime>
+#include <numeric>
+#include <stdexcept>
+
 namespace {
     const int Epsilon = 50;
 
@@ -130,6 +136,20 @@ TEST_F(ThreadPoolTest, ResizeShrink) {
     ASSERT_EQ(1, pool.size());
 }
 
+TEST_F(ThreadPoolTest, ResizeAfterStop) {
+    ghoul::ThreadPool pool(4);
+    pool.stop();
+
+    pool.resize(2);
+    EXPECT_EQ(2, pool.size());
+    pool.resize(3);
+    EXPECT_EQ(3, pool.size());
+
+    pool.start();
+    std::future<int> f = pool.queue([]() { return 1; });
+    EXPECT_EQ(1, f.get());
+}
+
 TEST_F(ThreadPoolTest, CorrectSizes) {
     ghoul::ThreadPool pool(5);
     EXPECT_EQ(5, pool.size());
@@ -441,3 +461,1092 @@ TEST_F(ThreadPoolTest, DetachingStop) {
     // As it is not blocking, the operation shouldn't take any time at all
     EXPECT_GE(Epsilon, ms);
 }
+
+TEST_F(ThreadPoolTest, WorkStealingInvariants) {
+    ghoul::ThreadPool pool(
+        2,
+        []() {},
+        []() {},
+        ghoul::thread::ThreadPriorityClass::Normal,
+        ghoul::thread::ThreadPriorityLevel::Normal,
+        ghoul::thread::Background::No,
+        ghoul::ThreadPool::WorkStealing::Yes
+    );
+    threadSleep(SchedulingWaitTime);
+
+    EXPECT_TRUE(pool.isWorkStealing());
+    EXPECT_EQ(2, pool.idleThreads());
+    EXPECT_EQ(2, pool.size());
+    EXPECT_EQ(0, pool.remainingTasks());
+
+    ghoul::ThreadPool fifoPool(1);
+    EXPECT_FALSE(fifoPool.isWorkStealing());
+}
+
+TEST_F(ThreadPoolTest, ContentionManyProducers) {
+    // Many external threads hammering the shared queue of a large pool with tiny tasks
+    const int nProducers = 8;
+    const int nTasks = 10000;
+
+    for (ghoul::ThreadPool::WorkStealing ws :
+        { ghoul::ThreadPool::WorkStealing::No, ghoul::ThreadPool::WorkStealing::Yes })
+    {
+        ghoul::ThreadPool pool(
+            16,
+            []() {},
+            []() {},
+            ghoul::thread::ThreadPriorityClass::Normal,
+            ghoul::thread::ThreadPriorityLevel::Normal,
+            ghoul::thread::Background::No,
+            ws
+        );
+
+        std::atomic_int counter(0);
+        std::vector<std::thread> producers;
+        for (int i = 0; i < nProducers; ++i) {
+            producers.emplace_back([&pool, &counter, nTasks]() {
+                for (int j = 0; j < nTasks; ++j) {
+                    pool.queue([&counter]() { ++counter; });
+                }
+            });
+        }
+        for (std::thread& t : producers) {
+            t.join();
+        }
+
+        pool.stop(ghoul::ThreadPool::RunRemainingTasks::Yes);
+        EXPECT_EQ(nProducers * nTasks, counter);
+        EXPECT_EQ(0, pool.remainingTasks());
+    }
+}
+
+TEST_F(ThreadPoolTest, WorkStealingNestedTasks) {
+    // A single task fans out into many subtasks that are pushed onto the local queue of
+    // the worker that runs it. The other workers have to steal them to participate
+    ghoul::ThreadPool pool(
+        4,
+        []() {},
+        []() {},
+        ghoul::thread::ThreadPriorityClass::Normal,
+        ghoul::thread::ThreadPriorityLevel::Normal,
+        ghoul::thread::Background::No,
+        ghoul::ThreadPool::WorkStealing::Yes
+    );
+
+    const int nChildren = 2000;
+    std::atomic_int counter(0);
+    std::mutex idMutex;
+    std::vector<std::thread::id> ids;
+
+    pool.queue([&]() {
+        for (int i = 0; i < nChildren; ++i) {
+            pool.queue([&]() {
+                threadSleep(std::chrono::microseconds(50));
+                {
+                    std::lock_guard<std::mutex> lock(idMutex);
+                    ids.push_back(std::this_thread::get_id());
+                }
+                ++counter;
+            });
+        }
+    });
+
+    pool.stop(ghoul::ThreadPool::RunRemainingTasks::Yes);
+    EXPECT_EQ(nChildren, counter);
+
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    EXPECT_LT(1, static_cast<int>(ids.size()));
+}
+
+TEST_F(ThreadPoolTest, WorkStealingRecursiveFutures) {
+    // Recursively spawned tasks returning values through their futures
+    ghoul::ThreadPool pool(
+        8,
+        []() {},
+        []() {},
+        ghoul::thread::ThreadPriorityClass::Normal,
+        ghoul::thread::ThreadPriorityLevel::Normal,
+        ghoul::thread::Background::No,
+        ghoul::ThreadPool::WorkStealing::Yes
+    );
+
+    std::atomic_int counter(0);
+    std::vector<std::future<int>> futures;
+    for (int i = 0; i < 64; ++i) {
+        futures.push_back(pool.queue([&pool, &counter, i]() {
+            for (int j = 0; j < 100; ++j) {
+                pool.queue([&counter]() { ++counter; });
+            }
+            return i;
+        }));
+    }
+
+    int sum = 0;
+    for (std::future<int>& f : futures) {
+        sum += f.get();
+    }
+    pool.stop(ghoul::ThreadPool::RunRemainingTasks::Yes);
+
+    EXPECT_EQ(64 * 63 / 2, sum);
+    EXPECT_EQ(64 * 100, counter);
+}
+
+TEST_F(ThreadPoolTest, WorkStealingResizeUnderLoad) {
+    // Shrinking the pool while the workers have tasks in their local queues must not
+    // lose any of the tasks
+    ghoul::ThreadPool pool(
+        8,
+        []() {},
+        []() {},
+        ghoul::thread::ThreadPriorityClass::Normal,
+        ghoul::thread::ThreadPriorityLevel::Normal,
+        ghoul::thread::Background::No,
+        ghoul::ThreadPool::WorkStealing::Yes
+    );
+
+    std::atomic_int counter(0);
+    for (int i = 0; i < 32; ++i) {
+        pool.queue([&pool, &counter]() {
+            for (int j = 0; j < 50; ++j) {
+                pool.queue([&counter]() {
+                    threadSleep(std::chrono::microseconds(20));
+                    ++counter;
+                });
+            }
+        });
+    }
+
+    pool.resize(2);
+    EXPECT_EQ(2, pool.size());
+    pool.resize(6);
+    EXPECT_EQ(6, pool.size());
+
+    // The detached workers finish their current task independently from the pool, so we
+    // have to wait for the work to finish rather than relying on 'stop'
+    auto start = std::chrono::high_resolution_clock::now();
+    while (counter != 32 * 50 &&
+           std::chrono::high_resolution_clock::now() - start < std::chrono::seconds(5))
+    {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(32 * 50, counter);
+    pool.stop(ghoul::ThreadPool::RunRemainingTasks::Yes);
+}
+
+TEST_F(ThreadPoolTest, WorkStealingStopWithoutRemaining) {
+    ghoul::ThreadPool pool(
+        2,
+        []() {},
+        []() {},
+        ghoul::thread::ThreadPriorityClass::Normal,
+        ghoul::thread::ThreadPriorityLevel::Normal,
+        ghoul::thread::Background::No,
+        ghoul::ThreadPool::WorkStealing::Yes
+    );
+
+    std::atomic_int counter(0);
+    pool.queue([&]() {
+        for (int i = 0; i < 100; ++i) {
+            pushWait(pool, 10, counter);
+        }
+    });
+    threadSleep(SchedulingWaitTime);
+
+    pool.stop(ghoul::ThreadPool::RunRemainingTasks::No);
+    EXPECT_EQ(0, pool.remainingTasks());
+    EXPECT_GT(100, counter);
+}
+
+TEST_F(ThreadPoolTest, PriorityOrdering) {
+    // Tests whether waiting tasks are started in the order of their priority and in FIFO
+    // order within the same priority
+    using Priority = ghoul::ThreadPool::Priority;
+
+    ghoul::ThreadPool pool(1);
+    // Block the only worker so that all of the following tasks are waiting
+    pushWait(pool, 50);
+    threadSleep(SchedulingWaitTime);
+
+    std::vector<int> res;
+    auto func = [&res](int i) {
+        res.push_back(i);
+    };
+
+    pool.queue(Priority::Background, func, 5);
+    pool.queue(Priority::Normal, func, 3);
+    pool.queue(Priority::High, func, 0);
+    pool.queue(func, 4);
+    pool.queue(Priority::High, func, 1);
+    pool.queue(Priority::High, func, 2);
+
+    pool.stop();
+
+    ASSERT_EQ(6, res.size());
+    for (int i = 0; i < 6; ++i) {
+        EXPECT_EQ(i, res[i]);
+    }
+}
+
+TEST_F(ThreadPoolTest, RemainingTasksPerPriority) {
+    using Priority = ghoul::ThreadPool::Priority;
+
+    ghoul::ThreadPool pool(1);
+    pushWait(pool, 100);
+    threadSleep(SchedulingWaitTime);
+
+    pool.queue(Priority::High, []() {});
+    pool.queue(Priority::Background, []() {});
+    pool.queue(Priority::Background, []() {});
+    pool.queue([]() {});
+    pool.queue([]() {});
+    pool.queue([]() {});
+
+    EXPECT_EQ(6, pool.remainingTasks());
+    EXPECT_EQ(1, pool.remainingTasks(Priority::High));
+    EXPECT_EQ(3, pool.remainingTasks(Priority::Normal));
+    EXPECT_EQ(2, pool.remainingTasks(Priority::Background));
+
+    pool.stop();
+    EXPECT_EQ(0, pool.remainingTasks());
+    EXPECT_EQ(0, pool.remainingTasks(Priority::High));
+    EXPECT_EQ(0, pool.remainingTasks(Priority::Normal));
+    EXPECT_EQ(0, pool.remainingTasks(Priority::Background));
+}
+
+TEST_F(ThreadPoolTest, PriorityStarvationProtection) {
+    // Tests whether a background task is started even if high priority tasks are waiting
+    using Priority = ghoul::ThreadPool::Priority;
+
+    ghoul::ThreadPool pool(1);
+    pushWait(pool, 25);
+    threadSleep(SchedulingWaitTime / 5);
+
+    std::atomic_int nHighBefore(0);
+    std::atomic_int nHigh(0);
+    pool.queue(Priority::Background, [&]() { nHighBefore = nHigh.load(); });
+    for (int i = 0; i < 1000; ++i) {
+        pool.queue(Priority::High, [&]() { ++nHigh; });
+    }
+
+    pool.stop();
+
+    EXPECT_EQ(1000, nHigh);
+    EXPECT_GT(1000, nHighBefore);
+}
+
+TEST_F(ThreadPoolTest, Post) {
+    using Priority = ghoul::ThreadPool::Priority;
+
+    ghoul::ThreadPool pool(2);
+
+    std::atomic_int counter(0);
+    for (int i = 0; i < 1000; ++i) {
+        pool.post([&counter]() { ++counter; });
+        pool.post(Priority::Background, [&counter]() { ++counter; });
+    }
+
+    // Move-only tasks can be posted and queued as well
+    auto ptr = std::make_unique<int>(5);
+    pool.post([&counter, p = std::move(ptr)]() { counter += *p; });
+    auto other = std::make_unique<int>(10);
+    std::future<int> f = pool.queue([p = std::move(other)]() { return *p; });
+
+    pool.stop();
+    EXPECT_EQ(2005, counter);
+    EXPECT_EQ(10, f.get());
+}
+
+TEST_F(ThreadPoolTest, StartupAndIdleCost) {
+    // Starting many threads should be fast and idle threads must not use the CPU
+    auto start = std::chrono::high_resolution_clock::now();
+    ghoul::ThreadPool pool(64);
+    auto end = std::chrono::high_resolution_clock::now();
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    EXPECT_GT(1000, ms);
+
+    std::clock_t cpuStart = std::clock();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    std::clock_t cpuEnd = std::clock();
+    const double cpuMs = 1000.0 * (cpuEnd - cpuStart) / CLOCKS_PER_SEC;
+    EXPECT_GT(50.0, cpuMs);
+    EXPECT_EQ(64, pool.idleThreads());
+}
+
+TEST_F(ThreadPoolTest, NoLostWakeups) {
+    // Every task is queued while the Worker is about to go to sleep. A lost notification
+    // would block this test forever
+    for (int spin : { 0, 50 }) {
+        ghoul::ThreadPool pool(
+            1,
+            []() {},
+            []() {},
+            ghoul::thread::ThreadPriorityClass::Normal,
+            ghoul::thread::ThreadPriorityLevel::Normal,
+            ghoul::thread::Background::No,
+            ghoul::ThreadPool::WorkStealing::No,
+            std::chrono::microseconds(spin)
+        );
+        EXPECT_EQ(spin, pool.spinDuration().count());
+
+        for (int i = 0; i < 10000; ++i) {
+            EXPECT_EQ(i, pool.queue([i]() { return i; }).get());
+        }
+    }
+}
+
+TEST_F(ThreadPoolTest, Placement) {
+    using ghoul::thread::Placement;
+
+    for (Placement p : { Placement::None, Placement::Compact, Placement::Spread }) {
+        ghoul::ThreadPool pool(
+            4,
+            []() {},
+            []() {},
+            ghoul::thread::ThreadPriorityClass::Normal,
+            ghoul::thread::ThreadPriorityLevel::Normal,
+            ghoul::thread::Background::No,
+            ghoul::ThreadPool::WorkStealing::Yes,
+            std::chrono::microseconds(0),
+            p
+        );
+        EXPECT_EQ(p, pool.placement());
+
+        std::atomic_int counter(0);
+        for (int i = 0; i < 1000; ++i) {
+            pool.post([&counter]() { ++counter; });
+        }
+        pool.resize(6);
+        pool.stop();
+        EXPECT_EQ(1000, counter);
+    }
+}
+
+TEST_F(ThreadPoolTest, QueueBatch) {
+    for (bool workStealing : { false, true }) {
+        ghoul::ThreadPool pool(
+            4,
+            []() {},
+            []() {},
+            ghoul::thread::ThreadPriorityClass::Normal,
+            ghoul::thread::ThreadPriorityLevel::Normal,
+            ghoul::thread::Background::No,
+            workStealing ?
+                ghoul::ThreadPool::WorkStealing::Yes :
+                ghoul::ThreadPool::WorkStealing::No
+        );
+
+        std::vector<int> values(10000);
+        std::iota(values.begin(), values.end(), 0);
+        std::future<void> f = pool.queueBatch(
+            values.begin(),
+            values.end(),
+            [](int& v) { v *= 2; }
+        );
+        f.get();
+        for (int i = 0; i < static_cast<int>(values.size()); ++i) {
+            ASSERT_EQ(2 * i, values[i]);
+        }
+
+        // An empty batch is ready immediately
+        std::future<void> empty = pool.queueBatch(
+            ghoul::ThreadPool::Priority::High,
+            values.begin(),
+            values.begin(),
+            [](int&) {}
+        );
+        EXPECT_EQ(
+            std::future_status::ready,
+            empty.wait_for(std::chrono::seconds(0))
+        );
+    }
+}
+
+TEST_F(ThreadPoolTest, QueueBatchException) {
+    ghoul::ThreadPool pool(2);
+
+    std::vector<int> values = { 0, 1, 2, 3, 4, 5 };
+    std::atomic_int counter(0);
+    std::future<void> f = pool.queueBatch(
+        values.begin(),
+        values.end(),
+        [&counter](int v) {
+            ++counter;
+            if (v == 3) {
+                throw std::runtime_error("error");
+            }
+        }
+    );
+    EXPECT_THROW(f.get(), std::runtime_error);
+    EXPECT_EQ(6, counter);
+}
+
+TEST_F(ThreadPoolTest, Instrumentation) {
+    ghoul::ThreadPool pool(2);
+    EXPECT_FALSE(pool.isInstrumentationEnabled());
+
+    auto totalTasks = [](const ghoul::ThreadPool::Statistics& s) {
+        uint64_t result = 0;
+        for (const ghoul::ThreadPool::WorkerStatistics& w : s.workers) {
+            result += w.nTasksExecuted;
+        }
+        return result;
+    };
+    auto histogramSum = [](const ghoul::ThreadPool::Histogram& h) {
+        return std::accumulate(h.begin(), h.end(), uint64_t(0));
+    };
+
+    // Nothing is counted while the instrumentation is disabled
+    pool.queue([]() {}).get();
+    ghoul::ThreadPool::Statistics stats = pool.statistics();
+    ASSERT_EQ(2, static_cast<int>(stats.workers.size()));
+    EXPECT_EQ(0u, totalTasks(stats));
+
+    pool.setInstrumentationEnabled(true);
+    EXPECT_TRUE(pool.isInstrumentationEnabled());
+
+    const int nTasks = 20;
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i < nTasks; ++i) {
+        futures.push_back(pool.queue([]() {
+            threadSleep(std::chrono::milliseconds(2));
+        }));
+    }
+    for (std::future<void>& f : futures) {
+        f.get();
+    }
+    // The counters are updated after the future has been set
+    threadSleep(SchedulingWaitTime);
+
+    stats = pool.statistics();
+    EXPECT_EQ(static_cast<uint64_t>(nTasks), totalTasks(stats));
+    std::chrono::nanoseconds busyTime(0);
+    uint64_t nRunTimes = 0;
+    uint64_t nQueueWaitTimes = 0;
+    uint64_t nShortTasks = 0;
+    for (const ghoul::ThreadPool::WorkerStatistics& w : stats.workers) {
+        EXPECT_EQ(0u, w.nTasksStolen);
+        busyTime += w.busyTime;
+        nRunTimes += histogramSum(w.runTime);
+        nQueueWaitTimes += histogramSum(w.queueWaitTime);
+        // A task that sleeps for 2ms cannot end up in the buckets below 1024us
+        nShortTasks += std::accumulate(w.runTime.begin(), w.runTime.begin() + 11, 0u);
+    }
+    EXPECT_LE(std::chrono::milliseconds(2 * nTasks), busyTime);
+    EXPECT_EQ(static_cast<uint64_t>(nTasks), nRunTimes);
+    EXPECT_EQ(static_cast<uint64_t>(nTasks), nQueueWaitTimes);
+    EXPECT_EQ(0u, nShortTasks);
+
+    ghoul::Dictionary dictionary = stats.toDictionary();
+    EXPECT_EQ(0, dictionary.value<int>("RemainingTasks"));
+    EXPECT_TRUE(dictionary.hasValue<ghoul::Dictionary>("Workers.1.RunTime"));
+    EXPECT_TRUE(dictionary.hasValue<ghoul::Dictionary>("Workers.2.QueueWaitTime"));
+    EXPECT_EQ(
+        static_cast<long long>(totalTasks(stats)),
+        dictionary.value<long long>("Workers.1.TasksExecuted") +
+        dictionary.value<long long>("Workers.2.TasksExecuted")
+    );
+    EXPECT_NE(std::string::npos, stats.toJson().find("\"RemainingTasks\":0"));
+
+    pool.resetStatistics();
+    EXPECT_EQ(0u, totalTasks(pool.statistics()));
+}
+
+TEST_F(ThreadPoolTest, InstrumentationSteals) {
+    ghoul::ThreadPool pool(
+        2,
+        []() {},
+        []() {},
+        ghoul::thread::ThreadPriorityClass::Normal,
+        ghoul::thread::ThreadPriorityLevel::Normal,
+        ghoul::thread::Background::No,
+        ghoul::ThreadPool::WorkStealing::Yes
+    );
+    pool.setInstrumentationEnabled(true);
+
+    // The parent blocks its Worker while waiting, so the other Worker has to steal both
+    // children from the parent's local queue
+    pool.queue([&pool]() {
+        std::future<void> a = pool.queue([]() {});
+        std::future<void> b = pool.queue([]() {});
+        a.get();
+        b.get();
+    }).get();
+    threadSleep(SchedulingWaitTime);
+
+    ghoul::ThreadPool::Statistics stats = pool.statistics();
+    uint64_t nStolen = 0;
+    uint64_t nExecuted = 0;
+    for (const ghoul::ThreadPool::WorkerStatistics& w : stats.workers) {
+        nStolen += w.nTasksStolen;
+        nExecuted += w.nTasksExecuted;
+    }
+    EXPECT_EQ(2u, nStolen);
+    EXPECT_EQ(3u, nExecuted);
+}
+
+TEST_F(ThreadPoolTest, CancellationToken) {
+    ghoul::CancellationToken token;
+    EXPECT_FALSE(token.isCancelled());
+    EXPECT_FALSE(token.hasDeadline());
+    EXPECT_NO_THROW(token.throwIfCancelled());
+
+    // All copies share the same state
+    ghoul::CancellationToken copy = token;
+    copy.cancel();
+    EXPECT_TRUE(token.isCancelled());
+    EXPECT_THROW(token.throwIfCancelled(), ghoul::CancellationToken::CancelledError);
+
+    ghoul::CancellationToken expired(ghoul::CancellationToken::Clock::now());
+    EXPECT_TRUE(expired.hasDeadline());
+    EXPECT_TRUE(expired.isCancelled());
+
+    ghoul::CancellationToken timeout(std::chrono::hours(1));
+    EXPECT_TRUE(timeout.hasDeadline());
+    EXPECT_FALSE(timeout.isCancelled());
+    timeout.cancel();
+    EXPECT_TRUE(timeout.isCancelled());
+}
+
+TEST_F(ThreadPoolTest, Cancellation) {
+    ghoul::ThreadPool pool(1);
+
+    // Block the only Worker so that all following tasks stay in the queue
+    std::promise<void> started;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::future<void> blocker = pool.queue([&started, released]() {
+        started.set_value();
+        released.wait();
+    });
+    started.get_future().wait();
+
+    ghoul::CancellationToken token;
+    ghoul::CancellationToken stale(std::chrono::milliseconds(10));
+    std::atomic_int nCancelled(0);
+    std::atomic_int nExecuted(0);
+    for (int i = 0; i < 10; ++i) {
+        pool.post(token, [&nCancelled]() { ++nCancelled; });
+        pool.post(
+            ghoul::ThreadPool::Priority::Background,
+            stale,
+            [&nCancelled]() { ++nCancelled; }
+        );
+        pool.post([&nExecuted]() { ++nExecuted; });
+    }
+    std::future<int> cancelled = pool.queue(token, [](int i) { return i; }, 1);
+    std::future<int> executed = pool.queue(
+        ghoul::ThreadPool::Priority::High,
+        ghoul::CancellationToken(),
+        [](int i) { return i; },
+        2
+    );
+
+    token.cancel();
+    threadSleep(SchedulingWaitTime);
+    release.set_value();
+    blocker.get();
+
+    EXPECT_EQ(2, executed.get());
+    EXPECT_THROW(cancelled.get(), std::future_error);
+    pool.stop();
+    EXPECT_EQ(0, nCancelled);
+    EXPECT_EQ(10, nExecuted);
+}
+
+TEST_F(ThreadPoolTest, CancellationOfRunningTask) {
+    ghoul::ThreadPool pool(1);
+
+    ghoul::CancellationToken token;
+    std::atomic_bool isRunning(false);
+    std::future<int> f = pool.queue(token, [token, &isRunning]() {
+        isRunning = true;
+        int nIterations = 0;
+        while (!token.isCancelled()) {
+            std::this_thread::yield();
+            ++nIterations;
+        }
+        return nIterations;
+    });
+
+    while (!isRunning) {
+        std::this_thread::yield();
+    }
+    token.cancel();
+    EXPECT_LE(0, f.get());
+}
+
+TEST_F(ThreadPoolTest, AutoScaling) {
+    ghoul::ThreadPool pool(1);
+    EXPECT_FALSE(pool.isAutoScaling());
+
+    ghoul::ThreadPool::AutoScaling policy;
+    policy.minThreads = 1;
+    policy.maxThreads = 4;
+    policy.queueWaitThreshold = std::chrono::milliseconds(5);
+    policy.idleTimeout = std::chrono::milliseconds(50);
+    policy.interval = std::chrono::milliseconds(5);
+    pool.enableAutoScaling(policy);
+    EXPECT_TRUE(pool.isAutoScaling());
+
+    // Tasks that block the workers until released force the pool to grow to its maximum
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic_int nStarted(0);
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i < 4; ++i) {
+        futures.push_back(pool.queue([released, &nStarted]() {
+            ++nStarted;
+            released.wait();
+        }));
+    }
+
+    const auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (nStarted < 4 && std::chrono::steady_clock::now() < timeout) {
+        threadSleep(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(4, nStarted);
+    EXPECT_EQ(4, pool.size());
+
+    release.set_value();
+    for (std::future<void>& f : futures) {
+        f.get();
+    }
+
+    // Without any work, the pool shrinks back to its minimum
+    while (pool.size() > 1 && std::chrono::steady_clock::now() < timeout) {
+        threadSleep(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(1, pool.size());
+
+    pool.disableAutoScaling();
+    EXPECT_FALSE(pool.isAutoScaling());
+    pool.resize(3);
+    EXPECT_EQ(3, pool.size());
+}
+
+TEST_F(ThreadPoolTest, CapacityBlock) {
+    ghoul::ThreadPool pool(1);
+    EXPECT_EQ(0, pool.capacity());
+    pool.setCapacity(2, ghoul::ThreadPool::OverflowPolicy::Block);
+    EXPECT_EQ(2, pool.capacity());
+    EXPECT_EQ(ghoul::ThreadPool::OverflowPolicy::Block, pool.overflowPolicy());
+
+    std::promise<void> started;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    pool.post([&started, released]() {
+        started.set_value();
+        released.wait();
+    });
+    started.get_future().wait();
+
+    std::atomic_int nExecuted(0);
+    pool.post([&nExecuted]() { ++nExecuted; });
+    pool.post([&nExecuted]() { ++nExecuted; });
+    EXPECT_EQ(2, pool.remainingTasks());
+
+    // The third task does not fit and blocks the producer until the Worker is free
+    std::atomic_bool hasQueued(false);
+    std::thread producer([&pool, &nExecuted, &hasQueued]() {
+        pool.post([&nExecuted]() { ++nExecuted; });
+        hasQueued = true;
+    });
+    threadSleep(SchedulingWaitTime);
+    EXPECT_FALSE(hasQueued);
+    EXPECT_EQ(2, pool.remainingTasks());
+
+    release.set_value();
+    producer.join();
+    EXPECT_TRUE(hasQueued);
+    pool.stop();
+    EXPECT_EQ(3, nExecuted);
+}
+
+TEST_F(ThreadPoolTest, CapacityCallerRuns) {
+    ghoul::ThreadPool pool(1);
+    pool.setCapacity(1, ghoul::ThreadPool::OverflowPolicy::CallerRuns);
+
+    std::promise<void> started;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    pool.post([&started, released]() {
+        started.set_value();
+        released.wait();
+    });
+    started.get_future().wait();
+
+    std::future<std::thread::id> queued = pool.queue([]() {
+        return std::this_thread::get_id();
+    });
+    std::future<std::thread::id> callerRuns = pool.queue([]() {
+        return std::this_thread::get_id();
+    });
+    // The second task has been executed before 'queue' returned
+    ASSERT_EQ(std::future_status::ready, callerRuns.wait_for(std::chrono::seconds(0)));
+    EXPECT_EQ(std::this_thread::get_id(), callerRuns.get());
+
+    release.set_value();
+    EXPECT_NE(std::this_thread::get_id(), queued.get());
+}
+
+TEST_F(ThreadPoolTest, CapacityReject) {
+    ghoul::ThreadPool pool(1);
+    pool.setCapacity(1, ghoul::ThreadPool::OverflowPolicy::Reject);
+
+    std::promise<void> started;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    pool.post([&started, released]() {
+        started.set_value();
+        released.wait();
+    });
+    started.get_future().wait();
+
+    std::future<int> accepted = pool.queue([]() { return 1; });
+    EXPECT_THROW(pool.queue([]() { return 2; }), ghoul::ThreadPool::QueueFullError);
+    EXPECT_THROW(pool.post([]() {}), ghoul::ThreadPool::QueueFullError);
+    EXPECT_EQ(1, pool.remainingTasks());
+
+    // Removing the limit accepts tasks again
+    pool.setCapacity(0);
+    std::future<int> unlimited = pool.queue([]() { return 3; });
+
+    release.set_value();
+    EXPECT_EQ(1, accepted.get());
+    EXPECT_EQ(3, unlimited.get());
+}
+
+TEST_F(ThreadPoolTest, CapacityDropOldest) {
+    using Priority = ghoul::ThreadPool::Priority;
+
+    ghoul::ThreadPool pool(1);
+    pool.setCapacity(2, ghoul::ThreadPool::OverflowPolicy::DropOldest);
+
+    std::promise<void> started;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    pool.post([&started, released]() {
+        started.set_value();
+        released.wait();
+    });
+    started.get_future().wait();
+
+    std::future<int> a = pool.queue(Priority::Normal, []() { return 1; });
+    std::future<int> b = pool.queue(Priority::Background, []() { return 2; });
+    // The Background task is dropped first, even though it is newer
+    std::future<int> c = pool.queue(Priority::Normal, []() { return 3; });
+    EXPECT_EQ(2, pool.remainingTasks());
+    std::future<int> d = pool.queue(Priority::High, []() { return 4; });
+    EXPECT_EQ(2, pool.remainingTasks());
+
+    release.set_value();
+    EXPECT_THROW(a.get(), std::future_error);
+    EXPECT_THROW(b.get(), std::future_error);
+    EXPECT_EQ(3, c.get());
+    EXPECT_EQ(4, d.get());
+}
+
+TEST_F(ThreadPoolTest, CapacityCancelledBlock) {
+    ghoul::ThreadPool pool(1);
+    pool.setCapacity(2, ghoul::ThreadPool::OverflowPolicy::Block);
+
+    std::promise<void> started;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    pool.post([&started, released]() {
+        started.set_value();
+        released.wait();
+    });
+    started.get_future().wait();
+
+    ghoul::CancellationToken token;
+    std::atomic_int nCancelled(0);
+    pool.post(token, [&nCancelled]() { ++nCancelled; });
+    pool.post(token, [&nCancelled]() { ++nCancelled; });
+    EXPECT_EQ(2, pool.remainingTasks());
+
+    // The producer is blocked until the waiting tasks are cancelled, even though the
+    // Worker does not take any of them out of the queue
+    std::atomic_int nExecuted(0);
+    std::atomic_bool hasQueued(false);
+    std::thread producer([&pool, &nExecuted, &hasQueued]() {
+        pool.post([&nExecuted]() { ++nExecuted; });
+        hasQueued = true;
+    });
+    threadSleep(SchedulingWaitTime);
+    EXPECT_FALSE(hasQueued);
+
+    token.cancel();
+    producer.join();
+    EXPECT_TRUE(hasQueued);
+    EXPECT_EQ(1, pool.remainingTasks());
+
+    // The cancelled tasks are gone, so there is space for another live task
+    pool.post([&nExecuted]() { ++nExecuted; });
+    EXPECT_EQ(2, pool.remainingTasks());
+
+    release.set_value();
+    pool.stop();
+    EXPECT_EQ(0, nCancelled);
+    EXPECT_EQ(2, nExecuted);
+}
+
+TEST_F(ThreadPoolTest, CapacityCancelledDropOldest) {
+    using Priority = ghoul::ThreadPool::Priority;
+
+    ghoul::ThreadPool pool(1);
+    pool.setCapacity(2, ghoul::ThreadPool::OverflowPolicy::DropOldest);
+
+    std::promise<void> started;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    pool.post([&started, released]() {
+        started.set_value();
+        released.wait();
+    });
+    started.get_future().wait();
+
+    ghoul::CancellationToken token;
+    std::future<int> a = pool.queue(Priority::Background, []() { return 1; });
+    std::future<int> b = pool.queue(Priority::Normal, token, []() { return 2; });
+    token.cancel();
+    EXPECT_EQ(1, pool.remainingTasks());
+    EXPECT_EQ(0, pool.remainingTasks(Priority::Normal));
+
+    // The cancelled task makes room instead of the live Background task
+    std::future<int> c = pool.queue(Priority::Normal, []() { return 3; });
+    EXPECT_EQ(2, pool.remainingTasks());
+    EXPECT_THROW(b.get(), std::future_error);
+
+    release.set_value();
+    EXPECT_EQ(1, a.get());
+    EXPECT_EQ(3, c.get());
+}
+
+TEST_F(ThreadPoolTest, CapacityFromWorker) {
+    // A Worker that queues into a full ThreadPool with the Block policy executes the
+    // task itself instead of waiting for the other Workers
+    ghoul::ThreadPool pool(1);
+    pool.setCapacity(1, ghoul::ThreadPool::OverflowPolicy::Block);
+
+    std::atomic_int nExecuted(0);
+    std::future<void> f = pool.queue([&pool, &nExecuted]() {
+        for (int i = 0; i < 10; ++i) {
+            pool.post([&nExecuted]() { ++nExecuted; });
+        }
+    });
+    f.get();
+    pool.stop();
+    EXPECT_EQ(10, nExecuted);
+}
+
+TEST_F(ThreadPoolTest, QueueAfter) {
+    using Clock = std::chrono::steady_clock;
+
+    ghoul::ThreadPool pool(2);
+    const Clock::time_point start = Clock::now();
+    std::future<Clock::time_point> late = pool.queueAfter(
+        std::chrono::milliseconds(50),
+        []() { return Clock::now(); }
+    );
+    std::future<int> early = pool.queueAfter(
+        ghoul::ThreadPool::Priority::High,
+        std::chrono::milliseconds(10),
+        [](int i) { return i; },
+        5
+    );
+
+    EXPECT_EQ(5, early.get());
+    EXPECT_EQ(std::future_status::timeout, late.wait_for(std::chrono::seconds(0)));
+    EXPECT_LE(std::chrono::milliseconds(50), late.get() - start);
+}
+
+TEST_F(ThreadPoolTest, QueueAfterDiscarded) {
+    std::future<int> f;
+    {
+        ghoul::ThreadPool pool(1);
+        f = pool.queueAfter(std::chrono::hours(1), []() { return 1; });
+    }
+    EXPECT_THROW(f.get(), std::future_error);
+}
+
+TEST_F(ThreadPoolTest, QueueAfterFullPool) {
+    using OverflowPolicy = ghoul::ThreadPool::OverflowPolicy;
+    for (OverflowPolicy policy : { OverflowPolicy::Block, OverflowPolicy::CallerRuns }) {
+        ghoul::ThreadPool pool(1);
+
+        std::promise<void> started;
+        std::promise<void> release;
+        std::shared_future<void> released = release.get_future().share();
+        std::atomic_bool isReleased(false);
+        std::future<void> blocker = pool.queue([&started, released]() {
+            started.set_value();
+            released.wait();
+        });
+        started.get_future().wait();
+        pool.setCapacity(1, policy);
+        std::future<int> waiting = pool.queue([]() { return 1; });
+
+        // The timer thread neither blocks on the full queue, which would delay the
+        // second timer, nor runs the tasks itself
+        std::future<bool> first = pool.queueAfter(
+            std::chrono::milliseconds(1),
+            [&isReleased]() { return isReleased.load(); }
+        );
+        std::future<bool> second = pool.queueAfter(
+            std::chrono::milliseconds(2),
+            [&isReleased]() { return isReleased.load(); }
+        );
+        const auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (pool.remainingTasks() < 3 && std::chrono::steady_clock::now() < timeout) {
+            threadSleep(std::chrono::milliseconds(1));
+        }
+        EXPECT_EQ(3, pool.remainingTasks());
+
+        isReleased = true;
+        release.set_value();
+        blocker.get();
+        EXPECT_EQ(1, waiting.get());
+        EXPECT_TRUE(first.get());
+        EXPECT_TRUE(second.get());
+    }
+}
+
+TEST_F(ThreadPoolTest, QueueEvery) {
+    ghoul::ThreadPool pool(2);
+
+    std::atomic_int nExecuted(0);
+    ghoul::CancellationToken token = pool.queueEvery(
+        std::chrono::milliseconds(5),
+        [&nExecuted]() { ++nExecuted; }
+    );
+
+    const auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (nExecuted < 5 && std::chrono::steady_clock::now() < timeout) {
+        threadSleep(std::chrono::milliseconds(1));
+    }
+    EXPECT_LE(5, nExecuted);
+
+    token.cancel();
+    // An execution that was queued before the cancellation might still finish
+    threadSleep(SchedulingWaitTime);
+    const int nFinal = nExecuted;
+    threadSleep(SchedulingWaitTime);
+    EXPECT_EQ(nFinal, nExecuted);
+}
+
+TEST_F(ThreadPoolTest, QueueEverySkipsWhileBusy) {
+    ghoul::ThreadPool pool(2);
+
+    std::atomic_int nRunning(0);
+    std::atomic_int nMaxRunning(0);
+    std::atomic_int nExecuted(0);
+    ghoul::CancellationToken token = pool.queueEvery(
+        std::chrono::milliseconds(1),
+        [&]() {
+            const int n = ++nRunning;
+            nMaxRunning = std::max(nMaxRunning.load(), n);
+            threadSleep(std::chrono::milliseconds(10));
+            --nRunning;
+            ++nExecuted;
+        }
+    );
+
+    threadSleep(std::chrono::milliseconds(100));
+    token.cancel();
+    pool.stop();
+
+    // The executions never overlap, even though the period is shorter than the runtime
+    EXPECT_EQ(1, nMaxRunning);
+    EXPECT_LE(1, nExecuted);
+    EXPECT_GE(11, nExecuted);
+}
+
+TEST_F(ThreadPoolTest, WorkerLocal) {
+    struct Counter {
+        Counter(std::atomic_int& s) : sum(&s) {}
+        Counter(Counter&& other) : sum(other.sum), value(other.value) {
+            other.sum = nullptr;
+        }
+        ~Counter() {
+            if (sum) {
+                *sum += value;
+            }
+        }
+        std::atomic_int* sum;
+        int value = 0;
+    };
+
+    std::atomic_int nCreated(0);
+    std::atomic_int sum(0);
+    ghoul::ThreadPool pool(4);
+    for (int i = 0; i < 200; ++i) {
+        pool.queue([&]() {
+            Counter& c = ghoul::ThreadPool::workerLocal<Counter>([&]() {
+                ++nCreated;
+                return Counter(sum);
+            });
+            ++c.value;
+        });
+    }
+    pool.stop();
+
+    // Each Worker creates at most one object, which is destroyed when the Worker ends
+    EXPECT_LE(1, nCreated);
+    EXPECT_GE(4, nCreated);
+    EXPECT_EQ(200, sum);
+}
+
+TEST_F(ThreadPoolTest, WorkerLocalTypes) {
+    struct Tag {
+        int value = 0;
+    };
+
+    ghoul::ThreadPool pool(1);
+    std::future<bool> f = pool.queue([]() {
+        ghoul::ThreadPool::workerLocal<int>() = 1;
+        ghoul::ThreadPool::workerLocal<Tag>().value = 2;
+        std::string& s = ghoul::ThreadPool::workerLocal<std::string>(
+            []() { return "abc"; }
+        );
+        // The factory is not called again for an existing object
+        std::string& t = ghoul::ThreadPool::workerLocal<std::string>(
+            []() { return "def"; }
+        );
+        return &s == &t && s == "abc";
+    });
+    EXPECT_TRUE(f.get());
+
+    std::future<int> g = pool.queue([]() {
+        return ghoul::ThreadPool::workerLocal<int>() +
+            ghoul::ThreadPool::workerLocal<Tag>().value;
+    });
+    EXPECT_EQ(3, g.get());
+}
+
+TEST_F(ThreadPoolTest, WorkerLocalDestroyedBeforeDeinitialization) {
+    struct Resource {
+        Resource(std::atomic_int& n) : nAlive(&n) { ++*nAlive; }
+        ~Resource() { --*nAlive; }
+        std::atomic_int* nAlive;
+    };
+
+    std::atomic_int nAlive(0);
+    std::atomic_int nAliveAtDeinitialization(-1);
+    ghoul::ThreadPool pool(
+        1,
+        []() {},
+        [&]() { nAliveAtDeinitialization = nAlive.load(); }
+    );
+    pool.queue([&]() {
+        ghoul::ThreadPool::workerLocal<std::unique_ptr<Resource>>(
+            [&]() { return std::make_unique<Resource>(nAlive); }
+        );
+    }).get();
+    EXPECT_EQ(1, nAlive);
+
+    pool.stop();
+    EXPECT_EQ(0, nAliveAtDeinitialization);
+    EXPECT_EQ(0, nAlive);
+}
@@ -0,0 +1,117 @@
+/*****************************************************************************************
+ *                                                                                       *
+ * GHOUL                                                                                 *
+ * General Helpful Open Utility Library                                                  *
+ *                                                                                       *
+ * Copyright (c) 2012-2016                                                               *
+ *                                                                                       *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this  *
+ * software and associated documentation files (the "Software"), to deal in the Software *
+ * without restriction, including without limitation the rights to use, copy, modify,    *
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to    *
+ * permit persons to whom the Software is furnished to do so, subject to the following   *
+ * conditions:                                                                           *
+ *                                                                                       *
+ * The above copyright notice and this permission notice shall be included in all copies *
+ * or substantial portions of the Software.                                              *
+ *                                                                                       *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,   *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A         *
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT    *
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF  *
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE  *
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ ****************************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include <ghoul/misc/timerwheel.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+class TimerWheelTest : public testing::Test {
+protected:
+    using Clock = ghoul::TimerWheel::Clock;
+    using ms = std::chrono::milliseconds;
+
+    // A fixed start makes the tests independent of the actual clock
+    const Clock::time_point Start = Clock::time_point() + std::chrono::hours(1);
+};
+
+TEST_F(TimerWheelTest, Empty) {
+    ghoul::TimerWheel wheel(ms(1), Start);
+    EXPECT_TRUE(wheel.isEmpty());
+    EXPECT_EQ(0, wheel.size());
+    EXPECT_EQ(Clock::time_point::max(), wheel.nextExpiration());
+    EXPECT_TRUE(wheel.advance(Start + std::chrono::hours(10)).empty());
+}
+
+TEST_F(TimerWheelTest, NeverEarly) {
+    ghoul::TimerWheel wheel(ms(1), Start);
+    bool hasExpired = false;
+    wheel.add(Start + ms(10) + std::chrono::microseconds(500), [&]() {
+        hasExpired = true;
+    });
+    EXPECT_EQ(1, wheel.size());
+
+    // The expiration is rounded up to the next tick
+    EXPECT_TRUE(wheel.advance(Start + ms(10)).empty());
+    EXPECT_EQ(Start + ms(11), wheel.nextExpiration());
+    EXPECT_TRUE(wheel.advance(Start + ms(11) - std::chrono::nanoseconds(1)).empty());
+
+    std::vector<ghoul::TimerWheel::Callback> expired = wheel.advance(Start + ms(11));
+    ASSERT_EQ(1, expired.size());
+    expired[0]();
+    EXPECT_TRUE(hasExpired);
+    EXPECT_TRUE(wheel.isEmpty());
+}
+
+TEST_F(TimerWheelTest, PastExpiration) {
+    ghoul::TimerWheel wheel(ms(1), Start);
+    EXPECT_TRUE(wheel.advance(Start + ms(100)).empty());
+
+    // A timer in the past expires with the next tick
+    wheel.add(Start + ms(5), []() {});
+    EXPECT_TRUE(wheel.advance(Start + ms(100)).empty());
+    EXPECT_EQ(1, wheel.advance(Start + ms(101)).size());
+}
+
+TEST_F(TimerWheelTest, AllLevels) {
+    ghoul::TimerWheel wheel(ms(1), Start);
+
+    // Expirations in every level, at the level boundaries and in the overflow list
+    std::vector<int64_t> ticks = {
+        1, 2, 63, 64, 65, 127, 128, 4095, 4096, 4097, 100000, 262143, 262144,
+        16777215, 16777216, 16777217, 20000000
+    };
+    std::mt19937 gen(1337);
+    std::uniform_int_distribution<int64_t> dist(1, 20000000);
+    for (int i = 0; i < 1000; ++i) {
+        ticks.push_back(dist(gen));
+    }
+
+    std::vector<int64_t> expiredAt;
+    int64_t now = 0;
+    for (int64_t t : ticks) {
+        wheel.add(Start + ms(t), [&expiredAt, &now, t]() {
+            // Every timer has to expire exactly at its tick
+            EXPECT_EQ(t, now);
+            expiredAt.push_back(t);
+        });
+    }
+    EXPECT_EQ(static_cast<int>(ticks.size()), wheel.size());
+
+    while (!wheel.isEmpty()) {
+        const Clock::time_point next = wheel.nextExpiration();
+        ASSERT_NE(Clock::time_point::max(), next);
+        now = std::chrono::duration_cast<ms>(next - Start).count();
+        for (ghoul::TimerWheel::Callback& c : wheel.advance(next)) {
+            c();
+        }
+    }
+
+    EXPECT_EQ(ticks.size(), expiredAt.size());
+    EXPECT_TRUE(std::is_sorted(expiredAt.begin(), expiredAt.end()));
+}